@@ -6,6 +6,10 @@ namespace dorado::alignment {
 
 bool BedFileAccess::load_bedfile(const std::string& bedfile) {
     std::lock_guard guard(m_mutex);
+    if (m_bedfile_lut.count(bedfile) != 0) {
+        // Already loaded, and indexed, for another client.
+        return true;
+    }
     auto bed = std::make_shared<BedFile>();
     if (!bed->load(bedfile)) {
         return false;
@@ -14,6 +14,8 @@ class BedFileAccess {
     std::map<std::string, std::shared_ptr<BedFile>> m_bedfile_lut;
 
 public:
+    // Loads and indexes the bed-file, unless it is already loaded, in which case all clients
+    // share the one copy.
     bool load_bedfile(const std::string& bedfile);
 
     // Returns the bed-file if already loaded. Empty pointer otherwise.
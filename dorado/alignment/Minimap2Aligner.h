@@ -6,6 +6,7 @@
 #include <minimap.h>
 
 #include <memory>
+#include <string>
 #include <vector>
 
 namespace dorado::alignment {
@@ -24,6 +25,9 @@ public:
                const std::string& alignment_header,
                mm_tbuf_t* buf);
     std::tuple<mm_reg1_t*, int> get_mapping(bam1_t* record, mm_tbuf_t* buf);
+    std::tuple<mm_reg1_t*, int> get_mapping(const std::string& qname,
+                                            const std::string& seq,
+                                            mm_tbuf_t* buf);
 
     HeaderSequenceRecords get_sequence_records_for_header() const;
 
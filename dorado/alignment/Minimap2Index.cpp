@@ -85,16 +85,26 @@ IndexLoadResult Minimap2Index::load_next_chunk(int num_threads) {
         return IndexLoadResult::no_index_loaded;
     }
 
-    std::shared_ptr<const mm_idx_t> next_idx(mm_idx_reader_read(m_index_reader.get(), num_threads),
-                                             IndexDeleter());
+    auto next_idx = read_next_chunk(num_threads);
     if (!next_idx) {
         return IndexLoadResult::end_of_index;
     }
 
-    set_index(std::move(next_idx));
+    use_chunk(std::move(next_idx));
+    return IndexLoadResult::success;
+}
 
+std::shared_ptr<const mm_idx_t> Minimap2Index::read_next_chunk(int num_threads) {
+    if (!m_index_reader) {
+        return nullptr;
+    }
+    return std::shared_ptr<const mm_idx_t>(mm_idx_reader_read(m_index_reader.get(), num_threads),
+                                           IndexDeleter());
+}
+
+void Minimap2Index::use_chunk(std::shared_ptr<const mm_idx_t> chunk) {
+    set_index(std::move(chunk));
     spdlog::debug("Loaded next index chunk with {} target seqs", m_index->n_seq);
-    return IndexLoadResult::success;
 }
 
 bool Minimap2Index::initialise(Minimap2Options options) {
@@ -33,6 +33,13 @@ public:
     IndexLoadResult load(const std::string& index_file, int num_threads, bool allow_split_index);
     IndexLoadResult load_next_chunk(int num_threads);
 
+    // The two halves of load_next_chunk(), so that the next chunk of a split index can be read
+    // while the current one is still in use.  read_next_chunk() leaves the current index as it
+    // is, and returns nullptr if there are no more chunks.  use_chunk() makes a chunk returned
+    // by read_next_chunk() the current index, and must not be called while it is being mapped.
+    std::shared_ptr<const mm_idx_t> read_next_chunk(int num_threads);
+    void use_chunk(std::shared_ptr<const mm_idx_t> chunk);
+
     // Returns a shallow copy of this MinimapIndex with the given mapping options applied.
     // By contract the given indexing options must be identical to those held in this instance
     // and the underlying index must be loaded.
@@ -5,6 +5,7 @@
 
 #include <spdlog/spdlog.h>
 
+#include <algorithm>
 #include <fstream>
 #include <iomanip>
 #include <optional>
@@ -245,9 +246,115 @@ bool BedFile::load(std::istream& input_stream) {
         return false;
     }
 
+    for (const auto& [genome, entries] : m_genomes) {
+        m_indices[genome] = build_index(entries);
+    }
     return true;
 }
 
+BedFile::IntervalIndex BedFile::build_index(const Entries& entries) {
+    IntervalIndex index;
+    auto& nodes = index.nodes;
+    const size_t num_nodes = entries.size();
+    nodes.reserve(num_nodes);
+    for (size_t i = 0; i < num_nodes; ++i) {
+        nodes.push_back({entries[i].start, entries[i].end, entries[i].end, i});
+    }
+    std::sort(nodes.begin(), nodes.end(), [](const auto& l, const auto& r) {
+        return std::tie(l.start, l.entry_idx) < std::tie(r.start, r.entry_idx);
+    });
+    if (num_nodes == 0) {
+        return index;
+    }
+
+    // Leaves are the even indices, and the nodes of level k are those whose lowest set bit is
+    // bit k.  The last node of the tree may have a missing right subtree, in which case the
+    // greatest end of the nodes to its right stands in for it.
+    size_t last_i = 0;
+    size_t last_max_end = 0;
+    for (size_t i = 0; i < num_nodes; i += 2) {
+        last_i = i;
+        last_max_end = nodes[i].max_end;
+    }
+    int level = 1;
+    for (; (size_t{1} << level) <= num_nodes; ++level) {
+        const size_t half_width = size_t{1} << (level - 1);
+        for (size_t i = (half_width << 1) - 1; i < num_nodes; i += half_width << 2) {
+            const size_t left_max_end = nodes[i - half_width].max_end;
+            const size_t right_max_end =
+                    i + half_width < num_nodes ? nodes[i + half_width].max_end : last_max_end;
+            nodes[i].max_end = std::max({nodes[i].end, left_max_end, right_max_end});
+        }
+        last_i = ((last_i >> level) & 1) ? last_i - half_width : last_i + half_width;
+        if (last_i < num_nodes) {
+            last_max_end = std::max(last_max_end, nodes[last_i].max_end);
+        }
+    }
+    index.max_level = level - 1;
+    return index;
+}
+
+std::vector<const BedFile::Entry*> BedFile::overlapping_entries(const std::string& genome,
+                                                                size_t first,
+                                                                size_t last) const {
+    std::vector<const Entry*> hits;
+    auto index_it = m_indices.find(genome);
+    if (index_it == m_indices.end() || index_it->second.max_level < 0) {
+        return hits;
+    }
+    const auto& nodes = index_it->second.nodes;
+    const auto& entries = m_genomes.at(genome);
+    const size_t num_nodes = nodes.size();
+
+    std::vector<size_t> hit_indices;
+    auto check_node = [&](size_t i) {
+        if (nodes[i].end >= first) {
+            hit_indices.push_back(nodes[i].entry_idx);
+        }
+    };
+
+    // Subtrees at or below this level are scanned linearly rather than descended into.
+    constexpr int LINEAR_SCAN_LEVEL = 3;
+    struct StackItem {
+        size_t i;
+        int level;
+        bool left_done;
+    };
+    std::vector<StackItem> stack;
+    const int max_level = index_it->second.max_level;
+    stack.push_back({(size_t{1} << max_level) - 1, max_level, false});
+    while (!stack.empty()) {
+        const auto item = stack.back();
+        stack.pop_back();
+        if (item.level <= LINEAR_SCAN_LEVEL) {
+            const size_t begin = item.i >> item.level << item.level;
+            const size_t end = std::min(begin + (size_t{2} << item.level) - 1, num_nodes);
+            for (size_t i = begin; i < end && nodes[i].start <= last; ++i) {
+                check_node(i);
+            }
+        } else if (!item.left_done) {
+            // Visit the left subtree, if it may hold overlaps, before this node.
+            const size_t left = item.i - (size_t{1} << (item.level - 1));
+            stack.push_back({item.i, item.level, true});
+            if (left >= num_nodes || nodes[left].max_end >= first) {
+                stack.push_back({left, item.level - 1, false});
+            }
+        } else if (item.i < num_nodes && nodes[item.i].start <= last) {
+            // The right subtree starts no earlier than this node, so is only worth visiting if
+            // this node starts within the interval.
+            check_node(item.i);
+            stack.push_back({item.i + (size_t{1} << (item.level - 1)), item.level - 1, false});
+        }
+    }
+
+    std::sort(hit_indices.begin(), hit_indices.end());
+    hits.reserve(hit_indices.size());
+    for (const size_t entry_idx : hit_indices) {
+        hits.push_back(&entries[entry_idx]);
+    }
+    return hits;
+}
+
 const BedFile::Entries& BedFile::entries(const std::string& genome) const {
     auto it = m_genomes.find(genome);
     return it != m_genomes.end() ? it->second : NO_ENTRIES;
@@ -29,10 +29,34 @@ public:
 
     const Entries& entries(const std::string& genome) const;
 
+    // Returns the entries for the genome which overlap the closed interval [first, last], in the
+    // order they appear in the file.  An entry [start, end] overlaps if start <= last and
+    // end >= first.  Uses an interval index built at load time, so takes O(log n + hits).
+    std::vector<const Entry*> overlapping_entries(const std::string& genome,
+                                                  size_t first,
+                                                  size_t last) const;
+
     const std::string& filename() const;
 
 private:
+    // Implicit augmented interval tree over a genome's entries, as in cgranges: the nodes are
+    // sorted by start, the tree is the complete binary tree implied by their indices, and each
+    // node holds the greatest end in its subtree.
+    struct IntervalIndex {
+        struct Node {
+            size_t start;
+            size_t end;
+            size_t max_end;
+            size_t entry_idx;
+        };
+        std::vector<Node> nodes;
+        int max_level{-1};
+    };
+
+    static IntervalIndex build_index(const Entries& entries);
+
     std::map<std::string, Entries> m_genomes;
+    std::map<std::string, IntervalIndex> m_indices;
     std::string m_file_name{"<stream>"};
     static const Entries NO_ENTRIES;
 };
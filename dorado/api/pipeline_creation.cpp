@@ -11,6 +11,7 @@
 #include "read_pipeline/StereoDuplexEncoderNode.h"
 #include "splitter/DuplexReadSplitter.h"
 #include "splitter/RNAReadSplitter.h"
+#include "utils/overlap_engine.h"
 
 #include <spdlog/spdlog.h>
 
@@ -125,11 +126,15 @@ void create_stereo_duplex_pipeline(PipelineDescriptor& pipeline_desc,
             {}, std::move(stereo_runners), stereo_model_config.basecaller.overlap(), duplex_rg_name,
             1000, "StereoBasecallerNode", mean_qscore_start_pos);
 
+    // Shared by pairing and modbase calling, so that modbase calling can reuse the
+    // minimap2 indices built for the template reads during pairing.
+    auto overlap_engine = std::make_shared<utils::OverlapEngine>();
+
     NodeHandle last_node_handle = stereo_basecaller_node;
     if (!modbase_runners.empty()) {
         auto mod_base_caller_node = pipeline_desc.add_node<ModBaseCallerNode>(
                 {}, std::move(modbase_runners), modbase_node_threads, size_t(model_config.stride),
-                1000);
+                1000, overlap_engine);
         pipeline_desc.add_node_sink(stereo_basecaller_node, mod_base_caller_node);
         last_node_handle = mod_base_caller_node;
     }
@@ -141,12 +146,12 @@ void create_stereo_duplex_pipeline(PipelineDescriptor& pipeline_desc,
             std::holds_alternative<DuplexPairingParameters>(pairing_parameters)
                     ? pipeline_desc.add_node<PairingNode>(
                               {stereo_node}, std::get<DuplexPairingParameters>(pairing_parameters),
-                              std::thread::hardware_concurrency(), 1000)
+                              std::thread::hardware_concurrency(), 1000, overlap_engine)
                     : pipeline_desc.add_node<PairingNode>(
                               {stereo_node},
                               std::move(std::get<std::map<std::string, std::string>>(
                                       pairing_parameters)),
-                              2, 1000);
+                              2, 1000, overlap_engine);
 
     // Create a duplex split node with the given settings and number of devices.
     // If splitter_settings.enabled is set to false, the splitter node will act
@@ -16,6 +16,7 @@
 #include <cxxpool.h>
 #include <spdlog/spdlog.h>
 
+#include <algorithm>
 #include <thread>
 
 namespace dorado::api {
@@ -39,9 +40,13 @@ std::pair<std::vector<basecall::RunnerPtr>, size_t> create_basecall_runners(
                                                                    params.memory_limit_fraction);
         }
         spdlog::debug("- CPU calling: set num_cpu_runners to {}", num_cpu_runners);
+        // Each runner calls its model on one thread, and waits on the shared decode pool while
+        // its chunks are decoded, so each decodes on its share of the cores.
+        const size_t num_decode_threads =
+                std::max(size_t{std::thread::hardware_concurrency()} / num_cpu_runners, size_t{1});
         for (size_t i = 0; i < num_cpu_runners; i++) {
-            runners.push_back(
-                    std::make_unique<basecall::ModelRunner>(params.model_config, params.device));
+            runners.push_back(std::make_unique<basecall::ModelRunner>(
+                    params.model_config, params.device, num_decode_threads));
         }
         if (runners.back()->batch_size() != (size_t)params.model_config.basecaller.batch_size()) {
             spdlog::debug("- CPU calling: set batch_size to {}", runners.back()->batch_size());
@@ -6,9 +6,11 @@
 
 namespace dorado::basecall {
 
-ModelRunner::ModelRunner(const CRFModelConfig &model_config, const std::string &device)
+ModelRunner::ModelRunner(const CRFModelConfig &model_config,
+                         const std::string &device,
+                         size_t num_decode_threads)
         : m_config(model_config),
-          m_decoder(decode::create_decoder(device, model_config)),
+          m_decoder(decode::create_decoder(device, model_config, num_decode_threads)),
           // TODO: m_options.dtype() depends on the device as TxModel uses kHalf in cuda which is not supported on CPU
           m_options(at::TensorOptions().dtype(m_decoder->dtype()).device(device)),
           m_module(load_crf_model(model_config, m_options)) {
@@ -14,7 +14,10 @@ namespace dorado::basecall {
 
 class ModelRunner final : public ModelRunnerBase {
 public:
-    ModelRunner(const CRFModelConfig &model_config, const std::string &device);
+    // num_decode_threads is the most threads CPU decoding may use at once for this runner.
+    ModelRunner(const CRFModelConfig &model_config,
+                const std::string &device,
+                size_t num_decode_threads = 1);
     void accept_chunk(int chunk_idx, const at::Tensor &chunk) final;
     std::vector<decode::DecodedChunk> call_chunks(int num_chunks) final;
     const CRFModelConfig &config() const final { return m_config; };
@@ -1,98 +1,109 @@
 #include "CPUDecoder.h"
 
 #include "beam_search.h"
+#include "crf_scan.h"
+#include "utils/concurrency/synchronisation.h"
 
 #include <ATen/Functions.h>
 #include <ATen/TensorIndexing.h>
 #include <ATen/TensorOperators.h>
-#include <math.h>
 #include <spdlog/spdlog.h>
 
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
 #include <vector>
 
 namespace {
 
-// Operates in TNC
-at::Tensor scan(const at::Tensor& Ms,
-                const float fixed_stay_score,
-                const at::Tensor& idx,
-                const at::Tensor& v0) {
-    const int T = int(Ms.size(0));
-    const int N = int(Ms.size(1));
-    const int C = int(Ms.size(2));
-
-    at::Tensor alpha = Ms.new_full({T + 1, N, C}, -1E38);
-    alpha[0] = v0;
-
-    for (int t = 0; t < T; t++) {
-        auto scored_steps = at::add(alpha.index({t, at::indexing::Slice(), idx}), Ms[t]);
-        auto scored_stay =
-                at::add(alpha.index({t, at::indexing::Slice()}), fixed_stay_score).unsqueeze(-1);
-        auto scored_transitions = at::cat({scored_stay, scored_steps}, -1);
-
-        alpha[t + 1] = at::logsumexp(scored_transitions, -1);
-    }
-
-    return alpha;
-}
-}  // namespace
+struct ScanShape {
+    int num_timesteps;
+    int num_batches;
+    int num_states;
+};
 
-namespace dorado::basecall::decode::inner {
-
-at::Tensor forward_scores(const at::Tensor& scores_TNC, const float fixed_stay_score) {
+ScanShape get_scan_shape(const at::Tensor& scores_TNC) {
     const int T = int(scores_TNC.size(0));  // Signal len
     const int N = int(scores_TNC.size(1));  // Num batches
     const int C = int(scores_TNC.size(2));  // 4^state_len * 4 = 4^(state_len + 1)
 
-    const int n_base = 4;
-    const int state_len = int(std::log(C) / std::log(n_base) - 1);
-
-    // Transition scores reshaped so that the 4 scores for each predecessor state are arranged along the
-    // innermost dimension.
-    const at::Tensor Ms = scores_TNC.reshape({T, N, -1, n_base});
+    // Number of states per timestep, with 4 transition scores into each state.
+    return {T, N, C / 4};
+}
 
-    // Number of states per timestep.
-    const int num_states = int(pow(n_base, state_len));
+// The scan kernels need each timestep's scores to be contiguous.
+at::Tensor prepare_scan_scores(const at::Tensor& scores_TNC) {
+    auto scores = scores_TNC.to(at::kFloat);
+    if (scores.stride(2) != 1) {
+        scores = scores.contiguous();
+    }
+    return scores;
+}
 
-    // Guide values at first timestep.
-    const auto v0 = Ms.new_full({{N, num_states}}, 0.0f);
+}  // namespace
 
-    // For each state, the indices of the 4 states that could precede it via a step transition.
-    const auto idx =
-            at::arange(num_states).repeat_interleave(n_base).reshape({n_base, -1}).t().contiguous();
+namespace dorado::basecall::decode::inner {
 
-    return scan(Ms, fixed_stay_score, idx, v0);
+at::Tensor forward_scores(const at::Tensor& scores_TNC, const float fixed_stay_score) {
+    const auto [T, N, num_states] = get_scan_shape(scores_TNC);
+    const auto scores = prepare_scan_scores(scores_TNC);
+
+    auto alpha = at::empty({T + 1, N, num_states}, scores.options());
+    const float* const scores_ptr = scores.data_ptr<float>();
+    float* const alpha_ptr = alpha.data_ptr<float>();
+    for (int n = 0; n < N; ++n) {
+        forward_scan(scores_ptr + n * scores.stride(1), scores.stride(0),
+                     alpha_ptr + n * num_states, N * num_states, T, num_states, fixed_stay_score);
+    }
+    return alpha;
 }
 
 at::Tensor backward_scores(const at::Tensor& scores_TNC, const float fixed_stay_score) {
-    const int N = int(scores_TNC.size(1));  // Num batches
-    const int C = int(scores_TNC.size(2));  // 4^state_len * 4 = 4^(state_len + 1)
-
-    const int n_base = 4;
-
-    const int state_len = int(std::log(C) / std::log(n_base) - 1);
-
-    // Number of states per timestep.
-    const int num_states = int(pow(n_base, state_len));
-
-    // Guide values at last timestep.
-    const at::Tensor vT = scores_TNC.new_full({N, num_states}, 0.0f);
+    const auto [T, N, num_states] = get_scan_shape(scores_TNC);
+    const auto scores = prepare_scan_scores(scores_TNC);
+
+    auto beta = at::empty({T + 1, N, num_states}, scores.options());
+    const float* const scores_ptr = scores.data_ptr<float>();
+    float* const beta_ptr = beta.data_ptr<float>();
+    for (int n = 0; n < N; ++n) {
+        backward_scan(scores_ptr + n * scores.stride(1), scores.stride(0),
+                      beta_ptr + n * num_states, N * num_states, T, num_states, fixed_stay_score);
+    }
+    return beta;
+}
 
-    const auto idx =
-            at::arange(num_states).repeat_interleave(n_base).reshape({n_base, -1}).t().contiguous();
-    auto idx_T = idx.flatten().argsort().reshape(idx.sizes());
+}  // namespace dorado::basecall::decode::inner
 
-    const auto Ms_T = scores_TNC.index({at::indexing::Slice(), at::indexing::Slice(), idx_T});
+namespace dorado::basecall::decode {
 
-    // For each state, the indices of the 4 states that could succeed it via a step transition.
-    idx_T = at::bitwise_right_shift(idx_T, 2);
+namespace {
 
-    return scan(Ms_T.flip(0), fixed_stay_score, idx_T.to(at::kLong), vT).flip(0);
+std::shared_ptr<utils::concurrency::MultiQueueThreadPool> get_decode_thread_pool() {
+    // The pool lives for as long as any decoder is using it.
+    static std::mutex mutex;
+    static std::weak_ptr<utils::concurrency::MultiQueueThreadPool> weak_pool;
+
+    std::lock_guard lock(mutex);
+    auto pool = weak_pool.lock();
+    if (!pool) {
+        const size_t num_threads = std::max(std::thread::hardware_concurrency(), 1u);
+        pool = std::make_shared<utils::concurrency::MultiQueueThreadPool>(num_threads,
+                                                                          "cpu_decode");
+        weak_pool = pool;
+    }
+    return pool;
 }
 
-}  // namespace dorado::basecall::decode::inner
+}  // namespace
 
-namespace dorado::basecall::decode {
+CPUDecoder::CPUDecoder(size_t num_threads)
+        : m_num_threads(std::max(num_threads, size_t{1})),
+          m_thread_pool(get_decode_thread_pool()),
+          m_task_queue(m_thread_pool->create_task_queue(utils::concurrency::TaskPriority::normal)) {
+}
 
 DecodeData CPUDecoder::beam_search_part_1(DecodeData data) const { return data; }
 
@@ -101,54 +112,51 @@ std::vector<DecodedChunk> CPUDecoder::beam_search_part_2(DecodeData data) const
     const auto scores_cpu = data.data.to(at::kCPU);
     const auto num_chunks = data.num_chunks;
     const auto& options = data.options;
-    int num_threads = std::min(num_chunks, 4);
-    int chunks_per_thread = num_chunks / num_threads;
-    int num_threads_with_one_more_chunk = num_chunks % num_threads;
 
     std::vector<DecodedChunk> chunk_results(num_chunks);
+    std::vector<std::exception_ptr> chunk_errors(num_chunks);
 
-    std::vector<std::thread> threads;
-    threads.reserve(num_threads);
-    for (int i = 0; i < num_threads; ++i) {
-        threads.emplace_back([&, i]() {
-            at::InferenceMode inference_mode_guard;
+    // Each task takes the next chunk until there are none left, so that this decoder uses at
+    // most m_num_threads of the pool's threads.
+    std::atomic<int> next_chunk_idx{0};
+    const size_t num_tasks = std::min(m_num_threads, size_t(std::max(num_chunks, 0)));
+    utils::concurrency::Latch tasks_remaining(num_tasks);
 
-            int t_first_chunk =
-                    i * chunks_per_thread + std::min(i, num_threads_with_one_more_chunk);
-            int t_num_chunks = chunks_per_thread + int(i < num_threads_with_one_more_chunk);
-
-            // Slice TNC -> TnC
-            using Slice = at::indexing::Slice;
-            auto t_scores =
-                    scores_cpu.index({Slice(), Slice(t_first_chunk, t_first_chunk + t_num_chunks)});
-
-            at::Tensor fwd = inner::forward_scores(t_scores, options.blank_score);
-            at::Tensor bwd = inner::backward_scores(t_scores, options.blank_score);
-
-            at::Tensor posts = at::softmax(fwd + bwd, -1);
-
-            // Transpose TnC to nTC
-            t_scores = t_scores.transpose(0, 1);
-            bwd = bwd.transpose(0, 1).contiguous();
-            posts = posts.transpose(0, 1).contiguous();
-
-            // Iter over n in nTC, passing TC tensors to beam_search_decode
-            for (int chunk_idx = 0; chunk_idx < t_num_chunks; chunk_idx++) {
-                auto decode_result = beam_search_decode(t_scores[chunk_idx], bwd[chunk_idx],
-                                                        posts[chunk_idx], options.beam_width,
-                                                        options.beam_cut, options.blank_score,
-                                                        options.q_shift, options.q_scale, 1.0f);
-                chunk_results[t_first_chunk + chunk_idx] = DecodedChunk{
-                        std::get<0>(decode_result),
-                        std::get<1>(decode_result),
-                        std::get<2>(decode_result),
-                };
+    for (size_t task_idx = 0; task_idx < num_tasks; ++task_idx) {
+        m_task_queue.push([&] {
+            at::InferenceMode inference_mode_guard;
+            for (int chunk_idx = next_chunk_idx++; chunk_idx < num_chunks;
+                 chunk_idx = next_chunk_idx++) {
+                try {
+                    // Slice TNC -> T1C, and decode the TC scores.
+                    const auto chunk_scores = scores_cpu.slice(1, chunk_idx, chunk_idx + 1);
+
+                    const auto fwd = inner::forward_scores(chunk_scores, options.blank_score);
+                    const auto bwd = inner::backward_scores(chunk_scores, options.blank_score);
+                    const auto posts = at::softmax(fwd + bwd, -1);
+
+                    auto decode_result = beam_search_decode(
+                            chunk_scores.select(1, 0), bwd.select(1, 0), posts.select(1, 0),
+                            options.beam_width, options.beam_cut, options.blank_score,
+                            options.q_shift, options.q_scale, 1.0f);
+                    chunk_results[chunk_idx] = DecodedChunk{
+                            std::get<0>(decode_result),
+                            std::get<1>(decode_result),
+                            std::get<2>(decode_result),
+                    };
+                } catch (...) {
+                    chunk_errors[chunk_idx] = std::current_exception();
+                }
             }
+            tasks_remaining.count_down();
         });
     }
+    tasks_remaining.wait();
 
-    for (auto& thread : threads) {
-        thread.join();
+    for (const auto& error : chunk_errors) {
+        if (error) {
+            std::rethrow_exception(error);
+        }
     }
 
     return chunk_results;
@@ -1,9 +1,12 @@
 #pragma once
 
 #include "Decoder.h"
+#include "utils/concurrency/multi_queue_thread_pool.h"
 
 #include <ATen/core/TensorBody.h>
 
+#include <memory>
+
 namespace dorado::basecall::decode {
 
 namespace inner {
@@ -15,10 +18,20 @@ at::Tensor backward_scores(const at::Tensor& scores_TNC, float fixed_stay_score)
 
 class CPUDecoder final : public Decoder {
 public:
+    // num_threads is the most chunks this decoder decodes at once on the shared pool.
+    explicit CPUDecoder(size_t num_threads = 1);
+
     DecodeData beam_search_part_1(DecodeData data) const;
     std::vector<DecodedChunk> beam_search_part_2(DecodeData data) const;
 
     at::ScalarType dtype() const { return at::ScalarType::Float; };
+
+private:
+    // Chunks are decoded on a pool shared by all CPU decoders, with one thread per core.  Each
+    // decoder limits itself to num_threads of them, so that decoders share the cores.
+    const size_t m_num_threads;
+    std::shared_ptr<utils::concurrency::MultiQueueThreadPool> m_thread_pool;
+    utils::concurrency::MultiQueueThreadPool::ThreadPoolQueue& m_task_queue;
 };
 
 }  // namespace dorado::basecall::decode
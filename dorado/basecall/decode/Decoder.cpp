@@ -11,7 +11,9 @@
 
 namespace dorado::basecall::decode {
 
-std::unique_ptr<Decoder> create_decoder(c10::Device device, const CRFModelConfig& config) {
+std::unique_ptr<Decoder> create_decoder(c10::Device device,
+                                        const CRFModelConfig& config,
+                                        size_t num_cpu_threads) {
 #if DORADO_CUDA_BUILD
     if (device.is_cuda()) {
         return std::make_unique<decode::CUDADecoder>(config.clamp ? 5.f : 0.f);
@@ -20,7 +22,7 @@ std::unique_ptr<Decoder> create_decoder(c10::Device device, const CRFModelConfig
     (void)config;  // unused in other build types
 #endif
     if (device.is_cpu()) {
-        return std::make_unique<decode::CPUDecoder>();
+        return std::make_unique<decode::CPUDecoder>(num_cpu_threads);
     }
 
     throw std::runtime_error("Unsupported device type for decoder creation: " + device.str());
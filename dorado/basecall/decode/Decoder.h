@@ -2,6 +2,7 @@
 
 #include <ATen/core/TensorBody.h>
 
+#include <cstddef>
 #include <cstdint>
 #include <memory>
 #include <string>
@@ -44,6 +45,9 @@ public:
     virtual at::ScalarType dtype() const = 0;
 };
 
-std::unique_ptr<Decoder> create_decoder(c10::Device device, const CRFModelConfig& config);
+// num_cpu_threads is the most threads CPU decoding may use at once.
+std::unique_ptr<Decoder> create_decoder(c10::Device device,
+                                        const CRFModelConfig& config,
+                                        size_t num_cpu_threads = 1);
 
 }  // namespace dorado::basecall::decode
@@ -9,7 +9,6 @@
 
 #include <algorithm>
 #include <array>
-#include <bitset>
 #include <cstring>
 #include <iostream>
 #include <limits>
@@ -23,6 +22,9 @@ typedef uint16_t state_t;
 constexpr int NUM_BASE_BITS = 2;
 constexpr int NUM_BASES = 1 << NUM_BASE_BITS;
 
+// Marks the end of a chain in the step hash table.
+constexpr uint16_t NO_STEP = std::numeric_limits<uint16_t>::max();
+
 // This is the data we need to retain for the whole beam
 struct BeamElement {
     state_t state;
@@ -118,6 +120,75 @@ uint32_t crc32c(uint32_t crc, uint32_t new_bits) {
     return crc;
 }
 
+// Returns the number of scores >= cutoff.
+#if ENABLE_AVX2_IMPL
+__attribute__((target("default")))
+#endif
+size_t count_scores_at_least(const float* scores, size_t num_scores, float cutoff) {
+    size_t count = 0;
+    const float* score_ptr = scores;
+#if !ENABLE_NEON_IMPL
+    for (size_t i = num_scores; i; --i) {
+        if (*score_ptr >= cutoff) {
+            ++count;
+        }
+        ++score_ptr;
+    }
+#else
+    uint32x4_t counts_x4_a = vdupq_n_u32(0u);
+    uint32x4_t counts_x4_b = vdupq_n_u32(0u);
+    const float32x4_t cutoff_x4 = vdupq_n_f32(cutoff);
+
+    // 8 fold unrolled version has the small upside that both loads
+    // can be done with a single ldp instruction.
+    const size_t kUnroll = 8;
+    for (size_t i = num_scores / kUnroll; i; --i) {
+        // True comparison sets lane bits to 0xffffffff, or -1 in two's complement,
+        // which we subtract to increment our counts.
+        float32x4_t scores_x4_a = vld1q_f32(score_ptr);
+        uint32x4_t comparisons_x4_a = vcgeq_f32(scores_x4_a, cutoff_x4);
+        counts_x4_a = vsubq_u32(counts_x4_a, comparisons_x4_a);
+
+        float32x4_t scores_x4_b = vld1q_f32(score_ptr + 4);
+        uint32x4_t comparisons_x4_b = vcgeq_f32(scores_x4_b, cutoff_x4);
+        counts_x4_b = vsubq_u32(counts_x4_b, comparisons_x4_b);
+
+        score_ptr += 8;
+    }
+    // Add together the result of 2 horizontal adds.
+    count = vaddvq_u32(counts_x4_a) + vaddvq_u32(counts_x4_b);
+    for (size_t i = num_scores % kUnroll; i; --i) {
+        if (*score_ptr >= cutoff) {
+            ++count;
+        }
+        ++score_ptr;
+    }
+#endif
+    return count;
+}
+
+#if ENABLE_AVX2_IMPL
+__attribute__((target("avx2"))) size_t count_scores_at_least(const float* scores,
+                                                              size_t num_scores,
+                                                              float cutoff) {
+    const __m256 cutoff_x8 = _mm256_set1_ps(cutoff);
+    size_t count = 0;
+    size_t i = 0;
+    for (; i + 8 <= num_scores; i += 8) {
+        // Each true comparison sets the sign bit of its lane, which movemask gathers up.
+        const __m256 comparisons_x8 =
+                _mm256_cmp_ps(_mm256_loadu_ps(scores + i), cutoff_x8, _CMP_GE_OQ);
+        count += __builtin_popcount(_mm256_movemask_ps(comparisons_x8));
+    }
+    for (; i < num_scores; ++i) {
+        if (scores[i] >= cutoff) {
+            ++count;
+        }
+    }
+    return count;
+}
+#endif
+
 }  // anonymous namespace
 
 namespace dorado::basecall::decode {
@@ -162,6 +233,19 @@ float beam_search(const T* const scores,
     std::vector<float> current_scores(max_beam_candidates);
     std::vector<float> prev_scores(max_beam_candidates);
 
+    // Hash table of step candidates, used to find steps that duplicate the sequence of a stay.
+    // Buckets hold the first step with a matching hash, chained in index order through
+    // next_step_with_hash.  Sized to keep the load factor <= 0.5, and allocated once so
+    // that deduplicating each block doesn't allocate.
+    const size_t max_step_candidates = max_beam_width * NUM_BASES;
+    size_t num_step_hash_buckets = 16;
+    while (num_step_hash_buckets < 2 * max_step_candidates) {
+        num_step_hash_buckets *= 2;
+    }
+    const auto step_hash_mask = static_cast<uint32_t>(num_step_hash_buckets - 1);
+    std::vector<uint16_t> step_hash_buckets(num_step_hash_buckets);
+    std::vector<uint16_t> next_step_with_hash(max_step_candidates);
+
     // Find the score an initial element needs in order to make it into the beam
     T beam_init_threshold = std::numeric_limits<T>::lowest();
     if (max_beam_width < num_states) {
@@ -223,13 +307,6 @@ float beam_search(const T* const scores,
 
         float max_score = std::numeric_limits<float>::lowest();
 
-        // Essentially a k=1 Bloom filter, indicating the presence of steps with particular
-        // sequence hashes.  Avoids comparing stay hashes against all possible progenitor
-        // states where none of them has the requisite sequence hash.
-        const uint32_t HASH_PRESENT_BITS = 4096;
-        const uint32_t HASH_PRESENT_MASK = HASH_PRESENT_BITS - 1;
-        std::bitset<HASH_PRESENT_BITS> step_hash_present;  // Default constructor zeros content.
-
         // Generate list of candidate elements for this timestep (block).
         // As we do so, update the maximum score.
         size_t new_elem_count = 0;
@@ -248,8 +325,6 @@ float beam_search(const T* const scores,
                                   static_cast<float>(block_back_scores[new_state]);
                 uint32_t new_hash = crc32c<NUM_BASE_BITS>(previous_element.hash, new_base);
 
-                step_hash_present[new_hash & HASH_PRESENT_MASK] = true;
-
                 // Add new element to the candidate list
                 current_beam_front[new_elem_count] = {new_hash, new_state, (uint8_t)prev_elem_idx,
                                                       false};
@@ -259,6 +334,16 @@ float beam_search(const T* const scores,
             }
         }
 
+        // Index the steps by hash.  Inserting in reverse means each chain is in ascending
+        // step index order.
+        std::fill(step_hash_buckets.begin(), step_hash_buckets.end(), NO_STEP);
+        for (size_t step_elem_idx = new_elem_count; step_elem_idx--;) {
+            const uint32_t hash = current_beam_front[step_elem_idx].hash;
+            auto& bucket = step_hash_buckets[hash & step_hash_mask];
+            next_step_with_hash[step_elem_idx] = bucket;
+            bucket = static_cast<uint16_t>(step_elem_idx);
+        }
+
         for (size_t prev_elem_idx = 0; prev_elem_idx < current_beam_width; ++prev_elem_idx) {
             const auto& previous_element = prev_beam_front[prev_elem_idx];
             // Add the possible stay.
@@ -270,37 +355,34 @@ float beam_search(const T* const scores,
             max_score = std::max(max_score, stay_score);
 
             // Determine whether the path including this stay duplicates another sequence ending in
-            // a step.
-            if (step_hash_present[previous_element.hash & HASH_PRESENT_MASK]) {
-                size_t stay_elem_idx = (current_beam_width << NUM_BASE_BITS) + prev_elem_idx;
-                // latest base is in smallest bits
-                int stay_latest_base = int(previous_element.state & 3);
-
-                // Go through all the possible step extensions that match this destination base with the stay and compare
-                // their hashes, merging if we find any.
-                for (size_t prev_elem_comp_idx = 0; prev_elem_comp_idx < current_beam_width;
-                     prev_elem_comp_idx++) {
-                    size_t step_elem_idx = (prev_elem_comp_idx << NUM_BASE_BITS) | stay_latest_base;
-                    if (current_beam_front[stay_elem_idx].hash ==
-                        current_beam_front[step_elem_idx].hash) {
-                        if (current_scores[stay_elem_idx] > current_scores[step_elem_idx]) {
-                            // Fold the step into the stay
-                            const float folded_score = log_sum_exp(current_scores[stay_elem_idx],
-                                                                   current_scores[step_elem_idx]);
-                            current_scores[stay_elem_idx] = folded_score;
-                            max_score = std::max(max_score, folded_score);
-                            // The step element will end up last, sorted by score
-                            current_scores[step_elem_idx] = std::numeric_limits<float>::lowest();
-                        } else {
-                            // Fold the stay into the step
-                            const float folded_score = log_sum_exp(current_scores[stay_elem_idx],
-                                                                   current_scores[step_elem_idx]);
-                            current_scores[step_elem_idx] = folded_score;
-                            max_score = std::max(max_score, folded_score);
-                            // The stay element will end up last, sorted by score
-                            current_scores[stay_elem_idx] = std::numeric_limits<float>::lowest();
-                        }
-                    }
+            // a step, merging if we find any.  Only steps that match the destination base of the
+            // stay can have the same sequence.
+            const size_t stay_elem_idx = new_elem_count;
+            // latest base is in smallest bits
+            const size_t stay_latest_base = previous_element.state & 3;
+            for (uint16_t step_elem_idx =
+                         step_hash_buckets[previous_element.hash & step_hash_mask];
+                 step_elem_idx != NO_STEP; step_elem_idx = next_step_with_hash[step_elem_idx]) {
+                if ((step_elem_idx & 3) != stay_latest_base ||
+                    current_beam_front[step_elem_idx].hash != previous_element.hash) {
+                    continue;
+                }
+                if (current_scores[stay_elem_idx] > current_scores[step_elem_idx]) {
+                    // Fold the step into the stay
+                    const float folded_score = log_sum_exp(current_scores[stay_elem_idx],
+                                                           current_scores[step_elem_idx]);
+                    current_scores[stay_elem_idx] = folded_score;
+                    max_score = std::max(max_score, folded_score);
+                    // The step element will end up last, sorted by score
+                    current_scores[step_elem_idx] = std::numeric_limits<float>::lowest();
+                } else {
+                    // Fold the stay into the step
+                    const float folded_score = log_sum_exp(current_scores[stay_elem_idx],
+                                                           current_scores[step_elem_idx]);
+                    current_scores[step_elem_idx] = folded_score;
+                    max_score = std::max(max_score, folded_score);
+                    // The stay element will end up last, sorted by score
+                    current_scores[stay_elem_idx] = std::numeric_limits<float>::lowest();
                 }
             }
 
@@ -312,46 +394,7 @@ float beam_search(const T* const scores,
 
         auto get_elem_count = [new_elem_count, &beam_cutoff_score, &current_scores]() {
             // Count the elements which meet the beam cutoff.
-            size_t elem_count = 0;
-            const float* score_ptr = current_scores.data();
-#if !ENABLE_NEON_IMPL
-            for (int i = int(new_elem_count); i; --i) {
-                if (*score_ptr >= beam_cutoff_score) {
-                    ++elem_count;
-                }
-                ++score_ptr;
-            }
-#else
-            uint32x4_t counts_x4_a = vdupq_n_u32(0u);
-            uint32x4_t counts_x4_b = vdupq_n_u32(0u);
-            const float32x4_t cutoff_x4 = vdupq_n_f32(beam_cutoff_score);
-
-            // 8 fold unrolled version has the small upside that both loads
-            // can be done with a single ldp instruction.
-            const int kUnroll = 8;
-            for (int i = int(new_elem_count) / kUnroll; i; --i) {
-                // True comparison sets lane bits to 0xffffffff, or -1 in two's complement,
-                // which we subtract to increment our counts.
-                float32x4_t scores_x4_a = vld1q_f32(score_ptr);
-                uint32x4_t comparisons_x4_a = vcgeq_f32(scores_x4_a, cutoff_x4);
-                counts_x4_a = vsubq_u32(counts_x4_a, comparisons_x4_a);
-
-                float32x4_t scores_x4_b = vld1q_f32(score_ptr + 4);
-                uint32x4_t comparisons_x4_b = vcgeq_f32(scores_x4_b, cutoff_x4);
-                counts_x4_b = vsubq_u32(counts_x4_b, comparisons_x4_b);
-
-                score_ptr += 8;
-            }
-            // Add together the result of 2 horizontal adds.
-            elem_count = vaddvq_u32(counts_x4_a) + vaddvq_u32(counts_x4_b);
-            for (int i = new_elem_count % kUnroll; i; --i) {
-                if (*score_ptr >= beam_cutoff_score) {
-                    ++elem_count;
-                }
-                ++score_ptr;
-            }
-#endif
-            return elem_count;
+            return count_scores_at_least(current_scores.data(), new_elem_count, beam_cutoff_score);
         };
 
         // Count the elements which meet the min score
@@ -0,0 +1,502 @@
+#include "crf_scan.h"
+
+#include "utils/simd.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <iterator>
+
+// State s (a kmer, most recent base in the lowest bits) can be reached by a step from
+// the 4 states (s >> 2) + k * (num_states / 4), i.e. those with a different base k
+// at the front, with score scores[s * 4 + k].  It can also be reached by a stay
+// from itself, with the fixed stay score.
+//
+// The forward scan accumulates over predecessors:
+//   out[t + 1][s] = logsumexp(out[t][s] + stay, out[t][pred(s, k)] + scores[t][s * 4 + k])
+// and the backward scan accumulates over successors.  For a state v, with
+// q = num_states / 4, the successors are 4 * (v % q) + b, all of which drop the
+// front base k = v / q:
+//   out[t][v] = logsumexp(out[t + 1][v] + stay,
+//                         out[t + 1][4 * (v % q) + b] + scores[t][(4 * (v % q) + b) * 4 + v / q])
+//
+// Each step reads one row of the previous result and one row of scores, and writes one
+// row of results, so a chunk's working set stays in L1 for the realistic state counts.
+
+namespace {
+
+constexpr int NUM_BASES = 4;
+
+float log_sum_exp(const float (&terms)[NUM_BASES + 1]) {
+    const float max_term = *std::max_element(std::begin(terms), std::end(terms));
+    float sum = 0.0f;
+    for (float term : terms) {
+        sum += std::exp(term - max_term);
+    }
+    return max_term + std::log(sum);
+}
+
+void forward_step_generic(const float* prev,
+                          const float* scores,
+                          float* out,
+                          int num_states,
+                          float fixed_stay_score) {
+    const int q = num_states / NUM_BASES;
+    for (int s = 0; s < num_states; ++s) {
+        const int pred_base = s >> 2;
+        const float* state_scores = scores + s * NUM_BASES;
+        const float terms[NUM_BASES + 1] = {
+                prev[s] + fixed_stay_score,
+                prev[pred_base] + state_scores[0],
+                prev[pred_base + q] + state_scores[1],
+                prev[pred_base + 2 * q] + state_scores[2],
+                prev[pred_base + 3 * q] + state_scores[3],
+        };
+        out[s] = log_sum_exp(terms);
+    }
+}
+
+void backward_step_generic(const float* next,
+                           const float* scores,
+                           float* out,
+                           int num_states,
+                           float fixed_stay_score) {
+    const int q = num_states / NUM_BASES;
+    for (int v = 0; v < num_states; ++v) {
+        const int dropped_base = v / q;
+        const int succ_base = (v % q) * NUM_BASES;
+        const float* succ_scores = scores + succ_base * NUM_BASES + dropped_base;
+        const float terms[NUM_BASES + 1] = {
+                next[v] + fixed_stay_score,
+                next[succ_base] + succ_scores[0],
+                next[succ_base + 1] + succ_scores[NUM_BASES],
+                next[succ_base + 2] + succ_scores[2 * NUM_BASES],
+                next[succ_base + 3] + succ_scores[3 * NUM_BASES],
+        };
+        out[v] = log_sum_exp(terms);
+    }
+}
+
+#if ENABLE_AVX2_IMPL
+// exp/log approximations, following the Cephes single precision implementations.
+// Relative error is ~1e-7 over the range used here.
+__attribute__((target("avx2"))) __m256 exp_avx2(__m256 x) {
+    x = _mm256_min_ps(x, _mm256_set1_ps(88.3762626647949f));
+    x = _mm256_max_ps(x, _mm256_set1_ps(-88.3762626647949f));
+
+    // exp(x) = 2^n * exp(r), with n = round(x / ln2) and r = x - n * ln2.
+    __m256 n = _mm256_mul_ps(x, _mm256_set1_ps(1.44269504088896341f));
+    n = _mm256_floor_ps(_mm256_add_ps(n, _mm256_set1_ps(0.5f)));
+    x = _mm256_sub_ps(x, _mm256_mul_ps(n, _mm256_set1_ps(0.693359375f)));
+    x = _mm256_sub_ps(x, _mm256_mul_ps(n, _mm256_set1_ps(-2.12194440e-4f)));
+
+    __m256 y = _mm256_set1_ps(1.9875691500E-4f);
+    y = _mm256_add_ps(_mm256_mul_ps(y, x), _mm256_set1_ps(1.3981999507E-3f));
+    y = _mm256_add_ps(_mm256_mul_ps(y, x), _mm256_set1_ps(8.3334519073E-3f));
+    y = _mm256_add_ps(_mm256_mul_ps(y, x), _mm256_set1_ps(4.1665795894E-2f));
+    y = _mm256_add_ps(_mm256_mul_ps(y, x), _mm256_set1_ps(1.6666665459E-1f));
+    y = _mm256_add_ps(_mm256_mul_ps(y, x), _mm256_set1_ps(5.0000001201E-1f));
+    y = _mm256_add_ps(_mm256_mul_ps(y, _mm256_mul_ps(x, x)), x);
+    y = _mm256_add_ps(y, _mm256_set1_ps(1.0f));
+
+    // Build 2^n directly in the exponent bits.
+    __m256i pow2n = _mm256_cvttps_epi32(n);
+    pow2n = _mm256_slli_epi32(_mm256_add_epi32(pow2n, _mm256_set1_epi32(127)), 23);
+    return _mm256_mul_ps(y, _mm256_castsi256_ps(pow2n));
+}
+
+// Only valid for x >= 1, which holds for the sums of exps we take the log of, since
+// the maximum term contributes exactly 1.
+__attribute__((target("avx2"))) __m256 log_avx2(__m256 x) {
+    // x = m * 2^e, with m in [0.5, 1).
+    const __m256i bits = _mm256_castps_si256(x);
+    __m256 e = _mm256_cvtepi32_ps(
+            _mm256_sub_epi32(_mm256_srli_epi32(bits, 23), _mm256_set1_epi32(126)));
+    x = _mm256_or_ps(_mm256_castsi256_ps(_mm256_and_si256(bits, _mm256_set1_epi32(0x807fffff))),
+                     _mm256_set1_ps(0.5f));
+
+    // Shift m into [sqrt(0.5), sqrt(2)).
+    const __m256 mask = _mm256_cmp_ps(x, _mm256_set1_ps(0.707106781186547524f), _CMP_LT_OS);
+    const __m256 tmp = _mm256_and_ps(x, mask);
+    x = _mm256_sub_ps(x, _mm256_set1_ps(1.0f));
+    e = _mm256_sub_ps(e, _mm256_and_ps(_mm256_set1_ps(1.0f), mask));
+    x = _mm256_add_ps(x, tmp);
+
+    const __m256 z = _mm256_mul_ps(x, x);
+    __m256 y = _mm256_set1_ps(7.0376836292E-2f);
+    y = _mm256_add_ps(_mm256_mul_ps(y, x), _mm256_set1_ps(-1.1514610310E-1f));
+    y = _mm256_add_ps(_mm256_mul_ps(y, x), _mm256_set1_ps(1.1676998740E-1f));
+    y = _mm256_add_ps(_mm256_mul_ps(y, x), _mm256_set1_ps(-1.2420140846E-1f));
+    y = _mm256_add_ps(_mm256_mul_ps(y, x), _mm256_set1_ps(1.4249322787E-1f));
+    y = _mm256_add_ps(_mm256_mul_ps(y, x), _mm256_set1_ps(-1.6668057665E-1f));
+    y = _mm256_add_ps(_mm256_mul_ps(y, x), _mm256_set1_ps(2.0000714765E-1f));
+    y = _mm256_add_ps(_mm256_mul_ps(y, x), _mm256_set1_ps(-2.4999993993E-1f));
+    y = _mm256_add_ps(_mm256_mul_ps(y, x), _mm256_set1_ps(3.3333331174E-1f));
+    y = _mm256_mul_ps(y, _mm256_mul_ps(x, z));
+
+    y = _mm256_add_ps(y, _mm256_mul_ps(e, _mm256_set1_ps(-2.12194440e-4f)));
+    y = _mm256_sub_ps(y, _mm256_mul_ps(z, _mm256_set1_ps(0.5f)));
+    x = _mm256_add_ps(x, y);
+    return _mm256_add_ps(x, _mm256_mul_ps(e, _mm256_set1_ps(0.693359375f)));
+}
+
+__attribute__((target("avx2"))) __m256 log_sum_exp_avx2(const __m256 (&terms)[NUM_BASES + 1]) {
+    __m256 max_term = terms[0];
+    for (int i = 1; i < NUM_BASES + 1; ++i) {
+        max_term = _mm256_max_ps(max_term, terms[i]);
+    }
+    __m256 sum = _mm256_setzero_ps();
+    for (int i = 0; i < NUM_BASES + 1; ++i) {
+        sum = _mm256_add_ps(sum, exp_avx2(_mm256_sub_ps(terms[i], max_term)));
+    }
+    return _mm256_add_ps(max_term, log_avx2(sum));
+}
+
+// Loads rows lo_row and lo_row + 4 of 4 floats into the low and high 128 bit lanes.
+__attribute__((target("avx2"))) __m256 load_row_pair(const float* src,
+                                                     std::ptrdiff_t row_stride,
+                                                     int lo_row) {
+    return _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(src + lo_row * row_stride)),
+                                _mm_loadu_ps(src + (lo_row + 4) * row_stride), 1);
+}
+
+// Loads 8 rows of 4 floats, separated by row_stride, and returns the 4 columns with
+// rows across the lanes.
+__attribute__((target("avx2"))) void load_transposed_8x4(const float* src,
+                                                         std::ptrdiff_t row_stride,
+                                                         __m256 (&cols)[NUM_BASES]) {
+    const __m256 r04 = load_row_pair(src, row_stride, 0);
+    const __m256 r15 = load_row_pair(src, row_stride, 1);
+    const __m256 r26 = load_row_pair(src, row_stride, 2);
+    const __m256 r37 = load_row_pair(src, row_stride, 3);
+
+    // Standard 4x4 transpose within each 128 bit lane.
+    const __m256 t0 = _mm256_unpacklo_ps(r04, r15);
+    const __m256 t1 = _mm256_unpackhi_ps(r04, r15);
+    const __m256 t2 = _mm256_unpacklo_ps(r26, r37);
+    const __m256 t3 = _mm256_unpackhi_ps(r26, r37);
+    cols[0] = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(1, 0, 1, 0));
+    cols[1] = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(3, 2, 3, 2));
+    cols[2] = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(1, 0, 1, 0));
+    cols[3] = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(3, 2, 3, 2));
+}
+
+// Processes 8 states at a time, which share 2 sets of predecessors.
+// Requires num_states to be a multiple of 8.
+__attribute__((target("avx2"))) void forward_step_avx2(const float* prev,
+                                                       const float* scores,
+                                                       float* out,
+                                                       int num_states,
+                                                       float fixed_stay_score) {
+    const int q = num_states / NUM_BASES;
+    const __m256 stay = _mm256_set1_ps(fixed_stay_score);
+    for (int s = 0; s < num_states; s += 8) {
+        __m256 step_scores[NUM_BASES];
+        load_transposed_8x4(scores + s * NUM_BASES, NUM_BASES, step_scores);
+
+        __m256 terms[NUM_BASES + 1];
+        terms[0] = _mm256_add_ps(_mm256_loadu_ps(prev + s), stay);
+        const int pred_base = s >> 2;
+        for (int k = 0; k < NUM_BASES; ++k) {
+            // States s..s+3 and s+4..s+7 have predecessors pred_base and pred_base + 1.
+            const float* pred = prev + pred_base + k * q;
+            const __m256 pred_scores =
+                    _mm256_setr_m128(_mm_set1_ps(pred[0]), _mm_set1_ps(pred[1]));
+            terms[k + 1] = _mm256_add_ps(pred_scores, step_scores[k]);
+        }
+        _mm256_storeu_ps(out + s, log_sum_exp_avx2(terms));
+    }
+}
+
+// Processes 8 consecutive values of v % q at a time, for each of the 4 values of v / q,
+// since they share successors.  Requires num_states to be a multiple of 32.
+__attribute__((target("avx2"))) void backward_step_avx2(const float* next,
+                                                        const float* scores,
+                                                        float* out,
+                                                        int num_states,
+                                                        float fixed_stay_score) {
+    const int q = num_states / NUM_BASES;
+    const __m256 stay = _mm256_set1_ps(fixed_stay_score);
+    for (int w = 0; w < q; w += 8) {
+        // succ_next[b] lane j: next[4 * (w + j) + b]
+        __m256 succ_next[NUM_BASES];
+        load_transposed_8x4(next + w * NUM_BASES, NUM_BASES, succ_next);
+
+        // succ_scores[b][k] lane j: scores[(4 * (w + j) + b) * 4 + k]
+        __m256 succ_scores[NUM_BASES][NUM_BASES];
+        for (int b = 0; b < NUM_BASES; ++b) {
+            load_transposed_8x4(scores + (w * NUM_BASES + b) * NUM_BASES, NUM_BASES * NUM_BASES,
+                                succ_scores[b]);
+        }
+
+        for (int k = 0; k < NUM_BASES; ++k) {
+            const int v = k * q + w;
+            __m256 terms[NUM_BASES + 1];
+            terms[0] = _mm256_add_ps(_mm256_loadu_ps(next + v), stay);
+            for (int b = 0; b < NUM_BASES; ++b) {
+                terms[b + 1] = _mm256_add_ps(succ_next[b], succ_scores[b][k]);
+            }
+            _mm256_storeu_ps(out + v, log_sum_exp_avx2(terms));
+        }
+    }
+}
+#endif  // ENABLE_AVX2_IMPL
+
+#if ENABLE_NEON_IMPL
+// exp/log approximations, following the Cephes single precision implementations.
+// Relative error is ~1e-7 over the range used here.
+float32x4_t exp_neon(float32x4_t x) {
+    x = vminq_f32(x, vdupq_n_f32(88.3762626647949f));
+    x = vmaxq_f32(x, vdupq_n_f32(-88.3762626647949f));
+
+    // exp(x) = 2^n * exp(r), with n = round(x / ln2) and r = x - n * ln2.
+    float32x4_t n = vrndmq_f32(vmlaq_f32(vdupq_n_f32(0.5f), x, vdupq_n_f32(1.44269504088896341f)));
+    x = vmlsq_f32(x, n, vdupq_n_f32(0.693359375f));
+    x = vmlsq_f32(x, n, vdupq_n_f32(-2.12194440e-4f));
+
+    float32x4_t y = vdupq_n_f32(1.9875691500E-4f);
+    y = vmlaq_f32(vdupq_n_f32(1.3981999507E-3f), y, x);
+    y = vmlaq_f32(vdupq_n_f32(8.3334519073E-3f), y, x);
+    y = vmlaq_f32(vdupq_n_f32(4.1665795894E-2f), y, x);
+    y = vmlaq_f32(vdupq_n_f32(1.6666665459E-1f), y, x);
+    y = vmlaq_f32(vdupq_n_f32(5.0000001201E-1f), y, x);
+    y = vmlaq_f32(x, y, vmulq_f32(x, x));
+    y = vaddq_f32(y, vdupq_n_f32(1.0f));
+
+    // Build 2^n directly in the exponent bits.
+    const int32x4_t pow2n = vshlq_n_s32(vaddq_s32(vcvtq_s32_f32(n), vdupq_n_s32(127)), 23);
+    return vmulq_f32(y, vreinterpretq_f32_s32(pow2n));
+}
+
+// Only valid for x >= 1, which holds for the sums of exps we take the log of, since
+// the maximum term contributes exactly 1.
+float32x4_t log_neon(float32x4_t x) {
+    // x = m * 2^e, with m in [0.5, 1).
+    const uint32x4_t bits = vreinterpretq_u32_f32(x);
+    float32x4_t e = vcvtq_f32_s32(
+            vsubq_s32(vreinterpretq_s32_u32(vshrq_n_u32(bits, 23)), vdupq_n_s32(126)));
+    x = vreinterpretq_f32_u32(vorrq_u32(vandq_u32(bits, vdupq_n_u32(0x807fffff)),
+                                        vreinterpretq_u32_f32(vdupq_n_f32(0.5f))));
+
+    // Shift m into [sqrt(0.5), sqrt(2)).
+    const uint32x4_t mask = vcltq_f32(x, vdupq_n_f32(0.707106781186547524f));
+    const float32x4_t tmp = vreinterpretq_f32_u32(vandq_u32(vreinterpretq_u32_f32(x), mask));
+    x = vsubq_f32(x, vdupq_n_f32(1.0f));
+    e = vsubq_f32(e, vreinterpretq_f32_u32(
+                             vandq_u32(vreinterpretq_u32_f32(vdupq_n_f32(1.0f)), mask)));
+    x = vaddq_f32(x, tmp);
+
+    const float32x4_t z = vmulq_f32(x, x);
+    float32x4_t y = vdupq_n_f32(7.0376836292E-2f);
+    y = vmlaq_f32(vdupq_n_f32(-1.1514610310E-1f), y, x);
+    y = vmlaq_f32(vdupq_n_f32(1.1676998740E-1f), y, x);
+    y = vmlaq_f32(vdupq_n_f32(-1.2420140846E-1f), y, x);
+    y = vmlaq_f32(vdupq_n_f32(1.4249322787E-1f), y, x);
+    y = vmlaq_f32(vdupq_n_f32(-1.6668057665E-1f), y, x);
+    y = vmlaq_f32(vdupq_n_f32(2.0000714765E-1f), y, x);
+    y = vmlaq_f32(vdupq_n_f32(-2.4999993993E-1f), y, x);
+    y = vmlaq_f32(vdupq_n_f32(3.3333331174E-1f), y, x);
+    y = vmulq_f32(y, vmulq_f32(x, z));
+
+    y = vmlaq_f32(y, e, vdupq_n_f32(-2.12194440e-4f));
+    y = vmlsq_f32(y, z, vdupq_n_f32(0.5f));
+    x = vaddq_f32(x, y);
+    return vmlaq_f32(x, e, vdupq_n_f32(0.693359375f));
+}
+
+float32x4_t log_sum_exp_neon(const float32x4_t (&terms)[NUM_BASES + 1]) {
+    float32x4_t max_term = terms[0];
+    for (int i = 1; i < NUM_BASES + 1; ++i) {
+        max_term = vmaxq_f32(max_term, terms[i]);
+    }
+    float32x4_t sum = vdupq_n_f32(0.0f);
+    for (int i = 0; i < NUM_BASES + 1; ++i) {
+        sum = vaddq_f32(sum, exp_neon(vsubq_f32(terms[i], max_term)));
+    }
+    return vaddq_f32(max_term, log_neon(sum));
+}
+
+// Processes the 4 states which share a set of predecessors.
+// Requires num_states to be a multiple of 4.
+void forward_step_neon(const float* prev,
+                       const float* scores,
+                       float* out,
+                       int num_states,
+                       float fixed_stay_score) {
+    const int q = num_states / NUM_BASES;
+    const float32x4_t stay = vdupq_n_f32(fixed_stay_score);
+    for (int s = 0; s < num_states; s += NUM_BASES) {
+        // De-interleave so that step_scores.val[k] lane j is scores[(s + j) * 4 + k].
+        const float32x4x4_t step_scores = vld4q_f32(scores + s * NUM_BASES);
+
+        float32x4_t terms[NUM_BASES + 1];
+        terms[0] = vaddq_f32(vld1q_f32(prev + s), stay);
+        const int pred_base = s >> 2;
+        for (int k = 0; k < NUM_BASES; ++k) {
+            terms[k + 1] = vaddq_f32(vdupq_n_f32(prev[pred_base + k * q]), step_scores.val[k]);
+        }
+        vst1q_f32(out + s, log_sum_exp_neon(terms));
+    }
+}
+
+// Processes 4 consecutive values of v % q at a time, for each of the 4 values of v / q,
+// since they share successors.  Requires num_states to be a multiple of 16.
+void backward_step_neon(const float* next,
+                        const float* scores,
+                        float* out,
+                        int num_states,
+                        float fixed_stay_score) {
+    const int q = num_states / NUM_BASES;
+    const float32x4_t stay = vdupq_n_f32(fixed_stay_score);
+    for (int w = 0; w < q; w += 4) {
+        // succ_next.val[b] lane j: next[4 * (w + j) + b]
+        const float32x4x4_t succ_next = vld4q_f32(next + w * NUM_BASES);
+
+        // succ_scores[b][k] lane j: scores[(4 * (w + j) + b) * 4 + k]
+        float32x4_t succ_scores[NUM_BASES][NUM_BASES];
+        for (int b = 0; b < NUM_BASES; ++b) {
+            const float* src = scores + (w * NUM_BASES + b) * NUM_BASES;
+            const float32x4x2_t t01 = vtrnq_f32(vld1q_f32(src), vld1q_f32(src + 16));
+            const float32x4x2_t t23 = vtrnq_f32(vld1q_f32(src + 32), vld1q_f32(src + 48));
+            succ_scores[b][0] =
+                    vcombine_f32(vget_low_f32(t01.val[0]), vget_low_f32(t23.val[0]));
+            succ_scores[b][1] =
+                    vcombine_f32(vget_low_f32(t01.val[1]), vget_low_f32(t23.val[1]));
+            succ_scores[b][2] =
+                    vcombine_f32(vget_high_f32(t01.val[0]), vget_high_f32(t23.val[0]));
+            succ_scores[b][3] =
+                    vcombine_f32(vget_high_f32(t01.val[1]), vget_high_f32(t23.val[1]));
+        }
+
+        for (int k = 0; k < NUM_BASES; ++k) {
+            const int v = k * q + w;
+            float32x4_t terms[NUM_BASES + 1];
+            terms[0] = vaddq_f32(vld1q_f32(next + v), stay);
+            for (int b = 0; b < NUM_BASES; ++b) {
+                terms[b + 1] = vaddq_f32(succ_next.val[b], succ_scores[b][k]);
+            }
+            vst1q_f32(out + v, log_sum_exp_neon(terms));
+        }
+    }
+}
+#endif  // ENABLE_NEON_IMPL
+
+// For non-AVX we use the NEON path if we have it, or the generic path that handles
+// any number of states.
+#if ENABLE_AVX2_IMPL
+__attribute__((target("default")))
+#endif
+void forward_scan_impl(const float* scores,
+                       std::ptrdiff_t scores_t_stride,
+                       float* out,
+                       std::ptrdiff_t out_t_stride,
+                       int num_timesteps,
+                       int num_states,
+                       float fixed_stay_score) {
+    for (int t = 0; t < num_timesteps; ++t) {
+        const float* prev = out + t * out_t_stride;
+#if ENABLE_NEON_IMPL
+        forward_step_neon(prev, scores + t * scores_t_stride, out + (t + 1) * out_t_stride,
+                          num_states, fixed_stay_score);
+#else
+        forward_step_generic(prev, scores + t * scores_t_stride, out + (t + 1) * out_t_stride,
+                             num_states, fixed_stay_score);
+#endif
+    }
+}
+
+#if ENABLE_AVX2_IMPL
+__attribute__((target("default")))
+#endif
+void backward_scan_impl(const float* scores,
+                        std::ptrdiff_t scores_t_stride,
+                        float* out,
+                        std::ptrdiff_t out_t_stride,
+                        int num_timesteps,
+                        int num_states,
+                        float fixed_stay_score) {
+    for (int t = num_timesteps - 1; t >= 0; --t) {
+        const float* next = out + (t + 1) * out_t_stride;
+#if ENABLE_NEON_IMPL
+        if (num_states % 16 == 0) {
+            backward_step_neon(next, scores + t * scores_t_stride, out + t * out_t_stride,
+                               num_states, fixed_stay_score);
+            continue;
+        }
+#endif
+        backward_step_generic(next, scores + t * scores_t_stride, out + t * out_t_stride,
+                              num_states, fixed_stay_score);
+    }
+}
+
+#if ENABLE_AVX2_IMPL
+__attribute__((target("avx2"))) void forward_scan_impl(const float* scores,
+                                                       std::ptrdiff_t scores_t_stride,
+                                                       float* out,
+                                                       std::ptrdiff_t out_t_stride,
+                                                       int num_timesteps,
+                                                       int num_states,
+                                                       float fixed_stay_score) {
+    const bool use_simd = num_states % 8 == 0;
+    for (int t = 0; t < num_timesteps; ++t) {
+        const float* prev = out + t * out_t_stride;
+        if (use_simd) {
+            forward_step_avx2(prev, scores + t * scores_t_stride, out + (t + 1) * out_t_stride,
+                              num_states, fixed_stay_score);
+        } else {
+            forward_step_generic(prev, scores + t * scores_t_stride,
+                                 out + (t + 1) * out_t_stride, num_states, fixed_stay_score);
+        }
+    }
+}
+
+__attribute__((target("avx2"))) void backward_scan_impl(const float* scores,
+                                                        std::ptrdiff_t scores_t_stride,
+                                                        float* out,
+                                                        std::ptrdiff_t out_t_stride,
+                                                        int num_timesteps,
+                                                        int num_states,
+                                                        float fixed_stay_score) {
+    const bool use_simd = num_states % 32 == 0;
+    for (int t = num_timesteps - 1; t >= 0; --t) {
+        const float* next = out + (t + 1) * out_t_stride;
+        if (use_simd) {
+            backward_step_avx2(next, scores + t * scores_t_stride, out + t * out_t_stride,
+                               num_states, fixed_stay_score);
+        } else {
+            backward_step_generic(next, scores + t * scores_t_stride, out + t * out_t_stride,
+                                  num_states, fixed_stay_score);
+        }
+    }
+}
+#endif
+
+}  // namespace
+
+namespace dorado::basecall::decode::inner {
+
+void forward_scan(const float* scores,
+                  std::ptrdiff_t scores_t_stride,
+                  float* out,
+                  std::ptrdiff_t out_t_stride,
+                  int num_timesteps,
+                  int num_states,
+                  float fixed_stay_score) {
+    std::fill_n(out, num_states, 0.0f);
+    forward_scan_impl(scores, scores_t_stride, out, out_t_stride, num_timesteps, num_states,
+                      fixed_stay_score);
+}
+
+void backward_scan(const float* scores,
+                   std::ptrdiff_t scores_t_stride,
+                   float* out,
+                   std::ptrdiff_t out_t_stride,
+                   int num_timesteps,
+                   int num_states,
+                   float fixed_stay_score) {
+    std::fill_n(out + num_timesteps * out_t_stride, num_states, 0.0f);
+    backward_scan_impl(scores, scores_t_stride, out, out_t_stride, num_timesteps, num_states,
+                       fixed_stay_score);
+}
+
+}  // namespace dorado::basecall::decode::inner
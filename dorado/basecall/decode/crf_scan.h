@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstddef>
+
+namespace dorado::basecall::decode::inner {
+
+// Log-space forward/backward scans over the CRF states of a single chunk.
+//
+// scores points to num_timesteps rows of num_states * 4 transition scores, each row
+// contiguous and separated by scores_t_stride floats.  Scores for transitions into
+// state s are at [s * 4, s * 4 + 4), ordered by the base dropped from the front of
+// the predecessor kmer.
+//
+// out points to num_timesteps + 1 rows of num_states floats, separated by
+// out_t_stride floats, which are written in place without further allocation.
+// The forward scan sets row 0 to 0 and fills forwards, the backward scan sets the
+// last row to 0 and fills backwards.
+//
+// Uses AVX2 or NEON where available, with a generic fallback.
+void forward_scan(const float* scores,
+                  std::ptrdiff_t scores_t_stride,
+                  float* out,
+                  std::ptrdiff_t out_t_stride,
+                  int num_timesteps,
+                  int num_states,
+                  float fixed_stay_score);
+
+void backward_scan(const float* scores,
+                   std::ptrdiff_t scores_t_stride,
+                   float* out,
+                   std::ptrdiff_t out_t_stride,
+                   int num_timesteps,
+                   int num_states,
+                   float fixed_stay_score);
+
+}  // namespace dorado::basecall::decode::inner
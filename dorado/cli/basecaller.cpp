@@ -591,6 +591,10 @@ void setup(const std::vector<std::string>& args,
     ProgressTracker tracker(int(num_reads), false, post_processing_percentage);
     tracker.set_description("Basecalling");
 
+    DataLoader loader(*pipeline, "cpu", thread_allocations.loader_threads, max_reads, read_list,
+                      reads_already_processed);
+    stats_reporters.push_back(stats::make_stats_reporter(loader));
+
     std::vector<dorado::stats::StatsCallable> stats_callables;
     stats_callables.push_back(
             [&tracker](const stats::NamedStats& stats) { tracker.update_progress_bar(stats); });
@@ -599,9 +603,6 @@ void setup(const std::vector<std::string>& args,
     auto stats_sampler = std::make_unique<dorado::stats::StatsSampler>(
             kStatsPeriod, stats_reporters, stats_callables, max_stats_records);
 
-    DataLoader loader(*pipeline, "cpu", thread_allocations.loader_threads, max_reads, read_list,
-                      reads_already_processed);
-
     auto func = [client_info](ReadCommon& read) { read.client_info = client_info; };
     loader.add_read_initialiser(func);
 
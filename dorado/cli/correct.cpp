@@ -1,6 +1,7 @@
 #include "cli/cli_utils.h"
 #include "correct/CorrectionProgressTracker.h"
 #include "dorado_version.h"
+#include "hts_io/PackedReadStore.h"
 #include "model_downloader/model_downloader.h"
 #include "read_pipeline/CorrectionInferenceNode.h"
 #include "read_pipeline/CorrectionMapperNode.h"
@@ -53,10 +54,13 @@ struct Options {
     std::string device;
     int batch_size = 0;
     uint64_t index_size = 0;
+    std::optional<uint64_t> index_prefetch_memory;
+    uint64_t overlap_memory = 0;
     bool to_paf = false;
     std::string in_paf_fn;
     std::string model_path;
     std::string resume_path_fn;
+    std::filesystem::path tmp_dir;
 };
 
 /// \brief Define the CLI options.
@@ -112,6 +116,10 @@ ParserPtr create_cli(int& verbosity) {
                       "example, a .fai index generated from the previously corrected output FASTA "
                       "file is a valid input here.")
                 .default_value("");
+        parser->visible.add_argument("--tmp-dir")
+                .help("Directory for temporary files, including a packed copy of the input reads "
+                      "which takes about 1.25 bytes per base. Default: the system temp directory.")
+                .default_value(std::string{});
     }
     {
         parser->visible.add_group("Advanced arguments");
@@ -123,6 +131,15 @@ ParserPtr create_cli(int& verbosity) {
                 .help("Size of index for mapping and alignment. Default 8G. Decrease index size to "
                       "lower memory footprint.")
                 .default_value(std::string{"8G"});
+        parser->visible.add_argument("--index-prefetch-memory")
+                .help("Memory allowed for loading the next index chunk while the current one is "
+                      "being mapped. Set to 0 to only load chunks once mapping has finished. "
+                      "Default: half of the available memory.")
+                .default_value(std::string{"auto"});
+        parser->visible.add_argument("--overlap-memory")
+                .help("Memory allowed for holding overlaps, across the index chunk being mapped "
+                      "and the previous chunk while it is being corrected.")
+                .default_value(std::string{"16G"});
     }
 
     return parser;
@@ -151,11 +168,22 @@ Options set_options(const utils::arg_parse::ArgParser& parser, const int verbosi
     opt.batch_size = parser.visible.get<int>("batch-size");
     opt.index_size = std::max<int64_t>(0, utils::arg_parse::parse_string_to_size<int64_t>(
                                                   parser.visible.get<std::string>("index-size")));
+    opt.overlap_memory = std::max<int64_t>(
+            0, utils::arg_parse::parse_string_to_size<int64_t>(
+                       parser.visible.get<std::string>("overlap-memory")));
+    const auto index_prefetch_memory = parser.visible.get<std::string>("index-prefetch-memory");
+    if (index_prefetch_memory != "auto") {
+        opt.index_prefetch_memory = std::max<int64_t>(
+                0, utils::arg_parse::parse_string_to_size<int64_t>(index_prefetch_memory));
+    }
     opt.to_paf = parser.visible.get<bool>("to-paf");
     opt.in_paf_fn = (parser.visible.is_used("--from-paf"))
                             ? parser.visible.get<std::string>("from-paf")
                             : "";
     opt.resume_path_fn = parser.visible.get<std::string>("resume-from");
+    const auto tmp_dir = parser.visible.get<std::string>("tmp-dir");
+    opt.tmp_dir = std::empty(tmp_dir) ? std::filesystem::temp_directory_path()
+                                      : std::filesystem::path(tmp_dir);
     opt.model_path = (parser.visible.is_used("--model-path"))
                              ? parser.visible.get<std::string>("model-path")
                              : "";
@@ -343,6 +371,28 @@ void validate_options(const Options& opt) {
         spdlog::error("Input resume index file {} does not exist!", opt.resume_path_fn);
         std::exit(EXIT_FAILURE);
     }
+    if (!std::filesystem::is_directory(opt.tmp_dir)) {
+        spdlog::error("Temporary directory {} does not exist!", opt.tmp_dir.string());
+        std::exit(EXIT_FAILURE);
+    }
+}
+
+// Checks that there's room in the temporary directory for the read store before spending any
+// time on building it.
+void check_read_store_space(const std::filesystem::path& in_reads_fn,
+                            const std::filesystem::path& tmp_dir) {
+    const uint64_t required_bytes = hts_io::PackedReadStore::estimate_file_bytes(in_reads_fn);
+    const uint64_t available_bytes = std::filesystem::space(tmp_dir).available;
+    spdlog::debug("Read store needs about {} MB, {} MB available in {}",
+                  required_bytes / (1024 * 1024), available_bytes / (1024 * 1024),
+                  tmp_dir.string());
+    if (required_bytes > available_bytes) {
+        throw std::runtime_error{"Not enough space in " + tmp_dir.string() +
+                                 " for a copy of the input reads, which needs about " +
+                                 std::to_string(required_bytes / (1024 * 1024)) + " MB but " +
+                                 std::to_string(available_bytes / (1024 * 1024)) +
+                                 " MB is available. Use --tmp-dir to choose another directory"};
+    }
 }
 
 }  // namespace
@@ -412,14 +462,24 @@ int correct(int argc, char* argv[]) {
         //      Since the MM2 index for a full genome could be larger than what can
         //      fit in memory, the alignment node needs to support split mm2 indices.
         //      This requires the input reads to be iterated over multiple times, once
-        //      for each index chunk. In order to manage this properly, the input file
-        //      reading is handled within the alignment node.
+        //      for each index chunk, which the alignment node does using the read store
+        //      if there is one, or by reading the input file again otherwise.
         //      Each alignment out of that node is expected to generate multiple aligned
         //      records, which will all be packaged and sent into a window generation node.
         //  2. Correction node will chunk up the alignments into multiple windows, create
         //      tensors, run inference and decode the windows into a final corrected sequence.
         //  3. Corrected reads will be written out FASTA or BAM format.
 
+        // When both the alignment and the correction nodes run, the input reads are parsed
+        // once, into a store which they both read from, however many index chunks there are.
+        // Otherwise the single node reads the input file directly, which needs no temporary
+        // space.
+        std::shared_ptr<const hts_io::PackedReadStore> read_store;
+        if (!opt.to_paf && std::empty(opt.in_paf_fn)) {
+            check_read_store_space(in_reads_fn, opt.tmp_dir);
+            read_store = std::make_shared<const hts_io::PackedReadStore>(in_reads_fn, opt.tmp_dir);
+        }
+
         std::unique_ptr<utils::HtsFile, HtsFileDeleter> hts_file;
         PipelineDescriptor pipeline_desc;
 
@@ -434,8 +494,8 @@ int correct(int argc, char* argv[]) {
 
             // 2. Window generation, encoding + inference and decoding to generate final reads.
             pipeline_desc.add_node<CorrectionInferenceNode>(
-                    {hts_writer}, in_reads_fn, correct_threads, opt.device, opt.infer_threads,
-                    opt.batch_size, model_dir);
+                    {hts_writer}, in_reads_fn, read_store, correct_threads, opt.device,
+                    opt.infer_threads, opt.batch_size, model_dir);
         } else {
             pipeline_desc.add_node<CorrectionPafWriterNode>({});
         }
@@ -456,8 +516,12 @@ int correct(int argc, char* argv[]) {
             aligner = std::make_unique<CorrectionPafReaderNode>(opt.in_paf_fn, std::move(skip_set));
         } else {
             // 1. Alignment node that generates alignments per read to be corrected.
-            aligner = std::make_unique<CorrectionMapperNode>(in_reads_fn, aligner_threads,
-                                                             opt.index_size, furthest_skip_header,
+            aligner = std::make_unique<CorrectionMapperNode>(in_reads_fn, read_store,
+                                                             aligner_threads,
+                                                             opt.index_size,
+                                                             opt.index_prefetch_memory,
+                                                             opt.overlap_memory,
+                                                             furthest_skip_header,
                                                              std::move(skip_set));
         }
 
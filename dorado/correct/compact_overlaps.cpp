@@ -0,0 +1,91 @@
+#include "compact_overlaps.h"
+
+#include "read_pipeline/messages.h"
+#include "utils/cigar.h"
+
+#include <chrono>
+
+namespace dorado::correction {
+
+uint32_t InternedReadNames::intern(std::string_view read_name) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_ids.find(read_name);
+    if (it == m_ids.end()) {
+        const auto read_idx = static_cast<uint32_t>(m_names.size());
+        it = m_ids.emplace(m_names.emplace_back(read_name), read_idx).first;
+    }
+    return it->second;
+}
+
+const std::string& InternedReadNames::name(uint32_t read_idx) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_names.at(read_idx);
+}
+
+uint64_t CompactTargetOverlaps::overlap_bytes(uint32_t n_cigar) {
+    return sizeof(Overlap) + n_cigar * sizeof(uint32_t);
+}
+
+void CompactTargetOverlaps::add(uint32_t query_idx,
+                                const utils::Overlap& overlap,
+                                const uint32_t* cigar,
+                                uint32_t n_cigar) {
+    const auto cigar_start = static_cast<uint32_t>(m_cigars.size());
+    m_cigars.insert(m_cigars.end(), cigar, cigar + n_cigar);
+    m_overlaps.push_back({query_idx, cigar_start, n_cigar, overlap});
+}
+
+uint64_t CompactTargetOverlaps::num_bytes() const {
+    return m_overlaps.size() * sizeof(Overlap) + m_cigars.size() * sizeof(uint32_t);
+}
+
+CorrectionAlignments CompactTargetOverlaps::expand(
+        const std::string& target_name,
+        const std::function<const std::string&(uint32_t)>& query_name) {
+    CorrectionAlignments alignments;
+    alignments.read_name = target_name;
+    alignments.qnames.reserve(m_overlaps.size());
+    alignments.cigars.reserve(m_overlaps.size());
+    alignments.overlaps.reserve(m_overlaps.size());
+    for (const auto& overlap : m_overlaps) {
+        alignments.qnames.push_back(query_name(overlap.query_idx));
+        alignments.cigars.push_back(
+                convert_mm2_cigar(m_cigars.data() + overlap.cigar_start, overlap.cigar_len));
+        alignments.overlaps.push_back(overlap.overlap);
+    }
+    // Free the compact copy now that it's been expanded.
+    *this = {};
+    return alignments;
+}
+
+bool OverlapMemoryBudget::within_budget() const {
+    const uint64_t pending_bytes = m_pending_bytes.load();
+    return pending_bytes == 0 || m_mapping_bytes.load() + pending_bytes <= m_max_bytes;
+}
+
+void OverlapMemoryBudget::wait_for_memory() {
+    if (within_budget()) {
+        return;
+    }
+    const auto wait_start = std::chrono::steady_clock::now();
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_cv.wait(lock, [this] { return within_budget(); });
+    m_wait_ms += std::chrono::duration_cast<std::chrono::milliseconds>(
+                         std::chrono::steady_clock::now() - wait_start)
+                         .count();
+}
+
+void OverlapMemoryBudget::finish_mapping() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_pending_bytes += m_mapping_bytes.exchange(0);
+}
+
+void OverlapMemoryBudget::release_pending(uint64_t num_bytes) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_pending_bytes -= num_bytes;
+    }
+    m_cv.notify_all();
+}
+
+}  // namespace dorado::correction
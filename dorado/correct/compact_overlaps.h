@@ -0,0 +1,100 @@
+#pragma once
+
+#include "utils/overlap.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace dorado {
+struct CorrectionAlignments;
+}
+
+namespace dorado::correction {
+
+// Gives each read name an index, in the order they're first seen.  Thread safe.
+class InternedReadNames {
+public:
+    uint32_t intern(std::string_view read_name);
+    const std::string& name(uint32_t read_idx) const;
+
+private:
+    mutable std::mutex m_mutex;
+    // Names are kept in a deque so the views used as keys stay valid as it grows.
+    std::deque<std::string> m_names;
+    std::unordered_map<std::string_view, uint32_t> m_ids;
+};
+
+// The overlaps of a single target, held compactly until they're sent on: by the index of each
+// query read, and with minimap2's CIGAR ops packed as length << 4 | op.
+class CompactTargetOverlaps {
+public:
+    // Estimated size of an overlap with n_cigar ops.
+    static uint64_t overlap_bytes(uint32_t n_cigar);
+
+    void add(uint32_t query_idx,
+             const utils::Overlap& overlap,
+             const uint32_t* cigar,
+             uint32_t n_cigar);
+
+    bool empty() const { return m_overlaps.empty(); }
+    size_t size() const { return m_overlaps.size(); }
+    uint64_t num_bytes() const;
+
+    // Expands the overlaps into CorrectionAlignments of the target, in the order they were added,
+    // and frees the compact copy.
+    CorrectionAlignments expand(const std::string& target_name,
+                                const std::function<const std::string&(uint32_t)>& query_name);
+
+private:
+    struct Overlap {
+        uint32_t query_idx;
+        // Range of the overlap's ops in m_cigars.
+        uint32_t cigar_start;
+        uint32_t cigar_len;
+        utils::Overlap overlap;
+    };
+    std::vector<Overlap> m_overlaps;
+    std::vector<uint32_t> m_cigars;
+};
+
+// Budget for the memory held by overlaps: those of the index chunk being mapped, and those of
+// previous chunks which are still to be sent.  Mapping waits while the total is over budget, but
+// only if there are overlaps to be sent, since otherwise waiting won't free anything.
+class OverlapMemoryBudget {
+public:
+    explicit OverlapMemoryBudget(uint64_t max_bytes) : m_max_bytes(max_bytes) {}
+
+    // Blocks while over budget, until pending overlaps are released.
+    void wait_for_memory();
+
+    void add_mapping(uint64_t num_bytes) { m_mapping_bytes += num_bytes; }
+    // Moves the overlaps of the chunk which has been mapped to those to be sent.
+    void finish_mapping();
+    // Releases overlaps which have been sent, waking any threads waiting on them.
+    void release_pending(uint64_t num_bytes);
+
+    uint64_t max_bytes() const { return m_max_bytes; }
+    uint64_t mapping_bytes() const { return m_mapping_bytes.load(); }
+    uint64_t pending_bytes() const { return m_pending_bytes.load(); }
+    int64_t wait_ms() const { return m_wait_ms.load(); }
+
+private:
+    bool within_budget() const;
+
+    const uint64_t m_max_bytes;
+    std::atomic<uint64_t> m_mapping_bytes{0};
+    std::atomic<uint64_t> m_pending_bytes{0};
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    std::atomic<int64_t> m_wait_ms{0};
+};
+
+}  // namespace dorado::correction
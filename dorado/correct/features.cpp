@@ -140,26 +140,25 @@ std::tuple<at::Tensor, at::Tensor> get_features_for_window(
         const CorrectionAlignments& alignments,
         int win_len,
         int tstart,
-        const std::vector<int>& max_ins) {
+        const std::vector<int>& max_ins,
+        const FeatureAllocator& allocate) {
     static auto base_encoding = gen_base_encoding();
 #ifndef NDEBUG
     static auto base_decoding = gen_base_decoding();
 #endif
-    auto bases_options = at::TensorOptions().dtype(torch::kInt32).device(torch::kCPU);
-    auto quals_options = at::TensorOptions().dtype(torch::kFloat32).device(torch::kCPU);
-
     const int length = std::accumulate(max_ins.begin(), max_ins.end(), 0) + (int)max_ins.size();
     const int reads = 1 + TOP_K;
 
-    auto bases = at::empty({reads, length}, bases_options);
+    // The buffers may be reused, so every element is written.
+    at::Tensor bases, quals;
+    std::tie(bases, quals) = allocate(reads, length);
     std::fill(bases.data_ptr<int>(), bases.data_ptr<int>() + bases.numel(), base_encoding['.']);
-    auto quals = at::empty({reads, length}, quals_options);
     std::fill(quals.data_ptr<float>(), quals.data_ptr<float>() + quals.numel(),
               normalize_quals((float)'!'));
 
     // Write bases/qual for target read
     const std::string& tseq = alignments.read_seq;
-    const std::vector<uint8_t>& tqual = alignments.read_qual;
+    const uint8_t* tqual = alignments.read_qual;
 
     int tpos = 0;
     int* target_bases_tensor = bases.data_ptr<int>();
@@ -188,27 +187,30 @@ std::tuple<at::Tensor, at::Tensor> get_features_for_window(
         int oqstart = alignments.overlaps[overlap.overlap_idx].qstart;
         int oqend = alignments.overlaps[overlap.overlap_idx].qend;
 
-        int qstart = -1, qend = -1, qlen = -1;
+        int qstart = -1, qend = -1;
         if (fwd) {
             qstart = oqstart + overlap.qstart;
             qend = oqstart + overlap.qend;
-            qlen = qend - qstart;
         } else {
             qstart = oqend - overlap.qend;
             qend = oqend - overlap.qstart;
-            qlen = qend - qstart;
         }
 
         LOG_TRACE("qstart {} qend {} aln qstart {} aln qend {} overlap qstart {} overlap qend {}",
                   qstart, qend, oqstart, oqend, overlap.qstart, overlap.qend);
         int query_iter = 0;
-        std::string qseq = alignments.seqs[overlap.overlap_idx].substr(qstart, qlen);
-        std::vector<uint8_t> qqual(alignments.quals[overlap.overlap_idx].begin() + qstart,
-                                   alignments.quals[overlap.overlap_idx].begin() + qend);
-        if (!fwd) {
-            qseq = utils::reverse_complement(qseq);
-            std::reverse(qqual.begin(), qqual.end());
-        }
+        // The query is read in place, in the orientation of the target, rather than copying
+        // out (and reverse complementing) the aligned part of it.
+        const std::string& qseq = alignments.seqs[overlap.overlap_idx];
+        const uint8_t* qqual = alignments.quals[overlap.overlap_idx];
+        auto query_base = [&](int i) {
+            if (fwd) {
+                return base_encoding[uint8_t(qseq[qstart + i])];
+            }
+            const char base = utils::complement_table[uint8_t(qseq[qend - 1 - i])];
+            return base_encoding[uint8_t(base) + 32];
+        };
+        auto query_qual = [&](int i) { return fwd ? qqual[qstart + i] : qqual[qend - 1 - i]; };
 
         const int cigar_len_total = static_cast<int>(std::size(cigar));
         const int cigar_len = overlap.cigar_end_idx - overlap.cigar_start_idx + 1;
@@ -247,8 +249,8 @@ std::tuple<at::Tensor, at::Tensor> get_features_for_window(
             case CigarOpType::EQ:
             case CigarOpType::X:
                 for (uint32_t i = 0; i < l; i++) {
-                    auto base = base_encoding[uint8_t(qseq[query_iter]) + (fwd ? 0 : 32)];
-                    auto qual = qqual[query_iter];
+                    auto base = query_base(query_iter);
+                    auto qual = query_qual(query_iter);
 
                     query_bases_tensor[idx] = base;
                     query_quals_tensor[idx] = normalize_quals((float)(qual + 33));
@@ -272,8 +274,8 @@ std::tuple<at::Tensor, at::Tensor> get_features_for_window(
             case CigarOpType::I:
                 idx -= max_ins[tpos - 1];
                 for (uint32_t i = 0; i < l; i++) {
-                    auto base = base_encoding[uint8_t(qseq[query_iter]) + (fwd ? 0 : 32)];
-                    auto qual = qqual[query_iter];
+                    auto base = query_base(query_iter);
+                    auto qual = query_qual(query_iter);
 
                     query_bases_tensor[(idx + i)] = base;
                     query_quals_tensor[(idx + i)] = normalize_quals((float)(qual + 33));
@@ -313,21 +315,42 @@ std::tuple<at::Tensor, at::Tensor> get_features_for_window(
 // The candidate positions are returned as a tuple with the
 // first element being a position in the target sequence
 // and the second element being an insertion offset from that
-// position.
-std::vector<std::pair<int, int>> get_supported(at::Tensor& bases) {
+// position. The column of each candidate in the tensor is
+// appended to columns.
+std::vector<std::pair<int, int>> get_supported(const at::Tensor& bases,
+                                               std::vector<int>& columns) {
     std::vector<std::pair<int, int>> supported;
 
-    static auto base_forward = base_forward_mapping();
     static auto base_encoding = gen_base_encoding();
-    static auto base_decoding = gen_base_decoding();
+    // Forward and reverse strand bases are counted together.
+    static const std::string fwd_bases = "ACGT*";
+    static const std::string rev_bases = "acgt#";
 
     const int reads = static_cast<int>(bases.sizes()[0]);
     const int length = static_cast<int>(bases.sizes()[1]);
 
-    auto bases_ptr = bases.data_ptr<int>();
+    const int* bases_ptr = bases.data_ptr<int>();
+
+    // The reads supporting each base are counted for all of the columns at once, a row at a
+    // time, so that the inner loops vectorise.
+    std::vector<int> base_counts(length);
+    std::vector<int> num_supported_bases(length, 0);
+    for (size_t b = 0; b < fwd_bases.length(); b++) {
+        const int fwd_code = base_encoding[fwd_bases[b]];
+        const int rev_code = base_encoding[rev_bases[b]];
+        std::fill(base_counts.begin(), base_counts.end(), 0);
+        for (int r = 0; r < reads; r++) {
+            const int* row = &bases_ptr[size_t(r) * length];
+            for (int c = 0; c < length; c++) {
+                base_counts[c] += int(row[c] == fwd_code) + int(row[c] == rev_code);
+            }
+        }
+        for (int c = 0; c < length; c++) {
+            num_supported_bases[c] += int(base_counts[c] >= 3);
+        }
+    }
 
     int tpos = -1, ins = 0;
-    std::array<int, 128> counter;
     for (int c = 0; c < length; c++) {
         if (bases_ptr[c] == base_encoding['*']) {
             ins += 1;
@@ -335,50 +358,23 @@ std::vector<std::pair<int, int>> get_supported(at::Tensor& bases) {
             tpos += 1;
             ins = 0;
         }
-        counter.fill(0);
-        for (int r = 0; r < reads; r++) {
-            auto base = bases_ptr[r * length + c];
-            LOG_TRACE("row {} base {}", r, base);
-            if (base == base_encoding['.']) {
-                continue;
-            }
-            counter[base_forward[base_decoding[base]]]++;
-        }
-
-        LOG_TRACE("col {} A {} C {} T {} G {} * {}", c, counter['A'], counter['C'], counter['T'],
-                  counter['G'], counter['*']);
-        int count = (int)std::count_if(counter.begin(), counter.end(),
-                                       [](int num) { return num >= 3; });
-        if (count >= 2) {
+        LOG_TRACE("col {} supported bases {}", c, num_supported_bases[c]);
+        if (num_supported_bases[c] >= 2) {
             supported.push_back({tpos, ins});
+            columns.push_back(c);
             LOG_TRACE("support added for {} {}", tpos, ins);
         }
-        LOG_TRACE("num supported {}", supported.size());
     }
+    LOG_TRACE("num supported {}", supported.size());
     return supported;
 }
 
-// Convert the tuple of pairs for {target pos, insertion offset} into a
-// column in the tensor.
-at::Tensor get_indices(const at::Tensor& bases, const std::vector<std::pair<int, int>>& supported) {
-    static auto base_encoding = gen_base_encoding();
-    auto tbase_tensor = bases.data_ptr<int>();
-    std::vector<int> indices;
-    for (int i = 0; i < bases.sizes()[1]; i++) {
-        if (tbase_tensor[i] != base_encoding['*']) {
-            indices.push_back(i);
-        }
-    }
-
-    std::vector<int> supported_indices;
-    supported_indices.reserve(supported.size());
-    for (auto [pos, ins] : supported) {
-        supported_indices.push_back(indices[pos] + ins);
-    }
-
-    return at::from_blob(supported_indices.data(), {(int)supported_indices.size()},
-                         at::TensorOptions().dtype(torch::kInt32).device(torch::kCPU))
-            .clone();
+// Convert the columns of the supported positions into a tensor.
+at::Tensor get_indices(const std::vector<int>& columns) {
+    auto indices = at::empty({(int)columns.size()},
+                             at::TensorOptions().dtype(torch::kInt32).device(torch::kCPU));
+    std::copy(columns.begin(), columns.end(), indices.data_ptr<int>());
+    return indices;
 }
 
 std::unordered_set<int> filter_features(std::vector<std::vector<OverlapWindow>>& windows,
@@ -435,43 +431,38 @@ std::unordered_set<int> filter_features(std::vector<std::vector<OverlapWindow>>&
     return overlap_idxs;
 }
 
-// Main interface function for generating features for the top_k overlaps for each window
+// Main interface function for generating features for the top_k overlaps of a window
 // given the overlaps for a target read.
-std::vector<WindowFeatures> extract_features(std::vector<std::vector<OverlapWindow>>& windows,
-                                             const CorrectionAlignments& alignments,
-                                             int window_size) {
-    const std::string& tseq = alignments.read_seq;
-    int tlen = (int)tseq.length();
-
-    std::vector<WindowFeatures> wfs;
-    for (int w = 0; w < (int)windows.size(); w++) {
-        int win_len = (w == (int)windows.size() - 1) ? tlen - window_size * w : window_size;
-        LOG_TRACE("win idx {}: win len {}", w, win_len);
-        auto& overlap_windows = windows[w];
-
-        WindowFeatures wf;
-        wf.window_idx = w;
-        wf.read_name = alignments.read_name;
-        wf.n_alns = (int)overlap_windows.size();
-        if (overlap_windows.size() > 1) {
-            // Find the maximum insert size
-            auto max_ins =
-                    get_max_ins_for_window(overlap_windows, alignments, w * window_size, win_len);
-
-            // Create tensors
-            auto [bases, quals] = get_features_for_window(overlap_windows, alignments, win_len,
-                                                          w * window_size, max_ins);
-            auto supported = get_supported(bases);
-            wf.bases = std::move(bases);
-            wf.quals = std::move(quals);
-            wf.supported = std::move(supported);
-            wf.length = (int)wf.supported.size();
-            wf.indices = get_indices(wf.bases, wf.supported);
-        }
-        wfs.push_back(std::move(wf));
+WindowFeatures extract_window_features(const std::vector<OverlapWindow>& overlap_windows,
+                                       const CorrectionAlignments& alignments,
+                                       int window_size,
+                                       int window_idx,
+                                       const FeatureAllocator& allocate) {
+    const int tlen = (int)alignments.read_seq.length();
+    const int tstart = window_idx * window_size;
+    const int win_len = std::min(window_size, tlen - tstart);
+    LOG_TRACE("win idx {}: win len {}", window_idx, win_len);
+
+    WindowFeatures wf;
+    wf.window_idx = window_idx;
+    wf.read_name = alignments.read_name;
+    wf.n_alns = (int)overlap_windows.size();
+    if (overlap_windows.size() > 1) {
+        // Find the maximum insert size
+        auto max_ins = get_max_ins_for_window(overlap_windows, alignments, tstart, win_len);
+
+        // Create tensors
+        auto [bases, quals] = get_features_for_window(overlap_windows, alignments, win_len,
+                                                      tstart, max_ins, allocate);
+        std::vector<int> columns;
+        auto supported = get_supported(bases, columns);
+        wf.bases = std::move(bases);
+        wf.quals = std::move(quals);
+        wf.supported = std::move(supported);
+        wf.length = (int)wf.supported.size();
+        wf.indices = get_indices(columns);
     }
-
-    return wfs;
+    return wf;
 }
 
 }  // namespace dorado::correction
@@ -2,6 +2,8 @@
 
 #include "types.h"
 
+#include <functional>
+#include <tuple>
 #include <unordered_set>
 
 namespace dorado {
@@ -14,8 +16,16 @@ namespace dorado::correction {
 std::unordered_set<int> filter_features(std::vector<std::vector<OverlapWindow>>& windows,
                                         const CorrectionAlignments& alignments);
 
-std::vector<WindowFeatures> extract_features(std::vector<std::vector<OverlapWindow>>& windows,
-                                             const CorrectionAlignments& alignments,
-                                             int window_size);
+// Provides the bases (int32) and quals (float32) tensors of a window's features, of shape
+// {reads, length}. Their contents may be uninitialised.
+using FeatureAllocator = std::function<std::tuple<at::Tensor, at::Tensor>(int reads, int length)>;
+
+// Generate the features for the TOP_K overlaps of window window_idx of the target read.
+// Windows are independent, so may be generated in parallel.
+WindowFeatures extract_window_features(const std::vector<OverlapWindow>& overlap_windows,
+                                       const CorrectionAlignments& alignments,
+                                       int window_size,
+                                       int window_idx,
+                                       const FeatureAllocator& allocate);
 
 }  // namespace dorado::correction
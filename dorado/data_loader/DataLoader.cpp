@@ -3,6 +3,7 @@
 #include "models/kits.h"
 #include "read_pipeline/ReadPipeline.h"
 #include "read_pipeline/messages.h"
+#include "torch_utils/signal_arena.h"
 #include "utils/PostCondition.h"
 #include "utils/thread_naming.h"
 #include "utils/time_utils.h"
@@ -161,13 +162,59 @@ models::ChemistryKey get_chemistry_key(const RunInfoDictData_t* const run_info_d
     return key;
 }
 
+// Decompresses the signal for a read from its signal table rows.
+// Returns an undefined tensor if the signal couldn't be read, so that the read is dropped
+// rather than being basecalled from partial signal.
+at::Tensor load_pod5_signal(Pod5FileReader_t* file,
+                            std::vector<uint64_t>& signal_rows,
+                            size_t num_samples,
+                            utils::SignalArena& signal_arena,
+                            const std::string& read_id) {
+    std::vector<SignalRowInfo_t*> signal_row_infos(signal_rows.size());
+    if (pod5_get_signal_row_info(file, signal_rows.size(), signal_rows.data(),
+                                 signal_row_infos.data()) != POD5_OK) {
+        spdlog::error("Failed to get read {} signal row info: {}", read_id,
+                      pod5_get_error_string());
+        return {};
+    }
+
+    auto samples = signal_arena.allocate(num_samples, at::kShort);
+    auto* dest = samples.data_ptr<int16_t>();
+    size_t samples_read = 0;
+    for (auto* signal_row_info : signal_row_infos) {
+        const size_t row_samples = signal_row_info->stored_sample_count;
+        if (samples_read + row_samples > num_samples) {
+            spdlog::error("Read {} has more signal than expected", read_id);
+            samples = {};
+            break;
+        }
+        if (pod5_get_signal(file, signal_row_info, row_samples, dest + samples_read) != POD5_OK) {
+            spdlog::error("Failed to get read {} signal: {}", read_id, pod5_get_error_string());
+            samples = {};
+            break;
+        }
+        samples_read += row_samples;
+    }
+    if (samples.defined() && samples_read != num_samples) {
+        spdlog::error("Read {} has {} samples of signal, expected {}", read_id, samples_read,
+                      num_samples);
+        samples = {};
+    }
+
+    if (pod5_free_signal_row_info(signal_row_infos.size(), signal_row_infos.data()) != POD5_OK) {
+        spdlog::error("Failed to free signal row info");
+    }
+    return samples;
+}
+
 SimplexReadPtr process_pod5_thread_fn(
         size_t row,
         Pod5ReadRecordBatch* batch,
-        Pod5FileReader* file,
+        const std::shared_ptr<Pod5FileReader>& file,
         const std::string& path,
         const std::unordered_map<int, std::vector<DataLoader::ReadSortInfo>>& reads_by_channel,
-        const std::unordered_map<std::string, size_t>& read_id_to_index) {
+        const std::unordered_map<std::string, size_t>& read_id_to_index,
+        const std::shared_ptr<utils::SignalArena>& signal_arena) {
     utils::set_thread_name("process_pod5");
     uint16_t read_table_version = 0;
     ReadBatchRowInfo_t read_data;
@@ -190,16 +237,21 @@ SimplexReadPtr process_pod5_thread_fn(
     }
     std::string read_id_str(read_id_tmp);
 
-    auto options = at::TensorOptions().dtype(at::kShort);
-    auto samples = at::empty(read_data.num_samples, options);
-
-    if (pod5_get_read_complete_signal(file, batch, row, read_data.num_samples,
-                                      samples.data_ptr<int16_t>()) != POD5_OK) {
-        spdlog::error("Failed to get read {} signal: {}", row, pod5_get_error_string());
+    // Only find where the signal is stored here.  It's decompressed when the read is
+    // first processed, so that queued reads don't hold their signal in memory.
+    std::vector<uint64_t> signal_rows(read_data.signal_row_count);
+    if (pod5_get_signal_row_indices(batch, row, read_data.signal_row_count, signal_rows.data()) !=
+        POD5_OK) {
+        spdlog::error("Failed to get read {} signal row indices: {}", row,
+                      pod5_get_error_string());
     }
 
     auto new_read = std::make_unique<SimplexRead>();
-    new_read->read_common.raw_data = samples;
+    new_read->read_common.raw_data_loader = [file, signal_rows = std::move(signal_rows),
+                                             num_samples = size_t(read_data.num_samples),
+                                             signal_arena, read_id = read_id_str]() mutable {
+        return load_pod5_signal(file.get(), signal_rows, num_samples, *signal_arena, read_id);
+    };
     new_read->read_common.sample_rate = run_sample_rate;
 
     auto start_time_ms = run_acquisition_start_time_ms +
@@ -829,20 +881,15 @@ void DataLoader::load_pod5_reads_from_file_by_read_ids(const std::string& path,
     // in the pod5 traversal API which persists unless the reader is opened
     // and closed everytime. So the caching logic was reverted until the
     // leak is fixed in pod5 API.
-    Pod5FileReader_t* file = pod5_open_file(path.c_str());
+    Pod5FileReader_t* raw_file = pod5_open_file(path.c_str());
 
-    if (!file) {
+    if (!raw_file) {
         spdlog::error("Failed to open file {}: {}", path, pod5_get_error_string());
         return;
     }
 
-    auto free_pod5 = [&]() {
-        if (pod5_close_and_free_reader(file) != POD5_OK) {
-            spdlog::error("Failed to close and free POD5 reader for file {}", path.c_str());
-        }
-    };
-
-    auto post = utils::PostCondition(free_pod5);
+    // Reads hold on to the file until they've loaded their signal.
+    std::shared_ptr<Pod5FileReader_t> file(raw_file, Pod5Destructor());
 
     std::vector<uint8_t> read_id_array(POD5_READ_ID_SIZE * read_ids.size());
     for (size_t i = 0; i < read_ids.size(); i++) {
@@ -851,14 +898,14 @@ void DataLoader::load_pod5_reads_from_file_by_read_ids(const std::string& path,
     }
 
     std::size_t batch_count = 0;
-    if (pod5_get_read_batch_count(&batch_count, file) != POD5_OK) {
+    if (pod5_get_read_batch_count(&batch_count, file.get()) != POD5_OK) {
         spdlog::error("Failed to query batch count: {}", pod5_get_error_string());
     }
 
     std::vector<std::uint32_t> traversal_batch_counts(batch_count);
     std::vector<std::uint32_t> traversal_batch_rows(read_ids.size());
     size_t find_success_count;
-    pod5_error_t err = pod5_plan_traversal(file, read_id_array.data(), read_ids.size(),
+    pod5_error_t err = pod5_plan_traversal(file.get(), read_id_array.data(), read_ids.size(),
                                            traversal_batch_counts.data(),
                                            traversal_batch_rows.data(), &find_success_count);
     if (err != POD5_OK) {
@@ -881,7 +928,7 @@ void DataLoader::load_pod5_reads_from_file_by_read_ids(const std::string& path,
             break;
         }
         Pod5ReadRecordBatch_t* batch = nullptr;
-        if (pod5_get_read_batch(&batch, file, batch_index) != POD5_OK) {
+        if (pod5_get_read_batch(&batch, file.get(), batch_index) != POD5_OK) {
             spdlog::error("Failed to get batch: {}", pod5_get_error_string());
             continue;
         }
@@ -893,7 +940,7 @@ void DataLoader::load_pod5_reads_from_file_by_read_ids(const std::string& path,
             if (can_process_pod5_row(batch, row, m_allowed_read_ids, m_ignored_read_ids)) {
                 futures.push_back(pool.push(process_pod5_thread_fn, row, batch, file,
                                             std::cref(path), std::cref(m_reads_by_channel),
-                                            std::cref(m_read_id_to_index)));
+                                            std::cref(m_read_id_to_index), m_signal_arena));
             }
         }
 
@@ -917,14 +964,18 @@ void DataLoader::load_pod5_reads_from_file(const std::string& path) {
     pod5_init();
 
     // Open the file ready for walking:
-    Pod5FileReader_t* file = pod5_open_file(path.c_str());
+    Pod5FileReader_t* raw_file = pod5_open_file(path.c_str());
 
-    if (!file) {
+    if (!raw_file) {
         spdlog::error("Failed to open file {}: {}", path, pod5_get_error_string());
+        return;
     }
 
+    // Reads hold on to the file until they've loaded their signal.
+    std::shared_ptr<Pod5FileReader_t> file(raw_file, Pod5Destructor());
+
     std::size_t batch_count = 0;
-    if (pod5_get_read_batch_count(&batch_count, file) != POD5_OK) {
+    if (pod5_get_read_batch_count(&batch_count, file.get()) != POD5_OK) {
         spdlog::error("Failed to query batch count: {}", pod5_get_error_string());
     }
 
@@ -935,7 +986,7 @@ void DataLoader::load_pod5_reads_from_file(const std::string& path) {
             break;
         }
         Pod5ReadRecordBatch_t* batch = nullptr;
-        if (pod5_get_read_batch(&batch, file, batch_index) != POD5_OK) {
+        if (pod5_get_read_batch(&batch, file.get(), batch_index) != POD5_OK) {
             spdlog::error("Failed to get batch: {}", pod5_get_error_string());
         }
 
@@ -953,7 +1004,7 @@ void DataLoader::load_pod5_reads_from_file(const std::string& path) {
             if (can_process_pod5_row(batch, int(row), m_allowed_read_ids, m_ignored_read_ids)) {
                 futures.push_back(pool.push(process_pod5_thread_fn, row, batch, file,
                                             std::cref(path), std::cref(m_reads_by_channel),
-                                            std::cref(m_read_id_to_index)));
+                                            std::cref(m_read_id_to_index), m_signal_arena));
             }
         }
 
@@ -969,9 +1020,6 @@ void DataLoader::load_pod5_reads_from_file(const std::string& path) {
             spdlog::error("Failed to release batch");
         }
     }
-    if (pod5_close_and_free_reader(file) != POD5_OK) {
-        spdlog::error("Failed to close and free POD5 reader");
-    }
 }
 
 void DataLoader::load_fast5_reads_from_file(const std::string& path) {
@@ -1018,8 +1066,7 @@ void DataLoader::load_fast5_reads_from_file(const std::string& path) {
                                      ds.getDataType().string());
         }
 
-        auto options = at::TensorOptions().dtype(at::kShort);
-        auto samples = at::empty(ds.getElementCount(), options);
+        auto samples = m_signal_arena->allocate(ds.getElementCount(), at::kShort);
         ds.read(samples.data_ptr<int16_t>());
 
         HighFive::Attribute mux_attr = raw.getAttribute("start_mux");
@@ -1102,7 +1149,8 @@ DataLoader::DataLoader(Pipeline& pipeline,
           m_device(device),
           m_num_worker_threads(num_worker_threads),
           m_allowed_read_ids(std::move(read_list)),
-          m_ignored_read_ids(std::move(read_ignore_list)) {
+          m_ignored_read_ids(std::move(read_ignore_list)),
+          m_signal_arena(utils::SignalArena::create({})) {
     m_max_reads = max_reads == 0 ? std::numeric_limits<decltype(m_max_reads)>::max() : max_reads;
     assert(m_num_worker_threads > 0);
     static std::once_flag vbz_init_flag;
@@ -1110,6 +1158,8 @@ DataLoader::DataLoader(Pipeline& pipeline,
 }
 
 stats::NamedStats DataLoader::sample_stats() const {
-    return stats::NamedStats{{"loaded_read_count", static_cast<double>(m_loaded_read_count)}};
+    auto stats = stats::from_obj(*m_signal_arena);
+    stats["loaded_read_count"] = static_cast<double>(m_loaded_read_count);
+    return stats;
 }
 }  // namespace dorado
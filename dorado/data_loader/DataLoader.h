@@ -20,6 +20,10 @@ struct Pod5FileReader;
 
 namespace dorado {
 
+namespace utils {
+class SignalArena;
+}
+
 class Pipeline;
 class ReadCommon;
 class SimplexRead;
@@ -111,6 +115,9 @@ private:
 
     std::vector<ReadInitialiserF> m_read_initialisers;
 
+    // Signal buffers are recycled once reads leave the pipeline.
+    std::shared_ptr<utils::SignalArena> m_signal_arena;
+
     // Issue warnings if read is potentially problematic
     void check_read(const SimplexReadPtr& read);
     // A flag to warn only once if the data chemsitry is known
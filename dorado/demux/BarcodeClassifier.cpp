@@ -3,6 +3,7 @@
 #include "barcoding_info.h"
 #include "utils/alignment_utils.h"
 #include "utils/barcode_kits.h"
+#include "utils/multi_pattern_edit_distance.h"
 #include "utils/sequence_utils.h"
 #include "utils/types.h"
 
@@ -108,6 +109,24 @@ int extract_barcode_penalty(std::string_view barcode,
     return penalty;
 }
 
+// Helper function to globally align every barcode in a kit to a region
+// within the read. The barcodes are scored together, except when tracing,
+// where each is aligned individually so that the alignments can be logged.
+std::vector<int> extract_barcode_penalties(const utils::MultiPatternEditDistance& barcodes,
+                                           std::string_view read,
+                                           const EdlibAlignConfig& config,
+                                           const char* debug_prefix) {
+    if (spdlog::get_level() != spdlog::level::trace) {
+        return barcodes.edit_distances(read);
+    }
+    std::vector<int> penalties;
+    penalties.reserve(barcodes.size());
+    for (const auto& barcode : barcodes.patterns()) {
+        penalties.push_back(extract_barcode_penalty(barcode, read, config, debug_prefix));
+    }
+    return penalties;
+}
+
 bool barcode_is_permitted(const demux::BarcodingInfo::FilterSet& allowed_barcodes,
                           const std::string& barcode_name) {
     if (!allowed_barcodes.has_value()) {
@@ -170,6 +189,12 @@ struct BarcodeClassifier::BarcodeCandidateKit {
     std::string bottom_context_rev_left_buffer;
     std::string bottom_context_rev_right_buffer;
     std::vector<std::string> barcode_names;
+    // The barcodes with the buffers from their context on either side, as they're
+    // aligned against the barcode region of a read.
+    utils::MultiPatternEditDistance top_barcodes;         // barcodes1 in top_context
+    utils::MultiPatternEditDistance top_barcodes_rev;     // barcodes1_rev in top_context_rev
+    utils::MultiPatternEditDistance bottom_barcodes;      // barcodes2 in bottom_context
+    utils::MultiPatternEditDistance bottom_barcodes_rev;  // barcodes2_rev in bottom_context_rev
     // This is the specific barcode kit product name
     // that is selected by the user, such as SQK-RBK114-96
     // or EXP-PBC096
@@ -311,6 +336,29 @@ std::vector<BarcodeClassifier::BarcodeCandidateKit> BarcodeClassifier::generate_
             candidate.barcode_names.push_back(bc_name);
         }
 
+        auto pad_barcodes = [](const std::vector<std::string>& barcodes,
+                               const std::string& left_buffer, const std::string& right_buffer) {
+            std::vector<std::string> padded_barcodes;
+            padded_barcodes.reserve(barcodes.size());
+            for (const auto& barcode : barcodes) {
+                padded_barcodes.push_back(
+                        std::string(left_buffer).append(barcode).append(right_buffer));
+            }
+            return utils::MultiPatternEditDistance(std::move(padded_barcodes));
+        };
+        candidate.top_barcodes =
+                pad_barcodes(candidate.barcodes1, candidate.top_context_left_buffer,
+                             candidate.top_context_right_buffer);
+        candidate.top_barcodes_rev =
+                pad_barcodes(candidate.barcodes1_rev, candidate.top_context_rev_left_buffer,
+                             candidate.top_context_rev_right_buffer);
+        candidate.bottom_barcodes =
+                pad_barcodes(candidate.barcodes2, candidate.bottom_context_left_buffer,
+                             candidate.bottom_context_right_buffer);
+        candidate.bottom_barcodes_rev =
+                pad_barcodes(candidate.barcodes2_rev, candidate.bottom_context_rev_left_buffer,
+                             candidate.bottom_context_rev_right_buffer);
+
         candidates_list.push_back(std::move(candidate));
     }
     spdlog::debug("> Kits to evaluate: {}", candidates_list.size());
@@ -408,20 +456,22 @@ std::vector<BarcodeScoreResult> BarcodeClassifier::calculate_barcode_score_diffe
     spdlog::trace("total v1 edit dist {}, total v2 edit dis {}", total_v1_penalty,
                   total_v2_penalty);
 
+    // Calculate barcode penalties for every barcode in both variants.
+    const auto top_mask_penalties_v1 = extract_barcode_penalties(
+            candidate.top_barcodes, top_mask_v1, mask_config, "top window v1");
+    const auto bottom_mask_penalties_v1 = extract_barcode_penalties(
+            candidate.bottom_barcodes_rev, bottom_mask_v1, mask_config, "bottom window v1");
+    const auto top_mask_penalties_v2 = extract_barcode_penalties(
+            candidate.bottom_barcodes, top_mask_v2, mask_config, "top window v2");
+    const auto bottom_mask_penalties_v2 = extract_barcode_penalties(
+            candidate.top_barcodes_rev, bottom_mask_v2, mask_config, "bottom window v2");
+
     std::vector<BarcodeScoreResult> results;
     for (size_t i = 0; i < candidate.barcodes1.size(); i++) {
-        const auto barcode1 = std::string(top_context_v1_left_buffer)
-                                      .append(candidate.barcodes1[i])
-                                      .append(top_context_v1_right_buffer);
-        const auto barcode1_rev = std::string(bottom_context_v2_left_buffer)
-                                          .append(candidate.barcodes1_rev[i])
-                                          .append(bottom_context_v2_right_buffer);
-        const auto barcode2 = std::string(top_context_v2_left_buffer)
-                                      .append(candidate.barcodes2[i])
-                                      .append(top_context_v2_right_buffer);
-        const auto barcode2_rev = std::string(bottom_context_v1_left_buffer)
-                                          .append(candidate.barcodes2_rev[i])
-                                          .append(bottom_context_v1_right_buffer);
+        const auto& barcode1 = candidate.top_barcodes.patterns()[i];
+        const auto& barcode1_rev = candidate.top_barcodes_rev.patterns()[i];
+        const auto& barcode2 = candidate.bottom_barcodes.patterns()[i];
+        const auto& barcode2_rev = candidate.bottom_barcodes_rev.patterns()[i];
         auto& barcode_name = candidate.barcode_names[i];
 
         if (!barcode_is_permitted(allowed_barcodes, barcode_name)) {
@@ -430,12 +480,9 @@ std::vector<BarcodeScoreResult> BarcodeClassifier::calculate_barcode_score_diffe
 
         spdlog::trace("Checking barcode {}", barcode_name);
 
-        // Calculate barcode penalties for v1.
-        auto top_mask_result_penalty_v1 =
-                extract_barcode_penalty(barcode1, top_mask_v1, mask_config, "top window v1");
-
-        auto bottom_mask_result_penalty_v1 = extract_barcode_penalty(
-                barcode2_rev, bottom_mask_v1, mask_config, "bottom window v1");
+        // Barcode penalties for v1.
+        auto top_mask_result_penalty_v1 = top_mask_penalties_v1[i];
+        auto bottom_mask_result_penalty_v1 = bottom_mask_penalties_v1[i];
 
         BarcodeScoreResult v1;
         v1.top_penalty = top_mask_result_penalty_v1;
@@ -452,12 +499,9 @@ std::vector<BarcodeScoreResult> BarcodeClassifier::calculate_barcode_score_diffe
         v1.bottom_barcode_pos = {bottom_start + bottom_result_v1.startLocations[0],
                                  bottom_start + bottom_result_v1.endLocations[0]};
 
-        // Calculate barcode penalties for v2.
-        auto top_mask_result_penalty_v2 =
-                extract_barcode_penalty(barcode2, top_mask_v2, mask_config, "top window v2");
-
-        auto bottom_mask_result_penalty_v2 = extract_barcode_penalty(
-                barcode1_rev, bottom_mask_v2, mask_config, "bottom window v2");
+        // Barcode penalties for v2.
+        auto top_mask_result_penalty_v2 = top_mask_penalties_v2[i];
+        auto bottom_mask_result_penalty_v2 = bottom_mask_penalties_v2[i];
 
         BarcodeScoreResult v2;
         v2.top_penalty = top_mask_result_penalty_v2;
@@ -610,14 +654,15 @@ std::vector<BarcodeScoreResult> BarcodeClassifier::calculate_barcode_score_doubl
     std::string_view bottom_mask =
             read_bottom.substr(bottom_start_idx, bottom_end_idx - bottom_start_idx);
 
+    const auto top_mask_penalties =
+            extract_barcode_penalties(candidate.top_barcodes, top_mask, mask_config, "top window");
+    const auto bottom_mask_penalties = extract_barcode_penalties(
+            candidate.top_barcodes_rev, bottom_mask, mask_config, "bottom window");
+
     std::vector<BarcodeScoreResult> results;
     for (size_t i = 0; i < candidate.barcodes1.size(); i++) {
-        auto barcode = std::string(top_left_buffer)
-                               .append(candidate.barcodes1[i])
-                               .append(top_right_buffer);
-        auto barcode_rev = std::string(bottom_left_buffer)
-                                   .append(candidate.barcodes1_rev[i])
-                                   .append(bottom_right_buffer);
+        const auto& barcode = candidate.top_barcodes.patterns()[i];
+        const auto& barcode_rev = candidate.top_barcodes_rev.patterns()[i];
         auto& barcode_name = candidate.barcode_names[i];
 
         if (!barcode_is_permitted(allowed_barcodes, barcode_name)) {
@@ -625,11 +670,8 @@ std::vector<BarcodeScoreResult> BarcodeClassifier::calculate_barcode_score_doubl
         }
         spdlog::trace("Checking barcode {}", barcode_name);
 
-        auto top_mask_penalty =
-                extract_barcode_penalty(barcode, top_mask, mask_config, "top window");
-
-        auto bottom_mask_penalty =
-                extract_barcode_penalty(barcode_rev, bottom_mask, mask_config, "bottom window");
+        auto top_mask_penalty = top_mask_penalties[i];
+        auto bottom_mask_penalty = bottom_mask_penalties[i];
 
         BarcodeScoreResult res;
         res.barcode_name = barcode_name;
@@ -735,10 +777,12 @@ std::vector<BarcodeScoreResult> BarcodeClassifier::calculate_barcode_score(
 
     spdlog::trace("BC location {}", top_bc_loc);
 
+    const auto top_mask_penalties =
+            extract_barcode_penalties(candidate.top_barcodes, top_mask, mask_config, "top window");
+
     std::vector<BarcodeScoreResult> results;
     for (size_t i = 0; i < candidate.barcodes1.size(); i++) {
-        const auto barcode = candidate.top_context_left_buffer + candidate.barcodes1[i] +
-                             candidate.top_context_right_buffer;
+        const auto& barcode = candidate.top_barcodes.patterns()[i];
         auto& barcode_name = candidate.barcode_names[i];
 
         if (!barcode_is_permitted(allowed_barcodes, barcode_name)) {
@@ -746,8 +790,7 @@ std::vector<BarcodeScoreResult> BarcodeClassifier::calculate_barcode_score(
         }
         spdlog::trace("Checking barcode {}", barcode_name);
 
-        auto top_mask_penalty =
-                extract_barcode_penalty(barcode, top_mask, mask_config, "top window");
+        auto top_mask_penalty = top_mask_penalties[i];
 
         BarcodeScoreResult res;
         res.barcode_name = barcode_name;
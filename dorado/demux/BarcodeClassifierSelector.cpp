@@ -6,25 +6,94 @@
 #include <spdlog/spdlog.h>
 
 #include <cassert>
+#include <filesystem>
+#include <iterator>
+#include <mutex>
+#include <system_error>
+#include <unordered_map>
 
 namespace dorado::demux {
 
+namespace {
+
+// Identifies the kit(s) a client asked for.
+std::string make_kit_id(const BarcodingInfo& barcode_kit_info) {
+    std::string kit_id = barcode_kit_info.kit_name;
+    for (const auto& path : {barcode_kit_info.custom_kit, barcode_kit_info.custom_seqs}) {
+        kit_id += '\n';
+        kit_id += path.value_or("");
+    }
+    return kit_id;
+}
+
+// Identifies the compiled classifier for a kit id.  Custom kit and sequence files are also
+// identified by their modification time, so that a file which is edited while the process is
+// running, e.g. between clients of a server, is compiled again.
+std::string make_compiled_kit_key(const BarcodingInfo& barcode_kit_info,
+                                  const std::string& kit_id) {
+    std::string key = kit_id;
+    for (const auto& path : {barcode_kit_info.custom_kit, barcode_kit_info.custom_seqs}) {
+        if (path) {
+            std::error_code error;
+            const auto write_time = std::filesystem::last_write_time(*path, error);
+            key += '\n';
+            key += error ? "" : std::to_string(write_time.time_since_epoch().count());
+        }
+    }
+    return key;
+}
+
+// Compiled classifiers are shared by every selector in the process, so that all of the nodes
+// and clients using a kit share a single copy.  A classifier is kept alive by the selectors
+// which use it, and compiled again if it's requested after they've all gone.
+class CompiledKits {
+public:
+    std::shared_ptr<const BarcodeClassifier> get(const std::string& key,
+                                                 const BarcodingInfo& barcode_kit_info) {
+        std::lock_guard lock(m_mutex);
+        for (auto it = m_classifiers.begin(); it != m_classifiers.end();) {
+            it = it->second.expired() && it->first != key ? m_classifiers.erase(it) : std::next(it);
+        }
+        auto& entry = m_classifiers[key];
+        auto classifier = entry.lock();
+        if (!classifier) {
+            spdlog::debug("Compiling barcode kit {}",
+                          barcode_kit_info.kit_name.empty() ? *barcode_kit_info.custom_kit
+                                                            : barcode_kit_info.kit_name);
+            KitInfoProvider kit_info_provider(
+                    barcode_kit_info.kit_name.empty()
+                            ? std::vector<std::string>{}
+                            : std::vector<std::string>{barcode_kit_info.kit_name},
+                    barcode_kit_info.custom_kit, barcode_kit_info.custom_seqs);
+            classifier = std::make_shared<const BarcodeClassifier>(std::move(kit_info_provider));
+            entry = classifier;
+        }
+        return classifier;
+    }
+
+private:
+    std::mutex m_mutex;
+    std::unordered_map<std::string, std::weak_ptr<const BarcodeClassifier>> m_classifiers;
+};
+
+CompiledKits& compiled_kits() {
+    static CompiledKits kits;
+    return kits;
+}
+
+}  // namespace
+
 std::shared_ptr<const BarcodeClassifier> BarcodeClassifierSelector::get_barcoder(
         const BarcodingInfo& barcode_kit_info) {
     if (barcode_kit_info.kit_name.empty() && !barcode_kit_info.custom_kit.has_value()) {
         throw std::runtime_error("Either kit name or custom kit file must be specified!");
     }
-    const auto kit_id = barcode_kit_info.kit_name.empty() ? *barcode_kit_info.custom_kit
-                                                          : barcode_kit_info.kit_name;
+    const auto kit_id = make_kit_id(barcode_kit_info);
     std::lock_guard<std::mutex> lock(m_mutex);
     auto& barcoder = m_barcoder_lut[kit_id];
     if (!barcoder) {
-        KitInfoProvider kit_info_provider(
-                barcode_kit_info.kit_name.empty()
-                        ? std::vector<std::string>{}
-                        : std::vector<std::string>{barcode_kit_info.kit_name},
-                barcode_kit_info.custom_kit, barcode_kit_info.custom_seqs);
-        barcoder = std::make_shared<const BarcodeClassifier>(std::move(kit_info_provider));
+        barcoder = compiled_kits().get(make_compiled_kit_key(barcode_kit_info, kit_id),
+                                       barcode_kit_info);
     }
     return barcoder;
 }
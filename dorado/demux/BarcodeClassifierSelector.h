@@ -10,6 +10,8 @@ namespace dorado::demux {
 class BarcodeClassifier;
 struct BarcodingInfo;
 
+// Provides the classifier for a client's kit.  Classifiers are compiled once per kit and are
+// immutable, so they're shared by every thread, and by every selector in the process.
 class BarcodeClassifierSelector final {
     std::mutex m_mutex{};
     std::unordered_map<std::string, std::shared_ptr<const BarcodeClassifier>> m_barcoder_lut{};
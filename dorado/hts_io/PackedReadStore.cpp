@@ -0,0 +1,190 @@
+#include "PackedReadStore.h"
+
+#include "read_pipeline/HtsReader.h"
+#include "utils/PostCondition.h"
+
+#include <htslib/sam.h>
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+
+namespace {
+
+constexpr char BASES[] = "ACGT";
+
+// Maps htslib's 4-bit base codes to 2-bit ones, or -1 for bases other than ACGT.
+constexpr std::array<int8_t, 16> NT16_TO_CODE{-1, 0, 1, -1, 2, -1, -1, -1,
+                                              3,  -1, -1, -1, -1, -1, -1, -1};
+
+// The 4 bases packed into each possible byte, first base in the low bits.
+constexpr auto UNPACKED_BYTES = [] {
+    std::array<std::array<char, 4>, 256> unpacked{};
+    for (size_t byte = 0; byte < unpacked.size(); ++byte) {
+        for (size_t i = 0; i < 4; ++i) {
+            unpacked[byte][i] = BASES[(byte >> (2 * i)) & 3];
+        }
+    }
+    return unpacked;
+}();
+
+// Typical ratio of the sizes of a FASTQ file before and after gzip compression.
+constexpr uint64_t GZIP_COMPRESSION_RATIO = 3;
+
+bool is_gzipped(const std::filesystem::path& path) {
+    std::ifstream file(path, std::ios::binary);
+    std::array<char, 2> magic{};
+    return file.read(magic.data(), magic.size()) && uint8_t(magic[0]) == 0x1f &&
+           uint8_t(magic[1]) == 0x8b;
+}
+
+std::filesystem::path unique_store_path(const std::filesystem::path& temp_dir) {
+    std::random_device device;
+    std::mt19937 rng(device());
+    std::uniform_int_distribution<unsigned long long> rand(0);
+    std::filesystem::path path;
+    do {
+        std::stringstream ss;
+        ss << "dorado_reads_" << std::hex << rand(rng) << ".bin";
+        path = temp_dir / ss.str();
+    } while (std::filesystem::exists(path));
+    return path;
+}
+
+}  // namespace
+
+namespace dorado::hts_io {
+
+PackedReadStore::PackedReadStore(const std::string& fastx_path,
+                                 const std::filesystem::path& temp_dir)
+        : m_store_path(unique_store_path(temp_dir)) {
+    // The destructor won't run if construction throws, so remove any partial store here.
+    bool constructed = false;
+    auto remove_partial_store = utils::PostCondition([this, &constructed] {
+        if (!constructed) {
+            std::error_code error;
+            std::filesystem::remove(m_store_path, error);
+        }
+    });
+
+    {
+        std::ofstream store(m_store_path, std::ios::binary);
+        if (!store) {
+            throw std::runtime_error("Could not create read store " + m_store_path.string());
+        }
+
+        HtsReader reader(fastx_path, std::nullopt);
+        std::vector<uint8_t> packed;
+        uint64_t offset = 0;
+        while (reader.read()) {
+            const bam1_t* record = reader.record.get();
+            std::string name = bam_get_qname(record);
+            if (m_read_indices.count(name) > 0) {
+                spdlog::warn("Ignoring duplicate read {} in {}", name, fastx_path);
+                continue;
+            }
+
+            const auto length = static_cast<uint32_t>(record->core.l_qseq);
+            const size_t packed_length = (length + 3) / 4;
+            Read read{offset, m_exceptions.size(), length, 0};
+
+            // Sequence then qualities.
+            packed.assign(packed_length + length, 0);
+            const uint8_t* seq = bam_get_seq(record);
+            for (uint32_t i = 0; i < length; ++i) {
+                const uint8_t nt16 = bam_seqi(seq, i);
+                int8_t code = NT16_TO_CODE[nt16];
+                if (code < 0) {
+                    m_exceptions.push_back({i, seq_nt16_str[nt16]});
+                    ++read.num_exceptions;
+                    code = 0;
+                }
+                packed[i / 4] |= static_cast<uint8_t>(code << (2 * (i % 4)));
+            }
+            std::copy_n(bam_get_qual(record), length, packed.begin() + packed_length);
+            store.write(reinterpret_cast<const char*>(packed.data()), packed.size());
+            offset += packed.size();
+
+            m_reads.push_back(read);
+            m_names.push_back(std::move(name));
+            m_read_indices.emplace(m_names.back(), m_reads.size() - 1);
+        }
+
+        if (!store.flush()) {
+            throw std::runtime_error("Could not write read store " + m_store_path.string());
+        }
+    }
+    spdlog::debug("Packed {} reads from {} into {}", m_reads.size(), fastx_path,
+                  m_store_path.string());
+
+    m_store = std::make_unique<utils::MappedFile>(m_store_path);
+    constructed = true;
+
+    // Where the platform allows it, remove the file now that it's mapped, so that it's cleaned
+    // up however the process exits.
+    std::error_code error;
+    if (std::filesystem::remove(m_store_path, error)) {
+        m_store_path.clear();
+    }
+}
+
+uint64_t PackedReadStore::estimate_file_bytes(const std::filesystem::path& fastx_path) {
+    uint64_t file_bytes = std::filesystem::file_size(fastx_path);
+    if (is_gzipped(fastx_path)) {
+        file_bytes *= GZIP_COMPRESSION_RATIO;
+    }
+    // Every base of a FASTQ record takes a byte for the base and one for its quality, and the
+    // store keeps a quarter of a byte for the base and one for its quality.
+    const uint64_t num_bases = file_bytes / 2;
+    return num_bases + num_bases / 4;
+}
+
+PackedReadStore::~PackedReadStore() {
+    m_store.reset();
+    if (!m_store_path.empty()) {
+        std::error_code error;
+        std::filesystem::remove(m_store_path, error);
+    }
+}
+
+std::optional<size_t> PackedReadStore::find(std::string_view read_name) const {
+    auto it = m_read_indices.find(read_name);
+    if (it == m_read_indices.end()) {
+        return std::nullopt;
+    }
+    return it->second;
+}
+
+void PackedReadStore::get_seq(size_t read_idx, std::string& seq) const {
+    const Read& read = m_reads[read_idx];
+    seq.resize(read.length);
+    const uint8_t* packed = m_store->data() + read.offset;
+    const size_t num_full_bytes = read.length / 4;
+    for (size_t i = 0; i < num_full_bytes; ++i) {
+        std::memcpy(&seq[4 * i], UNPACKED_BYTES[packed[i]].data(), 4);
+    }
+    for (size_t i = 4 * num_full_bytes; i < read.length; ++i) {
+        seq[i] = UNPACKED_BYTES[packed[num_full_bytes]][i % 4];
+    }
+    for (uint64_t e = read.first_exception; e < read.first_exception + read.num_exceptions; ++e) {
+        seq[m_exceptions[e].pos] = m_exceptions[e].base;
+    }
+}
+
+std::string PackedReadStore::seq(size_t read_idx) const {
+    std::string seq;
+    get_seq(read_idx, seq);
+    return seq;
+}
+
+const uint8_t* PackedReadStore::qual(size_t read_idx) const {
+    const Read& read = m_reads[read_idx];
+    return m_store->data() + read.offset + (read.length + 3) / 4;
+}
+
+}  // namespace dorado::hts_io
@@ -0,0 +1,76 @@
+#pragma once
+
+#include "utils/mapped_file.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Class to hold every read of a FASTx file for random access, so that the
+// file only has to be parsed once however many times the reads are used.
+
+namespace dorado::hts_io {
+
+// The reads are packed into a file at 2 bits per base and a byte per quality score, which is
+// then memory-mapped, so that the OS pages them in as they're used rather than the whole of a
+// large input being held in memory.  Bases other than ACGT are kept to one side, along with the
+// read names.
+//
+// Thread safe once constructed.
+class PackedReadStore {
+public:
+    // Reads every record of fastx_path, and packs them into a file in temp_dir.
+    PackedReadStore(const std::string& fastx_path, const std::filesystem::path& temp_dir);
+    ~PackedReadStore();
+
+    // Rough upper bound on the size of the file a store of fastx_path would need, at 1.25 bytes
+    // per base.  The number of bases is estimated from the size of the input, so this is only
+    // approximate for compressed inputs.
+    static uint64_t estimate_file_bytes(const std::filesystem::path& fastx_path);
+
+    size_t size() const { return m_reads.size(); }
+
+    // Returns the index of the read with the given name, if it's in the store.
+    std::optional<size_t> find(std::string_view read_name) const;
+
+    const std::string& name(size_t read_idx) const { return m_names[read_idx]; }
+    size_t length(size_t read_idx) const { return m_reads[read_idx].length; }
+
+    // Decodes the sequence of the read into seq, reusing its storage.
+    void get_seq(size_t read_idx, std::string& seq) const;
+    std::string seq(size_t read_idx) const;
+
+    // The read's quality scores, without the +33 offset, as a view into the store.
+    const uint8_t* qual(size_t read_idx) const;
+
+private:
+    struct Read {
+        uint64_t offset;
+        uint64_t first_exception;
+        uint32_t length;
+        uint32_t num_exceptions;
+    };
+    // A base which doesn't fit in 2 bits.
+    struct Exception {
+        uint32_t pos;
+        char base;
+    };
+
+    std::vector<Read> m_reads;
+    std::vector<Exception> m_exceptions;
+    // A deque, so that the views in m_read_indices stay valid as names are added.
+    std::deque<std::string> m_names;
+    std::unordered_map<std::string_view, size_t> m_read_indices;
+
+    std::filesystem::path m_store_path;
+    std::unique_ptr<utils::MappedFile> m_store;
+};
+
+}  // namespace dorado::hts_io
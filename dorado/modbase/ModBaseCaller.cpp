@@ -44,7 +44,6 @@ ModBaseCaller::ModBaseData::ModBaseData(const ModBaseModelConfig& config,
                                         const int batch_size_)
         : params(config),
           module_holder(load_modbase_model(params, opts)),
-          matcher(params),
           batch_size(batch_size_) {
     if (params.refine.do_rough_rescale) {
         scaler = std::make_unique<ModBaseScaler>(params.refine.levels, params.refine.kmer_len,
@@ -69,10 +68,6 @@ ModBaseCaller::ModBaseData::ModBaseData(const ModBaseModelConfig& config,
 #endif
 }
 
-std::vector<size_t> ModBaseCaller::ModBaseData::get_motif_hits(const std::string& seq) const {
-    return matcher.get_motif_hits(seq);
-}
-
 ModBaseCaller::ModBaseCaller(const std::vector<std::filesystem::path>& model_paths,
                              int batch_size,
                              const std::string& device)
@@ -109,6 +104,12 @@ ModBaseCaller::ModBaseCaller(const std::vector<std::filesystem::path>& model_pat
         m_caller_data.push_back(std::move(caller_data));
     }
 
+    std::vector<std::pair<std::string, size_t>> motifs;
+    for (const auto& caller_data : m_caller_data) {
+        motifs.emplace_back(caller_data->params.mods.motif, caller_data->params.mods.motif_offset);
+    }
+    m_motif_matcher = std::make_unique<const MultiMotifMatcher>(motifs);
+
     start_threads();
 }
 
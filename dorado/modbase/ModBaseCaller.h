@@ -34,14 +34,12 @@ public:
         ModBaseData(const ModBaseModelConfig& config,
                     const at::TensorOptions& opts,
                     const int batch_size_);
-        std::vector<size_t> get_motif_hits(const std::string& seq) const;
 
         const ModBaseModelConfig params;
         std::unique_ptr<ModBaseScaler> scaler;
 
     private:
         torch::nn::ModuleHolder<torch::nn::AnyModule> module_holder;
-        const MotifMatcher matcher;
         std::deque<std::shared_ptr<ModBaseTask>> input_queue;
         std::mutex input_lock;
         std::condition_variable input_cv;
@@ -79,6 +77,9 @@ public:
     }
     size_t num_model_callers() const { return m_caller_data.size(); }
 
+    // Matches the motifs of all of the models, indexed by model id, in one pass.
+    const MultiMotifMatcher& motif_matcher() const { return *m_motif_matcher; }
+
 private:
     void start_threads();
     void modbase_task_thread_fn(size_t model_id);
@@ -88,6 +89,7 @@ private:
     at::TensorOptions m_options;
     std::atomic<bool> m_terminate{false};
     std::vector<std::unique_ptr<ModBaseData>> m_caller_data;
+    std::unique_ptr<const MultiMotifMatcher> m_motif_matcher;
     std::vector<std::thread> m_task_threads;
 
     // Performance monitoring stats.
@@ -3,6 +3,7 @@
 #include "ModBaseCaller.h"
 #include "ModBaseModelConfig.h"
 #include "ModbaseScaler.h"
+#include "encode_kmer.h"
 #include "torch_utils/tensor_utils.h"
 #include "utils/sequence_utils.h"
 
@@ -45,7 +46,8 @@ ModBaseRunner::ModBaseRunner(std::shared_ptr<ModBaseCaller> caller)
 void ModBaseRunner::accept_chunk(int model_id,
                                  int chunk_idx,
                                  const at::Tensor& signal,
-                                 const std::vector<int8_t>& kmers) {
+                                 const std::vector<int>& kmer_seq_ints,
+                                 const std::vector<uint64_t>& kmer_seq_to_sig) {
     // As usual, avoid torch indexing because it is glacially slow.
     // GPU base calling uses float16 signals and input tensors.
     // CPU base calling uses float16 signals, float32 input tensors.
@@ -64,8 +66,13 @@ void ModBaseRunner::accept_chunk(int model_id,
     }
     using SeqInputType = int8_t;
     SeqInputType* const input_seqs_ptr = input_seqs.data_ptr<SeqInputType>();
-    std::memcpy(&input_seqs_ptr[chunk_idx * kmer_elem_count], kmers.data(),
-                kmer_elem_count * sizeof(SeqInputType));
+
+    // Encode the kmers straight into this chunk's slot of the input tensor.
+    const auto& context = caller_params(model_id).context;
+    assert(kmer_elem_count ==
+           int64_t(context.samples * context.kmer_len * utils::BaseInfo::NUM_BASES));
+    encode_kmer_context(kmer_seq_ints, kmer_seq_to_sig, context.bases_before, context.bases_after,
+                        context.samples, &input_seqs_ptr[chunk_idx * kmer_elem_count]);
 }
 
 at::Tensor ModBaseRunner::call_chunks(int model_id, int num_chunks) {
@@ -87,9 +94,7 @@ at::Tensor ModBaseRunner::scale_signal(size_t caller_id,
     return signal;
 }
 
-std::vector<size_t> ModBaseRunner::get_motif_hits(size_t caller_id, const std::string& seq) const {
-    return m_caller->caller_data(caller_id)->get_motif_hits(seq);
-}
+const MultiMotifMatcher& ModBaseRunner::motif_matcher() const { return m_caller->motif_matcher(); }
 
 const ModBaseModelConfig& ModBaseRunner::caller_params(size_t caller_id) const {
     return m_caller->caller_data(caller_id)->params;
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "MotifMatcher.h"
 #include "utils/stats.h"
 
 #include <ATen/core/TensorBody.h>
@@ -22,13 +23,14 @@ public:
     void accept_chunk(int model_id,
                       int chunk_idx,
                       const at::Tensor& signal,
-                      const std::vector<int8_t>& kmers);
+                      const std::vector<int>& kmer_seq_ints,
+                      const std::vector<uint64_t>& kmer_seq_to_sig);
     at::Tensor call_chunks(int model_id, int num_chunks);
     at::Tensor scale_signal(size_t caller_id,
                             at::Tensor signal,
                             const std::vector<int>& seq_ints,
                             const std::vector<uint64_t>& seq_to_sig_map) const;
-    std::vector<size_t> get_motif_hits(size_t caller_id, const std::string& seq) const;
+    const MultiMotifMatcher& motif_matcher() const;
     const ModBaseModelConfig& caller_params(size_t caller_id) const;
     size_t num_callers() const;
     size_t batch_size() const { return m_input_sigs[0].size(0); }
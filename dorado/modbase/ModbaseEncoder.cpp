@@ -45,6 +45,13 @@ void ModBaseEncoder::init(const std::vector<int>& sequence_ints,
 
 ModBaseEncoder::Context ModBaseEncoder::get_context(size_t seq_pos) const {
     NVTX3_FUNC_RANGE();
+    auto context = get_unencoded_context(seq_pos);
+    context.data.resize(encoded_size());
+    encode_context(context, context.data.data());
+    return context;
+}
+
+ModBaseEncoder::Context ModBaseEncoder::get_unencoded_context(size_t seq_pos) const {
     if (seq_pos >= size_t(m_seq_len)) {
         throw std::out_of_range("Sequence position out of range.");
     }
@@ -77,8 +84,7 @@ ModBaseEncoder::Context ModBaseEncoder::get_context(size_t seq_pos) const {
     auto seq_start = std::distance(m_sample_offsets.begin(), start_it) - 1;
     auto seq_end = std::distance(m_sample_offsets.begin(), end_it);
 
-    std::vector<int> seq_ints;
-
+    auto& seq_ints = context.seq_ints;
     if (seq_start >= m_bases_before &&
         seq_end + m_bases_after < static_cast<int>(m_sequence_ints.size())) {
         seq_ints = {m_sequence_ints.begin() + seq_start - m_bases_before,
@@ -99,20 +105,27 @@ ModBaseEncoder::Context ModBaseEncoder::get_context(size_t seq_pos) const {
                   seq_ints.begin() + fill_st);
     }
 
-    std::vector<uint64_t> chunk_seq_to_sig = {m_sample_offsets.begin() + seq_start,
-                                              m_sample_offsets.begin() + seq_end + 1};
+    auto& chunk_seq_to_sig = context.seq_to_sig;
+    chunk_seq_to_sig = {m_sample_offsets.begin() + seq_start,
+                        m_sample_offsets.begin() + seq_end + 1};
     std::transform(
             chunk_seq_to_sig.begin(), chunk_seq_to_sig.end(), chunk_seq_to_sig.begin(),
             [sig_start = context.first_sample, seq_to_sig_offset = context.lead_samples_needed](
                     auto val) { return val -= int(sig_start - seq_to_sig_offset); });
     chunk_seq_to_sig.front() = 0;
     chunk_seq_to_sig.back() = m_context_samples;
-
-    context.data = encode_kmer_context(seq_ints, chunk_seq_to_sig, m_bases_before, m_bases_after,
-                                       m_context_samples);
     return context;
 }
 
+void ModBaseEncoder::encode_context(const Context& context, int8_t* output) const {
+    encode_kmer_context(context.seq_ints, context.seq_to_sig, m_bases_before, m_bases_after,
+                        m_context_samples, output);
+}
+
+size_t ModBaseEncoder::encoded_size() const {
+    return size_t(m_kmer_len) * utils::BaseInfo::NUM_BASES * m_context_samples;
+}
+
 int ModBaseEncoder::sample_pos(int base_pos) const {
     if (m_base_start_justified) {
         // The sample position of the context base.
@@ -56,6 +56,8 @@ public:
         size_t num_existing_samples;  ///< Number of samples of raw data in the slice that already exist.
         size_t lead_samples_needed;  ///< Number of samples, if any, to pad the beginning of the raw data slice with.
         size_t tail_samples_needed;  ///< Number of samples, if any, to pad the end of the raw data slice with.
+        std::vector<int> seq_ints;  ///< Bases from which the slice is encoded, with -1 for positions off the read.
+        std::vector<uint64_t> seq_to_sig;  ///< Sample in the slice at which each kmer of seq_ints begins.
     };
 
     /** Get the encoded data of the context centered on a specified sequence position.
@@ -68,6 +70,19 @@ public:
      *  The data is arranged in Feature-Time order i.e each column corresponds to the kmer at a given sample.
      */
     Context get_context(size_t seq_pos) const;
+
+    /** As get_context, but without generating the encoded data, which can then be written
+     *  straight to its destination with encode_context.
+     */
+    Context get_unencoded_context(size_t seq_pos) const;
+
+    /** Write the encoded data of a context into output.
+     *  @param output Destination with room for encoded_size() entries, e.g. a slot of a model input tensor.
+     */
+    void encode_context(const Context& context, int8_t* output) const;
+
+    /// The number of entries in the encoded data of a context.
+    size_t encoded_size() const;
 };
 
 }  // namespace dorado::modbase
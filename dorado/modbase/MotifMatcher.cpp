@@ -4,8 +4,10 @@
 
 #include <nvtx3/nvtx3.hpp>
 
+#include <algorithm>
 #include <iterator>
 #include <regex>
+#include <stdexcept>
 #include <unordered_map>
 
 namespace {
@@ -31,6 +33,21 @@ const std::unordered_map<char, std::string> IUPAC_CODES =
                 // clang-format on
 };
 
+const std::unordered_map<char, char> IUPAC_COMPLEMENTS = {
+        {'A', 'T'}, {'C', 'G'}, {'G', 'C'}, {'T', 'A'}, {'U', 'A'}, {'R', 'Y'},
+        {'Y', 'R'}, {'S', 'S'}, {'W', 'W'}, {'K', 'M'}, {'M', 'K'}, {'B', 'V'},
+        {'D', 'H'}, {'H', 'D'}, {'V', 'B'}, {'N', 'N'},
+};
+
+std::string reverse_complement_motif(const std::string& motif) {
+    std::string rc_motif;
+    rc_motif.reserve(motif.size());
+    for (auto it = motif.rbegin(); it != motif.rend(); ++it) {
+        rc_motif += IUPAC_COMPLEMENTS.at(*it);
+    }
+    return rc_motif;
+}
+
 std::string expand_motif_regex(const std::string& motif) {
     std::string motif_regex = "(";
     for (auto base : motif) {
@@ -69,4 +86,120 @@ std::vector<size_t> MotifMatcher::get_motif_hits(std::string_view seq) const {
     return context_hits;
 }
 
+MultiMotifMatcher::MultiMotifMatcher(const std::vector<std::pair<std::string, size_t>>& motifs)
+        : m_num_motifs(motifs.size()) {
+    std::vector<std::string> patterns;
+    for (const auto& [motif, offset] : motifs) {
+        if (motif.empty() || offset >= motif.size()) {
+            throw std::runtime_error("Invalid motif '" + motif + "' with offset " +
+                                     std::to_string(offset) + ".");
+        }
+        patterns.push_back(motif);
+        m_patterns.push_back({motif.size(), offset});
+    }
+    for (const auto& [motif, offset] : motifs) {
+        patterns.push_back(reverse_complement_motif(motif));
+        m_patterns.push_back({motif.size(), motif.size() - 1 - offset});
+    }
+
+    // Lay out the patterns' bits, starting the reverse complements on a new word.
+    std::vector<size_t> first_bits;
+    size_t num_bits = 0;
+    for (size_t i = 0; i < patterns.size(); ++i) {
+        if (i == m_num_motifs) {
+            m_num_forward_words = (num_bits + 63) / 64;
+            num_bits = m_num_forward_words * 64;
+        }
+        first_bits.push_back(num_bits);
+        num_bits += patterns[i].size();
+    }
+    m_num_words = (num_bits + 63) / 64;
+
+    m_char_masks.assign(256 * m_num_words, 0);
+    m_start_bits.assign(m_num_words, 0);
+    m_end_bits.assign(m_num_words, 0);
+    m_word_end_bits.resize(m_num_words);
+    auto bit_mask = [](size_t bit) { return uint64_t{1} << (bit % 64); };
+    for (size_t i = 0; i < patterns.size(); ++i) {
+        const auto& pattern = patterns[i];
+        for (size_t pos = 0; pos < pattern.size(); ++pos) {
+            const size_t bit = first_bits[i] + pos;
+            // The IUPAC regex is either a single base or a bracketed set of them.
+            for (const char base : IUPAC_CODES.at(pattern[pos])) {
+                if (base != '[' && base != ']') {
+                    m_char_masks[static_cast<uint8_t>(base) * m_num_words + bit / 64] |= bit_mask(bit);
+                }
+            }
+        }
+        const size_t start_bit = first_bits[i];
+        const size_t end_bit = first_bits[i] + pattern.size() - 1;
+        m_start_bits[start_bit / 64] |= bit_mask(start_bit);
+        m_end_bits[end_bit / 64] |= bit_mask(end_bit);
+        m_word_end_bits[end_bit / 64].push_back({bit_mask(end_bit), i});
+    }
+}
+
+MultiMotifMatcher::Hits MultiMotifMatcher::get_motif_hits(std::string_view seq,
+                                                          Hits* rc_hits) const {
+    NVTX3_FUNC_RANGE();
+    Hits hits(m_num_motifs);
+    if (rc_hits) {
+        rc_hits->assign(m_num_motifs, {});
+    }
+
+    // Bit b of the state is set if the pattern position at b matches the sequence ending at the
+    // current base.  Each step extends the partial matches by a base, and starts new ones.
+    const size_t num_words = rc_hits ? m_num_words : m_num_forward_words;
+    std::vector<uint64_t> state(num_words, 0);
+    for (size_t i = 0; i < seq.size(); ++i) {
+        const uint64_t* char_masks = &m_char_masks[static_cast<uint8_t>(seq[i]) * m_num_words];
+        uint64_t carry = 0;
+        for (size_t word = 0; word < num_words; ++word) {
+            const uint64_t next_carry = state[word] >> 63;
+            state[word] = ((state[word] << 1) | carry | m_start_bits[word]) & char_masks[word];
+            carry = next_carry;
+
+            if ((state[word] & m_end_bits[word]) == 0) {
+                continue;
+            }
+            for (const auto& [mask, pattern_idx] : m_word_end_bits[word]) {
+                if ((state[word] & mask) == 0) {
+                    continue;
+                }
+                const auto& pattern = m_patterns[pattern_idx];
+                const size_t pattern_start = i + 1 - pattern.length;
+                if (pattern_idx < m_num_motifs) {
+                    hits[pattern_idx].push_back(pattern_start + pattern.offset);
+                } else {
+                    // Position in the reverse complement of the pattern's canonical base.
+                    const size_t rc_hit = seq.size() - 1 - (pattern_start + pattern.offset);
+                    (*rc_hits)[pattern_idx - m_num_motifs].push_back(rc_hit);
+                }
+            }
+        }
+    }
+
+    if (rc_hits) {
+        for (auto& motif_hits : *rc_hits) {
+            std::reverse(motif_hits.begin(), motif_hits.end());
+        }
+    }
+    return hits;
+}
+
+std::vector<size_t> MultiMotifMatcher::hits_within(size_t motif_idx,
+                                                   const std::vector<size_t>& hits,
+                                                   size_t start,
+                                                   size_t length) const {
+    const auto& pattern = m_patterns.at(motif_idx);
+    std::vector<size_t> hits_in_range;
+    for (const size_t hit : hits) {
+        const size_t pattern_start = hit - pattern.offset;
+        if (pattern_start >= start && pattern_start + pattern.length <= start + length) {
+            hits_in_range.push_back(hit - start);
+        }
+    }
+    return hits_in_range;
+}
+
 }  // namespace dorado::modbase
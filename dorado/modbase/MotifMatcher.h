@@ -1,7 +1,9 @@
 #pragma once
 
+#include <cstdint>
 #include <string>
 #include <string_view>
+#include <utility>
 #include <vector>
 
 namespace dorado::modbase {
@@ -19,4 +21,59 @@ private:
     const size_t m_motif_offset;
 };
 
+// Finds the hits of several motifs in one pass over a sequence, giving the same hits for each
+// motif as a MotifMatcher would.
+//
+// Uses the bit-parallel Shift-And algorithm, with the motifs laid end to end in a multi-word
+// state of one bit per motif position.  An IUPAC code in a motif matches each of the bases it
+// stands for.  The reverse complements of the motifs can be matched in the same pass, which
+// gives the hits in the reverse complement of the sequence without having to build it.
+class MultiMotifMatcher {
+public:
+    // Hits for each motif, in the order the motifs were given.
+    using Hits = std::vector<std::vector<size_t>>;
+
+    // Each motif is given with the offset of its canonical base.
+    explicit MultiMotifMatcher(const std::vector<std::pair<std::string, size_t>>& motifs);
+
+    size_t num_motifs() const { return m_num_motifs; }
+
+    // Returns the hits of each motif in seq.  If rc_hits is not null, it is filled with the hits
+    // in the reverse complement of seq, as positions in the reverse complement.
+    Hits get_motif_hits(std::string_view seq, Hits* rc_hits = nullptr) const;
+
+    // Returns the hits of a motif for which the whole motif lies within [start, start + length)
+    // of the sequence, as positions relative to start.
+    std::vector<size_t> hits_within(size_t motif_idx,
+                                    const std::vector<size_t>& hits,
+                                    size_t start,
+                                    size_t length) const;
+
+private:
+    struct Pattern {
+        size_t length;
+        size_t offset;
+    };
+    struct EndBit {
+        uint64_t mask;
+        size_t pattern_idx;
+    };
+
+    size_t m_num_motifs;
+    // The motifs, followed by their reverse complements.
+    std::vector<Pattern> m_patterns;
+    // The number of state words holding the motifs, and the motifs and reverse complements.  The
+    // reverse complements start on a new word, so that forward-only scans can skip them.
+    size_t m_num_forward_words{0};
+    size_t m_num_words{0};
+    // Bits for the positions of each pattern matching each character, indexed by
+    // char * m_num_words + word.
+    std::vector<uint64_t> m_char_masks;
+    // Bits for the first and last position of each pattern.
+    std::vector<uint64_t> m_start_bits;
+    std::vector<uint64_t> m_end_bits;
+    // The pattern ending at each end bit of each word.
+    std::vector<std::vector<EndBit>> m_word_end_bits;
+};
+
 }  // namespace dorado::modbase
@@ -4,6 +4,16 @@
 
 namespace dorado::modbase {
 
+// Writes the one-hot encoding of the kmer at each of `context_samples` samples into `output`,
+// which must have room for `4 * kmer_len * context_samples` bytes, e.g. a slot of a model input
+// tensor.  Any samples after the last one mapped by `seq_mappings` are zeroed.
+void encode_kmer_context(const std::vector<int>& seq,
+                         const std::vector<uint64_t>& seq_mappings,
+                         size_t bases_before,
+                         size_t bases_after,
+                         size_t context_samples,
+                         int8_t* output);
+
 std::vector<int8_t> encode_kmer_context(const std::vector<int>& seq,
                                         const std::vector<uint64_t>& seq_mappings,
                                         size_t bases_before,
@@ -22,6 +22,7 @@ namespace {
 
 constexpr std::size_t MAX_INPUT_QUEUE_SIZE{10000};
 constexpr std::size_t MAX_PROCESSING_QUEUE_SIZE{MAX_INPUT_QUEUE_SIZE / 2};
+constexpr std::size_t MAX_INPUT_BATCH_SIZE{64};
 
 std::shared_ptr<const dorado::alignment::Minimap2Index> load_and_get_index(
         dorado::alignment::IndexFileAccess& index_file_access,
@@ -50,16 +51,17 @@ std::shared_ptr<const dorado::alignment::Minimap2Index> load_and_get_index(
 
 void update_bed_results(dorado::ReadCommon& read_common, const dorado::alignment::BedFile& bed) {
     for (auto& align_result : read_common.alignment_results) {
-        for (const auto& entry : bed.entries(align_result.genome)) {
-            if (!(entry.start > (size_t)align_result.genome_end ||
-                  entry.end < (size_t)align_result.genome_start) &&
-                (entry.strand == align_result.direction || entry.strand == '.')) {
+        const auto overlaps =
+                bed.overlapping_entries(align_result.genome, size_t(align_result.genome_start),
+                                        size_t(align_result.genome_end));
+        for (const auto* entry : overlaps) {
+            if (entry->strand == align_result.direction || entry->strand == '.') {
                 // A hit
                 align_result.bed_hits++;
                 if (!align_result.bed_lines.empty()) {
                     align_result.bed_lines += "\n";
                 }
-                align_result.bed_lines += entry.bed_line;
+                align_result.bed_lines += entry->bed_line;
             }
         }
     }
@@ -190,46 +192,59 @@ void AlignerNode::align_bam_message(utils::concurrency::AsyncTaskExecutor& execu
         thread_local MmTbufPtr tbuf{mm_tbuf_init()};
         auto records = alignment::Minimap2Aligner(m_index_for_bam_messages)
                                .align(bam_message_.bam_ptr.get(), tbuf.get());
+        std::vector<Message> output_messages;
+        output_messages.reserve(records.size());
         for (auto& record : records) {
             if (m_bedfile_for_bam_messages && !(record->core.flag & BAM_FUNMAP)) {
                 auto ref_id = record->core.tid;
                 add_bed_hits_to_record(m_header_sequence_names.at(ref_id), record.get());
             }
-            send_message_to_sink(BamMessage{std::move(record), bam_message_.client_info});
+            output_messages.push_back(BamMessage{std::move(record), bam_message_.client_info});
         }
+        send_messages_to_sink(std::move(output_messages));
     });
 }
 
 void AlignerNode::input_thread_fn() {
-    Message message;
+    std::vector<Message> messages;
     // create an executor for the pool whose destructor will block till all tasks completed.
     utils::concurrency::AsyncTaskExecutor task_executor{*m_thread_pool, m_pipeline_priority,
                                                         MAX_PROCESSING_QUEUE_SIZE};
-    while (get_input_message(message)) {
-        if (std::holds_alternative<BamMessage>(message)) {
-            align_bam_message(task_executor, std::get<BamMessage>(std::move(message)));
-        } else if (std::holds_alternative<SimplexReadPtr>(message)) {
-            align_read(task_executor, std::get<SimplexReadPtr>(std::move(message)));
-        } else if (std::holds_alternative<DuplexReadPtr>(message)) {
-            align_read(task_executor, std::get<DuplexReadPtr>(std::move(message)));
-        } else {
-            send_message_to_sink(std::move(message));
-            continue;
+    while (get_input_messages(messages, MAX_INPUT_BATCH_SIZE)) {
+        for (auto& message : messages) {
+            if (std::holds_alternative<BamMessage>(message)) {
+                align_bam_message(task_executor, std::get<BamMessage>(std::move(message)));
+            } else if (std::holds_alternative<SimplexReadPtr>(message)) {
+                align_read(task_executor, std::get<SimplexReadPtr>(std::move(message)));
+            } else if (std::holds_alternative<DuplexReadPtr>(message)) {
+                align_read(task_executor, std::get<DuplexReadPtr>(std::move(message)));
+            } else {
+                send_message_to_sink(std::move(message));
+            }
         }
     }
 }
 
-stats::NamedStats AlignerNode::sample_stats() const { return stats::from_obj(m_work_queue); }
+stats::NamedStats AlignerNode::sample_stats() const {
+    auto stats = stats::from_obj(m_work_queue);
+    add_input_batch_stats(stats);
+    return stats;
+}
 
 void AlignerNode::add_bed_hits_to_record(const std::string& genome, bam1_t* record) {
     size_t genome_start = record->core.pos;
     size_t genome_end = bam_endpos(record);
     char direction = (bam_is_rev(record)) ? '-' : '+';
     int bed_hits = 0;
-    for (const auto& interval : m_bedfile_for_bam_messages->entries(genome)) {
-        if (!(interval.start >= genome_end || interval.end <= genome_start) &&
-            (interval.strand == direction || interval.strand == '.')) {
-            bed_hits++;
+    // Intervals overlap the half-open alignment range if they start before genome_end and end
+    // after genome_start.
+    if (genome_end > 0) {
+        const auto overlaps = m_bedfile_for_bam_messages->overlapping_entries(
+                genome, genome_start + 1, genome_end - 1);
+        for (const auto* interval : overlaps) {
+            if (interval->strand == direction || interval->strand == '.') {
+                bed_hits++;
+            }
         }
     }
     // update the record.
@@ -82,8 +82,11 @@ void BasecallerNode::input_thread_fn() {
             continue;
         }
 
-        // If this is a duplex read, raw_data won't have been generated yet.
-        materialise_read_raw_data(message);
+        // If this is a duplex read, raw_data won't have been generated yet.  Reads whose
+        // signal can't be loaded are dropped, and the error has already been logged.
+        if (!materialise_read_raw_data(message)) {
+            continue;
+        }
 
         // Now that we have acquired a read, wait until we can push to chunks_in
         // Chunk up the read and put the chunks into the pending chunk list.
@@ -383,7 +386,7 @@ BasecallerNode::BasecallerNode(std::vector<basecall::RunnerPtr> model_runners,
     auto chunk_queue_size = CalcMaxChunksIn(m_model_runners) / m_chunk_sizes.size();
     for (auto s : m_chunk_sizes) {
         m_chunk_in_queues.push_back(
-                std::make_unique<utils::AsyncQueue<std::unique_ptr<BasecallingChunk>>>(
+                std::make_unique<utils::LockFreeAsyncQueue<std::unique_ptr<BasecallingChunk>>>(
                         chunk_queue_size));
         spdlog::debug("BasecallerNode chunk size {}", s);
     }
@@ -2,6 +2,7 @@
 
 #include "read_pipeline/MessageSink.h"
 #include "utils/AsyncQueue.h"
+#include "utils/LockFreeAsyncQueue.h"
 #include "utils/stats.h"
 
 #include <atomic>
@@ -71,8 +72,10 @@ private:
 
     // Async queues to keep track of basecalling chunks. Each queue is for a different chunk size.
     // Basecall worker threads map to queue: `m_chunk_in_queues[worker_id % m_chunk_sizes.size()]`
+    // Every chunk passes through these and they are shared by the basecall workers, so they
+    // use the lock-free backend.
     std::vector<size_t> m_chunk_sizes;
-    std::vector<std::unique_ptr<utils::AsyncQueue<std::unique_ptr<BasecallingChunk>>>>
+    std::vector<std::unique_ptr<utils::LockFreeAsyncQueue<std::unique_ptr<BasecallingChunk>>>>
             m_chunk_in_queues;
 
     std::mutex m_working_reads_mutex;
@@ -5,8 +5,10 @@
 #include "correct/features.h"
 #include "correct/infer.h"
 #include "correct/windows.h"
+#include "hts_io/FastxRandomReader.h"
 #include "torch_utils/gpu_profiling.h"
 #include "utils/bam_utils.h"
+#include "utils/concurrency/synchronisation.h"
 #include "utils/sequence_utils.h"
 #include "utils/string_utils.h"
 #include "utils/thread_naming.h"
@@ -17,7 +19,6 @@
 #if DORADO_CUDA_BUILD
 #include "torch_utils/cuda_utils.h"
 #endif
-#include "hts_io/FastxRandomReader.h"
 
 #if DORADO_CUDA_BUILD
 #include <c10/cuda/CUDACachingAllocator.h>
@@ -30,7 +31,9 @@
 #include <spdlog/spdlog.h>
 #include <torch/script.h>
 
+#include <algorithm>
 #include <cassert>
+#include <exception>
 #include <filesystem>
 #include <iostream>
 #include <string>
@@ -41,6 +44,19 @@ using namespace dorado::correction;
 
 namespace {
 
+constexpr size_t FEATURES_QUEUE_SIZE = 1000;
+constexpr size_t INFERRED_FEATURES_QUEUE_SIZE = 500;
+
+// Windows waiting for inference or decoding are mostly held in the queues, so the pools of
+// feature buffers are capped at their capacity. Any windows beyond that get tensors of their own.
+constexpr size_t MAX_FEATURE_BUFFERS = FEATURES_QUEUE_SIZE + INFERRED_FEATURES_QUEUE_SIZE;
+
+// The input threads do the per-read work and the feature thread pool generates the windows of
+// the reads, and both are CPU bound, so the threads are split between them rather than each
+// getting that many.
+int num_input_threads(int threads) { return std::max(1, threads / 2); }
+int num_feature_threads(int threads) { return std::max(1, threads - num_input_threads(threads)); }
+
 dorado::BamPtr create_bam_record(const std::string& read_id, const std::string& seq) {
     bam1_t* rec = bam_init1();
     bam_set1(rec, read_id.length(), read_id.c_str(), 4 /*flag*/, -1 /*tid*/, -1 /*pos*/, 0 /*mapq*/,
@@ -49,13 +65,55 @@ dorado::BamPtr create_bam_record(const std::string& read_id, const std::string&
     return dorado::BamPtr(rec);
 }
 
+// Builds the .fai index of fastq if it doesn't have one, and returns the number of reads in it.
+int index_fastq(const std::string& fastq) {
+    char* idx_name = fai_path(fastq.c_str());
+    spdlog::debug("Looking for idx {}", idx_name);
+    if (idx_name && !std::filesystem::exists(idx_name)) {
+        if (fai_build(fastq.c_str()) != 0) {
+            spdlog::error("Failed to build index for file {}", fastq);
+            throw std::runtime_error{"Failed to build index for file " + fastq + "."};
+        }
+        spdlog::debug("Created fastq index.");
+    }
+    hts_free(idx_name);
+    return dorado::hts_io::FastxRandomReader(fastq).num_entries();
+}
+
+// Fetches a read from the read store if there is one, otherwise from the input file, in which
+// case its qualities are kept in the alignments.
+bool fetch_read(const std::string& read_name,
+                const dorado::hts_io::PackedReadStore* read_store,
+                const dorado::hts_io::FastxRandomReader* fastx_reader,
+                dorado::CorrectionAlignments& alignments,
+                std::string& seq,
+                const uint8_t*& qual) {
+    if (read_store) {
+        const auto read_idx = read_store->find(read_name);
+        if (!read_idx) {
+            spdlog::error("Read {} not found", read_name);
+            return false;
+        }
+        seq = read_store->seq(*read_idx);
+        qual = read_store->qual(*read_idx);
+        return true;
+    }
+    seq = fastx_reader->fetch_seq(read_name);
+    auto& qual_storage = alignments.qual_storage.emplace_back(fastx_reader->fetch_qual(read_name));
+    qual = qual_storage.data();
+    return !seq.empty() && qual_storage.size() == seq.length();
+}
+
 bool populate_alignments(dorado::CorrectionAlignments& alignments,
-                         dorado::hts_io::FastxRandomReader* reader,
+                         const dorado::hts_io::PackedReadStore* read_store,
+                         const dorado::hts_io::FastxRandomReader* fastx_reader,
                          const std::unordered_set<int>& useful_overlap_idxs) {
     const auto& tname = alignments.read_name;
 
-    alignments.read_seq = reader->fetch_seq(tname);
-    alignments.read_qual = reader->fetch_qual(tname);
+    if (!fetch_read(tname, read_store, fastx_reader, alignments, alignments.read_seq,
+                    alignments.read_qual)) {
+        return false;
+    }
     int tlen = (int)alignments.read_seq.length();
 
     // Might be worthwhile generating dense vectors with some index mapping to save memory
@@ -64,16 +122,21 @@ bool populate_alignments(dorado::CorrectionAlignments& alignments,
     alignments.seqs.resize(num_qnames);
     alignments.quals.resize(num_qnames);
     alignments.cigars.resize(num_qnames);
+    if (!read_store) {
+        alignments.qual_storage.reserve(useful_overlap_idxs.size() + 1);
+    }
 
     for (const size_t i : useful_overlap_idxs) {
         const std::string& qname = alignments.qnames[i];
-        alignments.seqs[i] = reader->fetch_seq(qname);
+        if (!fetch_read(qname, read_store, fastx_reader, alignments, alignments.seqs[i],
+                        alignments.quals[i])) {
+            return false;
+        }
         if ((int)alignments.seqs[i].length() != alignments.overlaps[i].qlen) {
             spdlog::error("qlen from before {} and qlen from after {} don't match for {}",
                           alignments.overlaps[i].qlen, alignments.seqs[i].length(), qname);
             return false;
         }
-        alignments.quals[i] = reader->fetch_qual(qname);
         if (alignments.overlaps[i].tlen != tlen) {
             spdlog::error("tlen from before {} and tlen from after {} don't match for {}",
                           alignments.overlaps[i].tlen, tlen, tname);
@@ -109,6 +172,21 @@ std::vector<std::string> concatenate_corrected_windows(const std::vector<std::st
 
 namespace dorado {
 
+template <typename T>
+at::Tensor CorrectionInferenceNode::MemoryManager<T>::get_tensor(int reads, int length) {
+    const auto options = at::TensorOptions().dtype<T>().device(torch::kCPU);
+    T* const ptr = size_t(reads) * length <= BUFFER_SIZE ? get_next_ptr() : nullptr;
+    if (!ptr) {
+        return at::empty({reads, length}, options);
+    }
+    return at::from_blob(
+            ptr, {reads, length},
+            [self = this->shared_from_this()](void* ptr) {
+                self->return_ptr(static_cast<T*>(ptr));
+            },
+            options);
+}
+
 void CorrectionInferenceNode::concat_features_and_send(const std::vector<std::string>& to_decode,
                                                        const std::string& read_name) {
     LOG_TRACE("decoding window for {}", read_name);
@@ -317,13 +395,69 @@ void CorrectionInferenceNode::infer_fn(const std::string& device_str, int mtx_id
     }
 }
 
-void CorrectionInferenceNode::input_thread_fn() {
-    auto thread_id = m_num_active_feature_threads++;
+std::vector<WindowFeatures> CorrectionInferenceNode::extract_features(
+        const std::vector<std::vector<OverlapWindow>>& windows,
+        const CorrectionAlignments& alignments) {
+    const FeatureAllocator allocate = [this](int reads, int length) {
+        return std::make_tuple(m_bases_manager->get_tensor(reads, length),
+                               m_quals_manager->get_tensor(reads, length));
+    };
+
+    const int n_windows = (int)windows.size();
+    std::vector<WindowFeatures> wfs(n_windows);
+    std::vector<std::exception_ptr> window_errors(n_windows);
+
+    // Windows with fewer than 2 overlaps have no features to generate.
+    std::vector<int> feature_windows;
+    for (int w = 0; w < n_windows; w++) {
+        if (windows[w].size() > 1) {
+            feature_windows.push_back(w);
+        } else {
+            wfs[w] = extract_window_features(windows[w], alignments, m_window_size, w, allocate);
+        }
+    }
+
+    utils::concurrency::Latch windows_remaining(feature_windows.size());
+    for (const int w : feature_windows) {
+        m_features_task_queue.push([&, w] {
+            try {
+                utils::ScopedProfileRange spr("extract_window_features", 2);
+                const auto start = std::chrono::steady_clock::now();
+                wfs[w] = extract_window_features(windows[w], alignments, m_window_size, w,
+                                                 allocate);
+                const int64_t time_us = std::chrono::duration_cast<std::chrono::microseconds>(
+                                                std::chrono::steady_clock::now() - start)
+                                                .count();
+                m_num_feature_windows++;
+                m_feature_window_time_us += time_us;
+                int64_t max_time_us = m_max_feature_window_time_us.load();
+                while (time_us > max_time_us &&
+                       !m_max_feature_window_time_us.compare_exchange_weak(max_time_us, time_us)) {
+                }
+            } catch (...) {
+                window_errors[w] = std::current_exception();
+            }
+            windows_remaining.count_down();
+        });
+    }
+    windows_remaining.wait();
+
+    for (const auto& error : window_errors) {
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
 
-    auto fastx_reader = std::make_unique<hts_io::FastxRandomReader>(m_fastq);
+    return wfs;
+}
+
+void CorrectionInferenceNode::input_thread_fn() {
+    m_num_active_feature_threads++;
 
-    if (thread_id == 0) {
-        total_reads_in_input = fastx_reader->num_entries();
+    // Without a read store, each thread fetches reads through its own handle on the input.
+    std::unique_ptr<hts_io::FastxRandomReader> fastx_reader;
+    if (!m_read_store) {
+        fastx_reader = std::make_unique<hts_io::FastxRandomReader>(m_fastq);
     }
 
     Message message;
@@ -354,12 +488,13 @@ void CorrectionInferenceNode::input_thread_fn() {
             }
 
             // Populate the alignment data with only the records that are useful after TOP_K filter
-            if (!populate_alignments(alignments, fastx_reader.get(), overlap_idxs)) {
+            if (!populate_alignments(alignments, m_read_store.get(), fastx_reader.get(),
+                                     overlap_idxs)) {
                 continue;
             }
 
             // Get the filtered features
-            auto wfs = extract_features(windows, alignments, m_window_size);
+            auto wfs = extract_features(windows, alignments);
 
             std::vector<std::string> corrected_seqs;
             corrected_seqs.resize(wfs.size());
@@ -411,19 +546,27 @@ void CorrectionInferenceNode::input_thread_fn() {
     }
 }
 
-CorrectionInferenceNode::CorrectionInferenceNode(const std::string& fastq,
-                                                 int threads,
-                                                 const std::string& device,
-                                                 int infer_threads,
-                                                 const int batch_size,
-                                                 const std::filesystem::path& model_dir)
-        : MessageSink(1000, threads),
+CorrectionInferenceNode::CorrectionInferenceNode(
+        const std::string& fastq,
+        std::shared_ptr<const hts_io::PackedReadStore> read_store,
+        int threads,
+        const std::string& device,
+        int infer_threads,
+        const int batch_size,
+        const std::filesystem::path& model_dir)
+        : MessageSink(1000, num_input_threads(threads)),
           m_fastq(fastq),
+          m_read_store(std::move(read_store)),
+          m_total_reads_in_input(m_read_store ? int(m_read_store->size()) : index_fastq(fastq)),
           m_model_config(parse_model_config(model_dir / "config.toml")),
-          m_features_queue(1000),
-          m_inferred_features_queue(500),
-          m_bases_manager(batch_size),
-          m_quals_manager(batch_size) {
+          m_features_queue(FEATURES_QUEUE_SIZE),
+          m_inferred_features_queue(INFERRED_FEATURES_QUEUE_SIZE),
+          m_features_thread_pool(std::make_shared<utils::concurrency::MultiQueueThreadPool>(
+                  num_feature_threads(threads), "corr_features")),
+          m_features_task_queue(m_features_thread_pool->create_task_queue(
+                  utils::concurrency::TaskPriority::normal)),
+          m_bases_manager(std::make_shared<MemoryManager<int>>(MAX_FEATURE_BUFFERS)),
+          m_quals_manager(std::make_shared<MemoryManager<float>>(MAX_FEATURE_BUFFERS)) {
     m_window_size = m_model_config.window_size;
 
     std::vector<std::string> devices;
@@ -463,17 +606,6 @@ CorrectionInferenceNode::CorrectionInferenceNode(const std::string& fastq,
     for (int i = 0; i < 4; i++) {
         m_decode_threads.push_back(std::thread(&CorrectionInferenceNode::decode_fn, this));
     }
-    // Create index for fastq file.
-    char* idx_name = fai_path(fastq.c_str());
-    spdlog::debug("Looking for idx {}", idx_name);
-    if (idx_name && !std::filesystem::exists(idx_name)) {
-        if (fai_build(fastq.c_str()) != 0) {
-            spdlog::error("Failed to build index for file {}", fastq);
-            throw std::runtime_error{"Failed to build index for file " + fastq + "."};
-        }
-        spdlog::debug("Created fastq index.");
-    }
-    hts_free(idx_name);
 }
 
 void CorrectionInferenceNode::terminate(const FlushOptions&) {
@@ -491,7 +623,16 @@ void CorrectionInferenceNode::terminate(const FlushOptions&) {
 stats::NamedStats CorrectionInferenceNode::sample_stats() const {
     stats::NamedStats stats = stats::from_obj(m_work_queue);
     stats["num_reads_corrected"] = double(num_reads.load());
-    stats["total_reads_in_input"] = total_reads_in_input;
+    stats["total_reads_in_input"] = m_total_reads_in_input;
+    const auto num_feature_windows = m_num_feature_windows.load();
+    stats["feature_windows"] = double(num_feature_windows);
+    if (num_feature_windows > 0) {
+        stats["feature_window_mean_us"] =
+                double(m_feature_window_time_us.load()) / num_feature_windows;
+    }
+    stats["feature_window_max_us"] = double(m_max_feature_window_time_us.load());
+    stats["feature_buffers"] =
+            double(m_bases_manager->num_buffers() + m_quals_manager->num_buffers());
     return stats;
 }
 
@@ -1,10 +1,11 @@
 #pragma once
 
 #include "correct/types.h"
-#include "hts_io/FastxRandomReader.h"
+#include "hts_io/PackedReadStore.h"
 #include "read_pipeline/MessageSink.h"
 #include "read_pipeline/messages.h"
 #include "utils/AsyncQueue.h"
+#include "utils/concurrency/multi_queue_thread_pool.h"
 #include "utils/stats.h"
 #include "utils/types.h"
 
@@ -12,6 +13,7 @@
 
 #include <atomic>
 #include <chrono>
+#include <cstdint>
 #include <filesystem>
 #include <memory>
 #include <mutex>
@@ -24,7 +26,10 @@ namespace dorado {
 
 class CorrectionInferenceNode : public MessageSink {
 public:
+    // Reads are looked up in read_store if one is given. Otherwise they're fetched from fastq
+    // through its .fai index, which is built if it doesn't exist.
     CorrectionInferenceNode(const std::string& fastq,
+                            std::shared_ptr<const hts_io::PackedReadStore> read_store,
                             int threads,
                             const std::string& device,
                             int infer_threads,
@@ -40,6 +45,8 @@ public:
 
 private:
     const std::string m_fastq;
+    const std::shared_ptr<const hts_io::PackedReadStore> m_read_store;
+    const int m_total_reads_in_input;
     correction::ModelConfig m_model_config;
     void input_thread_fn();
     int m_window_size;
@@ -51,6 +58,12 @@ private:
     void concat_features_and_send(const std::vector<std::string>& seqs,
                                   const std::string& read_name);
 
+    // Generates the features of each window of a read, with the windows spread across
+    // m_features_thread_pool.
+    std::vector<correction::WindowFeatures> extract_features(
+            const std::vector<std::vector<correction::OverlapWindow>>& windows,
+            const CorrectionAlignments& alignments);
+
     utils::AsyncQueue<correction::WindowFeatures> m_features_queue;
     utils::AsyncQueue<correction::WindowFeatures> m_inferred_features_queue;
 
@@ -59,7 +72,6 @@ private:
 
     std::atomic<int> num_reads{0};
     std::atomic<int> num_early_reads{0};
-    int total_reads_in_input{0};
 
     std::unordered_map<std::string, std::vector<std::string>> m_features_by_id;
     std::unordered_map<std::string, int> m_pending_features_by_id;
@@ -70,26 +82,47 @@ private:
 
     std::array<std::mutex, 32> m_gpu_mutexes;
 
-    // Class to pre-allocate memory and generate tensors from it.
+    // Shared by the input threads for generating the features of windows.
+    std::shared_ptr<utils::concurrency::MultiQueueThreadPool> m_features_thread_pool;
+    utils::concurrency::MultiQueueThreadPool::ThreadPoolQueue& m_features_task_queue;
+
+    std::atomic<int64_t> m_num_feature_windows{0};
+    std::atomic<int64_t> m_feature_window_time_us{0};
+    std::atomic<int64_t> m_max_feature_window_time_us{0};
+
+    // Class to pool memory for window features and generate tensors from it.
+    // Tensors borrow a buffer from the pool, which is returned when the last tensor using it
+    // is destroyed, so the manager is kept alive by its tensors. The pool grows whenever all
+    // of its buffers are in use, up to max_buffers. Windows too large for a buffer, or which
+    // arrive when all max_buffers are in use, get tensors of their own.
     template <typename T>
-    class MemoryManager {
+    class MemoryManager : public std::enable_shared_from_this<MemoryManager<T>> {
     public:
-        MemoryManager(int batch_size) {
-            const size_t num_tensors = 8 * 8;  // devices * threads per device;
-            size_t tensor_size = WS * NR * batch_size;
-            m_bases_ptr = std::make_unique<T[]>(tensor_size * num_tensors);
+        explicit MemoryManager(size_t max_buffers) : m_max_buffers(max_buffers) {}
+        ~MemoryManager() = default;
 
-            for (size_t i = 0; i < num_tensors; i++) {
-                m_bases_locations.push(&m_bases_ptr.get()[i * tensor_size]);
-            }
-        };
+        // Returns a tensor of shape {reads, length}, whose contents are uninitialised.
+        at::Tensor get_tensor(int reads, int length);
 
-        ~MemoryManager() = default;
+        size_t num_buffers() const {
+            std::lock_guard<std::mutex> lock(m_bases_mtx);
+            return m_buffers.size();
+        }
 
+    private:
+        static constexpr int WS = 5120;
+        static constexpr int NR = 31;
+        static constexpr size_t BUFFER_SIZE = size_t{WS} * NR;
+
+        // Returns nullptr if all of the buffers are in use and the pool is full.
         T* get_next_ptr() {
             std::lock_guard<std::mutex> lock(m_bases_mtx);
             if (m_bases_locations.size() == 0) {
-                throw std::runtime_error("No more pointers left!");
+                if (m_buffers.size() >= m_max_buffers) {
+                    return nullptr;
+                }
+                m_buffers.push_back(std::make_unique<T[]>(BUFFER_SIZE));
+                return m_buffers.back().get();
             }
             auto next_ptr = m_bases_locations.front();
             m_bases_locations.pop();
@@ -101,17 +134,14 @@ private:
             m_bases_locations.push(ptr);
         }
 
-    private:
-        static constexpr int WS = 5120;
-        static constexpr int NR = 31;
-
-        std::unique_ptr<T[]> m_bases_ptr;
+        const size_t m_max_buffers;
+        std::vector<std::unique_ptr<T[]>> m_buffers;
         std::queue<T*> m_bases_locations;
-        std::mutex m_bases_mtx;
+        mutable std::mutex m_bases_mtx;
     };
 
-    MemoryManager<int> m_bases_manager;
-    MemoryManager<float> m_quals_manager;
+    const std::shared_ptr<MemoryManager<int>> m_bases_manager;
+    const std::shared_ptr<MemoryManager<float>> m_quals_manager;
 };
 
 }  // namespace dorado
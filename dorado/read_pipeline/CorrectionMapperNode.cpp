@@ -11,6 +11,7 @@
 #include "utils/PostCondition.h"
 #include "utils/alignment_utils.h"
 #include "utils/bam_utils.h"
+#include "utils/memory_utils.h"
 #include "utils/thread_naming.h"
 
 #include <htslib/faidx.h>
@@ -18,15 +19,46 @@
 #include <minimap.h>
 #include <spdlog/spdlog.h>
 
+#include <algorithm>
 #include <cassert>
+#include <chrono>
 #include <filesystem>
+#include <future>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// Threads for reading the next index chunk, which runs alongside the aligner threads.
+constexpr int INDEX_PREFETCH_THREADS = 2;
+
+int64_t ms_since(Clock::time_point start) {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - start).count();
+}
+
+// Rough size of an index chunk: the sequence packed at 4 bits per base, plus a position and
+// hash table entry for each minimizer, of which there are about 2 per window.
+uint64_t estimate_index_bytes(const mm_idx_t& index) {
+    uint64_t num_bases = 0;
+    for (uint32_t i = 0; i < index.n_seq; ++i) {
+        num_bases += index.seq[i].len;
+    }
+    const uint64_t num_minimizers = 2 * num_bases / (index.w + 1);
+    return num_bases / 2 + num_minimizers * 2 * sizeof(uint64_t);
+}
+
+}  // namespace
 
 namespace dorado {
 
 void CorrectionMapperNode::extract_alignments(const mm_reg1_t* reg,
                                               int hits,
-                                              const std::string& qread,
-                                              const std::string& qname) {
+                                              size_t query_idx,
+                                              int query_len) {
+    // Each read is mapped once per chunk, so repeated query/target pairs can only come from
+    // this read's hits.
+    std::unordered_set<int32_t> processed_targets;
+    uint64_t num_bytes = 0;
     for (int j = 0; j < hits; j++) {
         // mapping region
         auto aln = &reg[j];
@@ -35,54 +67,35 @@ void CorrectionMapperNode::extract_alignments(const mm_reg1_t* reg,
             continue;
         }
 
-        const auto& ref = m_index->index()->seq[aln->rid];
-        const std::string tname(ref.name);
+        const uint32_t target_idx = m_chunk_overlaps.target_read_idxs[aln->rid];
 
-        // Skip self alignment.
-        if (qname == tname) {
+        // Skip self alignment, and targets which aren't in the read store.
+        if (target_idx == query_idx || target_idx == NO_READ) {
             continue;
         }
 
-        std::unique_lock<std::mutex> lock(m_correction_mtx);
-        if (m_read_mutex.find(tname) == m_read_mutex.end()) {
-            m_read_mutex.emplace(tname, std::make_unique<std::mutex>());
-            CorrectionAlignments new_aln;
-            new_aln.read_name = tname;
-            m_correction_records.emplace(tname, std::move(new_aln));
-            m_processed_queries_per_target.emplace(tname, std::unordered_set<std::string>());
-        }
-        auto& mtx = *m_read_mutex[tname];
-        auto& processed_queries = m_processed_queries_per_target[tname];
-        auto& alignments = m_correction_records[tname];
-        lock.unlock();
-
-        {
-            std::lock_guard<std::mutex> aln_lock(mtx);
-            if (processed_queries.find(qname) != processed_queries.end()) {
-                // Query/target pair has been processed before. Assume that
-                // the first one processed is the best one, and ignore
-                // the rest.
-                continue;
-            } else {
-                processed_queries.insert(qname);
-            }
+        if (!processed_targets.insert(aln->rid).second) {
+            // Query/target pair has been processed before. Assume that
+            // the first one processed is the best one, and ignore
+            // the rest.
+            continue;
         }
 
         utils::Overlap ovlp;
         ovlp.qstart = aln->qs;
         ovlp.qend = aln->qe;
-        ovlp.qlen = (int)qread.length();
+        ovlp.qlen = query_len;
         ovlp.fwd = !aln->rev;
         ovlp.tstart = aln->rs;
         ovlp.tend = aln->re;
-        ovlp.tlen = ref.len;
+        ovlp.tlen = m_index->index()->seq[aln->rid].len;
 
         if (ovlp.qlen < ovlp.qstart || ovlp.qlen < ovlp.qend) {
             spdlog::warn(
                     "Inconsistent query alignment detected: tname {} tlen {} tstart {} tend {} "
                     "qname {} qlen {} qstart {} qend {}",
-                    tname, ovlp.tlen, ovlp.tstart, ovlp.tend, qname, ovlp.qlen, ovlp.qstart,
-                    ovlp.qend);
+                    read_name(target_idx), ovlp.tlen, ovlp.tstart, ovlp.tend,
+                    read_name(query_idx), ovlp.qlen, ovlp.qstart, ovlp.qend);
             continue;
         }
 
@@ -90,51 +103,68 @@ void CorrectionMapperNode::extract_alignments(const mm_reg1_t* reg,
             spdlog::warn(
                     "Inconsistent target alignment detected: tname {} tlen {} tstart {} tend {} "
                     "qname {} qlen {} qstart {} qend {}",
-                    tname, ovlp.tlen, ovlp.tstart, ovlp.tend, qname, ovlp.qlen, ovlp.qstart,
-                    ovlp.qend);
+                    read_name(target_idx), ovlp.tlen, ovlp.tstart, ovlp.tend,
+                    read_name(query_idx), ovlp.qlen, ovlp.qstart, ovlp.qend);
             continue;
         }
 
-        // Non-const because it will be moved below.
-        std::vector<CigarOp> cigar = convert_mm2_cigar(aln->p->cigar, aln->p->n_cigar);
-
         {
-            std::lock_guard<std::mutex> aln_lock(mtx);
-
-            alignments.qnames.push_back(qname);
-            alignments.cigars.push_back(std::move(cigar));
-            alignments.overlaps.push_back(std::move(ovlp));
+            std::lock_guard<std::mutex> aln_lock(
+                    m_target_mutexes[aln->rid % m_target_mutexes.size()]);
+            m_chunk_overlaps.targets[aln->rid].add(static_cast<uint32_t>(query_idx), ovlp,
+                                                   aln->p->cigar, aln->p->n_cigar);
         }
+        num_bytes += correction::CompactTargetOverlaps::overlap_bytes(aln->p->n_cigar);
     }
+    m_overlap_memory.add_mapping(num_bytes);
+}
+
+const std::string& CorrectionMapperNode::read_name(size_t read_idx) const {
+    if (m_read_store) {
+        return m_read_store->name(read_idx);
+    }
+    return m_read_names.name(static_cast<uint32_t>(read_idx));
+}
+
+void CorrectionMapperNode::map_read(size_t read_idx, const std::string& read_seq, mm_tbuf_t* tbuf) {
+    m_overlap_memory.wait_for_memory();
+    std::tuple<mm_reg1_t*, int> mapping =
+            m_aligner->get_mapping(read_name(read_idx), read_seq, tbuf);
+    mm_reg1_t* reg = std::get<0>(mapping);
+    int hits = std::get<1>(mapping);
+    extract_alignments(reg, hits, read_idx, int(read_seq.length()));
+    m_alignments_processed++;
+    // TODO: Remove and move to ProgressTracker
+    if (m_alignments_processed.load() % 10000 == 0) {
+        spdlog::debug("Alignments processed {}, overlaps held {} MB",
+                      m_alignments_processed.load(),
+                      (float)m_overlap_memory.mapping_bytes() / (1024 * 1024));
+    }
+
+    for (int j = 0; j < hits; j++) {
+        free(reg[j].p);
+    }
+    free(reg);
 }
 
 void CorrectionMapperNode::input_thread_fn() {
     utils::set_thread_name("errcorr_node");
-    BamPtr read;
     MmTbufPtr tbuf(mm_tbuf_init());
-    while (m_reads_queue.try_pop(read) != utils::AsyncQueueStatus::Terminate) {
-        const std::string read_name = bam_get_qname(read.get());
-        const std::string read_seq = utils::extract_sequence(read.get());
-        std::tuple<mm_reg1_t*, int> mapping = m_aligner->get_mapping(read.get(), tbuf.get());
-        mm_reg1_t* reg = std::get<0>(mapping);
-        int hits = std::get<1>(mapping);
-        extract_alignments(reg, hits, read_seq, read_name);
-        m_alignments_processed++;
-        // TODO: Remove and move to ProgressTracker
-        if (m_alignments_processed.load() % 10000 == 0) {
-            std::unique_lock<std::mutex> lock(m_correction_mtx);
-            size_t total = 0;
-            for (auto& [_, r] : m_correction_records) {
-                total += r.size();
-            }
-            spdlog::debug("Alignments processed {}, total m_corrected_records size {} MB",
-                          m_alignments_processed.load(), (float)total / (1024 * 1024));
-        }
-
-        for (int j = 0; j < hits; j++) {
-            free(reg[j].p);
+    std::string read_seq;
+    if (m_read_store) {
+        const size_t num_reads = m_read_store->size();
+        for (size_t read_idx = m_next_read_idx++; read_idx < num_reads;
+             read_idx = m_next_read_idx++) {
+            m_read_store->get_seq(read_idx, read_seq);
+            map_read(read_idx, read_seq, tbuf.get());
         }
-        free(reg);
+        return;
+    }
+    BamPtr read;
+    while (m_reads_queue.try_pop(read) != utils::AsyncQueueStatus::Terminate) {
+        const uint32_t read_idx = m_read_names.intern(bam_get_qname(read.get()));
+        read_seq = utils::extract_sequence(read.get());
+        map_read(read_idx, read_seq, tbuf.get());
     }
 }
 
@@ -143,12 +173,28 @@ void CorrectionMapperNode::load_read_fn() {
     HtsReader reader(m_index_file, {});
     while (reader.read()) {
         m_reads_queue.try_push(BamPtr(bam_dup1(reader.record.get())));
-        m_reads_read++;
-        // TODO: Remove and move to ProgressTracker
-        if (m_reads_read.load() % 10000 == 0) {
-            spdlog::debug("Read {} reads", m_reads_read.load());
+    }
+}
+
+CorrectionMapperNode::ChunkOverlaps CorrectionMapperNode::create_chunk_overlaps() {
+    const mm_idx_t* index = m_index->index();
+    ChunkOverlaps chunk_overlaps;
+    chunk_overlaps.target_read_idxs.resize(index->n_seq, NO_READ);
+    chunk_overlaps.targets.resize(index->n_seq);
+    for (uint32_t rid = 0; rid < index->n_seq; ++rid) {
+        if (!m_read_store) {
+            // Every target is one of the streamed reads.
+            chunk_overlaps.target_read_idxs[rid] = m_read_names.intern(index->seq[rid].name);
+            continue;
+        }
+        const auto read_idx = m_read_store->find(index->seq[rid].name);
+        if (read_idx) {
+            chunk_overlaps.target_read_idxs[rid] = static_cast<uint32_t>(*read_idx);
+        } else {
+            spdlog::warn("Index target {} not found in the input reads", index->seq[rid].name);
         }
     }
+    return chunk_overlaps;
 }
 
 void CorrectionMapperNode::send_data_fn(Pipeline& pipeline) {
@@ -156,32 +202,57 @@ void CorrectionMapperNode::send_data_fn(Pipeline& pipeline) {
     while (true) {
         std::unique_lock<std::mutex> lock(m_copy_mtx);
         m_copy_cv.wait(lock, [&] {
-            return (!m_shadow_correction_records.empty() || m_copy_terminate.load());
+            return (!m_shadow_chunk_overlaps.empty() || m_copy_terminate.load());
         });
 
-        if (m_shadow_correction_records.empty() && m_copy_terminate.load()) {
+        if (m_shadow_chunk_overlaps.empty() && m_copy_terminate.load()) {
             break;
         }
 
-        for (auto& shadow_data : m_shadow_correction_records) {
-            spdlog::debug("Pushing {} records downstream of mapping.", shadow_data.size());
+        for (auto& chunk_overlaps : m_shadow_chunk_overlaps) {
+            spdlog::debug("Pushing {} records downstream of mapping.",
+                          chunk_overlaps.targets.size());
             int64_t num_pushed{0};
-            for (auto& [tname, r] : shadow_data) {
-                // Skip reads which were already processed.
-                if (m_skip_set.count(tname) > 0) {
-                    spdlog::trace("Resuming in mapping: skipping read '{}'.", tname);
+            for (size_t rid = 0; rid < chunk_overlaps.targets.size(); ++rid) {
+                auto& target_overlaps = chunk_overlaps.targets[rid];
+                if (target_overlaps.empty()) {
                     continue;
                 }
-                pipeline.push_message(std::move(r));
-                ++num_pushed;
+                const uint64_t num_bytes = target_overlaps.num_bytes();
+                const uint32_t target_read_idx = chunk_overlaps.target_read_idxs[rid];
+                // Skip reads which were already processed.
+                if (m_skip_set.count(read_name(target_read_idx)) > 0) {
+                    spdlog::trace("Resuming in mapping: skipping read '{}'.",
+                                  read_name(target_read_idx));
+                    target_overlaps = {};
+                } else {
+                    pipeline.push_message(target_overlaps.expand(
+                            read_name(target_read_idx),
+                            [this](uint32_t query_idx) -> const std::string& {
+                                return read_name(query_idx);
+                            }));
+                    ++num_pushed;
+                }
+                m_overlap_memory.release_pending(num_bytes);
             }
             m_reads_to_infer.fetch_add(num_pushed);
             spdlog::debug("Pushed {} non-skipped records for correction.", num_pushed);
         }
-        m_shadow_correction_records.clear();
+        m_shadow_chunk_overlaps.clear();
     }
 }
 
+bool CorrectionMapperNode::should_prefetch_next_chunk() const {
+    // Chunks are filled up to the index size, so the next one should be no larger than this.
+    const uint64_t next_chunk_bytes = estimate_index_bytes(*m_index->index());
+    const uint64_t budget = m_index_prefetch_bytes
+                                    ? *m_index_prefetch_bytes
+                                    : utils::available_host_memory_GB() * utils::BYTES_PER_GB / 2;
+    spdlog::debug("Index chunk estimated at {} MB, prefetch budget {} MB",
+                  next_chunk_bytes / (1024 * 1024), budget / (1024 * 1024));
+    return next_chunk_bytes <= budget;
+}
+
 void CorrectionMapperNode::process(Pipeline& pipeline) {
     std::thread reader_thread;
     std::vector<std::thread> aligner_threads;
@@ -222,21 +293,38 @@ void CorrectionMapperNode::process(Pipeline& pipeline) {
                  alignment::IndexLoadResult::end_of_index);
     }
 
-    do {
+    while (true) {
         spdlog::debug("Align with index {}", m_current_index);
-        m_reads_read.store(0);
+        m_next_read_idx.store(0);
         m_alignments_processed.store(0);
         m_reads_queue.restart();
 
         // Create aligner.
         m_aligner = std::make_unique<alignment::Minimap2Aligner>(m_index);
-        // 1. Start thread for generating reads.
-        reader_thread = std::thread(&CorrectionMapperNode::load_read_fn, this);
-        // 2. Start threads for aligning reads.
+        m_chunk_overlaps = create_chunk_overlaps();
+        // 1. Start reading the next index chunk while this one is mapped, if there's room.
+        std::future<std::shared_ptr<const mm_idx_t>> next_chunk;
+        if (should_prefetch_next_chunk()) {
+            next_chunk = std::async(std::launch::async, [this] {
+                utils::set_thread_name("errcorr_index");
+                const auto load_start = Clock::now();
+                auto chunk = m_index->read_next_chunk(INDEX_PREFETCH_THREADS);
+                m_index_load_ms += ms_since(load_start);
+                if (chunk) {
+                    ++m_index_chunks_prefetched;
+                }
+                return chunk;
+            });
+        }
+        // 2. Start threads for aligning reads, which take them from the read store in turn, or
+        // from a thread streaming them from the input file if there's no store.
+        if (!m_read_store) {
+            reader_thread = std::thread(&CorrectionMapperNode::load_read_fn, this);
+        }
         for (int i = 0; i < m_num_threads; i++) {
             aligner_threads.push_back(std::thread(&CorrectionMapperNode::input_thread_fn, this));
         }
-        // 3. Wait for alignments to finish and all reads to be read
+        // 3. Wait for all reads to be read and for alignments to finish
         if (reader_thread.joinable()) {
             reader_thread.join();
         }
@@ -247,20 +335,41 @@ void CorrectionMapperNode::process(Pipeline& pipeline) {
             }
         }
         aligner_threads.clear();
+        if (m_overlap_memory.mapping_bytes() > m_overlap_memory.max_bytes()) {
+            // Mapping only pauses for the previous chunk's overlaps to be sent, so a single
+            // chunk can still go over the budget.
+            spdlog::warn(
+                    "Overlaps for index chunk {} take {} MB, over the budget of {} MB. Decrease "
+                    "the index size to reduce memory use.",
+                    m_current_index, m_overlap_memory.mapping_bytes() / (1024 * 1024),
+                    m_overlap_memory.max_bytes() / (1024 * 1024));
+        }
         {
             // Only copy when the thread sending alignments to downstream pipeline
             // is done.
             std::unique_lock<std::mutex> lock(m_copy_mtx);
-            m_shadow_correction_records.emplace_back(std::move(m_correction_records));
+            m_shadow_chunk_overlaps.emplace_back(std::move(m_chunk_overlaps));
+            m_overlap_memory.finish_mapping();
         }
         m_copy_cv.notify_one();
 
-        m_correction_records = {};
-        m_read_mutex.clear();
-        m_processed_queries_per_target.clear();
+        m_chunk_overlaps = {};
         // 4. Load next index and loop
         m_current_index++;
-    } while (m_index->load_next_chunk(m_num_threads) != alignment::IndexLoadResult::end_of_index);
+        const auto wait_start = Clock::now();
+        std::shared_ptr<const mm_idx_t> chunk;
+        if (next_chunk.valid()) {
+            chunk = next_chunk.get();
+        } else {
+            chunk = m_index->read_next_chunk(m_num_threads);
+            m_index_load_ms += ms_since(wait_start);
+        }
+        m_index_load_wait_ms += ms_since(wait_start);
+        if (!chunk) {
+            break;
+        }
+        m_index->use_chunk(std::move(chunk));
+    }
 
     m_copy_terminate.store(true);
     m_copy_cv.notify_all();
@@ -269,15 +378,22 @@ void CorrectionMapperNode::process(Pipeline& pipeline) {
     }
 }
 
-CorrectionMapperNode::CorrectionMapperNode(const std::string& index_file,
-                                           int threads,
-                                           uint64_t index_size,
-                                           std::string furthest_skip_header,
-                                           std::unordered_set<std::string> skip_set)
+CorrectionMapperNode::CorrectionMapperNode(
+        const std::string& index_file,
+        std::shared_ptr<const hts_io::PackedReadStore> read_store,
+        int threads,
+        uint64_t index_size,
+        std::optional<uint64_t> index_prefetch_bytes,
+        uint64_t max_overlap_bytes,
+        std::string furthest_skip_header,
+        std::unordered_set<std::string> skip_set)
         : MessageSink(10000, threads),
           m_index_file(index_file),
+          m_read_store(std::move(read_store)),
           m_num_threads(threads),
           m_reads_queue(5000),
+          m_overlap_memory(max_overlap_bytes),
+          m_index_prefetch_bytes(index_prefetch_bytes),
           m_furthest_skip_header{std::move(furthest_skip_header)},
           m_skip_set{std::move(skip_set)} {
     auto options = alignment::create_preset_options("ava-ont");
@@ -327,6 +443,16 @@ stats::NamedStats CorrectionMapperNode::sample_stats() const {
     stats["num_reads_to_infer"] = static_cast<double>(m_reads_to_infer.load());
     stats["index_seqs"] = m_index_seqs;
     stats["current_idx"] = m_current_index;
+    stats["index_chunks_prefetched"] = m_index_chunks_prefetched.load();
+    const int64_t load_ms = m_index_load_ms.load();
+    const int64_t wait_ms = m_index_load_wait_ms.load();
+    stats["index_load_ms"] = double(load_ms);
+    stats["index_load_wait_ms"] = double(wait_ms);
+    // Load time hidden behind mapping, i.e. the aligner idle time saved by prefetching.
+    stats["index_load_overlap_ms"] = double(std::max<int64_t>(0, load_ms - wait_ms));
+    stats["overlap_bytes_mapping"] = double(m_overlap_memory.mapping_bytes());
+    stats["overlap_bytes_pending"] = double(m_overlap_memory.pending_bytes());
+    stats["overlap_memory_wait_ms"] = double(m_overlap_memory.wait_ms());
     return stats;
 }
 
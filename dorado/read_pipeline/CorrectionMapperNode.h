@@ -4,12 +4,15 @@
 #include "alignment/Minimap2Aligner.h"
 #include "alignment/Minimap2Index.h"
 #include "alignment/Minimap2IndexSupportTypes.h"
+#include "correct/compact_overlaps.h"
+#include "hts_io/PackedReadStore.h"
 #include "read_pipeline/MessageSink.h"
 #include "read_pipeline/messages.h"
 #include "utils/AsyncQueue.h"
 #include "utils/stats.h"
 #include "utils/types.h"
 
+#include <array>
 #include <atomic>
 #include <chrono>
 #include <condition_variable>
@@ -17,19 +20,37 @@
 #include <cstdint>
 #include <memory>
 #include <mutex>
+#include <optional>
 #include <string>
 #include <thread>
-#include <unordered_map>
 #include <unordered_set>
 #include <vector>
 
 namespace dorado {
 
+// Maps all reads against each chunk of a split index of the same reads in turn.  The reads are
+// taken from a store, rather than the input file being parsed again for every chunk.  Without a
+// store, e.g. when only writing overlaps, the input file is streamed for each chunk instead and
+// read names are interned on the fly to give each read an index.
+//
+// While one chunk is being mapped, the next is read in the background if the memory budget for
+// it allows, so that the aligner threads don't sit idle while it's built.  If no budget is
+// given, half of the host memory available at the time is used.
+//
+// The overlaps of each target are held compactly, by read index and with minimap2's packed
+// CIGARs, and only expanded into CorrectionAlignments as they're sent on once the chunk has
+// been mapped.  A target's overlaps are only complete once every read has been mapped against
+// it, i.e. at the end of the chunk.  To bound memory, mapping pauses while the overlaps held,
+// including those of the previous chunk which are still to be sent, exceed max_overlap_bytes.
+// The overlaps of a single chunk aren't limited, other than by the index size.
 class CorrectionMapperNode : public MessageSink {
 public:
     CorrectionMapperNode(const std::string& index_file,
+                         std::shared_ptr<const hts_io::PackedReadStore> read_store,
                          int threads,
                          uint64_t index_size,
+                         std::optional<uint64_t> index_prefetch_bytes,
+                         uint64_t max_overlap_bytes,
                          std::string furthest_skip_header,
                          std::unordered_set<std::string> skip_set);
     ~CorrectionMapperNode() = default;
@@ -42,6 +63,7 @@ public:
 
 private:
     std::string m_index_file;
+    std::shared_ptr<const hts_io::PackedReadStore> m_read_store;
     int m_num_threads;
 
     std::unique_ptr<alignment::Minimap2Aligner> m_aligner;
@@ -49,34 +71,54 @@ private:
 
     void input_thread_fn();
     void load_read_fn();
+    void map_read(size_t read_idx, const std::string& read_seq, mm_tbuf_t* tbuf);
     void send_data_fn(Pipeline& pipeline);
+    bool should_prefetch_next_chunk() const;
 
-    void extract_alignments(const mm_reg1_t* reg,
-                            int hits,
-                            const std::string& qread,
-                            const std::string& qname);
+    void extract_alignments(const mm_reg1_t* reg, int hits, size_t query_idx, int query_len);
 
-    // Queue for reads being aligned.
+    struct ChunkOverlaps {
+        // Read index of each target in the chunk, or NO_READ if it isn't in the store.
+        std::vector<uint32_t> target_read_idxs;
+        std::vector<correction::CompactTargetOverlaps> targets;
+    };
+    static constexpr uint32_t NO_READ = UINT32_MAX;
+    ChunkOverlaps create_chunk_overlaps();
+
+    // Index of the next read in the store to align against the current index chunk.
+    std::atomic<size_t> m_next_read_idx{0};
+
+    // Reads streamed from the input file for aligning if there's no store, and the index given
+    // to each of their names.
     utils::AsyncQueue<BamPtr> m_reads_queue;
+    correction::InternedReadNames m_read_names;
+    const std::string& read_name(size_t read_idx) const;
 
-    // Map to collects alignments by target id.
-    std::mutex m_correction_mtx;
-    std::unordered_map<std::string, CorrectionAlignments> m_correction_records;
-    std::unordered_map<std::string, std::unordered_set<std::string>> m_processed_queries_per_target;
+    // Overlaps of the chunk being mapped, by target id in the chunk.  Targets are locked by
+    // stripe rather than individually, or with a single lock across all of them.
+    ChunkOverlaps m_chunk_overlaps;
+    std::array<std::mutex, 1024> m_target_mutexes;
 
     std::mutex m_copy_mtx;
     std::condition_variable m_copy_cv;
-    std::vector<std::unordered_map<std::string, CorrectionAlignments>> m_shadow_correction_records;
+    std::vector<ChunkOverlaps> m_shadow_chunk_overlaps;
 
-    // Mutex per target id to prevent a global lock across all targets.
-    std::unordered_map<std::string, std::unique_ptr<std::mutex>> m_read_mutex;
+    // Estimated sizes of the overlaps of the chunk being mapped, and of those which are still to
+    // be sent.  Aligner threads wait for memory before mapping each read.
+    correction::OverlapMemoryBudget m_overlap_memory;
 
     int m_index_seqs{0};
     int m_current_index{0};
-    std::atomic<int> m_reads_read{0};
     std::atomic<int> m_alignments_processed{0};
     std::atomic<size_t> m_reads_to_infer{0};
 
+    std::optional<uint64_t> m_index_prefetch_bytes;
+    std::atomic<int> m_index_chunks_prefetched{0};
+    // Time spent reading index chunks after the first, and the part of it which the aligner
+    // threads spent waiting rather than mapping.
+    std::atomic<int64_t> m_index_load_ms{0};
+    std::atomic<int64_t> m_index_load_wait_ms{0};
+
     std::atomic<bool> m_copy_terminate{false};
 
     std::string m_furthest_skip_header;
@@ -12,6 +12,14 @@
 #include <cassert>
 #include <filesystem>
 #include <stdexcept>
+#include <vector>
+
+namespace {
+
+// Maximum number of input messages processed per batch.
+constexpr size_t MAX_INPUT_BATCH_SIZE = 256;
+
+}  // namespace
 
 namespace dorado {
 
@@ -38,56 +46,61 @@ OutputMode HtsWriter::get_output_mode(const std::string& mode) {
 }
 
 void HtsWriter::input_thread_fn() {
-    Message message;
-    while (get_input_message(message)) {
-        if (!std::holds_alternative<BamMessage>(message)) {
-            continue;
+    std::vector<Message> messages;
+    while (get_input_messages(messages, MAX_INPUT_BATCH_SIZE)) {
+        for (auto& message : messages) {
+            process_message(std::move(message));
         }
+    }
+}
 
-        auto bam_message = std::move(std::get<BamMessage>(message));
-        BamPtr aln = std::move(bam_message.bam_ptr);
+void HtsWriter::process_message(Message&& message) {
+    if (!std::holds_alternative<BamMessage>(message)) {
+        return;
+    }
 
-        if (m_file.get_output_mode() == utils::HtsFile::OutputMode::FASTQ) {
-            if (!m_gpu_names.empty()) {
-                bam_aux_append(aln.get(), "DS", 'Z', int(m_gpu_names.length() + 1),
-                               (uint8_t*)m_gpu_names.c_str());
-            }
-        }
+    auto bam_message = std::move(std::get<BamMessage>(message));
+    BamPtr aln = std::move(bam_message.bam_ptr);
 
-        auto res = write(aln.get());
-        if (res < 0) {
-            throw std::runtime_error("Failed to write SAM record, error code " +
-                                     std::to_string(res));
+    if (m_file.get_output_mode() == utils::HtsFile::OutputMode::FASTQ) {
+        if (!m_gpu_names.empty()) {
+            bam_aux_append(aln.get(), "DS", 'Z', int(m_gpu_names.length() + 1),
+                           (uint8_t*)m_gpu_names.c_str());
         }
+    }
 
-        // For the purpose of estimating write count, we ignore duplex reads
-        int64_t dx_tag = 0;
-        auto tag_str = bam_aux_get(aln.get(), "dx");
-        if (tag_str) {
-            dx_tag = bam_aux2i(tag_str);
-        }
+    auto res = write(aln.get());
+    if (res < 0) {
+        throw std::runtime_error("Failed to write SAM record, error code " + std::to_string(res));
+    }
 
-        bool ignore_read_id = dx_tag == 1;
+    // For the purpose of estimating write count, we ignore duplex reads
+    int64_t dx_tag = 0;
+    auto tag_str = bam_aux_get(aln.get(), "dx");
+    if (tag_str) {
+        dx_tag = bam_aux2i(tag_str);
+    }
 
-        if (ignore_read_id) {
-            // Read is a duplex read.
-            m_duplex_reads_written++;
+    bool ignore_read_id = dx_tag == 1;
+
+    if (ignore_read_id) {
+        // Read is a duplex read.
+        m_duplex_reads_written++;
+    } else {
+        std::string read_id;
+
+        // If read is a split read, use the parent read id
+        // to track write count since we don't know a priori
+        // how many split reads will be generated.
+        auto pid_tag = bam_aux_get(aln.get(), "pi");
+        if (pid_tag) {
+            read_id = std::string(bam_aux2Z(pid_tag));
+            m_split_reads_written++;
         } else {
-            std::string read_id;
-
-            // If read is a split read, use the parent read id
-            // to track write count since we don't know a priori
-            // how many split reads will be generated.
-            auto pid_tag = bam_aux_get(aln.get(), "pi");
-            if (pid_tag) {
-                read_id = std::string(bam_aux2Z(pid_tag));
-                m_split_reads_written++;
-            } else {
-                read_id = bam_get_qname(aln.get());
-            }
-
-            m_processed_read_ids.add(std::move(read_id));
+            read_id = bam_get_qname(aln.get());
         }
+
+        m_processed_read_ids.add(std::move(read_id));
     }
 }
 
@@ -117,6 +130,10 @@ int HtsWriter::write(bam1_t* const record) {
 
 stats::NamedStats HtsWriter::sample_stats() const {
     auto stats = stats::from_obj(m_work_queue);
+    add_input_batch_stats(stats);
+    for (const auto& [name, value] : stats::from_obj(m_file)) {
+        stats[name] = value;
+    }
     stats["unique_simplex_reads_written"] = static_cast<double>(m_processed_read_ids.size());
     stats["duplex_reads_written"] = static_cast<double>(m_duplex_reads_written.load());
     stats["split_reads_written"] = static_cast<double>(m_split_reads_written.load());
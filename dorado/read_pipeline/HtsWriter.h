@@ -45,6 +45,7 @@ private:
     std::string m_gpu_names{};
 
     void input_thread_fn();
+    void process_message(Message&& message);
     std::atomic<int> m_duplex_reads_written{0};
     std::atomic<int> m_split_reads_written{0};
 
@@ -2,7 +2,9 @@
 
 #include "utils/thread_naming.h"
 
+#include <algorithm>
 #include <cassert>
+#include <iterator>
 
 namespace dorado {
 
@@ -19,6 +21,69 @@ void MessageSink::push_message_internal(Message &&message) {
     assert(status == utils::AsyncQueueStatus::Success);
 }
 
+void MessageSink::push_messages(std::vector<Message> &&messages) {
+#ifndef NDEBUG
+    const auto status =
+#endif
+            m_work_queue.try_push_n(std::move(messages));
+    // As with push_message_internal, we don't expect the sink to be terminating.
+    assert(status == utils::AsyncQueueStatus::Success);
+}
+
+bool MessageSink::get_input_messages(std::vector<Message> &messages, size_t max_messages) {
+    messages.clear();
+    const bool forward_disconnected = !m_sinks.empty() && forward_on_disconnected();
+    while (messages.empty()) {
+        {
+            std::lock_guard lock(m_deferred_input_mutex);
+            messages.swap(m_deferred_input_messages);
+        }
+        if (messages.empty()) {
+            const auto status = m_work_queue.process_and_pop_n(
+                    [&messages](Message &&message) { messages.push_back(std::move(message)); },
+                    max_messages);
+            if (status != utils::AsyncQueueStatus::Success) {
+                return false;
+            }
+            ++m_num_input_batches;
+            m_num_input_batch_messages += messages.size();
+        }
+
+        if (forward_disconnected) {
+            // As in get_input_message, reads for disconnected clients skip this node.  They
+            // are only forwarded once the messages ahead of them have been returned, so the
+            // batch is cut short at the first one and the rest are kept for the next call.
+            auto is_disconnected = [](const Message &message) {
+                return is_read_message(message) && get_read_common_data(message).client_info &&
+                       get_read_common_data(message).client_info->is_disconnected();
+            };
+            auto kept_begin = messages.begin();
+            while (kept_begin != messages.end() && is_disconnected(*kept_begin)) {
+                send_message_to_sink(0, std::move(*kept_begin));
+                ++kept_begin;
+            }
+            const auto kept_end = std::find_if(kept_begin, messages.end(), is_disconnected);
+            if (kept_end != messages.end()) {
+                std::lock_guard lock(m_deferred_input_mutex);
+                m_deferred_input_messages.insert(m_deferred_input_messages.begin(),
+                                                 std::make_move_iterator(kept_end),
+                                                 std::make_move_iterator(messages.end()));
+            }
+            messages.erase(kept_end, messages.end());
+            messages.erase(messages.begin(), kept_begin);
+        }
+    }
+    return true;
+}
+
+void MessageSink::add_input_batch_stats(stats::NamedStats &stats) const {
+    const auto num_batches = m_num_input_batches.load();
+    stats["input_batches"] = double(num_batches);
+    stats["mean_input_batch_size"] =
+            num_batches > 0 ? double(m_num_input_batch_messages.load()) / double(num_batches)
+                            : 0.0;
+}
+
 void MessageSink::add_sink(MessageSink &sink) { m_sinks.push_back(std::ref(sink)); }
 
 void MessageSink::start_input_processing(const std::function<void()> &input_thread_fn,
@@ -7,6 +7,7 @@
 #include "utils/stats.h"
 
 #include <atomic>
+#include <cstdint>
 #include <iostream>
 #include <memory>
 #include <mutex>
@@ -43,6 +44,10 @@ public:
         push_message_internal(Message(std::move(msg)));
     }
 
+    // Adds a batch of messages to the input queue, synchronising once per batch rather
+    // than once per message.  This can block if the sink's queue is full.
+    void push_messages(std::vector<Message>&& messages);
+
     // Waits until work is finished and shuts down worker threads.
     // No work can be done by the node after this returns until
     // restart is subsequently called.
@@ -75,6 +80,19 @@ protected:
         send_message_to_sink(0, std::forward<Msg>(message));
     }
 
+    // Sends a batch of messages to the designated sink.
+    void send_messages_to_sink(int sink_index, std::vector<Message>&& messages) {
+        m_sinks.at(sink_index).get().push_messages(std::move(messages));
+    }
+
+    // Version for nodes with a single sink that is implicit.
+    void send_messages_to_sink(std::vector<Message>&& messages) {
+        if (m_sinks.size() != 1) {
+            throw std::runtime_error("Invalid m_sinks size");
+        }
+        send_messages_to_sink(0, std::move(messages));
+    }
+
     // Pops the next input message, returning true on success.
     // If terminating, returns false.
     bool get_input_message(Message& message) {
@@ -90,6 +108,14 @@ protected:
         return status == utils::AsyncQueueStatus::Success;
     }
 
+    // Replaces the contents of messages with up to max_messages input messages, popped
+    // under a single acquisition of the input queue, returning true on success.
+    // If terminating, returns false.
+    bool get_input_messages(std::vector<Message>& messages, size_t max_messages);
+
+    // Adds stats on the batches popped by get_input_messages.
+    void add_input_batch_stats(stats::NamedStats& stats) const;
+
     // Queue of work items for this node.
     utils::AsyncQueue<Message> m_work_queue;
 
@@ -110,6 +136,15 @@ private:
 
     void push_message_internal(Message&& message);
 
+    // Messages popped by get_input_messages but held back to keep them in order with reads
+    // for disconnected clients, which are forwarded rather than returned.
+    std::mutex m_deferred_input_mutex;
+    std::vector<Message> m_deferred_input_messages;
+
+    // Batches popped by get_input_messages, and the messages they contained.
+    std::atomic<int64_t> m_num_input_batches{0};
+    std::atomic<int64_t> m_num_input_batch_messages{0};
+
     // Input processing threads.
     const int m_num_input_threads;
     std::vector<std::thread> m_input_threads;
@@ -4,7 +4,9 @@
 #include "modbase/ModBaseModelConfig.h"
 #include "modbase/ModBaseRunner.h"
 #include "modbase/ModbaseEncoder.h"
+#include "modbase/MotifMatcher.h"
 #include "torch_utils/tensor_utils.h"
+#include "utils/adaptive_batch_policy.h"
 #include "utils/math_utils.h"
 #include "utils/sequence_utils.h"
 #include "utils/stats.h"
@@ -23,23 +25,32 @@ using namespace std::chrono_literals;
 
 namespace dorado {
 
+using Clock = utils::AdaptiveBatchPolicy::Clock;
+
+// A partial batch waits at least FORCE_TIMEOUT for more chunks, and longer if the recent
+// arrival rate says it will fill, up to MAX_BATCH_WAIT.
 constexpr auto FORCE_TIMEOUT = 100ms;
+constexpr auto MAX_BATCH_WAIT = 1000ms;
 
 struct ModBaseCallerNode::RemoraChunk {
     RemoraChunk(std::shared_ptr<WorkingRead> read,
                 at::Tensor input_signal,
-                std::vector<int8_t> kmer_data,
+                std::vector<int> seq_ints,
+                std::vector<uint64_t> seq_to_sig,
                 size_t position,
                 bool template_direction)
             : working_read(std::move(read)),
               signal(std::move(input_signal)),
-              encoded_kmers(std::move(kmer_data)),
+              kmer_seq_ints(std::move(seq_ints)),
+              kmer_seq_to_sig(std::move(seq_to_sig)),
               context_hit(position),
               is_template_direction(template_direction) {}
 
     std::shared_ptr<WorkingRead> working_read;
     at::Tensor signal;
-    std::vector<int8_t> encoded_kmers;
+    // The kmer encoding is written straight into the batch input by the runner.
+    std::vector<int> kmer_seq_ints;
+    std::vector<uint64_t> kmer_seq_to_sig;
     size_t context_hit;
     std::vector<float> scores;
     bool is_template_direction;
@@ -55,11 +66,13 @@ struct ModBaseCallerNode::WorkingRead {
 ModBaseCallerNode::ModBaseCallerNode(std::vector<modbase::RunnerPtr> model_runners,
                                      size_t remora_threads,
                                      size_t block_stride,
-                                     size_t max_reads)
+                                     size_t max_reads,
+                                     std::shared_ptr<utils::OverlapEngine> overlap_engine)
         : MessageSink(max_reads, static_cast<int>(remora_threads)),
           m_runners(std::move(model_runners)),
           m_block_stride(block_stride),
           m_batch_size(m_runners[0]->batch_size()),
+          m_overlap_engine(std::move(overlap_engine)),
           // TODO -- more principled calculation of output queue size
           m_processed_chunks(10 * max_reads) {
     init_modbase_info();
@@ -170,6 +183,17 @@ void ModBaseCallerNode::duplex_mod_call(Message&& message) {
 
         std::vector<unsigned long> all_context_hits;
 
+        // Find the motif hits of every model on both strands of the duplex read in one pass.
+        const auto& motif_matcher = runner->motif_matcher();
+        modbase::MultiMotifMatcher::Hits complement_hits;
+        const auto template_hits =
+                motif_matcher.get_motif_hits(read->read_common.seq, &complement_hits);
+
+        // Duplex read ids are "<template id>;<complement id>".  The simplex sequences are those
+        // of the original reads, so indices of them cached by pairing can be reused.
+        const auto& duplex_read_id = read->read_common.read_id;
+        const auto separator_pos = duplex_read_id.find(';');
+
         for (const bool is_template_direction : {true, false}) {
             auto simplex_signal =
                     is_template_direction
@@ -192,8 +216,20 @@ void ModBaseCallerNode::duplex_mod_call(Message&& message) {
                                              ? read->read_common.seq
                                              : utils::reverse_complement(read->read_common.seq);
 
+            const auto simplex_read_id =
+                    separator_pos == std::string::npos
+                            ? duplex_read_id
+                            : (is_template_direction ? duplex_read_id.substr(0, separator_pos)
+                                                     : duplex_read_id.substr(separator_pos + 1));
+
+            // In the complement direction the query is the reverse complement of the simplex
+            // read, so its index is cached separately from the one for the read's own sequence.
+            const auto query_name =
+                    is_template_direction ? simplex_read_id : simplex_read_id + ":rc";
+
             auto [moves_offset, target_start, new_move_table] =
-                    utils::realign_moves(simplex_seq, duplex_seq, simplex_moves);
+                    utils::realign_moves(simplex_seq, duplex_seq, simplex_moves,
+                                         m_overlap_engine.get(), query_name);
 
             // If the alignment has failed, the rest of this duplex mod call cannot be completed in this direction
             if (moves_offset == -1 && target_start == -1 && new_move_table.empty()) {
@@ -226,13 +262,15 @@ void ModBaseCallerNode::duplex_mod_call(Message&& message) {
                         params.context.bases_after, params.context.base_start_justify);
                 encoder.init(sequence_ints, seq_to_sig_map);
 
-                auto context_hits = runner->get_motif_hits(caller_id, new_seq);
+                const auto& strand_hits = is_template_direction ? template_hits : complement_hits;
+                auto context_hits = motif_matcher.hits_within(caller_id, strand_hits[caller_id],
+                                                              size_t(target_start), new_seq.size());
                 m_num_context_hits += static_cast<int64_t>(context_hits.size());
                 chunks_to_enqueue.reserve(context_hits.size());
 
                 for (auto context_hit : context_hits) {
                     nvtx3::scoped_range range_create_chunk{"create_chunk"};
-                    auto slice = encoder.get_context(context_hit);
+                    auto slice = encoder.get_unencoded_context(context_hit);
                     // signal
                     auto input_signal = scaled_signal.index({at::indexing::Slice(
                             slice.first_sample, slice.first_sample + slice.num_existing_samples)});
@@ -253,8 +291,9 @@ void ModBaseCallerNode::duplex_mod_call(Message&& message) {
                     }
 
                     chunks_to_enqueue.push_back(std::make_unique<RemoraChunk>(
-                            working_read, input_signal, std::move(slice.data),
-                            context_hit_in_duplex_space, is_template_direction));
+                            working_read, input_signal, std::move(slice.seq_ints),
+                            std::move(slice.seq_to_sig), context_hit_in_duplex_space,
+                            is_template_direction));
 
                     all_context_hits.push_back(context_hit_in_duplex_space);
                     ++working_read->num_modbase_chunks;
@@ -323,6 +362,9 @@ void ModBaseCallerNode::simplex_mod_call(Message&& message) {
     auto& runner = m_runners[0];
     std::vector<std::vector<std::unique_ptr<RemoraChunk>>> chunks_to_enqueue_by_caller(
             runner->num_callers());
+
+    // Find the motif hits of every model in one pass.
+    const auto motif_hits = runner->motif_matcher().get_motif_hits(read->read_common.seq);
     for (size_t caller_id = 0; caller_id < runner->num_callers(); ++caller_id) {
         nvtx3::scoped_range range{"generate_chunks"};
 
@@ -351,12 +393,12 @@ void ModBaseCallerNode::simplex_mod_call(Message&& message) {
                                         params.context.base_start_justify);
         encoder.init(sequence_ints, seq_to_sig_map);
 
-        auto context_hits = runner->get_motif_hits(caller_id, read->read_common.seq);
+        const auto& context_hits = motif_hits[caller_id];
         m_num_context_hits += static_cast<int64_t>(context_hits.size());
         chunks_to_enqueue.reserve(context_hits.size());
         for (auto context_hit : context_hits) {
             nvtx3::scoped_range nvtxrange{"create_chunk"};
-            auto slice = encoder.get_context(context_hit);
+            auto slice = encoder.get_unencoded_context(context_hit);
             // signal
             auto input_signal = scaled_signal.index({at::indexing::Slice(
                     slice.first_sample, slice.first_sample + slice.num_existing_samples)});
@@ -366,7 +408,8 @@ void ModBaseCallerNode::simplex_mod_call(Message&& message) {
                         {(int64_t)slice.lead_samples_needed, (int64_t)slice.tail_samples_needed});
             }
             chunks_to_enqueue.push_back(std::make_unique<RemoraChunk>(
-                    working_read, input_signal, std::move(slice.data), context_hit, true));
+                    working_read, input_signal, std::move(slice.seq_ints),
+                    std::move(slice.seq_to_sig), context_hit, true));
 
             ++working_read->num_modbase_chunks;
         }
@@ -425,25 +468,52 @@ void ModBaseCallerNode::modbasecall_worker_thread(size_t worker_id, size_t calle
     auto& chunk_queue = m_chunk_queues[caller_id];
 
     std::vector<std::unique_ptr<RemoraChunk>> batched_chunks;
-    auto last_chunk_reserve_time = std::chrono::system_clock::now();
+    utils::AdaptiveBatchPolicy batch_policy(m_batch_size, FORCE_TIMEOUT, MAX_BATCH_WAIT);
+    auto batch_start = Clock::now();
+    auto last_chunk_time = batch_start;
+
+    auto call_batch = [&](std::atomic<int64_t>& reason_count) {
+        call_current_batch(worker_id, caller_id, batched_chunks);
+        ++reason_count;
+        const auto latency = Clock::now() - batch_start;
+        const int64_t latency_ms =
+                std::chrono::duration_cast<std::chrono::milliseconds>(latency).count();
+        m_batch_latency_ms += latency_ms;
+        int64_t max_latency_ms = m_max_batch_latency_ms;
+        while (latency_ms > max_latency_ms &&
+               !m_max_batch_latency_ms.compare_exchange_weak(max_latency_ms, latency_ms)) {
+        }
+    };
 
     size_t previous_chunk_count = 0;
     while (true) {
         nvtx3::scoped_range range{"modbasecall_worker_thread"};
+        // An empty batch just waits for its first chunk, checking in periodically.
+        auto deadline = Clock::now() + FORCE_TIMEOUT;
+        if (!batched_chunks.empty()) {
+            deadline = batch_policy.deadline(batched_chunks.size(), batch_start, last_chunk_time);
+        }
+
         // Repeatedly attempt to complete the current batch with one acquisition of the
         // chunk queue mutex.
         auto grab_chunk = [&batched_chunks](std::unique_ptr<RemoraChunk> chunk) {
             batched_chunks.push_back(std::move(chunk));
         };
         const auto status = chunk_queue->process_and_pop_n_with_timeout(
-                grab_chunk, m_batch_size - batched_chunks.size(),
-                last_chunk_reserve_time + FORCE_TIMEOUT);
+                grab_chunk, m_batch_size - batched_chunks.size(), deadline);
         if (status == utils::AsyncQueueStatus::Terminate) {
             break;
         }
 
-        // Reset timeout.
-        last_chunk_reserve_time = std::chrono::system_clock::now();
+        const auto now = Clock::now();
+        const size_t num_new_chunks = batched_chunks.size() - previous_chunk_count;
+        batch_policy.record_arrivals(num_new_chunks, now);
+        if (num_new_chunks != 0) {
+            if (previous_chunk_count == 0) {
+                batch_start = now;
+            }
+            last_chunk_time = now;
+        }
 
         // We have just grabbed a number of chunks (0 in the case of timeout) from
         // the chunk queue and added them to batched_chunks.  Insert those chunks
@@ -453,15 +523,15 @@ void ModBaseCallerNode::modbasecall_worker_thread(size_t worker_id, size_t calle
             assert(chunk_idx < m_batch_size);
             const auto& chunk = batched_chunks[chunk_idx];
             runner->accept_chunk(int(caller_id), int(chunk_idx), chunk->signal,
-                                 chunk->encoded_kmers);
+                                 chunk->kmer_seq_ints, chunk->kmer_seq_to_sig);
         }
 
-        // If we have a complete batch, or we have a partial batch and timed out,
-        // then call what we have.
-        if (batched_chunks.size() == m_batch_size ||
-            (status == utils::AsyncQueueStatus::Timeout && !batched_chunks.empty())) {
-            // Input tensor is full, let's get scores.
-            call_current_batch(worker_id, caller_id, batched_chunks);
+        // If we have a complete batch, or we have a partial batch which has reached its
+        // deadline, then call what we have.
+        if (batched_chunks.size() == m_batch_size) {
+            call_batch(m_num_full_batch_flushes);
+        } else if (!batched_chunks.empty() && now >= deadline) {
+            call_batch(m_num_deadline_batch_flushes);
         }
 
         previous_chunk_count = batched_chunks.size();
@@ -469,7 +539,7 @@ void ModBaseCallerNode::modbasecall_worker_thread(size_t worker_id, size_t calle
 
     // Basecall any remaining chunks.
     if (!batched_chunks.empty()) {
-        call_current_batch(worker_id, caller_id, batched_chunks);
+        call_batch(m_num_terminate_batch_flushes);
     }
 
     // Reduce the count of active model callers.  If this was the last active
@@ -511,6 +581,7 @@ void ModBaseCallerNode::call_current_batch(
     } else {
         ++m_num_partial_batches_called;
     }
+    m_num_batched_chunks += batched_chunks.size();
 
     batched_chunks.clear();
 }
@@ -592,6 +663,16 @@ std::unordered_map<std::string, double> ModBaseCallerNode::sample_stats() const
     }
     stats["batches_called"] = double(m_num_batches_called);
     stats["partial_batches_called"] = double(m_num_partial_batches_called);
+    const auto num_batches = m_num_batches_called + m_num_partial_batches_called;
+    if (num_batches > 0) {
+        stats["batch_fill_ratio"] =
+                double(m_num_batched_chunks) / double(num_batches * int64_t(m_batch_size));
+        stats["batch_latency_ms_mean"] = double(m_batch_latency_ms) / double(num_batches);
+    }
+    stats["batch_latency_ms_max"] = double(m_max_batch_latency_ms);
+    stats["batch_flushes_full"] = double(m_num_full_batch_flushes);
+    stats["batch_flushes_deadline"] = double(m_num_deadline_batch_flushes);
+    stats["batch_flushes_terminate"] = double(m_num_terminate_batch_flushes);
     stats["input_chunks_sleeps"] = double(m_num_input_chunks_sleeps);
     stats["call_chunks_ms"] = double(m_call_chunks_ms);
     stats["context_hits"] = double(m_num_context_hits);
@@ -16,6 +16,10 @@
 
 namespace dorado {
 
+namespace utils {
+class OverlapEngine;
+}  // namespace utils
+
 namespace modbase {
 class ModBaseRunner;
 using RunnerPtr = std::unique_ptr<ModBaseRunner>;
@@ -26,10 +30,12 @@ class ModBaseCallerNode : public MessageSink {
     struct WorkingRead;
 
 public:
+    // overlap_engine, if given, is used to realign duplex reads' moves to the duplex sequence.
     ModBaseCallerNode(std::vector<modbase::RunnerPtr> model_runners,
                       size_t remora_threads,
                       size_t block_stride,
-                      size_t max_reads);
+                      size_t max_reads,
+                      std::shared_ptr<utils::OverlapEngine> overlap_engine = nullptr);
     ~ModBaseCallerNode();
     std::string get_name() const override { return "ModBaseCallerNode"; }
     stats::NamedStats sample_stats() const override;
@@ -62,6 +68,7 @@ private:
     std::vector<modbase::RunnerPtr> m_runners;
     size_t m_block_stride;
     size_t m_batch_size;
+    std::shared_ptr<utils::OverlapEngine> m_overlap_engine;
 
     std::thread m_output_worker;
     std::vector<std::thread> m_runner_workers;
@@ -83,6 +90,12 @@ private:
     // Performance monitoring stats.
     std::atomic<int64_t> m_num_batches_called = 0;
     std::atomic<int64_t> m_num_partial_batches_called = 0;
+    std::atomic<int64_t> m_num_batched_chunks = 0;
+    std::atomic<int64_t> m_num_full_batch_flushes = 0;
+    std::atomic<int64_t> m_num_deadline_batch_flushes = 0;
+    std::atomic<int64_t> m_num_terminate_batch_flushes = 0;
+    std::atomic<int64_t> m_batch_latency_ms = 0;
+    std::atomic<int64_t> m_max_batch_latency_ms = 0;
     std::atomic<int64_t> m_num_input_chunks_sleeps = 0;
     std::atomic<int64_t> m_call_chunks_ms = 0;
     std::atomic<int64_t> m_num_context_hits = 0;
@@ -1,6 +1,7 @@
 #include "PairingNode.h"
 
 #include "ClientInfo.h"
+#include "utils/sequence_sketch.h"
 #include "utils/sequence_utils.h"
 #include "utils/thread_naming.h"
 
@@ -22,6 +23,10 @@ size_t read_signal_bytes(const dorado::SimplexRead& read) {
     return read.read_common.raw_data.nbytes();
 }
 
+void hash_combine(size_t& seed, size_t value) {
+    seed ^= value + 0x9e3779b97f4a7c15ULL + (seed << 6) + (seed >> 2);
+}
+
 // There are 4 different cases to consider when checking for adjacent reads -
 // 1 Both reads are unsplit - in this case the next and prev ids determined
 //     from the pod5 are unchanged and consistent.
@@ -59,7 +64,9 @@ namespace dorado {
 //    lengths must be at least 20%.
 // 2. If the lengths are >98% similar, reads are at least 5KB, and time
 //    delta is <100ms, consider them to be a pair.
-// 3. If the early acceptance fails, then run minimap2 to generate overlap
+// 3. If the early acceptance fails, then reject pairs whose sketches show they can't
+//    overlap on opposite strands, to avoid running minimap2 on them.
+// 4. Otherwise run minimap2 to generate overlap
 //    coordinates. If there is only 1 hit from minimap2 mapping,
 //    the mapping quality is high (>50), the overlap covers
 //    most of the shorter read (80%), the overlap is at least 50 bp long,
@@ -69,6 +76,8 @@ namespace dorado {
 PairingNode::PairingResult PairingNode::is_within_time_and_length_criteria(
         const dorado::SimplexRead& temp,
         const dorado::SimplexRead& comp,
+        const utils::SequenceSketch* temp_sketch,
+        const utils::SequenceSketch* comp_sketch,
         int tid) {
     if (!are_reads_adjacent(temp, comp)) {
         return {false, 0, 0, 0, 0};
@@ -101,6 +110,11 @@ PairingNode::PairingResult PairingNode::is_within_time_and_length_criteria(
                 int(comp.read_common.seq.length() - 1)};
     }
 
+    if (temp_sketch && comp_sketch && !utils::may_have_rc_overlap(*temp_sketch, *comp_sketch)) {
+        m_sketch_rejected_pairs++;
+        return {false, 0, 0, 0, 0};
+    }
+
     return is_within_alignment_criteria(temp, comp, delta, true, tid);
 }
 
@@ -115,9 +129,9 @@ PairingNode::PairingResult PairingNode::is_within_alignment_criteria(
     nvtx3::scoped_range loop{nvtx_id};
 
     MmTbufPtr& working_buffer = m_tbufs[tid];
-    const auto overlap_result =
-            utils::compute_overlap(temp.read_common.seq, temp.read_common.read_id,
-                                   comp.read_common.seq, comp.read_common.read_id, working_buffer);
+    const auto overlap_result = m_overlap_engine->compute_overlap(
+            temp.read_common.seq, temp.read_common.read_id, comp.read_common.seq,
+            comp.read_common.read_id, working_buffer);
 
     if (overlap_result) {
         const uint8_t mapq = overlap_result->mapq;
@@ -248,29 +262,108 @@ void PairingNode::pair_list_worker_thread(int tid) {
     --m_num_active_worker_threads;
 }
 
+PairingNode::CacheShard& PairingNode::get_cache_shard(int32_t client_id,
+                                                      const UniquePoreIdentifierKey& key) {
+    size_t hash = std::hash<int32_t>{}(client_id);
+    hash_combine(hash, std::hash<int>{}(std::get<0>(key)));
+    hash_combine(hash, std::hash<std::string>{}(std::get<1>(key)));
+    hash_combine(hash, std::hash<std::string>{}(std::get<2>(key)));
+    return m_cache_shards[hash % kNumCacheShards];
+}
+
+void PairingNode::release_cached_read(const CachedReadPtr& cached_read) {
+    if (cached_read->num_refs.fetch_sub(1) == 1) {
+        send_message_to_sink(std::move(cached_read->read));
+    }
+}
+
+void PairingNode::evict_cached_reads(std::vector<CachedReadPtr>& cached_reads) {
+    for (auto& cached_read : cached_reads) {
+        m_cache_signal_bytes -= read_signal_bytes(*cached_read->read);
+        release_cached_read(cached_read);
+    }
+    cached_reads.clear();
+}
+
+void PairingNode::add_working_pore(int32_t client_id,
+                                   const UniquePoreIdentifierKey& key,
+                                   std::vector<CachedReadPtr>& evicted_reads) {
+    std::vector<UniquePoreIdentifierKey> evicted_keys;
+    {
+        std::lock_guard lock(m_working_pores_mutex);
+        auto& working_pores = m_working_pores[client_id];
+        working_pores.push_back(key);
+        while (working_pores.size() > m_max_num_keys) {
+            // Remove the oldest key (front of the list)
+            evicted_keys.push_back(std::move(working_pores.front()));
+            working_pores.pop_front();
+        }
+    }
+
+    // The shards are locked separately, so a read may have been added for an evicted pore in
+    // the meantime.  It's evicted along with the rest.
+    for (const auto& evicted_key : evicted_keys) {
+        auto& shard = get_cache_shard(client_id, evicted_key);
+        std::lock_guard lock(shard.mutex);
+        auto& pore_reads = shard.pore_reads[client_id];
+        auto pore_it = pore_reads.find(evicted_key);
+        if (pore_it == pore_reads.end()) {
+            continue;
+        }
+        for (auto& cached_read : pore_it->second) {
+            evicted_reads.push_back(std::move(cached_read));
+        }
+        pore_reads.erase(pore_it);
+    }
+}
+
+void PairingNode::flush_read_cache(std::optional<int32_t> client_id) {
+    std::vector<CachedReadPtr> evicted_reads;
+    for (auto& shard : m_cache_shards) {
+        std::lock_guard lock(shard.mutex);
+        for (auto client_it = shard.pore_reads.begin(); client_it != shard.pore_reads.end();) {
+            if (client_id && client_it->first != *client_id) {
+                ++client_it;
+                continue;
+            }
+            for (auto& [key, reads_list] : client_it->second) {
+                // key is the UniquePoreIdentifierKey of the pore these reads came from
+                for (auto& cached_read : reads_list) {
+                    evicted_reads.push_back(std::move(cached_read));
+                }
+            }
+            client_it = shard.pore_reads.erase(client_it);
+        }
+    }
+    {
+        std::lock_guard lock(m_working_pores_mutex);
+        if (client_id) {
+            m_working_pores.erase(*client_id);
+        } else {
+            m_working_pores.clear();
+        }
+    }
+    evict_cached_reads(evicted_reads);
+}
+
 void PairingNode::pair_generating_worker_thread(int tid) {
     utils::set_thread_name("pair_gen_thrd");
     at::InferenceMode inference_mode_guard;
 
-    auto compare_reads_by_time = [](const SimplexReadPtr& read1, const SimplexReadPtr& read2) {
-        return read1->read_common.start_time_ms < read2->read_common.start_time_ms;
+    auto compare_reads_by_time = [](const CachedReadPtr& read1, const CachedReadPtr& read2) {
+        return read1->read->read_common.start_time_ms < read2->read->read_common.start_time_ms;
     };
+    auto sketch_of = [](const CachedRead& cached_read) {
+        return cached_read.sketch ? &*cached_read.sketch : nullptr;
+    };
+
+    std::vector<CachedReadPtr> evicted_reads;
 
     Message message;
     while (get_input_message(message)) {
         if (std::holds_alternative<CacheFlushMessage>(message)) {
-            std::unique_lock<std::mutex> lock(m_pairing_mtx);
             auto flush_message = std::get<CacheFlushMessage>(message);
-            auto& read_cache = m_read_caches[flush_message.client_id];
-            for (auto& [key, reads_list] : read_cache.channel_read_map) {
-                // kv is a std::pair<UniquePoreIdentifierKey, std::list<std::shared_ptr<Read>>>
-                for (auto& read_ptr : reads_list) {
-                    // Push each read message
-                    m_cache_signal_bytes -= read_signal_bytes(*read_ptr);
-                    send_message_to_sink(std::move(read_ptr));
-                }
-            }
-            m_read_caches.erase(flush_message.client_id);
+            flush_read_cache(flush_message.client_id);
             continue;
         }
 
@@ -289,170 +382,114 @@ void PairingNode::pair_generating_worker_thread(int tid) {
         std::string run_id = read->read_common.run_id;
         std::string flowcell_id = read->read_common.flowcell_id;
         int32_t client_id = read->read_common.client_info->client_id();
-
-        std::unique_lock<std::mutex> lock(m_pairing_mtx);
-
-        auto& read_cache = m_read_caches[client_id];
         UniquePoreIdentifierKey key = std::make_tuple(channel, run_id, flowcell_id);
-        auto read_list_iter = read_cache.channel_read_map.find(key);
-        // Check if the key is already in the list
-        if (read_list_iter == read_cache.channel_read_map.end()) {
-            // Key is not in the dequeue
-            // Add the new key to the end of the list
-            {
-                read_cache.working_channel_keys.push_back(key);
-                std::list<SimplexReadPtr> reads;
-                m_cache_signal_bytes += read_signal_bytes(*read);
-                reads.push_back(std::move(read));
-                read_cache.channel_read_map.emplace(key, std::move(reads));
-            }
-
-            if (read_cache.working_channel_keys.size() > m_max_num_keys) {
-                // Remove the oldest key (front of the list)
-                auto oldest_key = read_cache.working_channel_keys.front();
-                read_cache.working_channel_keys.pop_front();
 
-                auto oldest_key_it = read_cache.channel_read_map.find(oldest_key);
-
-                // Remove the oldest key from the map
-                for (auto& read_ptr : oldest_key_it->second) {
-                    m_cache_signal_bytes -= read_signal_bytes(*read_ptr);
-                    m_reads_to_clear.insert(std::move(read_ptr));
-                }
-                read_cache.channel_read_map.erase(oldest_key);
-                assert(read_cache.channel_read_map.size() ==
-                       read_cache.working_channel_keys.size());
-            }
-        } else {
-            auto& cached_read_list = read_list_iter->second;
-            // It's safe to take raw pointers of these reads since their ownership isn't released from this
-            // node until their counter in |m_reads_in_flight_ctr| hits 0.
-            SimplexRead* later_read = nullptr;
-            SimplexRead* earlier_read = nullptr;
-
-            auto later_read_iter = std::lower_bound(
-                    cached_read_list.begin(), cached_read_list.end(), read, compare_reads_by_time);
+        // Sketch the read before taking the lock. Reads too short to be paired don't need one.
+        auto cached_read = std::make_shared<CachedRead>();
+        if (read->read_common.seq.length() >= size_t(kMinSeqLength)) {
+            cached_read->sketch = utils::sketch_sequence(read->read_common.seq);
+        }
+        m_cache_signal_bytes += read_signal_bytes(*read);
+        cached_read->read = std::move(read);
+
+        // The neighbouring reads each get a reference for the pair evaluations, so it's safe
+        // to use them after the shard is unlocked even if they're evicted in the meantime.
+        CachedReadPtr later_read;
+        CachedReadPtr earlier_read;
+        bool is_new_pore = false;
+        {
+            auto& shard = get_cache_shard(client_id, key);
+            std::lock_guard lock(shard.mutex);
+            auto [pore_it, inserted] = shard.pore_reads[client_id].try_emplace(key);
+            is_new_pore = inserted;
+            auto& cached_read_list = pore_it->second;
+
+            auto later_read_iter = std::lower_bound(cached_read_list.begin(),
+                                                    cached_read_list.end(), cached_read,
+                                                    compare_reads_by_time);
             if (later_read_iter != cached_read_list.end()) {
-                later_read = later_read_iter->get();
-                m_reads_in_flight_ctr[later_read]++;
+                later_read = *later_read_iter;
+                ++later_read->num_refs;
             }
 
             if (later_read_iter != cached_read_list.begin()) {
-                earlier_read = std::prev(later_read_iter)->get();
-                m_reads_in_flight_ctr[earlier_read]++;
+                earlier_read = *std::prev(later_read_iter);
+                ++earlier_read->num_refs;
             }
 
-            SimplexRead* const read_ptr = read.get();
-            m_cache_signal_bytes += read_signal_bytes(*read);
-            cached_read_list.insert(later_read_iter, std::move(read));
-            m_reads_in_flight_ctr[read_ptr]++;
+            ++cached_read->num_refs;
+            cached_read_list.insert(later_read_iter, cached_read);
 
             while (cached_read_list.size() > m_max_num_reads) {
-                m_cache_signal_bytes -= read_signal_bytes(*cached_read_list.front());
-                auto cached_read = std::move(cached_read_list.front());
+                evicted_reads.push_back(std::move(cached_read_list.front()));
                 cached_read_list.pop_front();
-                m_reads_to_clear.insert(std::move(cached_read));
-            }
-
-            // Release mutex around read cache to run pair evaluations.
-            lock.unlock();
-
-            if (later_read) {
-                auto [is_pair, qs, qe, rs, re] =
-                        is_within_time_and_length_criteria(*read_ptr, *later_read, tid);
-                if (is_pair) {
-                    ReadPair pair;
-                    pair.template_read = ReadPair::ReadData::from_read(*read_ptr, qs, qe);
-                    pair.complement_read = ReadPair::ReadData::from_read(*later_read, rs, re);
-
-                    read_ptr->is_duplex_parent = true;
-                    later_read->is_duplex_parent = true;
-                    ++read_ptr->num_duplex_candidate_pairs;
-                    send_message_to_sink(std::move(pair));
-                }
-            }
-
-            if (earlier_read) {
-                auto [is_pair, qs, qe, rs, re] =
-                        is_within_time_and_length_criteria(*earlier_read, *read_ptr, tid);
-                if (is_pair) {
-                    ReadPair pair;
-                    pair.template_read = ReadPair::ReadData::from_read(*earlier_read, qs, qe);
-                    pair.complement_read = ReadPair::ReadData::from_read(*read_ptr, rs, re);
-
-                    earlier_read->is_duplex_parent = true;
-                    read_ptr->is_duplex_parent = true;
-                    ++earlier_read->num_duplex_candidate_pairs;
-                    send_message_to_sink(std::move(pair));
-                }
             }
+        }
 
-            // Acquire read cache lock again to decrement in flight read counters.
-            lock.lock();
+        if (is_new_pore) {
+            add_working_pore(client_id, key, evicted_reads);
+        }
 
-            // Decrement in-flight counter for each read.
-            m_reads_in_flight_ctr[read_ptr]--;
-            if (earlier_read) {
-                m_reads_in_flight_ctr[earlier_read]--;
-            }
-            if (later_read) {
-                m_reads_in_flight_ctr[later_read]--;
+        SimplexRead* const read_ptr = cached_read->read.get();
+
+        if (later_read) {
+            auto [is_pair, qs, qe, rs, re] = is_within_time_and_length_criteria(
+                    *read_ptr, *later_read->read, sketch_of(*cached_read), sketch_of(*later_read),
+                    tid);
+            if (is_pair) {
+                ReadPair pair;
+                pair.template_read = ReadPair::ReadData::from_read(*read_ptr, qs, qe);
+                pair.complement_read = ReadPair::ReadData::from_read(*later_read->read, rs, re);
+
+                read_ptr->is_duplex_parent = true;
+                later_read->read->is_duplex_parent = true;
+                ++read_ptr->num_duplex_candidate_pairs;
+                send_message_to_sink(std::move(pair));
             }
+            release_cached_read(later_read);
         }
 
-        // Once pairs have been evaluated, check if any of the in-flight reads
-        // need to be purged from the cache.
-        for (auto to_clear_itr = m_reads_to_clear.begin();
-             to_clear_itr != m_reads_to_clear.end();) {
-            auto in_flight_itr = m_reads_in_flight_ctr.find(to_clear_itr->get());
-            bool ok_to_clear = false;
-            // If a read to clear is not in-flight (not in the in-flight list
-            // or in-flight counter is 0), then clear it
-            // from the cache.
-            if (in_flight_itr == m_reads_in_flight_ctr.end()) {
-                ok_to_clear = true;
-            } else if (in_flight_itr->second.load() == 0) {
-                m_reads_in_flight_ctr.erase(in_flight_itr);
-                ok_to_clear = true;
-            }
-            if (ok_to_clear) {
-                auto read_handle = m_reads_to_clear.extract(*to_clear_itr++);
-                send_message_to_sink(std::move(read_handle.value()));
-            } else {
-                ++to_clear_itr;
+        if (earlier_read) {
+            auto [is_pair, qs, qe, rs, re] = is_within_time_and_length_criteria(
+                    *earlier_read->read, *read_ptr, sketch_of(*earlier_read),
+                    sketch_of(*cached_read), tid);
+            if (is_pair) {
+                ReadPair pair;
+                pair.template_read = ReadPair::ReadData::from_read(*earlier_read->read, qs, qe);
+                pair.complement_read = ReadPair::ReadData::from_read(*read_ptr, rs, re);
+
+                earlier_read->read->is_duplex_parent = true;
+                read_ptr->is_duplex_parent = true;
+                ++earlier_read->read->num_duplex_candidate_pairs;
+                send_message_to_sink(std::move(pair));
             }
+            release_cached_read(earlier_read);
         }
+
+        release_cached_read(cached_read);
+
+        // Reads evicted from the cache are sent on by whichever thread drops the last reference.
+        evict_cached_reads(evicted_reads);
     }
 
     if (--m_num_active_worker_threads == 0) {
         if (!m_preserve_cache_during_flush) {
-            std::unique_lock<std::mutex> lock(m_pairing_mtx);
-            // There are still reads in channel_read_map. Push them to the sink.
+            // There are still reads in the cache. Push them to the sink.
             // Last thread alive is responsible for cleaning up the cache.
-            for (auto& [client_id, read_cache] : m_read_caches) {
-                for (auto& kv : read_cache.channel_read_map) {
-                    // kv is a std::pair<UniquePoreIdentifierKey, std::list<std::shared_ptr<Read>>>
-                    auto& reads_list = kv.second;
-
-                    for (auto& read_ptr : reads_list) {
-                        m_cache_signal_bytes -= read_signal_bytes(*read_ptr);
-                        // Push each read message
-                        send_message_to_sink(std::move(read_ptr));
-                    }
-                }
-            }
-            m_read_caches.clear();
+            flush_read_cache(std::nullopt);
         }
-        m_reads_in_flight_ctr.clear();
     }
 }
 
 PairingNode::PairingNode(std::map<std::string, std::string> template_complement_map,
                          int num_worker_threads,
-                         size_t max_reads)
+                         size_t max_reads,
+                         std::shared_ptr<utils::OverlapEngine> overlap_engine)
         : MessageSink(max_reads, 0),
           m_num_worker_threads(num_worker_threads),
-          m_template_complement_map(std::move(template_complement_map)) {
+          m_template_complement_map(std::move(template_complement_map)),
+          m_overlap_engine(overlap_engine ? std::move(overlap_engine)
+                                          : std::make_shared<utils::OverlapEngine>()) {
     // Set up the complement-template_map
     for (auto& key : m_template_complement_map) {
         m_complement_template_map[key.second] = key.first;
@@ -463,11 +500,14 @@ PairingNode::PairingNode(std::map<std::string, std::string> template_complement_
 
 PairingNode::PairingNode(DuplexPairingParameters pairing_params,
                          int num_worker_threads,
-                         size_t max_reads)
+                         size_t max_reads,
+                         std::shared_ptr<utils::OverlapEngine> overlap_engine)
         : MessageSink(max_reads, 0),
           m_num_worker_threads(num_worker_threads),
           m_max_num_keys(std::numeric_limits<size_t>::max()),
-          m_max_num_reads(std::numeric_limits<size_t>::max()) {
+          m_max_num_reads(std::numeric_limits<size_t>::max()),
+          m_overlap_engine(overlap_engine ? std::move(overlap_engine)
+                                          : std::make_shared<utils::OverlapEngine>()) {
     switch (pairing_params.read_order) {
     case ReadOrder::BY_CHANNEL:
         // N.B. with BY_CHANNEL ordering the ont_basecall_client application has a dependency
@@ -524,8 +564,13 @@ stats::NamedStats PairingNode::sample_stats() const {
     stats::NamedStats stats = m_work_queue.sample_stats();
     stats["early_accepted_pairs"] = m_early_accepted_pairs.load();
     stats["overlap_accepted_pairs"] = m_overlap_accepted_pairs.load();
+    // Each of these pairs would otherwise have needed a minimap2 index and mapping.
+    stats["sketch_rejected_pairs"] = m_sketch_rejected_pairs.load();
     stats["cached_signal_mb"] =
             static_cast<double>(m_cache_signal_bytes) / static_cast<double>(1024 * 1024);
+    for (const auto& [name, value] : stats::from_obj(*m_overlap_engine)) {
+        stats[name] = value;
+    }
     return stats;
 }
 
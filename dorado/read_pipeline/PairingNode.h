@@ -1,9 +1,12 @@
 #pragma once
 
 #include "ReadPipeline.h"
+#include "utils/overlap_engine.h"
+#include "utils/sequence_sketch.h"
 #include "utils/stats.h"
 #include "utils/types.h"
 
+#include <array>
 #include <atomic>
 #include <cstdint>
 #include <deque>
@@ -11,6 +14,7 @@
 #include <map>
 #include <memory>
 #include <mutex>
+#include <optional>
 #include <string>
 #include <thread>
 #include <tuple>
@@ -24,19 +28,40 @@ class PairingNode : public MessageSink {
     // The values are channel, run_id, flowcell_id
     using UniquePoreIdentifierKey = std::tuple<int, std::string, std::string>;
 
-    struct ReadCache {
-        std::map<UniquePoreIdentifierKey, std::list<SimplexReadPtr>> channel_read_map;
-        std::deque<UniquePoreIdentifierKey> working_channel_keys;
+    // A cached read, along with its sketch if it's long enough to be aligned.
+    struct CachedRead {
+        SimplexReadPtr read;
+        std::optional<utils::SequenceSketch> sketch;
+        // One reference for the cache, plus one for each pair evaluation using the read.
+        // The read is sent on when the last reference is released.
+        std::atomic<int> num_refs{1};
     };
+    using CachedReadPtr = std::shared_ptr<CachedRead>;
+
+    // Each pore's reads, sorted by start time.
+    using PoreReads = std::map<UniquePoreIdentifierKey, std::list<CachedReadPtr>>;
+
+    // Pores are spread over the shards by hash, so that workers handling reads from
+    // different pores don't contend on the same lock.
+    struct alignas(64) CacheShard {
+        std::mutex mutex;
+        std::unordered_map<int32_t, PoreReads> pore_reads;  // Keyed by client_id.
+    };
+    static constexpr size_t kNumCacheShards = 64;
 
 public:
     // Template-complement map: uses the pair_list pairing method
+    // If no overlap engine is given then the node creates its own.
     PairingNode(std::map<std::string, std::string> template_complement_map,
                 int num_worker_threads,
-                size_t max_reads);
+                size_t max_reads,
+                std::shared_ptr<utils::OverlapEngine> overlap_engine = nullptr);
 
     // No template-complement map: uses the pair_generation pairing method
-    PairingNode(DuplexPairingParameters pairing_params, int num_worker_threads, size_t max_reads);
+    PairingNode(DuplexPairingParameters pairing_params,
+                int num_worker_threads,
+                size_t max_reads,
+                std::shared_ptr<utils::OverlapEngine> overlap_engine = nullptr);
     ~PairingNode() { terminate_impl(); }
     std::string get_name() const override { return "PairingNode"; }
     stats::NamedStats sample_stats() const override;
@@ -84,10 +109,23 @@ private:
 
     // Members for pair_generating method
 
-    std::mutex m_pairing_mtx;
+    CacheShard& get_cache_shard(int32_t client_id, const UniquePoreIdentifierKey& key);
+    void release_cached_read(const CachedReadPtr& cached_read);
+    // Releases the cache's reference to each of the reads, and clears the list.
+    void evict_cached_reads(std::vector<CachedReadPtr>& cached_reads);
+    // Records a newly seen pore, and moves the reads of any pores evicted to make room for it
+    // into evicted_reads.
+    void add_working_pore(int32_t client_id,
+                          const UniquePoreIdentifierKey& key,
+                          std::vector<CachedReadPtr>& evicted_reads);
+    // Evicts every read cached for the client, or for every client if none is given.
+    void flush_read_cache(std::optional<int32_t> client_id);
+
+    std::array<CacheShard, kNumCacheShards> m_cache_shards;
 
-    // individual read caches per client, keyed by client_id
-    std::unordered_map<int32_t, ReadCache> m_read_caches;
+    // The pores with cached reads for each client, oldest first, keyed by client_id.
+    std::mutex m_working_pores_mutex;
+    std::unordered_map<int32_t, std::deque<UniquePoreIdentifierKey>> m_working_pores;
 
     /**
      * The maximum number of different channels (pores) to keep in memory concurrently. 
@@ -108,6 +146,8 @@ private:
     using PairingResult = std::tuple<bool, uint32_t, uint32_t, uint32_t, uint32_t>;
     PairingResult is_within_time_and_length_criteria(const dorado::SimplexRead& read1,
                                                      const dorado::SimplexRead& read2,
+                                                     const utils::SequenceSketch* sketch1,
+                                                     const utils::SequenceSketch* sketch2,
                                                      int tid);
 
     PairingResult is_within_alignment_criteria(const dorado::SimplexRead& temp,
@@ -116,17 +156,15 @@ private:
                                                bool allow_rejection,
                                                int tid);
 
+    // Caches the minimap2 index of each template read, which may be in several candidate pairs.
+    std::shared_ptr<utils::OverlapEngine> m_overlap_engine;
     // Store the minimap2 buffers used for mapping. One buffer per thread.
     std::vector<MmTbufPtr> m_tbufs;
 
-    // Track reads which need to be emptied from the cache but are still being
-    // evaluated for pairs by other threads.
-    std::unordered_map<const SimplexRead*, std::atomic<int>> m_reads_in_flight_ctr;
-    std::unordered_set<SimplexReadPtr> m_reads_to_clear;
-
     // Stats tracking for pairing node.
     std::atomic<int> m_early_accepted_pairs{0};
     std::atomic<int> m_overlap_accepted_pairs{0};
+    std::atomic<int> m_sketch_rejected_pairs{0};
     std::atomic<size_t> m_cache_signal_bytes{0};
 };
 
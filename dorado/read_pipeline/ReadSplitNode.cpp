@@ -50,6 +50,12 @@ void ReadSplitNode::input_thread_fn() {
             continue;
         }
 
+        // The signal may not have been loaded from the source file yet.  Reads whose
+        // signal can't be loaded are dropped, and the error has already been logged.
+        if (!materialise_read_raw_data(message)) {
+            continue;
+        }
+
         // If this message isn't a read, we'll get a bad_variant_access exception.
         auto initial_read = std::get<SimplexReadPtr>(std::move(message));
         auto read_id = initial_read->read_common.read_id;
@@ -77,6 +83,9 @@ stats::NamedStats ReadSplitNode::sample_stats() const {
     stats["num_input_reads_pushed"] = static_cast<double>(m_num_input_reads_pushed.load());
     stats["num_reads_split"] = static_cast<double>(m_num_reads_split.load());
     stats["total_num_reads_pushed"] = static_cast<double>(m_total_num_reads_pushed.load());
+    for (const auto& [name, value] : stats::from_obj(*m_splitter)) {
+        stats[name] = value;
+    }
     return stats;
 }
 
@@ -5,42 +5,59 @@
 #include <spdlog/spdlog.h>
 
 #include <algorithm>
+#include <vector>
+
+namespace {
+
+// Maximum number of input messages processed per batch.
+constexpr size_t MAX_INPUT_BATCH_SIZE = 64;
+
+}  // namespace
 
 namespace dorado {
 
 void ReadToBamTypeNode::input_thread_fn() {
     at::InferenceMode inference_mode_guard;
 
-    Message message;
-    while (get_input_message(message)) {
-        // If this message isn't a read, just forward it to the sink.
-        if (!is_read_message(message)) {
-            send_message_to_sink(std::move(message));
-            continue;
+    std::vector<Message> messages;
+    std::vector<Message> output_messages;
+    while (get_input_messages(messages, MAX_INPUT_BATCH_SIZE)) {
+        for (auto& message : messages) {
+            process_message(std::move(message), output_messages);
         }
+        send_messages_to_sink(std::move(output_messages));
+        output_messages.clear();
+    }
+}
+
+void ReadToBamTypeNode::process_message(Message&& message, std::vector<Message>& output_messages) {
+    // If this message isn't a read, just forward it to the sink.
+    if (!is_read_message(message)) {
+        output_messages.push_back(std::move(message));
+        return;
+    }
 
-        auto& read_common_data = get_read_common_data(message);
+    auto& read_common_data = get_read_common_data(message);
 
-        bool is_duplex_parent = false;
-        if (!read_common_data.is_duplex) {
-            is_duplex_parent = std::get<SimplexReadPtr>(message)->is_duplex_parent;
-        }
+    bool is_duplex_parent = false;
+    if (!read_common_data.is_duplex) {
+        is_duplex_parent = std::get<SimplexReadPtr>(message)->is_duplex_parent;
+    }
 
-        // alias barcode if present
-        if (m_sample_sheet && !read_common_data.barcode.empty()) {
-            auto alias = m_sample_sheet->get_alias(
-                    read_common_data.flowcell_id, read_common_data.position_id,
-                    read_common_data.experiment_id, read_common_data.barcode);
-            if (!alias.empty()) {
-                read_common_data.barcode = alias;
-            }
+    // alias barcode if present
+    if (m_sample_sheet && !read_common_data.barcode.empty()) {
+        auto alias = m_sample_sheet->get_alias(
+                read_common_data.flowcell_id, read_common_data.position_id,
+                read_common_data.experiment_id, read_common_data.barcode);
+        if (!alias.empty()) {
+            read_common_data.barcode = alias;
         }
+    }
 
-        auto alns = read_common_data.extract_sam_lines(m_emit_moves, m_modbase_threshold,
-                                                       is_duplex_parent);
-        for (auto& aln : alns) {
-            send_message_to_sink(BamMessage{std::move(aln), read_common_data.client_info});
-        }
+    auto alns = read_common_data.extract_sam_lines(m_emit_moves, m_modbase_threshold,
+                                                   is_duplex_parent);
+    for (auto& aln : alns) {
+        output_messages.push_back(BamMessage{std::move(aln), read_common_data.client_info});
     }
 }
 
@@ -55,6 +72,10 @@ ReadToBamTypeNode::ReadToBamTypeNode(bool emit_moves,
                   static_cast<uint8_t>(std::min(modbase_threshold_frac * 256.0f, 255.0f))),
           m_sample_sheet(std::move(sample_sheet)) {}
 
-stats::NamedStats ReadToBamTypeNode::sample_stats() const { return stats::from_obj(m_work_queue); }
+stats::NamedStats ReadToBamTypeNode::sample_stats() const {
+    auto stats = stats::from_obj(m_work_queue);
+    add_input_batch_stats(stats);
+    return stats;
+}
 
 }  // namespace dorado
@@ -31,6 +31,8 @@ public:
 
 private:
     void input_thread_fn();
+    // Converts a read to BAM records, or passes through anything else.
+    void process_message(Message&& message, std::vector<Message>& output_messages);
 
     bool m_emit_moves;
     uint8_t m_modbase_threshold;
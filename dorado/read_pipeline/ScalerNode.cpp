@@ -133,6 +133,11 @@ void ScalerNode::input_thread_fn() {
             continue;
         }
 
+        // The signal may not have been loaded from the source file yet.  Reads whose
+        // signal can't be loaded are dropped, and the error has already been logged.
+        if (!materialise_read_raw_data(message)) {
+            continue;
+        }
         auto read = std::get<SimplexReadPtr>(std::move(message));
 
         bool is_rna_model =
@@ -362,14 +362,22 @@ const ReadCommon &get_read_common_data(const Message &message) {
     }
 }
 
-void materialise_read_raw_data(Message &message) {
-    if (std::holds_alternative<DuplexReadPtr>(message)) {
+bool materialise_read_raw_data(Message &message) {
+    if (std::holds_alternative<SimplexReadPtr>(message)) {
+        auto &read_common = std::get<SimplexReadPtr>(message)->read_common;
+        if (read_common.raw_data_loader) {
+            read_common.raw_data = read_common.raw_data_loader();
+            read_common.raw_data_loader = nullptr;
+        }
+        return read_common.raw_data.defined();
+    } else if (std::holds_alternative<DuplexReadPtr>(message)) {
         // Note: we could deallocate stereo_feature_inputs fields,
         // but this made a negligible difference to overall memory usage.
         auto &duplex_read = *std::get<DuplexReadPtr>(message);
         duplex_read.read_common.raw_data =
                 generate_stereo_features(duplex_read.stereo_feature_inputs);
     }
+    return true;
 }
 
 ReadPair::ReadData ReadPair::ReadData::from_read(const SimplexRead &read,
@@ -9,6 +9,7 @@
 
 #include <atomic>
 #include <cstdint>
+#include <functional>
 #include <limits>
 #include <memory>
 #include <string>
@@ -39,6 +40,10 @@ class ReadCommon {
 public:
     at::Tensor raw_data;  // Loaded from source file
 
+    // If set, raw_data hasn't been loaded from the source file yet, and calling this will
+    // load it.  Nodes that need the signal call materialise_read_raw_data() first.
+    std::function<at::Tensor()> raw_data_loader;
+
     int model_stride{-1};  // The down sampling factor of the model
 
     std::string read_id;                  // Unique read ID (UUID4)
@@ -218,17 +223,27 @@ public:
 
 // Overlaps for error correction
 struct CorrectionAlignments {
+    CorrectionAlignments() = default;
+    // Move only, since the qualities may point into qual_storage.
+    CorrectionAlignments(const CorrectionAlignments&) = delete;
+    CorrectionAlignments& operator=(const CorrectionAlignments&) = delete;
+    CorrectionAlignments(CorrectionAlignments&&) = default;
+    CorrectionAlignments& operator=(CorrectionAlignments&&) = default;
+
     // Populated in CorrectionMapperNode::extract_alignments
     std::string read_name;
     std::vector<std::string> qnames;
     std::vector<std::vector<CigarOp>> cigars;
     std::vector<utils::Overlap> overlaps;
 
-    // Populated in CorrectionInferenceNode::populate_alignments if the alignment is useful
+    // Populated in CorrectionInferenceNode::populate_alignments if the alignment is useful.
+    // Qualities are views of the same length as the sequences, into the read store, or into
+    // qual_storage if the reads were fetched from the input file.
     std::string read_seq;
-    std::vector<uint8_t> read_qual;
+    const uint8_t* read_qual{nullptr};
     std::vector<std::string> seqs;
-    std::vector<std::vector<uint8_t>> quals;
+    std::vector<const uint8_t*> quals;
+    std::vector<std::vector<uint8_t>> qual_storage;
 
     // This is mostly to workaround an issue where sometimes
     // the tend of an overlap is much bigger than the
@@ -248,7 +263,7 @@ struct CorrectionAlignments {
     }
 
     size_t size() {
-        size_t si = read_name.length() + read_seq.length() + read_qual.size();
+        size_t si = read_name.length() + read_seq.length();
         for (auto& o : overlaps) {
             si += sizeof(o);
         }
@@ -258,9 +273,6 @@ struct CorrectionAlignments {
         for (auto& s : seqs) {
             si += s.length();
         }
-        for (auto& v : quals) {
-            si += v.size();
-        }
         for (auto& s : qnames) {
             si += s.length();
         }
@@ -289,7 +301,9 @@ bool is_read_message(const Message& message);
 ReadCommon& get_read_common_data(Message& message);
 const ReadCommon& get_read_common_data(const Message& message);
 
-// Ensures the raw_data field is non-empty, which it won't necessarily be for DuplexRead.
-void materialise_read_raw_data(Message& message);
+// Ensures the raw_data field is non-empty, which it won't necessarily be for DuplexRead,
+// or for reads whose signal is loaded lazily.  Returns false if the signal couldn't be
+// loaded, in which case the read should be dropped.
+bool materialise_read_raw_data(Message& message);
 
 }  // namespace dorado
@@ -3,8 +3,6 @@
 #include "myers.h"
 #include "read_pipeline/read_utils.h"
 #include "splitter/splitter_utils.h"
-#include "utils/PostCondition.h"
-#include "utils/alignment_utils.h"
 #include "utils/sequence_utils.h"
 #include "utils/uuid_utils.h"
 
@@ -17,6 +15,7 @@
 #include <cmath>
 #include <iomanip>
 #include <iterator>
+#include <memory>
 #include <optional>
 #include <string>
 #include <string_view>
@@ -26,6 +25,16 @@ namespace dorado::splitter {
 
 namespace {
 
+// Names of the split finders, as reported in trace logging and stats.
+constexpr const char* SIGNAL_SCAN = "SIGNAL_SCAN";
+constexpr const char* PORE_ADAPTER = "PORE_ADAPTER";
+constexpr const char* MUA_ADAPTER = "muA_adapter";
+constexpr const char* PORE_FLANK = "PORE_FLANK";
+constexpr const char* PORE_ALL = "PORE_ALL";
+constexpr const char* ADAPTER_FLANK = "ADAPTER_FLANK";
+constexpr const char* ADAPTER_MIDDLE = "ADAPTER_MIDDLE";
+constexpr const char* SPLIT_MIDDLE = "SPLIT_MIDDLE";
+
 //[start, end)
 std::optional<PosRange> find_best_adapter_match(const std::string& adapter,
                                                 const std::string& seq,
@@ -39,17 +48,13 @@ std::optional<PosRange> find_best_adapter_match(const std::string& adapter,
         return std::nullopt;
     }
 
-    auto edlib_cfg = edlibNewAlignConfig(dist_thr, EDLIB_MODE_HW, EDLIB_TASK_LOC, NULL, 0);
-
-    auto edlib_result = edlibAlign(adapter.c_str(), int(adapter.size()), seq.c_str() + shift,
-                                   int(span), edlib_cfg);
-    assert(edlib_result.status == EDLIB_STATUS_OK);
+    const auto match = myers_align_best(adapter, std::string_view(seq).substr(shift, span),
+                                        static_cast<std::size_t>(dist_thr));
     std::optional<PosRange> res = std::nullopt;
-    if (edlib_result.status == EDLIB_STATUS_OK && edlib_result.editDistance != -1) {
-        assert(edlib_result.editDistance <= dist_thr);
-        res = {edlib_result.startLocations[0] + shift, edlib_result.endLocations[0] + shift + 1};
+    if (match) {
+        assert(match->edist <= static_cast<std::size_t>(dist_thr));
+        res = {match->begin + shift, match->end + shift};
     }
-    edlibFreeAlignResult(edlib_result);
     return res;
 }
 
@@ -82,24 +87,16 @@ std::optional<PosRange> check_rc_match(const std::string& seq,
     auto rc_compl = dorado::utils::reverse_complement(
             seq.substr(compl_r.first, compl_r.second - compl_r.first));
 
-    auto edlib_cfg = edlibNewAlignConfig(dist_thr, EDLIB_MODE_HW, EDLIB_TASK_LOC, NULL, 0);
-
-    auto edlib_result = edlibAlign(seq.c_str() + templ_r.first, int(templ_r.second - templ_r.first),
-                                   rc_compl.c_str(), int(rc_compl.size()), edlib_cfg);
-    assert(edlib_result.status == EDLIB_STATUS_OK);
-
-    bool match = (edlib_result.status == EDLIB_STATUS_OK) && (edlib_result.editDistance != -1);
+    const auto match = myers_align_best(
+            std::string_view(seq).substr(templ_r.first, templ_r.second - templ_r.first), rc_compl,
+            static_cast<std::size_t>(dist_thr));
     std::optional<PosRange> res = std::nullopt;
     if (match) {
-        assert(edlib_result.editDistance <= dist_thr);
-        assert(edlib_result.numLocations > 0 &&
-               edlib_result.endLocations[0] < int(compl_r.second) &&
-               edlib_result.startLocations[0] < int(compl_r.second));
-        res = PosRange(compl_r.second - edlib_result.endLocations[0],
-                       compl_r.second - edlib_result.startLocations[0]);
+        assert(match->edist <= static_cast<std::size_t>(dist_thr));
+        assert(match->end <= compl_r.second && match->begin < compl_r.second);
+        res = PosRange(compl_r.second - (match->end - 1), compl_r.second - match->begin);
     }
 
-    edlibFreeAlignResult(edlib_result);
     return res;
 }
 
@@ -121,18 +118,39 @@ float qscore_mean(const std::string& qstring, splitter::PosRange r) {
 
 struct DuplexReadSplitter::ExtRead {
     SimplexReadPtr read;
+    // For subreads, a view into the signal of the read they were split from.
     at::Tensor data_as_float32;
     std::vector<uint64_t> move_sums;
+    // Pore samples of the original read's signal, which are shared by all of its subreads,
+    // and the offset of this read's signal within the original's.
+    std::shared_ptr<const PoreSamples<float>> pore_samples;
+    uint64_t signal_offset{0};
     splitter::PosRanges possible_pore_regions;
 };
 
-DuplexReadSplitter::ExtRead DuplexReadSplitter::create_ext_read(SimplexReadPtr r) const {
+DuplexReadSplitter::ExtRead DuplexReadSplitter::create_ext_read(SimplexReadPtr r,
+                                                                const ExtRead* parent) const {
     ExtRead ext_read;
     ext_read.read = std::move(r);
     ext_read.move_sums = utils::move_cum_sums(ext_read.read->read_common.moves);
     assert(!ext_read.move_sums.empty());
     assert(ext_read.move_sums.back() == ext_read.read->read_common.seq.length());
-    ext_read.data_as_float32 = ext_read.read->read_common.raw_data.to(at::kFloat);
+    if (parent) {
+        // The signal of a subread starts at its split point in the parent's signal.
+        const uint64_t signal_start = ext_read.read->read_common.split_point;
+        const uint64_t signal_end =
+                signal_start + ext_read.read->read_common.get_raw_data_samples();
+        ext_read.data_as_float32 = parent->data_as_float32.index(
+                {at::indexing::Slice(signal_start, signal_end)});
+        ext_read.pore_samples = parent->pore_samples;
+        ext_read.signal_offset = parent->signal_offset + signal_start;
+    } else {
+        const auto start_ts = std::chrono::steady_clock::now();
+        ext_read.data_as_float32 = ext_read.read->read_common.raw_data.to(at::kFloat);
+        ext_read.pore_samples = std::make_shared<const PoreSamples<float>>(
+                find_pore_samples(ext_read.data_as_float32, m_settings.pore_thr));
+        m_finder_stats.at(SIGNAL_SCAN).record(start_ts, 0);
+    }
     ext_read.possible_pore_regions = possible_pore_regions(ext_read);
     return ext_read;
 }
@@ -140,9 +158,10 @@ DuplexReadSplitter::ExtRead DuplexReadSplitter::create_ext_read(SimplexReadPtr r
 PosRanges DuplexReadSplitter::possible_pore_regions(const DuplexReadSplitter::ExtRead& read) const {
     spdlog::trace("Analyzing signal in read {}", read.read->read_common.read_id);
 
-    auto pore_sample_ranges =
-            detect_pore_signal<float>(read.data_as_float32, m_settings.pore_thr,
-                                      m_settings.pore_cl_dist, m_settings.expect_pore_prefix);
+    auto pore_sample_ranges = cluster_pore_samples(
+            *read.pore_samples, read.signal_offset,
+            read.signal_offset + read.data_as_float32.size(0), m_settings.pore_cl_dist,
+            m_settings.expect_pore_prefix);
 
     std::vector<std::pair<float, PosRange>> candidate_regions;
     for (auto pore_sample_range : pore_sample_ranges) {
@@ -234,19 +253,14 @@ PosRanges DuplexReadSplitter::find_muA_adapter_spikes(const ExtRead& read) const
 
         // Search the sequence.
         if (best_only) {
-            auto edlib_cfg = edlibNewAlignConfig(static_cast<int>(max_edist), EDLIB_MODE_HW,
-                                                 EDLIB_TASK_LOC, nullptr, 0);
-            auto edlib_result = edlibAlign(query.data(), static_cast<int>(query.size()), seq.data(),
-                                           static_cast<int>(seq.size()), edlib_cfg);
-            assert(edlib_result.status == EDLIB_STATUS_OK);
-            auto edlib_cleanup = utils::PostCondition([&] { edlibFreeAlignResult(edlib_result); });
+            const auto match = myers_align_best(query, seq, max_edist);
 
             // Add the match if it looks good.
             PosRanges ranges;
-            if (edlib_result.status == EDLIB_STATUS_OK && edlib_result.editDistance != -1) {
+            if (match) {
                 PosRange range;
-                range.first = min_start + edlib_result.startLocations[0];
-                range.second = min_start + edlib_result.endLocations[0] + 1;
+                range.first = min_start + match->begin;
+                range.second = min_start + match->end;
                 if (static_cast<std::int64_t>(range.first) <= max_start) {
                     ranges.push_back(range);
                 }
@@ -525,19 +539,19 @@ std::vector<DuplexReadSplitter::ExtRead> DuplexReadSplitter::apply_split_finders
     std::vector<ExtRead> split_reads;
     split_reads.push_back(std::move(orig_read));
 
-    apply_split_finder(split_reads, "PORE_ADAPTER", [this](const ExtRead& read) {
+    apply_split_finder(split_reads, PORE_ADAPTER, [this](const ExtRead& read) {
         return filter_ranges(read.possible_pore_regions, [this, &read](PosRange r) {
             return check_nearby_adapter(*read.read, r, m_settings.adapter_edist);
         });
     });
 
     if (is_rapid) {
-        apply_split_finder(split_reads, "muA_adapter",
+        apply_split_finder(split_reads, MUA_ADAPTER,
                            [this](const ExtRead& read) { return find_muA_adapter_spikes(read); });
     }
 
     if (!m_settings.simplex_mode) {
-        apply_split_finder(split_reads, "PORE_FLANK", [this](const ExtRead& read) {
+        apply_split_finder(split_reads, PORE_FLANK, [this](const ExtRead& read) {
             auto filter = [this, &read](PosRange r) {
                 return check_flank_match(*read.read, r, m_settings.flank_err);
             };
@@ -545,7 +559,7 @@ std::vector<DuplexReadSplitter::ExtRead> DuplexReadSplitter::apply_split_finders
                                 m_settings.strand_end_flank + m_settings.strand_start_flank);
         });
 
-        apply_split_finder(split_reads, "PORE_ALL", [this](const ExtRead& read) {
+        apply_split_finder(split_reads, PORE_ALL, [this](const ExtRead& read) {
             auto filter = [this, &read](PosRange r) {
                 return check_nearby_adapter(*read.read, r, m_settings.relaxed_adapter_edist) &&
                        check_flank_match(*read.read, r, m_settings.relaxed_flank_err);
@@ -554,7 +568,7 @@ std::vector<DuplexReadSplitter::ExtRead> DuplexReadSplitter::apply_split_finders
                                 m_settings.strand_end_flank + m_settings.strand_start_flank);
         });
 
-        apply_split_finder(split_reads, "ADAPTER_FLANK", [this](const ExtRead& read) {
+        apply_split_finder(split_reads, ADAPTER_FLANK, [this](const ExtRead& read) {
             auto filter = [this, &read](PosRange r) {
                 return check_flank_match(*read.read, {r.first, r.first}, m_settings.flank_err);
             };
@@ -565,7 +579,7 @@ std::vector<DuplexReadSplitter::ExtRead> DuplexReadSplitter::apply_split_finders
                     filter);
         });
 
-        apply_split_finder(split_reads, "ADAPTER_MIDDLE", [this](const ExtRead& read) {
+        apply_split_finder(split_reads, ADAPTER_MIDDLE, [this](const ExtRead& read) {
             if (auto split = identify_middle_adapter_split(*read.read)) {
                 return PosRanges{*split};
             } else {
@@ -573,7 +587,7 @@ std::vector<DuplexReadSplitter::ExtRead> DuplexReadSplitter::apply_split_finders
             }
         });
 
-        apply_split_finder(split_reads, "SPLIT_MIDDLE", [this](const ExtRead& read) {
+        apply_split_finder(split_reads, SPLIT_MIDDLE, [this](const ExtRead& read) {
             if (auto split = identify_extra_middle_split(*read.read)) {
                 return PosRanges{*split};
             } else {
@@ -590,19 +604,23 @@ void DuplexReadSplitter::apply_split_finder(std::vector<ExtRead>& to_split,
                                             const char* description,
                                             const SplitFinder& split_finder) const {
     spdlog::trace("Running {}", description);
+    auto& finder_stats = m_finder_stats.at(description);
 
     std::vector<ExtRead> split_round_result;
     split_round_result.reserve(to_split.size());
     for (auto& read : to_split) {
+        const auto start_ts = std::chrono::steady_clock::now();
         auto spacers = split_finder(read);
+        finder_stats.record(start_ts, spacers.size());
         spdlog::trace("DSN: {} strategy {} splits in read {}", description, spacers.size(),
                       read.read->read_common.read_id);
 
         if (spacers.empty()) {
             split_round_result.push_back(std::move(read));
         } else {
-            for (auto& sr : subreads(std::move(read.read), spacers)) {
-                split_round_result.push_back(create_ext_read(std::move(sr)));
+            auto parent_read = std::move(read.read);
+            for (auto& sr : subreads(std::move(parent_read), spacers)) {
+                split_round_result.push_back(create_ext_read(std::move(sr), &read));
             }
         }
     }
@@ -670,8 +688,33 @@ std::vector<SimplexReadPtr> DuplexReadSplitter::split(SimplexReadPtr init_read)
 }
 
 DuplexReadSplitter::DuplexReadSplitter(DuplexSplitSettings settings)
-        : m_settings(std::move(settings)) {}
+        : m_settings(std::move(settings)) {
+    for (const char* name : {SIGNAL_SCAN, PORE_ADAPTER, MUA_ADAPTER, PORE_FLANK, PORE_ALL,
+                             ADAPTER_FLANK, ADAPTER_MIDDLE, SPLIT_MIDDLE}) {
+        m_finder_stats.try_emplace(name);
+    }
+}
 
 DuplexReadSplitter::~DuplexReadSplitter() {}
 
+void DuplexReadSplitter::FinderStats::record(std::chrono::steady_clock::time_point start_ts,
+                                             size_t splits) {
+    const auto elapsed = std::chrono::steady_clock::now() - start_ts;
+    time_us += std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count();
+    num_reads++;
+    num_splits += splits;
+}
+
+stats::NamedStats DuplexReadSplitter::sample_stats() const {
+    stats::NamedStats stats;
+    for (const auto& [name, finder_stats] : m_finder_stats) {
+        stats[name + ".num_reads"] = double(finder_stats.num_reads.load());
+        stats[name + ".time_ms"] = double(finder_stats.time_us.load()) / 1000;
+        if (name != SIGNAL_SCAN) {
+            stats[name + ".num_splits"] = double(finder_stats.num_splits.load());
+        }
+    }
+    return stats;
+}
+
 }  // namespace dorado::splitter
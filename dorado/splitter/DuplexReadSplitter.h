@@ -3,8 +3,11 @@
 #include "splitter/splitter_utils.h"
 #include "utils/types.h"
 
+#include <atomic>
+#include <chrono>
 #include <cstdint>
 #include <functional>
+#include <map>
 #include <optional>
 #include <string>
 #include <vector>
@@ -17,11 +20,23 @@ public:
     ~DuplexReadSplitter();
 
     std::vector<SimplexReadPtr> split(SimplexReadPtr init_read) const override;
+    std::string get_name() const override { return "DuplexReadSplitter"; }
+    stats::NamedStats sample_stats() const override;
 
 private:
     struct ExtRead;
 
-    ExtRead create_ext_read(SimplexReadPtr r) const;
+    // Time spent in, and splits found by, a split finder, or in the initial signal scan.
+    struct FinderStats {
+        std::atomic<uint64_t> num_reads{0};
+        std::atomic<uint64_t> num_splits{0};
+        std::atomic<uint64_t> time_us{0};
+
+        void record(std::chrono::steady_clock::time_point start_ts, size_t splits);
+    };
+
+    // Subreads reuse the signal and pore samples of the |parent| they were split from.
+    ExtRead create_ext_read(SimplexReadPtr r, const ExtRead* parent = nullptr) const;
     PosRanges possible_pore_regions(const ExtRead& read) const;
     PosRanges find_muA_adapter_spikes(const ExtRead& read) const;
     bool check_nearby_adapter(const SimplexRead& read,
@@ -42,6 +57,9 @@ private:
                             const SplitFinder& split_finder) const;
 
     const DuplexSplitSettings m_settings;
+    // Keyed by split finder description.  Every entry is added on construction, so the map
+    // itself is never modified while splitting.
+    mutable std::map<std::string, FinderStats> m_finder_stats;
 };
 
 }  // namespace dorado::splitter
@@ -13,6 +13,7 @@ public:
     RNAReadSplitter(RNASplitSettings settings);
 
     std::vector<SimplexReadPtr> split(SimplexReadPtr init_read) const override;
+    std::string get_name() const override { return "RNAReadSplitter"; }
 
 private:
     //TODO consider precomputing and reusing ranges with high signal
@@ -1,5 +1,7 @@
 #pragma once
 
+#include "utils/stats.h"
+
 #include <cstdint>
 #include <memory>
 #include <string>
@@ -78,6 +80,9 @@ public:
     virtual ~ReadSplitter() = default;
 
     virtual std::vector<SimplexReadPtr> split(SimplexReadPtr init_read) const = 0;
+
+    virtual std::string get_name() const = 0;
+    virtual stats::NamedStats sample_stats() const { return {}; }
 };
 
 }  // namespace splitter
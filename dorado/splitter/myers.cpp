@@ -1,53 +1,155 @@
 #include "myers.h"
 
-#include "utils/PostCondition.h"
-#include "utils/alignment_utils.h"
-
 #include <algorithm>
 #include <cassert>
 #include <cstdint>
 #include <iomanip>
 #include <optional>
 #include <ostream>
+#include <string>
 
 namespace dorado::splitter {
 
 namespace {
 
-// Returns the array D[0..n], where D[i] is equal to local alignment of the pattern to suffix of text[0..i).
-std::vector<size_t> d_myers(const char* pattern, size_t m, const char* text, size_t n) {
-    constexpr size_t MAX_ALPHABET = 256;
-    assert(m < 64);
-    uint64_t PM[MAX_ALPHABET]{};
-    for (size_t i = 0; i < m; i++) {
-        PM[static_cast<uint8_t>(pattern[i])] |= uint64_t{1} << i;
+constexpr size_t WORD_SIZE = 64;
+constexpr size_t MAX_ALPHABET = 256;
+
+// The pattern as bitmasks of the positions of each character, split into blocks of 64 rows.
+class BlockedPattern {
+public:
+    explicit BlockedPattern(std::string_view pattern)
+            : m_length(pattern.size()),
+              m_num_blocks((pattern.size() + WORD_SIZE - 1) / WORD_SIZE),
+              m_peq(MAX_ALPHABET * m_num_blocks) {
+        for (size_t i = 0; i < m_length; i++) {
+            m_peq[static_cast<uint8_t>(pattern[i]) * m_num_blocks + i / WORD_SIZE] |=
+                    uint64_t{1} << (i % WORD_SIZE);
+        }
+    }
+
+    size_t length() const { return m_length; }
+    size_t num_blocks() const { return m_num_blocks; }
+    const uint64_t* peq(char c) const { return &m_peq[static_cast<uint8_t>(c) * m_num_blocks]; }
+
+    // The number of rows in a block, which is less than 64 for the last block of a pattern
+    // that isn't a multiple of 64 long.
+    size_t block_rows(size_t block) const {
+        return std::min(WORD_SIZE, m_length - block * WORD_SIZE);
+    }
+
+private:
+    size_t m_length;
+    size_t m_num_blocks;
+    std::vector<uint64_t> m_peq;
+};
+
+// Advances one block of the DP matrix by a column, given the horizontal delta coming into its
+// top row, and returns the horizontal delta out of its last row.
+int advance_block(uint64_t& pv, uint64_t& mv, uint64_t eq, int hin, size_t last_row) {
+    const uint64_t xv = eq | mv;
+    if (hin < 0) {
+        eq |= 1;
+    }
+    const uint64_t xh = (((eq & pv) + pv) ^ pv) | eq;
+    uint64_t ph = mv | ~(xh | pv);
+    uint64_t mh = pv & xh;
+
+    const int hout = int((ph >> last_row) & 1) - int((mh >> last_row) & 1);
+
+    ph <<= 1;
+    mh <<= 1;
+    if (hin < 0) {
+        mh |= 1;
+    } else if (hin > 0) {
+        ph |= 1;
+    }
+    pv = mh | ~(xv | ph);
+    mv = ph & xv;
+    return hout;
+}
+
+// Calls on_column(j, edist) for each j in [1, text.size()], where edist is the edit distance
+// of the whole pattern against text[0..j), either with the start of the alignment anywhere
+// in the text (free_start, i.e. edlib's EDLIB_MODE_HW) or at its start (EDLIB_MODE_SHW).
+//
+// Distances above max_edist are reported as max_edist + 1.  This lets the blocks of the
+// pattern whose rows are all above max_edist be skipped (Ukkonen's cut-off), so only the
+// first few blocks of a long pattern are usually computed.
+template <typename OnColumn>
+void myers_scan(const BlockedPattern& pattern,
+                std::string_view text,
+                bool free_start,
+                std::size_t max_edist,
+                OnColumn&& on_column) {
+    struct Block {
+        uint64_t pv;
+        uint64_t mv;
+        // The score of the last row of the block.
+        int64_t score;
+        int64_t rows;
+    };
+    const size_t num_blocks = pattern.num_blocks();
+    const auto k = static_cast<int64_t>(max_edist);
+    std::vector<Block> blocks(num_blocks);
+    for (size_t b = 0; b < num_blocks; b++) {
+        blocks[b].rows = pattern.block_rows(b);
+    }
+
+    // In the first column the score of row i is i.
+    size_t last_block = 0;
+    blocks[0] = {~uint64_t{0}, 0, blocks[0].rows, blocks[0].rows};
+    while (last_block + 1 < num_blocks && blocks[last_block].score <= k) {
+        auto& block = blocks[++last_block];
+        block = {~uint64_t{0}, 0, blocks[last_block - 1].score + block.rows, block.rows};
     }
 
-    std::vector<size_t> D(n + 1);
-    uint64_t VP = ~uint64_t{0};
-    uint64_t VN = 0;
-    size_t score = m;
-    D[0] = score;
-    for (size_t j = 0; j < n; j++) {
-        const uint64_t EQ = PM[static_cast<uint8_t>(text[j])];
-        const uint64_t D0 = (((EQ & VP) + VP) ^ VP) | EQ | VN;
-        uint64_t HP = VN | ~(D0 | VP);
-        uint64_t HN = D0 & VP;
-
-        if (HP & (uint64_t{1} << (m - 1))) {
-            score++;
+    for (size_t j = 0; j < text.size(); j++) {
+        const uint64_t* eq = pattern.peq(text[j]);
+        int hout = free_start ? 0 : 1;
+        for (size_t b = 0; b <= last_block; b++) {
+            auto& block = blocks[b];
+            hout = advance_block(block.pv, block.mv, eq[b], hout, block.rows - 1);
+            block.score += hout;
+        }
+
+        // Only the first row after the last active one can drop to max_edist in this column,
+        // and only if the last row of the active ones was within it in the previous column.
+        const auto prev_score = blocks[last_block].score - hout;
+        if (last_block + 1 < num_blocks && prev_score <= k) {
+            auto& block = blocks[++last_block];
+            block.pv = ~uint64_t{0};
+            block.mv = 0;
+            block.score = prev_score + block.rows +
+                          advance_block(block.pv, block.mv, eq[last_block], hout, block.rows - 1);
         }
-        if (HN & (uint64_t{1} << (m - 1))) {
-            score--;
+
+        // Deactivate trailing blocks whose rows are all above max_edist.
+        while (last_block > 0 && blocks[last_block].score >= k + blocks[last_block].rows) {
+            last_block--;
         }
-        D[j + 1] = score;
 
-        HP <<= 1;
-        HN <<= 1;
-        VP = HN | ~(D0 | HP);
-        VN = D0 & HP;
+        const auto score = blocks[last_block].score;
+        const bool in_range = last_block + 1 == num_blocks && score <= k;
+        on_column(j + 1, in_range ? static_cast<std::size_t>(score) : max_edist + 1);
     }
-    return D;
+}
+
+// Finds the start of the longest alignment of query which ends at the end of seq with an edit
+// distance of edist, as edlib reports for an EDLIB_MODE_HW match ending there.  An alignment
+// with edist edits can't span more than query.size() + edist bases of seq, so only that much of
+// seq needs to be passed in.
+std::size_t find_match_start(std::string_view query, std::string_view seq, std::size_t edist) {
+    const std::string rev_query(query.rbegin(), query.rend());
+    const std::string rev_seq(seq.rbegin(), seq.rend());
+    std::size_t match_len = 0;
+    myers_scan(BlockedPattern(rev_query), rev_seq, false, edist,
+               [&](std::size_t j, std::size_t column_edist) {
+                   if (column_edist == edist) {
+                       match_len = j;
+                   }
+               });
+    return seq.size() - match_len;
 }
 
 }  // namespace
@@ -57,10 +159,11 @@ std::vector<EdistResult> myers_align(std::string_view query,
                                      std::size_t max_edist) {
     std::vector<EdistResult> ranges;
     const auto query_len = query.size();
-    if (seq.size() < query_len) {
+    if (query_len == 0 || seq.size() < query_len) {
         // Too small, don't bother.
         return ranges;
     }
+    const BlockedPattern pattern(query);
 
     auto add_match = [&](std::size_t end, std::size_t edist) {
         // |edist| is for the full query ending at |end|, so we know the earliest that the match can start.
@@ -72,40 +175,33 @@ std::vector<EdistResult> myers_align(std::string_view query,
             ranges.push_back({min_match_start, end, edist});
 
         } else {
-            // If this isn't an exact match then hand over to edlib to get the start index.
+            // If this isn't an exact match then search the span it can cover for the start index.
             const auto max_match_span = seq.substr(min_match_start, max_match_len);
-            auto edlib_cfg = edlibNewAlignConfig(static_cast<int>(edist), EDLIB_MODE_HW,
-                                                 EDLIB_TASK_LOC, nullptr, 0);
-            auto edlib_result =
-                    edlibAlign(query.data(), static_cast<int>(query.size()), max_match_span.data(),
-                               static_cast<int>(max_match_span.size()), edlib_cfg);
-            assert(edlib_result.status == EDLIB_STATUS_OK);
-            auto edlib_cleanup = utils::PostCondition([&] { edlibFreeAlignResult(edlib_result); });
-
-            if (edlib_result.status == EDLIB_STATUS_OK) {
-                // edlib only reports the best edist it finds, so if there's a better match in the same span then it'll
-                // report that instead. This can happen for spans that are close together, for example:
-                // edists:...,7,6,5,5,4,5,6,6,6,5,6,..., max_edist=5
-                //               end1=^    end2=^
-                // When processing 'end2' we have to extend our search span to include that of 'end1' (since it's
-                // |max_edist| indices away). This means that, if the edits aren't insertions, we end up finding the
-                // same sequence as |end1|, which has a better edist and hence is the only thing edlib reports.
-                // We should be safe to ignore the worse edist in those cases.
-                for (int i = 0; i < edlib_result.numLocations; i++) {
-                    // edlib indices are inclusive, ours are exclusive.
-                    const std::size_t edlib_end =
-                            min_match_start + edlib_result.endLocations[i] + 1;
-                    if (edlib_result.editDistance == static_cast<int>(edist) && edlib_end == end) {
-                        ranges.push_back(
-                                {min_match_start + edlib_result.startLocations[i], end, edist});
-                    }
-                }
+
+            // If there's a better match in the same span then we skip this one. This can happen
+            // for spans that are close together, for example:
+            // edists:...,7,6,5,5,4,5,6,6,6,5,6,..., max_edist=5
+            //               end1=^    end2=^
+            // When processing 'end2' we have to extend our search span to include that of 'end1' (since it's
+            // |max_edist| indices away). This means that, if the edits aren't insertions, we end up finding the
+            // same sequence as |end1|, which has a better edist.
+            // We should be safe to ignore the worse edist in those cases.
+            std::size_t best_span_edist = edist;
+            myers_scan(pattern, max_match_span, true, edist,
+                       [&](std::size_t, std::size_t span_edist) {
+                           best_span_edist = std::min(best_span_edist, span_edist);
+                       });
+            if (best_span_edist == edist) {
+                const auto start = find_match_start(query, max_match_span, edist);
+                ranges.push_back({min_match_start + start, end, edist});
             }
         }
     };
 
     // Calculate edit distances for each index.
-    const auto local_edists = d_myers(query.data(), query.size(), seq.data(), seq.size());
+    std::vector<std::size_t> local_edists(seq.size() + 1, std::min(query_len, max_edist + 1));
+    myers_scan(pattern, seq, true, max_edist,
+               [&](std::size_t j, std::size_t edist) { local_edists[j] = edist; });
 
     // Look for drops below the threshold and join neighbouring ranges together.
     //
@@ -149,6 +245,34 @@ std::vector<EdistResult> myers_align(std::string_view query,
     return ranges;
 }
 
+std::optional<EdistResult> myers_align_best(std::string_view query,
+                                            std::string_view seq,
+                                            std::size_t max_edist) {
+    if (query.empty()) {
+        return std::nullopt;
+    }
+
+    // Find the first of the best scoring ends.
+    std::size_t best_end = 0;
+    std::size_t best_edist = max_edist + 1;
+    myers_scan(BlockedPattern(query), seq, true, max_edist,
+               [&](std::size_t j, std::size_t edist) {
+                   if (edist < best_edist) {
+                       best_edist = edist;
+                       best_end = j;
+                   }
+               });
+    if (best_edist > max_edist) {
+        return std::nullopt;
+    }
+
+    const auto max_match_len = std::min(query.size() + best_edist, best_end);
+    const auto min_match_start = best_end - max_match_len;
+    const auto start =
+            find_match_start(query, seq.substr(min_match_start, max_match_len), best_edist);
+    return EdistResult{min_match_start + start, best_end, best_edist};
+}
+
 void print_edists(std::ostream& os, std::string_view seq, const std::vector<size_t>& edists) {
     assert(edists.size() == seq.size() + 1);
 
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <iosfwd>
+#include <optional>
 #include <string_view>
 #include <vector>
 
@@ -15,6 +16,14 @@ std::vector<EdistResult> myers_align(std::string_view query,
                                      std::string_view seq,
                                      std::size_t max_edist);
 
+// Finds the best match of query in seq with an edit distance of at most max_edist.  This is the
+// same match as edlibAlign() in EDLIB_MODE_HW reports first: the earliest ending of the best
+// matches, starting as early as possible.  Patterns of any length are supported, and only the
+// rows of the DP matrix within max_edist are computed, so small thresholds are cheap.
+std::optional<EdistResult> myers_align_best(std::string_view query,
+                                            std::string_view seq,
+                                            std::size_t max_edist);
+
 void print_edists(std::ostream& os, std::string_view seq, const std::vector<size_t>& edists);
 
 }  // namespace dorado::splitter
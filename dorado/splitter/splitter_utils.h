@@ -48,45 +48,80 @@ struct SampleRange {
 template <typename T>
 using SampleRanges = std::vector<SampleRange<T>>;
 
+// The samples of a signal above a threshold, in order.  Open pore signal is rare, so this is
+// usually much smaller than the signal, and any part of the signal can be clustered from it
+// without scanning the signal again.
 template <typename T>
-SampleRanges<T> detect_pore_signal(const at::Tensor& signal,
-                                   T threshold,
-                                   uint64_t cluster_dist,
-                                   uint64_t ignore_prefix) {
-    SampleRanges<T> ans;
+struct PoreSamples {
+    std::vector<uint64_t> positions;
+    std::vector<T> values;
+};
+
+template <typename T>
+PoreSamples<T> find_pore_samples(const at::Tensor& signal, T threshold) {
+    PoreSamples<T> samples;
     auto pore_a = signal.accessor<T, 1>();
+    for (int64_t i = 0; i < pore_a.size(0); i++) {
+        if (pore_a[i] > threshold) {
+            samples.positions.push_back(i);
+            samples.values.push_back(pore_a[i]);
+        }
+    }
+    return samples;
+}
+
+// Clusters the pore samples in [begin, end) of the signal, ignoring the first ignore_prefix
+// samples of that range.  Sample positions in the result are relative to begin.
+template <typename T>
+SampleRanges<T> cluster_pore_samples(const PoreSamples<T>& samples,
+                                     uint64_t begin,
+                                     uint64_t end,
+                                     uint64_t cluster_dist,
+                                     uint64_t ignore_prefix) {
+    SampleRanges<T> ans;
     int64_t cl_start = -1;
     int64_t cl_end = -1;
 
     T cl_max = std::numeric_limits<T>::min();
     int64_t cl_argmax = -1;
-    for (auto i = ignore_prefix; i < uint64_t(pore_a.size(0)); i++) {
-        if (pore_a[i] > threshold) {
-            //check if we need to start new cluster
-            if (cl_end == -1 || i > cl_end + cluster_dist) {
-                //report previous cluster
-                if (cl_end != -1) {
-                    assert(cl_start != -1);
-                    ans.push_back(SampleRange(cl_start, cl_end, cl_argmax, cl_max));
-                }
-                cl_start = i;
-                cl_max = std::numeric_limits<T>::min();
+    const auto first = std::lower_bound(samples.positions.begin(), samples.positions.end(),
+                                        begin + ignore_prefix);
+    for (auto it = first; it != samples.positions.end() && *it < end; ++it) {
+        const auto i = *it - begin;
+        const auto val = samples.values[it - samples.positions.begin()];
+        //check if we need to start new cluster
+        if (cl_end == -1 || i > cl_end + cluster_dist) {
+            //report previous cluster
+            if (cl_end != -1) {
+                assert(cl_start != -1);
+                ans.push_back(SampleRange(cl_start, cl_end, cl_argmax, cl_max));
             }
-            if (pore_a[i] >= cl_max) {
-                cl_max = pore_a[i];
-                cl_argmax = i;
-            }
-            cl_end = i + 1;
+            cl_start = i;
+            cl_max = std::numeric_limits<T>::min();
+        }
+        if (val >= cl_max) {
+            cl_max = val;
+            cl_argmax = i;
         }
+        cl_end = i + 1;
     }
     //report last cluster
     if (cl_end != -1) {
         assert(cl_start != -1);
-        assert(cl_start < pore_a.size(0) && cl_end <= pore_a.size(0));
+        assert(uint64_t(cl_end) <= end - begin);
         ans.push_back(SampleRange(cl_start, cl_end, cl_argmax, cl_max));
     }
 
     return ans;
 }
 
+template <typename T>
+SampleRanges<T> detect_pore_signal(const at::Tensor& signal,
+                                   T threshold,
+                                   uint64_t cluster_dist,
+                                   uint64_t ignore_prefix) {
+    return cluster_pore_samples(find_pore_samples(signal, threshold), 0, signal.size(0),
+                                cluster_dist, ignore_prefix);
+}
+
 }  // namespace dorado::splitter
@@ -0,0 +1,119 @@
+#include "signal_arena.h"
+
+#include <ATen/Functions.h>
+#include <c10/core/ScalarType.h>
+
+#include <algorithm>
+
+namespace {
+
+// Classes go up in quarter octaves, so at most a fifth of a slab is wasted by allocations of
+// MIN_CLASS_BYTES or more.  Smaller allocations all use the smallest class.
+constexpr size_t MIN_CLASS_BYTES = size_t{16} << 10;
+constexpr size_t MAX_CLASS_BYTES = size_t{64} << 20;
+constexpr size_t CLASSES_PER_OCTAVE = 4;
+
+const std::vector<size_t>& get_size_classes() {
+    static const std::vector<size_t> size_classes = [] {
+        std::vector<size_t> classes;
+        for (size_t octave = MIN_CLASS_BYTES; octave < MAX_CLASS_BYTES; octave *= 2) {
+            for (size_t step = 0; step < CLASSES_PER_OCTAVE; ++step) {
+                classes.push_back(octave + step * (octave / CLASSES_PER_OCTAVE));
+            }
+        }
+        classes.push_back(MAX_CLASS_BYTES);
+        return classes;
+    }();
+    return size_classes;
+}
+
+}  // namespace
+
+namespace dorado::utils {
+
+std::shared_ptr<SignalArena> SignalArena::create(const Options& options) {
+    // Private constructor, so no make_shared.
+    return std::shared_ptr<SignalArena>(new SignalArena(options));
+}
+
+SignalArena::SignalArena(const Options& options)
+        : m_max_cached_bytes(options.max_cached_bytes),
+          m_free_slabs(get_size_classes().size()) {
+}
+
+size_t SignalArena::size_class_bytes(size_t num_bytes) {
+    const auto& size_classes = get_size_classes();
+    const auto it = std::lower_bound(size_classes.begin(), size_classes.end(), num_bytes);
+    return it == size_classes.end() ? 0 : *it;
+}
+
+at::Tensor SignalArena::allocate(int64_t num_elements, at::ScalarType dtype) {
+    const auto options = at::TensorOptions().dtype(dtype);
+    const size_t num_bytes = num_elements * c10::elementSize(dtype);
+    ++m_num_allocations;
+
+    const auto& size_classes = get_size_classes();
+    const auto class_it = std::lower_bound(size_classes.begin(), size_classes.end(), num_bytes);
+    if (class_it == size_classes.end()) {
+        ++m_num_oversize;
+        return at::empty({num_elements}, options);
+    }
+    const size_t size_class = std::distance(size_classes.begin(), class_it);
+    const size_t slab_bytes = *class_it;
+
+    at::Tensor slab;
+    {
+        std::lock_guard lock(m_mutex);
+        auto& free_slabs = m_free_slabs[size_class];
+        if (!free_slabs.empty()) {
+            slab = std::move(free_slabs.back());
+            free_slabs.pop_back();
+            m_cached_bytes -= slab_bytes;
+        }
+    }
+    if (slab.defined()) {
+        ++m_num_reused;
+    } else {
+        slab = at::empty({int64_t(slab_bytes)}, at::TensorOptions().dtype(at::kByte));
+    }
+    m_bytes_in_use += slab_bytes;
+
+    // The returned tensor doesn't own the slab: its deleter hands the slab back.
+    void* const data = slab.data_ptr();
+    return at::from_blob(
+            data, {num_elements},
+            [arena = shared_from_this(), size_class, slab = std::move(slab)](void*) mutable {
+                arena->release(size_class, std::move(slab));
+            },
+            options);
+}
+
+void SignalArena::release(size_t size_class, at::Tensor slab) {
+    const size_t slab_bytes = get_size_classes()[size_class];
+    m_bytes_in_use -= slab_bytes;
+
+    std::lock_guard lock(m_mutex);
+    if (m_cached_bytes + slab_bytes > m_max_cached_bytes) {
+        // Let the slab be freed.
+        ++m_num_released;
+        return;
+    }
+    m_free_slabs[size_class].push_back(std::move(slab));
+    m_cached_bytes += slab_bytes;
+}
+
+stats::NamedStats SignalArena::sample_stats() const {
+    stats::NamedStats stats;
+    stats["bytes_in_use"] = double(m_bytes_in_use.load());
+    {
+        std::lock_guard lock(m_mutex);
+        stats["bytes_cached"] = double(m_cached_bytes);
+    }
+    stats["allocations"] = double(m_num_allocations.load());
+    stats["allocations_avoided"] = double(m_num_reused.load());
+    stats["oversize_allocations"] = double(m_num_oversize.load());
+    stats["slabs_released"] = double(m_num_released.load());
+    return stats;
+}
+
+}  // namespace dorado::utils
@@ -0,0 +1,64 @@
+#pragma once
+
+#include "utils/stats.h"
+
+#include <ATen/core/TensorBody.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace dorado::utils {
+
+// Size-classed allocator for read signal tensors.
+//
+// Each allocation is rounded up to a size class and backed by a slab from that class.
+// When the last tensor referencing a slab is destroyed, e.g. when the read leaves the
+// pipeline, the slab goes back on the free list for its class rather than being freed,
+// so that steady-state loading doesn't go through the system allocator.
+// Allocations larger than the biggest class are made directly.
+//
+// Thread safe.  Tensors keep the arena alive, so it may be released before them.
+class SignalArena : public std::enable_shared_from_this<SignalArena> {
+public:
+    struct Options {
+        // Upper bound on the bytes held in free slabs.  Slabs freed beyond this are
+        // returned to the system.
+        size_t max_cached_bytes = size_t{1} << 30;
+    };
+
+    static std::shared_ptr<SignalArena> create(const Options& options);
+
+    // Returns an uninitialised 1D tensor.
+    at::Tensor allocate(int64_t num_elements, at::ScalarType dtype);
+
+    std::string get_name() const { return "SignalArena"; }
+    stats::NamedStats sample_stats() const;
+
+    // Size in bytes of the class used for an allocation of num_bytes, or 0 if the
+    // allocation is too big for any class.
+    static size_t size_class_bytes(size_t num_bytes);
+
+private:
+    explicit SignalArena(const Options& options);
+
+    void release(size_t size_class, at::Tensor slab);
+
+    const size_t m_max_cached_bytes;
+
+    mutable std::mutex m_mutex;
+    std::vector<std::vector<at::Tensor>> m_free_slabs;  // Indexed by size class.
+    size_t m_cached_bytes{0};
+
+    std::atomic<size_t> m_bytes_in_use{0};
+    std::atomic<size_t> m_num_allocations{0};
+    std::atomic<size_t> m_num_reused{0};
+    std::atomic<size_t> m_num_oversize{0};
+    std::atomic<size_t> m_num_released{0};
+};
+
+}  // namespace dorado::utils
@@ -4,10 +4,12 @@
 #include <atomic>
 #include <cassert>
 #include <condition_variable>
+#include <iterator>
 #include <mutex>
 #include <queue>
 #include <string>
 #include <unordered_map>
+#include <vector>
 
 namespace dorado::utils {
 
@@ -138,6 +140,43 @@ public:
         return AsyncQueueStatus::Success;
     }
 
+    // Adds all of items to the queue, acquiring the lock once for as many items as
+    // there is space for, rather than once per item.
+    // If the queue fills up, blocks until there is space or terminate() is called.
+    // If all items were added, AsyncQueueStatus::Success is returned.
+    // If terminate() was called, any items not yet added are dropped and
+    // AsyncQueueStatus::Terminate is returned.
+    AsyncQueueStatus try_push_n(std::vector<Item>&& items) {
+        auto next_item = items.begin();
+        while (next_item != items.end()) {
+            std::unique_lock lock(m_mutex);
+
+            // Ensure there is space for at least one new item.
+            m_not_full_cv.wait(lock,
+                               [this] { return m_items.size() < m_capacity || m_terminate; });
+            if (m_terminate) {
+                return AsyncQueueStatus::Terminate;
+            }
+
+            const size_t num_to_push = std::min(size_t(std::distance(next_item, items.end())),
+                                                m_capacity - m_items.size());
+            for (size_t i = 0; i < num_to_push; ++i, ++next_item) {
+                m_items.push(std::move(*next_item));
+            }
+            m_num_pushes += num_to_push;
+
+            // Inform waiting threads that there are now items available.
+            lock.unlock();
+            if (num_to_push == 1) {
+                m_not_empty_cv.notify_one();
+            } else {
+                m_not_empty_cv.notify_all();
+            }
+        }
+        items.clear();
+        return AsyncQueueStatus::Success;
+    }
+
     // Obtains the next item in the queue, potentially timing out.
     // If queue is empty:
     // If timeout is reached, but we are not terminating, returns AsyncQueueStatus::Timeout.
@@ -0,0 +1,396 @@
+#pragma once
+
+#include "AsyncQueue.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace dorado::utils {
+
+// Bounded multi-producer/multi-consumer queue with the same interface and
+// Success/Timeout/Terminate semantics as AsyncQueue, so either can be used for a
+// given queue depending on how contended it is.
+//
+// Items live in a fixed ring buffer of cells, each tagged with a sequence number
+// that tells producers and consumers whether the cell is ready for them
+// (D. Vyukov's bounded MPMC queue).  Pushes and pops that don't need to wait never
+// take a lock.  A thread that has to block (queue full/empty) falls back to a
+// mutex + condition variable, and the other side only touches that mutex if it
+// sees a waiter registered.
+template <class Item>
+class LockFreeAsyncQueue {
+    // Number of attempts made on the lock-free path before a thread registers as
+    // a waiter and blocks.
+    static constexpr int SPIN_COUNT = 64;
+
+    // Avoid false sharing between the producer and consumer positions.
+    static constexpr std::size_t CACHE_LINE_SIZE = 64;
+
+    struct alignas(CACHE_LINE_SIZE) Cell {
+        // == position: free for the producer claiming that position.
+        // == position + 1: holds the item for the consumer claiming that position.
+        std::atomic<std::size_t> sequence;
+        alignas(Item) unsigned char storage[sizeof(Item)];
+
+        Item* item() { return std::launder(reinterpret_cast<Item*>(storage)); }
+    };
+
+    const std::size_t m_capacity;
+    std::unique_ptr<Cell[]> m_cells;
+
+    // Next position to push to/pop from.  These also serve as the push/pop counts.
+    alignas(CACHE_LINE_SIZE) std::atomic<std::size_t> m_enqueue_pos{0};
+    alignas(CACHE_LINE_SIZE) std::atomic<std::size_t> m_dequeue_pos{0};
+
+    // If true, waits should terminate regardless of other state.
+    // Pending attempts to push or pop items will fail.
+    alignas(CACHE_LINE_SIZE) std::atomic<bool> m_terminate{false};
+
+    // Slow path state, only used when a thread has to block.
+    mutable std::mutex m_wait_mutex;
+    std::condition_variable m_not_full_cv;
+    std::condition_variable m_not_empty_cv;
+    std::atomic<int> m_num_waiting_producers{0};
+    std::atomic<int> m_num_waiting_consumers{0};
+    // Number of times a thread had to block, for comparing against AsyncQueue.
+    std::atomic<int64_t> m_num_blocking_waits{0};
+
+    bool try_enqueue(Item& item) {
+        std::size_t pos = m_enqueue_pos.load(std::memory_order_relaxed);
+        while (true) {
+            Cell& cell = m_cells[pos % m_capacity];
+            const std::size_t seq = cell.sequence.load(std::memory_order_acquire);
+            if (seq == pos) {
+                if (m_enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    new (cell.storage) Item(std::move(item));
+                    // seq_cst so that this is ordered against waiter registration: see
+                    // wake_waiters.
+                    cell.sequence.store(pos + 1, std::memory_order_seq_cst);
+                    return true;
+                }
+                // pos has been updated by the failed CAS.
+            } else if (seq < pos) {
+                // The cell still holds an item from the previous lap: we're full.
+                return false;
+            } else {
+                pos = m_enqueue_pos.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // Pops the next item, if there is one, handing it to consume_fn.
+    template <class ConsumeFn>
+    bool try_dequeue(ConsumeFn&& consume_fn) {
+        std::size_t pos = m_dequeue_pos.load(std::memory_order_relaxed);
+        while (true) {
+            Cell& cell = m_cells[pos % m_capacity];
+            const std::size_t seq = cell.sequence.load(std::memory_order_acquire);
+            if (seq == pos + 1) {
+                if (m_dequeue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    Item* stored = cell.item();
+                    consume_fn(std::move(*stored));
+                    stored->~Item();
+                    cell.sequence.store(pos + m_capacity, std::memory_order_seq_cst);
+                    return true;
+                }
+            } else if (seq < pos + 1) {
+                // Nothing has been written to this cell yet: we're empty.
+                return false;
+            } else {
+                pos = m_dequeue_pos.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // True if the next pop would find an item.
+    bool has_item() const {
+        const std::size_t pos = m_dequeue_pos.load(std::memory_order_relaxed);
+        return m_cells[pos % m_capacity].sequence.load(std::memory_order_seq_cst) == pos + 1;
+    }
+
+    // True if the next push would find a free cell.
+    bool has_space() const {
+        const std::size_t pos = m_enqueue_pos.load(std::memory_order_relaxed);
+        return m_cells[pos % m_capacity].sequence.load(std::memory_order_seq_cst) == pos;
+    }
+
+    // Wakes threads blocked in the slow path, if there are any.  The cell sequence
+    // updates, waiter registration and the checks on both sides are all seq_cst, so
+    // either we see the waiter, or the waiter sees the queue state we just published.
+    void wake_waiters(std::atomic<int>& num_waiting, std::condition_variable& cv, bool all) {
+        if (num_waiting.load(std::memory_order_seq_cst) == 0) {
+            return;
+        }
+        {
+            // Taking the mutex ensures a waiter that has registered itself is
+            // actually waiting on the CV before we notify it.
+            std::lock_guard lock(m_wait_mutex);
+        }
+        if (all) {
+            cv.notify_all();
+        } else {
+            cv.notify_one();
+        }
+    }
+
+    // Blocks until ready() is true, we are terminating, or the timeout is reached.
+    // Returns false on timeout.
+    template <class Ready, class WaitFn>
+    bool wait_until_ready(std::atomic<int>& num_waiting, Ready ready, WaitFn wait_fn) {
+        for (int i = 0; i < SPIN_COUNT; ++i) {
+            if (ready() || m_terminate.load(std::memory_order_acquire)) {
+                return true;
+            }
+            std::this_thread::yield();
+        }
+
+        std::unique_lock lock(m_wait_mutex);
+        num_waiting.fetch_add(1, std::memory_order_seq_cst);
+        ++m_num_blocking_waits;
+        const bool wait_status = wait_fn(
+                lock, [&] { return ready() || m_terminate.load(std::memory_order_acquire); });
+        num_waiting.fetch_sub(1, std::memory_order_relaxed);
+        return wait_status;
+    }
+
+    void wait_for_space() {
+        wait_until_ready(
+                m_num_waiting_producers, [this] { return has_space(); },
+                [this](auto& lock, auto pred) {
+                    m_not_full_cv.wait(lock, pred);
+                    return true;
+                });
+    }
+
+    bool wait_for_item() {
+        return wait_until_ready(
+                m_num_waiting_consumers, [this] { return has_item(); },
+                [this](auto& lock, auto pred) {
+                    m_not_empty_cv.wait(lock, pred);
+                    return true;
+                });
+    }
+
+    template <class Clock, class Duration>
+    bool wait_for_item_or_timeout(const std::chrono::time_point<Clock, Duration>& timeout_time) {
+        return wait_until_ready(
+                m_num_waiting_consumers, [this] { return has_item(); },
+                [this, &timeout_time](auto& lock, auto pred) {
+                    return m_not_empty_cv.wait_until(lock, timeout_time, pred);
+                });
+    }
+
+    // Pops up to max_count items, calling process_fn on each.
+    // Returns the number of items popped.
+    template <class ProcessFn>
+    std::size_t process_items(ProcessFn& process_fn, std::size_t max_count) {
+        std::size_t num_popped = 0;
+        while (num_popped < max_count && try_dequeue(process_fn)) {
+            ++num_popped;
+        }
+        if (num_popped > 0) {
+            // In general we have removed > 1 item and there can be > 1 thread waiting to push.
+            wake_waiters(m_num_waiting_producers, m_not_full_cv, true);
+        }
+        return num_popped;
+    }
+
+    // Shared implementation of the single item pops.
+    template <class WaitFn>
+    AsyncQueueStatus pop_impl(Item& item, WaitFn wait_fn) {
+        while (true) {
+            if (try_dequeue([&item](Item&& popped) { item = std::move(popped); })) {
+                // Inform a waiting thread that the queue is not full.
+                wake_waiters(m_num_waiting_producers, m_not_full_cv, false);
+                return AsyncQueueStatus::Success;
+            }
+
+            const bool wait_status = wait_fn();
+
+            // Termination takes effect once all items have been popped from the queue.
+            if (m_terminate.load(std::memory_order_acquire) && !has_item()) {
+                return AsyncQueueStatus::Terminate;
+            }
+            if (!wait_status && !has_item()) {
+                return AsyncQueueStatus::Timeout;
+            }
+            // Another consumer may beat us to the item, in which case we go round again.
+        }
+    }
+
+    // Shared implementation of the batch pops.
+    template <class ProcessFn, class WaitFn>
+    AsyncQueueStatus process_and_pop_n_impl(ProcessFn& process_fn,
+                                            std::size_t max_count,
+                                            WaitFn wait_fn) {
+        while (true) {
+            if (process_items(process_fn, max_count) > 0) {
+                return AsyncQueueStatus::Success;
+            }
+
+            const bool wait_status = wait_fn();
+
+            // Termination takes effect once all items have been popped from the queue.
+            if (m_terminate.load(std::memory_order_acquire) && !has_item()) {
+                return AsyncQueueStatus::Terminate;
+            }
+            if (!wait_status && !has_item()) {
+                return AsyncQueueStatus::Timeout;
+            }
+        }
+    }
+
+public:
+    // Attempts to push items beyond capacity will block.
+    // The sequence numbering needs at least 2 cells, so capacity is rounded up to that.
+    explicit LockFreeAsyncQueue(std::size_t capacity)
+            : m_capacity(std::max<std::size_t>(capacity, 2)),
+              m_cells(std::make_unique<Cell[]>(m_capacity)) {
+        for (std::size_t i = 0; i < m_capacity; ++i) {
+            m_cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    ~LockFreeAsyncQueue() {
+        // Ensure waits terminate before destruction.
+        terminate();
+
+        // Destroy anything that was never popped.
+        while (try_dequeue([](Item&&) {})) {
+        }
+    }
+
+    // Contains std::mutex and std::condition_variable, so is not copyable or movable.
+    LockFreeAsyncQueue(const LockFreeAsyncQueue&) = delete;
+    LockFreeAsyncQueue(LockFreeAsyncQueue&&) = delete;
+    LockFreeAsyncQueue& operator=(const LockFreeAsyncQueue&) = delete;
+    LockFreeAsyncQueue& operator=(LockFreeAsyncQueue&&) = delete;
+
+    // See AsyncQueue::try_push.
+    AsyncQueueStatus try_push(Item&& item) {
+        while (true) {
+            if (m_terminate.load(std::memory_order_acquire)) {
+                return AsyncQueueStatus::Terminate;
+            }
+
+            if (try_enqueue(item)) {
+                // Inform a waiting thread that there is now an item available.
+                wake_waiters(m_num_waiting_consumers, m_not_empty_cv, false);
+                return AsyncQueueStatus::Success;
+            }
+
+            // Wait for space, given our limit on capacity.
+            wait_for_space();
+        }
+    }
+
+    // See AsyncQueue::try_push_n.
+    // Consumers are woken once per run of items pushed, rather than once per item.
+    AsyncQueueStatus try_push_n(std::vector<Item>&& items) {
+        std::size_t num_pushed = 0;
+        auto wake_consumers = [this, &num_pushed] {
+            if (num_pushed > 0) {
+                wake_waiters(m_num_waiting_consumers, m_not_empty_cv, num_pushed > 1);
+                num_pushed = 0;
+            }
+        };
+
+        for (auto& item : items) {
+            while (true) {
+                if (m_terminate.load(std::memory_order_acquire)) {
+                    wake_consumers();
+                    return AsyncQueueStatus::Terminate;
+                }
+                if (try_enqueue(item)) {
+                    ++num_pushed;
+                    break;
+                }
+
+                // Full, so make sure consumers know about what we've pushed before waiting.
+                wake_consumers();
+                wait_for_space();
+            }
+        }
+        wake_consumers();
+        items.clear();
+        return AsyncQueueStatus::Success;
+    }
+
+    // See AsyncQueue::try_pop_until.
+    template <class Clock, class Duration>
+    AsyncQueueStatus try_pop_until(Item& item,
+                                   const std::chrono::time_point<Clock, Duration>& timeout_time) {
+        return pop_impl(item, [&] { return wait_for_item_or_timeout(timeout_time); });
+    }
+
+    // See AsyncQueue::try_pop.
+    AsyncQueueStatus try_pop(Item& item) {
+        return pop_impl(item, [this] { return wait_for_item(); });
+    }
+
+    // See AsyncQueue::process_and_pop_n.
+    // Pops whatever is available up to max_count, rather than what was present
+    // when a lock was obtained.
+    template <class ProcessFn>
+    AsyncQueueStatus process_and_pop_n(ProcessFn process_fn, std::size_t max_count) {
+        return process_and_pop_n_impl(process_fn, max_count, [this] { return wait_for_item(); });
+    }
+
+    // See AsyncQueue::process_and_pop_n_with_timeout.
+    template <class ProcessFn, class Clock, class Duration>
+    AsyncQueueStatus process_and_pop_n_with_timeout(
+            ProcessFn process_fn,
+            std::size_t max_count,
+            const std::chrono::time_point<Clock, Duration>& timeout_time) {
+        return process_and_pop_n_impl(process_fn, max_count,
+                                      [&] { return wait_for_item_or_timeout(timeout_time); });
+    }
+
+    // See AsyncQueue::terminate.
+    void terminate() {
+        m_terminate.store(true, std::memory_order_release);
+        {
+            // Ensure any thread that has registered as a waiter is actually waiting.
+            std::lock_guard lock(m_wait_mutex);
+        }
+        m_not_full_cv.notify_all();
+        m_not_empty_cv.notify_all();
+    }
+
+    // Resets state to active following a terminate call.
+    void restart() { m_terminate.store(false, std::memory_order_release); }
+
+    // Maximum number of items the queue can contain.
+    std::size_t capacity() const { return m_capacity; }
+
+    // Approximate number of items in the queue.  Only useful for stats sampling and
+    // testing.
+    std::size_t size() const {
+        const std::size_t pops = m_dequeue_pos.load(std::memory_order_acquire);
+        const std::size_t pushes = m_enqueue_pos.load(std::memory_order_acquire);
+        return pushes > pops ? std::min(pushes - pops, m_capacity) : 0;
+    }
+
+    std::string get_name() const { return "queue"; }
+
+    std::unordered_map<std::string, double> sample_stats() const {
+        std::unordered_map<std::string, double> stats;
+        stats["items"] = double(size());
+        stats["pushes"] = double(m_enqueue_pos.load(std::memory_order_relaxed));
+        stats["pops"] = double(m_dequeue_pos.load(std::memory_order_relaxed));
+        stats["blocking_waits"] = double(m_num_blocking_waits.load(std::memory_order_relaxed));
+        return stats;
+    }
+};
+
+}  // namespace dorado::utils
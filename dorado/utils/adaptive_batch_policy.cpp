@@ -0,0 +1,64 @@
+#include "adaptive_batch_policy.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+// Time constant of the arrival rate estimate, in seconds.
+constexpr double RATE_TIME_CONSTANT_S = 2.0;
+
+// Batches wait this much longer than they are expected to take to fill, to allow for variation
+// in the arrival rate.
+constexpr double FILL_TIME_SLACK = 1.5;
+
+}  // namespace
+
+namespace dorado::utils {
+
+AdaptiveBatchPolicy::AdaptiveBatchPolicy(size_t batch_size,
+                                         Clock::duration min_wait,
+                                         Clock::duration max_wait)
+        : m_batch_size(batch_size),
+          m_min_wait(min_wait),
+          m_max_wait(std::max(min_wait, max_wait)) {}
+
+void AdaptiveBatchPolicy::record_arrivals(size_t num_items, Clock::time_point now) {
+    if (!m_has_update) {
+        // Arrivals before the first update took an unknown time, so only start timing here.
+        m_last_update = now;
+        m_has_update = true;
+        return;
+    }
+    const double elapsed_s = std::chrono::duration<double>(now - m_last_update).count();
+    const double decay = std::exp(-elapsed_s / RATE_TIME_CONSTANT_S);
+    m_decayed_items = m_decayed_items * decay + double(num_items);
+    m_decayed_seconds = m_decayed_seconds * decay + elapsed_s;
+    m_last_update = now;
+}
+
+double AdaptiveBatchPolicy::arrival_rate() const {
+    return m_decayed_seconds > 0 ? m_decayed_items / m_decayed_seconds : 0;
+}
+
+AdaptiveBatchPolicy::Clock::time_point AdaptiveBatchPolicy::deadline(
+        size_t num_batched,
+        Clock::time_point batch_start,
+        Clock::time_point last_arrival) const {
+    // However items arrive, a batch isn't kept waiting for longer than max_wait in total.
+    const auto latest_deadline = batch_start + m_max_wait;
+    const double rate = arrival_rate();
+    if (rate <= 0) {
+        return std::min(last_arrival + m_min_wait, latest_deadline);
+    }
+
+    // The remaining items are expected from the most recent arrival onwards.
+    const size_t num_remaining = m_batch_size - std::min(num_batched, m_batch_size);
+    const double max_wait_s = std::chrono::duration<double>(m_max_wait).count();
+    const double fill_time_s = std::min(FILL_TIME_SLACK * double(num_remaining) / rate, max_wait_s);
+    const auto fill_time = std::chrono::duration_cast<Clock::duration>(
+            std::chrono::duration<double>(fill_time_s));
+    return std::min(last_arrival + std::clamp(fill_time, m_min_wait, m_max_wait), latest_deadline);
+}
+
+}  // namespace dorado::utils
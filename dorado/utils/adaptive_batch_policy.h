@@ -0,0 +1,49 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+
+namespace dorado::utils {
+
+// Decides how long a partially filled batch should wait for more items before it is called,
+// from the recent rate at which items have arrived.
+//
+// After each arrival, a batch waits for as long as the rest of it is expected to take to fill,
+// with some slack, and at least min_wait.  No batch waits for more than max_wait from its first
+// item, so one which isn't expected to fill gathers as many items as it can in that time.  Until
+// there is an estimate of the arrival rate, a batch is called once no items have arrived for
+// min_wait.
+//
+// Not thread safe: each consumer of a queue should have its own policy, so that the rate is of
+// the items it actually receives.
+class AdaptiveBatchPolicy {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    AdaptiveBatchPolicy(size_t batch_size, Clock::duration min_wait, Clock::duration max_wait);
+
+    // Records the arrival of num_items, which may be 0, at the given time.
+    void record_arrivals(size_t num_items, Clock::time_point now);
+
+    // The estimated arrival rate in items per second, or 0 if there is no estimate yet.
+    double arrival_rate() const;
+
+    // The time at which a batch of num_batched items should be called, given the arrival times
+    // of its first and most recent items.
+    Clock::time_point deadline(size_t num_batched,
+                               Clock::time_point batch_start,
+                               Clock::time_point last_arrival) const;
+
+private:
+    const size_t m_batch_size;
+    const Clock::duration m_min_wait;
+    const Clock::duration m_max_wait;
+
+    // Exponentially decaying sums of the items that have arrived and of the time they took.
+    double m_decayed_items{0};
+    double m_decayed_seconds{0};
+    Clock::time_point m_last_update;
+    bool m_has_update{false};
+};
+
+}  // namespace dorado::utils
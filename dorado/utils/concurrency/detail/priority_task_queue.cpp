@@ -21,10 +21,11 @@ std::size_t PriorityTaskQueue::size(TaskPriority priority) const {
     return priority == TaskPriority::high ? m_num_high_prio : m_num_normal_prio;
 }
 
-WaitingTask PriorityTaskQueue::pop() {
+WaitingTask PriorityTaskQueue::pop() { return pop(next_priority()); }
+
+TaskPriority PriorityTaskQueue::next_priority() const {
     assert(!m_producer_queue_list.empty());
-    const auto next_priority = m_producer_queue_list.front()->priority();
-    return pop(next_priority);
+    return m_producer_queue_list.front()->priority();
 }
 
 WaitingTask PriorityTaskQueue::pop(TaskPriority priority) {
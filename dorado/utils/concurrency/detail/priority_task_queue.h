@@ -34,6 +34,9 @@ public:
     WaitingTask pop();
     WaitingTask pop(TaskPriority priority);
 
+    // Priority of the task which pop() would return.
+    TaskPriority next_priority() const;
+
     std::size_t size() const;
     std::size_t size(TaskPriority priority) const;
 
@@ -4,6 +4,17 @@
 
 #include <algorithm>
 
+namespace {
+
+// Lets a task pushed from one of the pool's own threads go to that thread's shard.
+thread_local const dorado::utils::concurrency::MultiQueueThreadPool* t_worker_pool{nullptr};
+thread_local std::size_t t_worker_index{0};
+
+constexpr std::uint64_t NORMAL_IN_FLIGHT_UNIT{1};
+constexpr std::uint64_t HIGH_IN_FLIGHT_UNIT{std::uint64_t{1} << 32};
+
+}  // namespace
+
 namespace dorado::utils::concurrency {
 
 MultiQueueThreadPool::MultiQueueThreadPool(std::size_t num_threads)
@@ -24,28 +35,25 @@ MultiQueueThreadPool::MultiQueueThreadPool(std::size_t num_threads, std::string
 void MultiQueueThreadPool::initialise() {
     // Total number of threads are m_num_threads + expansion space for the
     // same number of high prio tasks, in case all threads are busy with a
-    //// normal prio task when a high prio task arrives.
-    for (std::size_t i{0}; i < m_num_threads * 2; ++i) {
-        m_threads.emplace_back([this] { process_task_queue(); });
+    // normal prio task when a high prio task arrives.
+    const std::size_t total_threads = m_num_threads * 2;
+    for (std::size_t i{0}; i < std::max(total_threads, std::size_t{1}); ++i) {
+        m_shards.emplace_back(std::make_unique<Shard>());
+    }
+    for (std::size_t i{0}; i < total_threads; ++i) {
+        m_threads.emplace_back([this, i] { process_task_queue(i); });
     }
 }
 
 MultiQueueThreadPool::~MultiQueueThreadPool() { join(); }
 
 void MultiQueueThreadPool::join() {
-    // post as many done messages as there are threads to make sure all waiting threads will receive a wakeup
-    detail::PriorityTaskQueue::TaskQueue* terminate_task_queue;
+    // Threads finish off any tasks that are still queued before they exit.
     {
-        std::lock_guard lock(m_mutex);
-        terminate_task_queue = &m_priority_task_queue.create_task_queue(TaskPriority::normal);
-    }
-    for (uint32_t thread_index{0}; thread_index < m_num_threads * 2; ++thread_index) {
-        {
-            std::lock_guard lock(m_mutex);
-            terminate_task_queue->push([this] { m_done.store(true, std::memory_order_relaxed); });
-        }
-        m_message_received.notify_one();
+        std::lock_guard lock(m_idle_mutex);
+        m_done.store(true);
     }
+    m_message_received.notify_all();
     for (auto& worker : m_threads) {
         if (worker.joinable()) {
             worker.join();
@@ -53,106 +61,134 @@ void MultiQueueThreadPool::join() {
     }
 }
 
-void MultiQueueThreadPool::send(TaskType task, detail::PriorityTaskQueue::TaskQueue& task_queue) {
+void MultiQueueThreadPool::send(TaskType task, ThreadPoolQueue& task_queue) {
+    const std::size_t shard_index =
+            t_worker_pool == this
+                    ? t_worker_index
+                    : task_queue.m_next_shard.fetch_add(1, std::memory_order_relaxed) %
+                              m_shards.size();
+    auto& shard = *m_shards[shard_index];
     {
-        std::lock_guard lock(m_mutex);
-        task_queue.push(std::move(task));
+        std::lock_guard lock(shard.mutex);
+        task_queue.m_task_queues[shard_index]->push(std::move(task));
+        shard.num_tasks.fetch_add(1);
     }
-    m_message_received.notify_one();
-}
-
-std::size_t MultiQueueThreadPool::num_tasks_in_flight() {
-    return m_normal_prio_tasks_in_flight + m_high_prio_tasks_in_flight;
-}
 
-bool MultiQueueThreadPool::try_pop_next_task(detail::WaitingTask& next_task) {
-    if (m_priority_task_queue.empty()) {
-        return false;
-    }
-    if (num_tasks_in_flight() < m_num_threads) {
-        next_task = m_priority_task_queue.pop();
-        if (next_task.priority == TaskPriority::normal) {
-            ++m_normal_prio_tasks_in_flight;
-        } else {
-            ++m_high_prio_tasks_in_flight;
+    // An idle thread increments m_num_idle_threads before checking the shards, so either
+    // it will see the task or we'll see it.  Taking the mutex ensures that a thread which
+    // has just found nothing is waiting by the time it's notified.
+    if (m_num_idle_threads.load() > 0) {
+        {
+            std::lock_guard lock(m_idle_mutex);
         }
-        return true;
-    }
-
-    if (m_high_prio_tasks_in_flight < m_num_threads &&
-        !m_priority_task_queue.empty(TaskPriority::high)) {
-        next_task = m_priority_task_queue.pop(TaskPriority::high);
-        ++m_high_prio_tasks_in_flight;
-        return true;
+        m_message_received.notify_one();
     }
+}
 
-    if (m_normal_prio_tasks_in_flight < m_num_expansion_low_prio_threads &&
-        !m_priority_task_queue.empty(TaskPriority::normal)) {
-        next_task = m_priority_task_queue.pop(TaskPriority::normal);
-        ++m_normal_prio_tasks_in_flight;
-        return true;
+bool MultiQueueThreadPool::try_start_task(TaskPriority priority, bool allow_expansion) {
+    const auto unit = priority == TaskPriority::high ? HIGH_IN_FLIGHT_UNIT : NORMAL_IN_FLIGHT_UNIT;
+    auto in_flight = m_tasks_in_flight.load();
+    while (true) {
+        const std::size_t normal_in_flight = in_flight & (HIGH_IN_FLIGHT_UNIT - 1);
+        const std::size_t high_in_flight = in_flight >> 32;
+        if (!allow_expansion) {
+            if (normal_in_flight + high_in_flight >= m_num_threads) {
+                return false;
+            }
+        } else if (priority == TaskPriority::high) {
+            if (high_in_flight >= m_num_threads) {
+                return false;
+            }
+        } else if (normal_in_flight >= m_num_expansion_low_prio_threads) {
+            return false;
+        }
+        if (m_tasks_in_flight.compare_exchange_weak(in_flight, in_flight + unit)) {
+            return true;
+        }
     }
-
-    return false;
 }
 
 void MultiQueueThreadPool::decrement_in_flight_tasks(TaskPriority priority) {
-    if (priority == TaskPriority::normal) {
-        --m_normal_prio_tasks_in_flight;
+    m_tasks_in_flight.fetch_sub(priority == TaskPriority::high ? HIGH_IN_FLIGHT_UNIT
+                                                               : NORMAL_IN_FLIGHT_UNIT);
+}
+
+bool MultiQueueThreadPool::try_pop_next_task_from_shard(Shard& shard,
+                                                        detail::WaitingTask& next_task) {
+    std::lock_guard lock(shard.mutex);
+    auto& queue = shard.queue;
+    if (queue.empty()) {
+        return false;
+    }
+    if (try_start_task(queue.next_priority(), false)) {
+        next_task = queue.pop();
+    } else if (!queue.empty(TaskPriority::high) && try_start_task(TaskPriority::high, true)) {
+        next_task = queue.pop(TaskPriority::high);
+    } else if (!queue.empty(TaskPriority::normal) && try_start_task(TaskPriority::normal, true)) {
+        next_task = queue.pop(TaskPriority::normal);
     } else {
-        --m_high_prio_tasks_in_flight;
+        return false;
     }
+    shard.num_tasks.fetch_sub(1);
+    return true;
 }
 
-detail::WaitingTask MultiQueueThreadPool::decrement_in_flight_and_wait_on_next_task(
-        std::optional<TaskPriority> last_task_priority) {
-    // Design flaw: doing both decrement and wait, an SRP violation - weak cohesion, because we don't
-    // want to unlock between the decrement and the wait, and it is a lesser "evil" than the
-    // alternative design flaw of passing a lock between functions, high coupling, as threading is
-    // easier to reason about if the locking is encapsulated.
-    std::unique_lock lock(m_mutex);
-    if (last_task_priority) {
-        decrement_in_flight_tasks(*last_task_priority);
+bool MultiQueueThreadPool::try_pop_next_task(std::size_t thread_index,
+                                             detail::WaitingTask& next_task) {
+    // Own shard first, then steal from the others.
+    const std::size_t num_shards = m_shards.size();
+    for (std::size_t offset{0}; offset < num_shards; ++offset) {
+        auto& shard = *m_shards[(thread_index + offset) % num_shards];
+        if (shard.num_tasks.load() > 0 && try_pop_next_task_from_shard(shard, next_task)) {
+            return true;
+        }
     }
-    detail::WaitingTask next_task{};
-    m_message_received.wait(lock, [this, &next_task] { return try_pop_next_task(next_task); });
-    return next_task;
+    return false;
 }
 
-void MultiQueueThreadPool::process_task_queue() {
+void MultiQueueThreadPool::process_task_queue(std::size_t thread_index) {
     set_thread_name(m_name);
+    t_worker_pool = this;
+    t_worker_index = thread_index;
     detail::WaitingTask waiting_task{};
-    std::optional<TaskPriority> last_task_priority{std::nullopt};
-    while (!m_done.load(std::memory_order_relaxed)) {
-        waiting_task = decrement_in_flight_and_wait_on_next_task(last_task_priority);
-        last_task_priority = waiting_task.priority;
+    while (true) {
+        if (!try_pop_next_task(thread_index, waiting_task)) {
+            std::unique_lock lock(m_idle_mutex);
+            m_num_idle_threads.fetch_add(1);
+            m_message_received.wait(lock, [this, thread_index, &waiting_task] {
+                return try_pop_next_task(thread_index, waiting_task) || m_done.load();
+            });
+            m_num_idle_threads.fetch_sub(1);
+            if (!waiting_task.task) {
+                break;
+            }
+        }
         waiting_task.task();
+        waiting_task.task = nullptr;
+        decrement_in_flight_tasks(waiting_task.priority);
     }
-    if (last_task_priority) {
-        std::lock_guard lock(m_mutex);
-        decrement_in_flight_tasks(*last_task_priority);
-        // Signal so that the condition variable will be checked by waiting threads
-        // This is necessary since it is possible join() was called before all the threads
-        // in the thread pool had begun waiting on the condition variable, in which case
-        // the notify_one() calls in the joining code would have had no effect.
-        m_message_received.notify_one();
-    }
+    t_worker_pool = nullptr;
 }
 
 MultiQueueThreadPool::ThreadPoolQueue::ThreadPoolQueue(
         MultiQueueThreadPool* parent,
-        detail::PriorityTaskQueue::TaskQueue& task_queue)
-        : m_parent(parent), m_task_queue(task_queue) {}
+        std::vector<detail::PriorityTaskQueue::TaskQueue*> task_queues)
+        : m_parent(parent), m_task_queues(std::move(task_queues)) {}
 
 void MultiQueueThreadPool::ThreadPoolQueue::push(TaskType task) {
-    m_parent->send(std::move(task), m_task_queue);
+    m_parent->send(std::move(task), *this);
 }
 
 MultiQueueThreadPool::ThreadPoolQueue& MultiQueueThreadPool::create_task_queue(
         TaskPriority priority) {
-    std::lock_guard lock(m_mutex);
-    auto& task_queue = m_priority_task_queue.create_task_queue(priority);
-    return *m_queues.emplace_back(new ThreadPoolQueue(this, task_queue));
+    std::lock_guard lock(m_queues_mutex);
+    std::vector<detail::PriorityTaskQueue::TaskQueue*> task_queues;
+    task_queues.reserve(m_shards.size());
+    for (auto& shard : m_shards) {
+        std::lock_guard shard_lock(shard->mutex);
+        task_queues.push_back(&shard->queue.create_task_queue(priority));
+    }
+    return *m_queues.emplace_back(new ThreadPoolQueue(this, std::move(task_queues)));
 }
 
 }  // namespace dorado::utils::concurrency
@@ -6,9 +6,9 @@
 
 #include <atomic>
 #include <condition_variable>
+#include <cstdint>
 #include <memory>
 #include <mutex>
-#include <optional>
 #include <string>
 #include <thread>
 #include <vector>
@@ -24,6 +24,12 @@ using TaskType = detail::TaskType;
 // enqueue a large amount of tasks ahead of a second producer thread
 // beginning to enqueue tasks.
 //
+// To avoid a single lock being shared by every producer and worker, each worker thread
+// owns a shard holding its own part of every queue. Pushes are spread across the shards
+// (tasks pushed from a worker go to its own shard), and a worker whose shard is empty
+// steals from the others. Ordering within a queue, and between queues, is therefore
+// only FIFO/cyclic per shard rather than across the whole pool.
+//
 // N.B. If the pool is initialised with N threads then the actual number of
 // threads managed by the pool will be 2*N, allowing the pool to expand under
 // certain circumstances.
@@ -50,10 +56,12 @@ public:
         friend class MultiQueueThreadPool;
 
         MultiQueueThreadPool* m_parent;
-        detail::PriorityTaskQueue::TaskQueue& m_task_queue;
+        // One per shard, indexed by shard.
+        std::vector<detail::PriorityTaskQueue::TaskQueue*> m_task_queues;
+        std::atomic<std::size_t> m_next_shard{0};
 
         ThreadPoolQueue(MultiQueueThreadPool* parent,
-                        detail::PriorityTaskQueue::TaskQueue& task_queue);
+                        std::vector<detail::PriorityTaskQueue::TaskQueue*> task_queues);
 
         ThreadPoolQueue(const ThreadPoolQueue&) = delete;
         ThreadPoolQueue& operator=(const ThreadPoolQueue&) = delete;
@@ -63,28 +71,41 @@ public:
     };
 
 private:
-    void send(TaskType task, detail::PriorityTaskQueue::TaskQueue& task_queue);
+    // A worker's portion of the queued tasks.
+    struct alignas(64) Shard {
+        std::mutex mutex;
+        detail::PriorityTaskQueue queue;
+        // Mirrors queue.size(), so that empty shards can be skipped without locking.
+        std::atomic<std::size_t> num_tasks{0};
+    };
+
+    void send(TaskType task, ThreadPoolQueue& task_queue);
 
     std::string m_name{"async_task_exec"};
     const std::size_t m_num_threads;
     const std::size_t m_num_expansion_low_prio_threads;
     std::vector<std::thread> m_threads;
-    std::atomic_bool m_done{false};  // Note that this flag is only accessed by the managed threads.
+    std::vector<std::unique_ptr<Shard>> m_shards;  // One per managed thread.
 
-    std::mutex m_mutex;
-    std::vector<std::unique_ptr<ThreadPoolQueue>> m_queues;
-    detail::PriorityTaskQueue m_priority_task_queue;
+    // Number of normal (low 32 bits) and high (high 32 bits) priority tasks in flight,
+    // packed so that the admission checks can update both atomically.
+    std::atomic<std::uint64_t> m_tasks_in_flight{0};
+
+    // Only used by idle workers.
+    std::mutex m_idle_mutex;
     std::condition_variable m_message_received;
-    std::size_t m_normal_prio_tasks_in_flight{};
-    std::size_t m_high_prio_tasks_in_flight{};
+    std::atomic<std::size_t> m_num_idle_threads{0};
+    std::atomic_bool m_done{false};
+
+    std::mutex m_queues_mutex;
+    std::vector<std::unique_ptr<ThreadPoolQueue>> m_queues;
 
-    void decrement_in_flight_tasks(TaskPriority priority);
     void initialise();
-    detail::WaitingTask decrement_in_flight_and_wait_on_next_task(
-            std::optional<TaskPriority> last_task_priority);
-    void process_task_queue();
-    bool try_pop_next_task(detail::WaitingTask& next_task);
-    std::size_t num_tasks_in_flight();
+    void process_task_queue(std::size_t thread_index);
+    bool try_pop_next_task(std::size_t thread_index, detail::WaitingTask& next_task);
+    bool try_pop_next_task_from_shard(Shard& shard, detail::WaitingTask& next_task);
+    bool try_start_task(TaskPriority priority, bool allow_expansion);
+    void decrement_in_flight_tasks(TaskPriority priority);
 };
 
 }  // namespace dorado::utils::concurrency
@@ -2,16 +2,22 @@
 
 #include "utils/PostCondition.h"
 #include "utils/bam_utils.h"
+#include "utils/loser_tree.h"
+#include "utils/radix_sort.h"
 
 #include <htslib/bgzf.h>
 #include <htslib/hts.h>
 #include <htslib/sam.h>
+#include <htslib/thread_pool.h>
 #include <spdlog/spdlog.h>
 
+#include <atomic>
 #include <cassert>
+#include <exception>
 #include <filesystem>
-#include <map>
+#include <mutex>
 #include <stdexcept>
+#include <thread>
 
 namespace {
 
@@ -28,9 +34,13 @@ bool compare_headers(const dorado::SamHdrPtr& header1, const dorado::SamHdrPtr&
 
 namespace dorado::utils {
 
+// Thread safe, so that concurrent merges can share it.
 struct HtsFile::ProgressUpdater {
     const ProgressCallback* m_progress_callback{nullptr};
-    size_t m_from{0}, m_to{0}, m_max{0}, m_last_progress{0};
+    size_t m_from{0}, m_to{0}, m_max{0};
+    std::atomic<size_t> m_count{0};
+    std::atomic<size_t> m_last_progress{0};
+    std::mutex m_mutex;
     ProgressUpdater() = default;
     ProgressUpdater(const ProgressCallback& progress_callback, size_t from, size_t to, size_t max)
             : m_progress_callback(&progress_callback),
@@ -39,12 +49,20 @@ struct HtsFile::ProgressUpdater {
               m_max(max),
               m_last_progress(0) {}
 
-    void operator()(size_t count) {
+    // Adds num_processed to the count of records processed.
+    void operator()(size_t num_processed) {
         if (!m_progress_callback) {
             return;
         }
+        const size_t count = m_count.fetch_add(num_processed) + num_processed;
         const size_t new_progress = m_from + (m_to - m_from) * std::min(count, m_max) / m_max;
-        if (new_progress != m_last_progress) {
+        // Only take the lock when the reported percentage may change, so concurrent merges
+        // rarely contend here.
+        if (new_progress <= m_last_progress) {
+            return;
+        }
+        std::lock_guard lock(m_mutex);
+        if (new_progress > m_last_progress) {
             m_last_progress = new_progress;
             m_progress_callback->operator()(new_progress);
         }
@@ -127,6 +145,9 @@ void HtsFile::set_num_threads(std::size_t threads) {
 }
 
 HtsFile::~HtsFile() {
+    if (m_spill_thread.joinable()) {
+        m_spill_thread.join();
+    }
     if (!m_finalised) {
         spdlog::error("finalise() not called on a HtsFile.");
     }
@@ -142,6 +163,7 @@ void HtsFile::set_buffer_size(size_t buff_size) {
                                  std::to_string(MINIMUM_BUFFER_SIZE) + " (" +
                                  std::to_string(MINIMUM_BUFFER_SIZE / 1000) + " KB).");
     }
+    m_buffer_size = buff_size;
     m_bam_buffer.resize(buff_size);
 }
 
@@ -151,54 +173,114 @@ void HtsFile::flush_temp_file(const bam1_t* last_record) {
         // a flush, or that finalise() was called without ever passing any reads.
         return;
     }
-    if (last_record) {
-        // We add last_record to our buffer map with offset -1, so that we know where it should be sorted into
-        // the output.
-        auto sorting_key = calculate_sorting_key(last_record);
-        m_buffer_map.insert({sorting_key, -1});
-    }
 
-    // Open the file for writing, and write the header. Note that all temp files will have the same header.
+    // The previous spill has to finish before its buffer can be reused.
+    wait_for_spill();
+
+    // Swap buffers so that new records can be cached while this one is written out. The records'
+    // data pointers remain valid since swapping doesn't move the buffers' contents. On the first
+    // spill the buffer swapped in is empty, and it's only allocated once a record is cached.
+    std::swap(m_bam_buffer, m_spill_buffer);
+    std::swap(m_buffer_entries, m_spill_entries);
+    m_buffer_entries.clear();
+    m_current_buffer_offset = 0;
+    m_spill_last_record.reset(last_record ? bam_dup1(last_record) : nullptr);
+
+    // Note that all temp files will have the same header.
     auto file_index = m_temp_files.size();
     auto tempfilename = m_filename + "." + std::to_string(file_index) + ".tmp";
     m_temp_files.push_back(tempfilename);
-    m_file.reset(hts_open(tempfilename.c_str(), "wb"));
-    if (m_file->format.compression == bgzf) {
-        auto res = bgzf_mt(m_file->fp.bgzf, m_threads, 128);
+    m_spill_thread = std::thread([this, tempfilename] {
+        stats::Timer timer;
+        try {
+            write_temp_file(tempfilename);
+        } catch (...) {
+            m_spill_error = std::current_exception();
+        }
+        m_spill_time_ms += timer.GetElapsedMS();
+        ++m_num_spills;
+    });
+}
+
+void HtsFile::write_temp_file(const std::string& filename) {
+    const bam1_t* last_record = m_spill_last_record.get();
+    if (last_record) {
+        // We add last_record to our buffer entries with offset -1, so that we know where it should
+        // be sorted into the output.
+        auto sorting_key = calculate_sorting_key(last_record);
+        m_spill_entries.push_back({sorting_key, -1});
+    }
+
+    // The sort is stable, so records with the same key are written in the order they were cached.
+    radix_sort(m_spill_entries, m_spill_sort_scratch,
+               [](const BufferEntry& entry) { return entry.sorting_key; });
+
+    // Open the file for writing, and write the header.
+    HtsFilePtr file(hts_open(filename.c_str(), "wb"));
+    if (!file) {
+        throw std::runtime_error("Could not open temp file " + filename);
+    }
+    if (file->format.compression == bgzf) {
+        auto res = bgzf_mt(file->fp.bgzf, m_threads, 128);
         if (res < 0) {
             throw std::runtime_error("Could not enable multi threading for BAM generation.");
         }
     }
     if (m_mode != OutputMode::FASTQ && m_mode != OutputMode::FASTA) {
-        if (sam_hdr_write(m_file.get(), m_header.get()) != 0) {
+        if (sam_hdr_write(file.get(), m_header.get()) != 0) {
             throw std::runtime_error("Could not write header to temp file.");
         }
     }
 
-    for (const auto& item : m_buffer_map) {
+    for (const auto& entry : m_spill_entries) {
         // This will give us the offsets into the buffer in sorted order.
-        int64_t offset = item.second;
+        int64_t offset = entry.offset;
         const bam1_t* record{nullptr};
         if (offset == -1) {
             record = last_record;
         } else {
-            if (size_t(offset) + sizeof(bam1_t) > m_bam_buffer.size()) {
+            if (size_t(offset) + sizeof(bam1_t) > m_spill_buffer.size()) {
                 throw std::out_of_range("Index out of bounds in BAM record buffer.");
             }
-            record = std::launder(reinterpret_cast<bam1_t*>(m_bam_buffer.data() + offset));
-            if (size_t(offset) + sizeof(bam1_t) + size_t(record->l_data) > m_bam_buffer.size()) {
+            record = std::launder(reinterpret_cast<bam1_t*>(m_spill_buffer.data() + offset));
+            if (size_t(offset) + sizeof(bam1_t) + size_t(record->l_data) > m_spill_buffer.size()) {
                 throw std::out_of_range("Index out of bounds in BAM record buffer.");
             }
         }
-        auto res = write_to_file(record);
+        auto res = sam_write1(file.get(), m_header.get(), record);
         if (res < 0) {
             throw std::runtime_error("Error writing to BAM temporary file, error code " +
                                      std::to_string(res));
         }
     }
-    m_file.reset();
-    m_current_buffer_offset = 0;
-    m_buffer_map.clear();
+    file.reset();
+    m_spill_entries.clear();
+    m_spill_last_record.reset();
+}
+
+void HtsFile::wait_for_spill() {
+    if (!m_spill_thread.joinable()) {
+        return;
+    }
+    stats::Timer timer;
+    m_spill_thread.join();
+    m_spill_stall_time_ms += timer.GetElapsedMS();
+    if (m_spill_error) {
+        std::rethrow_exception(std::exchange(m_spill_error, nullptr));
+    }
+}
+
+stats::NamedStats HtsFile::sample_stats() const {
+    stats::NamedStats stats;
+    const auto spill_time_ms = m_spill_time_ms.load();
+    const auto spill_stall_time_ms = m_spill_stall_time_ms.load();
+    // Time the writer would have been stalled for if spills were done synchronously.
+    const auto stall_time_avoided_ms = std::max<int64_t>(spill_time_ms - spill_stall_time_ms, 0);
+    stats["spill_count"] = double(m_num_spills.load());
+    stats["spill_time_ms"] = double(spill_time_ms);
+    stats["spill_stall_time_ms"] = double(spill_stall_time_ms);
+    stats["spill_stall_time_avoided_ms"] = double(stall_time_avoided_ms);
+    return stats;
 }
 
 // If we are doing sorted BAM output, then when we are done we will have sorted temporary files
@@ -225,6 +307,7 @@ void HtsFile::finalise(const ProgressCallback& progress_callback) {
 
     // If any reads are cached for writing, write out the final temporary file.
     flush_temp_file(nullptr);
+    wait_for_spill();
 
     bool file_is_mapped = (sam_hdr_nref(m_header.get()) > 0);
     m_header.reset();
@@ -293,6 +376,9 @@ int HtsFile::write_to_file(const bam1_t* record) {
 }
 
 void HtsFile::cache_record(const bam1_t* record) {
+    if (m_bam_buffer.empty()) {
+        m_bam_buffer.resize(m_buffer_size);
+    }
     size_t bytes_required = sizeof(bam1_t) + size_t(record->l_data);
     if (m_current_buffer_offset + bytes_required > m_bam_buffer.size()) {
         // This record won't fit in the buffer, so flush the current buffer, plus this record, to the file.
@@ -300,7 +386,7 @@ void HtsFile::cache_record(const bam1_t* record) {
         return;
     }
     auto sorting_key = calculate_sorting_key(record);
-    m_buffer_map.insert({sorting_key, m_current_buffer_offset});
+    m_buffer_entries.push_back({sorting_key, m_current_buffer_offset});
 
     // Copy the contents of the bam1_t struct into the memory buffer.
     auto record_buff = m_bam_buffer.data() + m_current_buffer_offset;
@@ -331,16 +417,67 @@ bool HtsFile::merge_temp_files_iteratively(const ProgressCallback& progress_call
     progress_callback(percent_start_merging);
     ProgressUpdater update_progress(progress_callback, percent_start_merging, 100,
                                     m_num_records * progress_multiplier);
-    for (size_t iter = 0; iter < num_batches; ++iter) {
-        if (!merge_temp_files(update_progress, batcher.get_batch(iter),
-                              batcher.get_merge_filename(iter))) {
+
+    // All the files share one pool for (de)compression, which also reads ahead on the
+    // input files while records are being merged and written.
+    const int num_threads = std::max(m_threads, 1);
+    hts_tpool* pool = hts_tpool_init(num_threads);
+    if (!pool) {
+        spdlog::error("Could not create thread pool for merging.");
+        return false;
+    }
+    auto destroy_pool = utils::PostCondition([pool] { hts_tpool_destroy(pool); });
+
+    // Batches at the same merge level are independent, so merge them concurrently.
+    size_t level_begin = 0;
+    while (level_begin < num_batches) {
+        const size_t merge_level = batcher.get_merge_level(level_begin);
+        size_t level_end = level_begin + 1;
+        while (level_end < num_batches && batcher.get_merge_level(level_end) == merge_level) {
+            ++level_end;
+        }
+
+        std::atomic<size_t> next_batch{level_begin};
+        std::atomic_bool success{true};
+        std::mutex error_mutex;
+        std::exception_ptr error;
+        auto merge_batches = [&] {
+            try {
+                for (size_t batch = next_batch++; batch < level_end && success;
+                     batch = next_batch++) {
+                    if (!merge_temp_files(update_progress, pool, batcher.get_batch(batch),
+                                          batcher.get_merge_filename(batch))) {
+                        success = false;
+                    }
+                }
+            } catch (...) {
+                std::lock_guard lock(error_mutex);
+                error = std::current_exception();
+                success = false;
+            }
+        };
+        const size_t num_workers = std::min(level_end - level_begin, size_t(num_threads));
+        std::vector<std::thread> workers;
+        for (size_t i = 1; i < num_workers; ++i) {
+            workers.emplace_back(merge_batches);
+        }
+        merge_batches();
+        for (auto& worker : workers) {
+            worker.join();
+        }
+        if (error) {
+            std::rethrow_exception(error);
+        }
+        if (!success) {
             return false;
         }
+        level_begin = level_end;
     }
     return true;
 }
 
 bool HtsFile::merge_temp_files(ProgressUpdater& update_progress,
+                               hts_tpool* pool,
                                const std::vector<std::string>& temp_files,
                                const std::string& merged_filename) const {
     // This code assumes the headers for the files are all the same. This will be
@@ -351,9 +488,14 @@ bool HtsFile::merge_temp_files(ProgressUpdater& update_progress,
     std::vector<BamPtr> top_records(num_temp_files);
     std::vector<uint64_t> top_record_scores(num_temp_files);
     SamHdrPtr header{};
+    htsThreadPool thread_pool{pool, 0};
     for (size_t i = 0; i < num_temp_files; ++i) {
         in_files[i].reset(hts_open(temp_files[i].c_str(), "rb"));
-        if (bgzf_mt(in_files[i]->fp.bgzf, m_threads, 128) < 0) {
+        if (!in_files[i]) {
+            spdlog::error("Could not open temporary file {}", temp_files[i]);
+            return false;
+        }
+        if (hts_set_opt(in_files[i].get(), HTS_OPT_THREAD_POOL, &thread_pool) < 0) {
             spdlog::error("Could not enable multi threading for BAM reading.");
             return false;
         }
@@ -381,7 +523,11 @@ bool HtsFile::merge_temp_files(ProgressUpdater& update_progress,
 
     // Open the output file, and write the header.
     HtsFilePtr out_file(hts_open(merged_filename.c_str(), "wb"));
-    if (bgzf_mt(out_file->fp.bgzf, m_threads, 128) < 0) {
+    if (!out_file) {
+        spdlog::error("Could not open merged file {}", merged_filename);
+        return false;
+    }
+    if (hts_set_opt(out_file.get(), HTS_OPT_THREAD_POOL, &thread_pool) < 0) {
         spdlog::error("Could not enable multi threading for BAM generation.");
         return false;
     }
@@ -404,25 +550,10 @@ bool HtsFile::merge_temp_files(ProgressUpdater& update_progress,
         }
     }
 
-    size_t processed_records = 0;
-    size_t files_done = 0;
-    while (files_done < num_temp_files) {
-        // Find the next file to write a record from.
-        uint64_t best_score = std::numeric_limits<uint64_t>::max();
-        int best_index = -1;
-        for (size_t i = 0; i < num_temp_files; ++i) {
-            if (top_records[i]) {
-                auto score = top_record_scores[i];
-                if (best_index == -1 || score < best_score) {
-                    best_score = score;
-                    best_index = int(i);
-                }
-            }
-        }
-        if (best_index == -1) {
-            spdlog::error("Logic error in merging algorithm.");
-            return false;
-        }
+    LoserTree<uint64_t> merge_tree(top_record_scores);
+    while (!merge_tree.empty()) {
+        // The file with the next record to write.
+        const size_t best_index = merge_tree.top();
 
         // Write the record.
         auto res = sam_write1(out_file.get(), out_header.get(), top_records[best_index].get());
@@ -430,19 +561,17 @@ bool HtsFile::merge_temp_files(ProgressUpdater& update_progress,
             spdlog::error("Failed to write to sorted file {}, error code {}", out_file->fn, res);
             return false;
         }
-        ++processed_records;
-        update_progress(processed_records);
+        update_progress(1);
 
         // Load the next record for the file.
-        top_records[best_index].reset(bam_init1());
         res = sam_read1(in_files[best_index].get(), header.get(), top_records[best_index].get());
         if (res >= 0) {
-            top_record_scores[best_index] = calculate_sorting_key(top_records[best_index].get());
+            merge_tree.replace_top(calculate_sorting_key(top_records[best_index].get()));
         } else if (res == -1) {
             // EOF reached. Close the file and mark that this file is done.
             top_records[best_index].reset();
             in_files[best_index].reset();
-            ++files_done;
+            merge_tree.pop_top();
         } else if (res < -1) {
             spdlog::error("Error reading record from file {}, error code {}",
                           in_files[best_index]->fn, res);
@@ -501,6 +630,13 @@ const std::string& FileMergeBatcher::get_merge_filename(size_t n) const {
     return m_merge_jobs[n].merged_file;
 }
 
+size_t FileMergeBatcher::get_merge_level(size_t n) const {
+    if (n >= m_merge_jobs.size()) {
+        throw std::range_error("Merge job index out of bounds.");
+    }
+    return m_merge_jobs[n].merge_level;
+}
+
 std::string FileMergeBatcher::make_merged_filename() {
     auto filename_root = (m_file_path / "batch_").string();
     return filename_root + std::to_string(m_current_batch) + ".tmp";
@@ -511,7 +647,7 @@ std::vector<FileMergeBatcher::MergeJob> FileMergeBatcher::recursive_batching(
     std::vector<MergeJob> jobs;
     if (files.size() <= m_batch_size) {
         auto final_file = make_merged_filename();
-        jobs.push_back({files, final_file});
+        jobs.push_back({files, final_file, m_recursion_level});
         ++m_recursion_level;
         ++m_current_batch;
         return jobs;
@@ -532,7 +668,7 @@ std::vector<FileMergeBatcher::MergeJob> FileMergeBatcher::recursive_batching(
         if (k + batch_size > count) {
             this_batch_size = count - k;
         }
-        jobs.push_back({{}, batch_out_file});
+        jobs.push_back({{}, batch_out_file, m_recursion_level});
         for (size_t i = 0; i < this_batch_size; ++i) {
             jobs.back().files.push_back(files[k + i]);
         }
@@ -558,7 +694,8 @@ std::vector<FileMergeBatcher::MergeJob> FileMergeBatcher::recursive_batching(
     }
     auto more_jobs = recursive_batching(merged_files);
     for (size_t k = 0; k < more_jobs.size(); ++k) {
-        jobs.push_back({std::move(more_jobs[k].files), std::move(more_jobs[k].merged_file)});
+        jobs.push_back({std::move(more_jobs[k].files), std::move(more_jobs[k].merged_file),
+                        more_jobs[k].merge_level});
     }
     return jobs;
 }
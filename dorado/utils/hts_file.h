@@ -1,12 +1,17 @@
 #pragma once
 
+#include "stats.h"
 #include "types.h"
 
 #include <algorithm>
+#include <atomic>
+#include <exception>
 #include <filesystem>
 #include <functional>
-#include <map>
 #include <string>
+#include <thread>
+
+struct hts_tpool;
 
 namespace dorado::utils {
 
@@ -30,6 +35,9 @@ public:
     // Support for setting threads after construction
     void set_num_threads(std::size_t threads);
 
+    // Size of the buffer used to sort records for sorted BAM output.  A second buffer of the
+    // same size is allocated once the first is full, so that one can be written to a temp file
+    // in the background while records are cached in the other.
     void set_buffer_size(size_t buff_size);
     int set_header(const sam_hdr_t* header);
     int write(bam1_t* record);
@@ -40,6 +48,9 @@ public:
 
     OutputMode get_output_mode() const { return m_mode; }
 
+    std::string get_name() const { return "HtsFile"; }
+    stats::NamedStats sample_stats() const;
+
 private:
     std::string m_filename;
     HtsFilePtr m_file;
@@ -51,18 +62,41 @@ private:
     bool m_sort_bam;
     const OutputMode m_mode;
 
+    // Sorting key and buffer offset of a cached record, with offset -1 for a record which
+    // is not in the buffer.
+    struct BufferEntry {
+        uint64_t sorting_key;
+        int64_t offset;
+    };
+
     std::vector<std::byte> m_bam_buffer;
-    std::multimap<uint64_t, int64_t> m_buffer_map;
+    size_t m_buffer_size{0};
+    std::vector<BufferEntry> m_buffer_entries;  // Unsorted until the buffer is spilled.
     std::vector<std::string> m_temp_files;
     int64_t m_current_buffer_offset{0};
 
+    // The previous buffer, which is written to a temp file on m_spill_thread.
+    std::vector<std::byte> m_spill_buffer;
+    std::vector<BufferEntry> m_spill_entries;
+    std::vector<BufferEntry> m_spill_sort_scratch;
+    BamPtr m_spill_last_record;
+    std::thread m_spill_thread;
+    std::exception_ptr m_spill_error;
+
+    std::atomic<size_t> m_num_spills{0};
+    std::atomic<int64_t> m_spill_time_ms{0};
+    std::atomic<int64_t> m_spill_stall_time_ms{0};
+
     struct ProgressUpdater;
 
     void flush_temp_file(const bam1_t* last_record);
+    void write_temp_file(const std::string& filename);
+    void wait_for_spill();
     int write_to_file(const bam1_t* record);
     void cache_record(const bam1_t* record);
     bool merge_temp_files_iteratively(const ProgressCallback& progress_callback) const;
     bool merge_temp_files(ProgressUpdater& update_progress,
+                          hts_tpool* pool,
                           const std::vector<std::string>& temp_files,
                           const std::string& merged_filename) const;
     void initialise_threads();
@@ -77,11 +111,15 @@ public:
     size_t get_recursion_level() const;
     const std::vector<std::string>& get_batch(size_t n) const;
     const std::string& get_merge_filename(size_t n) const;
+    // Batches with the same merge level don't depend on each other's output, so can be
+    // merged concurrently.  Levels are non-decreasing with the batch index.
+    size_t get_merge_level(size_t n) const;
 
 private:
     struct MergeJob {
         std::vector<std::string> files;
         std::string merged_file;
+        size_t merge_level;
     };
 
     int m_current_batch;
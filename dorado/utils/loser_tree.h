@@ -0,0 +1,104 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+namespace dorado::utils {
+
+// Tournament tree for k-way merging of sorted sources.
+//
+// Each source is represented by the key of its next item.  Finding the smallest key is O(1)
+// and replacing it with the next key from the same source is O(log k), compared to O(k) for
+// a linear scan.  Ties are broken in favour of the lowest source index, so that the merge
+// order matches a linear scan using a strict less-than comparison.
+template <typename Key>
+class LoserTree {
+public:
+    // Constructs the tree from the first key of each source.
+    explicit LoserTree(std::vector<Key> keys)
+            : m_keys(std::move(keys)),
+              m_exhausted(m_keys.size(), false),
+              m_tree(std::max<size_t>(m_keys.size(), 1)),
+              m_num_active(m_keys.size()) {
+        const size_t num_sources = m_keys.size();
+        if (num_sources == 0) {
+            return;
+        }
+        // Leaves are at [num_sources, 2 * num_sources), with internal node i having children
+        // 2i and 2i+1.  Play the matches bottom-up, keeping the loser at each internal node.
+        std::vector<size_t> winners(2 * num_sources);
+        for (size_t i = 0; i < num_sources; ++i) {
+            winners[num_sources + i] = i;
+        }
+        for (size_t node = num_sources - 1; node > 0; --node) {
+            const size_t left = winners[2 * node];
+            const size_t right = winners[2 * node + 1];
+            const bool left_wins = beats(left, right);
+            winners[node] = left_wins ? left : right;
+            m_tree[node] = left_wins ? right : left;
+        }
+        m_tree[0] = num_sources > 1 ? winners[1] : 0;
+    }
+
+    bool empty() const { return m_num_active == 0; }
+
+    // Index of the source with the smallest key.
+    size_t top() const {
+        assert(!empty());
+        return m_tree[0];
+    }
+
+    const Key& top_key() const { return m_keys[top()]; }
+
+    // Replaces the key of the top source with the next key from that source.
+    void replace_top(Key key) {
+        m_keys[top()] = std::move(key);
+        replay();
+    }
+
+    // Marks the top source as exhausted.
+    void pop_top() {
+        m_exhausted[top()] = true;
+        --m_num_active;
+        replay();
+    }
+
+private:
+    std::vector<Key> m_keys;
+    std::vector<bool> m_exhausted;
+    // m_tree[0] is the overall winner, and m_tree[1..k) the loser at each internal node.
+    std::vector<size_t> m_tree;
+    size_t m_num_active;
+
+    bool beats(size_t lhs, size_t rhs) const {
+        if (m_exhausted[lhs] != m_exhausted[rhs]) {
+            return m_exhausted[rhs];
+        }
+        if (!m_exhausted[lhs]) {
+            if (m_keys[lhs] < m_keys[rhs]) {
+                return true;
+            }
+            if (m_keys[rhs] < m_keys[lhs]) {
+                return false;
+            }
+        }
+        return lhs < rhs;
+    }
+
+    // Replays the matches on the path from the previous winner's leaf to the root.
+    void replay() {
+        const size_t num_sources = m_keys.size();
+        size_t winner = m_tree[0];
+        for (size_t node = (num_sources + winner) / 2; node > 0; node /= 2) {
+            if (beats(m_tree[node], winner)) {
+                std::swap(m_tree[node], winner);
+            }
+        }
+        m_tree[0] = winner;
+    }
+};
+
+}  // namespace dorado::utils
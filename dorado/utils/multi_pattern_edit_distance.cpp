@@ -0,0 +1,194 @@
+#include "multi_pattern_edit_distance.h"
+
+#include "simd.h"
+
+#include <edlib.h>
+
+#include <algorithm>
+#include <cassert>
+
+namespace {
+
+// Patterns are processed in groups of this many lanes, i.e. two AVX2 registers.
+constexpr size_t LANES_PER_PASS = 8;
+constexpr size_t MAX_LANE_PATTERN_LENGTH = 64;
+
+// Computes the global edit distance of the pattern in each lane against the text, which is
+// given as character codes.  scores must have room for num_lanes entries, and num_lanes must
+// be a multiple of LANES_PER_PASS.
+//
+// Each column of the DP matrix is held as vertical deltas, with the top row of the matrix
+// increasing by 1 per column since leading text characters aren't free.  The score of the
+// bottom row is tracked from the horizontal delta of the last pattern position.
+#if ENABLE_AVX2_IMPL
+__attribute__((target("default")))
+#endif
+void edit_distances_impl(const uint8_t* codes,
+                         size_t num_codes,
+                         const uint64_t* peq,
+                         const uint64_t* lane_lengths,
+                         size_t num_lanes,
+                         int64_t* scores) {
+    for (size_t pass = 0; pass < num_lanes; pass += LANES_PER_PASS) {
+        uint64_t pv[LANES_PER_PASS];
+        uint64_t mv[LANES_PER_PASS];
+        uint64_t score[LANES_PER_PASS];
+        for (size_t lane = 0; lane < LANES_PER_PASS; ++lane) {
+            pv[lane] = ~uint64_t{0};
+            mv[lane] = 0;
+            score[lane] = lane_lengths[pass + lane];
+        }
+        for (size_t j = 0; j < num_codes; ++j) {
+            const uint64_t* eq_row = peq + codes[j] * num_lanes + pass;
+            for (size_t lane = 0; lane < LANES_PER_PASS; ++lane) {
+                const uint64_t eq = eq_row[lane];
+                const uint64_t xv = eq | mv[lane];
+                const uint64_t xh = (((eq & pv[lane]) + pv[lane]) ^ pv[lane]) | eq;
+                uint64_t ph = mv[lane] | ~(xh | pv[lane]);
+                uint64_t mh = pv[lane] & xh;
+                const uint64_t last_bit = lane_lengths[pass + lane] - 1;
+                score[lane] += (ph >> last_bit) & 1;
+                score[lane] -= (mh >> last_bit) & 1;
+                ph = (ph << 1) | 1;
+                mh <<= 1;
+                pv[lane] = mh | ~(xv | ph);
+                mv[lane] = ph & xv;
+            }
+        }
+        for (size_t lane = 0; lane < LANES_PER_PASS; ++lane) {
+            scores[pass + lane] = int64_t(score[lane]);
+        }
+    }
+}
+
+#if ENABLE_AVX2_IMPL
+// One step of the algorithm below for 4 lanes.
+__attribute__((target("avx2"))) inline void edit_distance_step_avx2(__m256i eq,
+                                                                    __m256i last_bit,
+                                                                    __m256i& pv,
+                                                                    __m256i& mv,
+                                                                    __m256i& score) {
+    const __m256i ones = _mm256_set1_epi64x(1);
+    const __m256i all_set = _mm256_set1_epi64x(-1);
+    const __m256i xv = _mm256_or_si256(eq, mv);
+    const __m256i xh = _mm256_or_si256(
+            _mm256_xor_si256(_mm256_add_epi64(_mm256_and_si256(eq, pv), pv), pv), eq);
+    __m256i ph = _mm256_or_si256(mv, _mm256_andnot_si256(_mm256_or_si256(xh, pv), all_set));
+    __m256i mh = _mm256_and_si256(pv, xh);
+    score = _mm256_add_epi64(score, _mm256_and_si256(_mm256_srlv_epi64(ph, last_bit), ones));
+    score = _mm256_sub_epi64(score, _mm256_and_si256(_mm256_srlv_epi64(mh, last_bit), ones));
+    ph = _mm256_or_si256(_mm256_slli_epi64(ph, 1), ones);
+    mh = _mm256_slli_epi64(mh, 1);
+    pv = _mm256_or_si256(mh, _mm256_andnot_si256(_mm256_or_si256(xv, ph), all_set));
+    mv = _mm256_and_si256(ph, xv);
+}
+
+// The same algorithm as above, with the 8 lanes of a pass in two AVX2 registers.  Interleaving
+// the two halves hides some of the latency of each step's dependency chain.
+__attribute__((target("avx2"))) void edit_distances_impl(const uint8_t* codes,
+                                                         size_t num_codes,
+                                                         const uint64_t* peq,
+                                                         const uint64_t* lane_lengths,
+                                                         size_t num_lanes,
+                                                         int64_t* scores) {
+    static_assert(LANES_PER_PASS == 8);
+    const __m256i ones = _mm256_set1_epi64x(1);
+    for (size_t pass = 0; pass < num_lanes; pass += LANES_PER_PASS) {
+        const auto* lengths = reinterpret_cast<const __m256i*>(lane_lengths + pass);
+        const __m256i length_lo = _mm256_loadu_si256(lengths);
+        const __m256i length_hi = _mm256_loadu_si256(lengths + 1);
+        const __m256i last_bit_lo = _mm256_sub_epi64(length_lo, ones);
+        const __m256i last_bit_hi = _mm256_sub_epi64(length_hi, ones);
+        __m256i pv_lo = _mm256_set1_epi64x(-1);
+        __m256i pv_hi = _mm256_set1_epi64x(-1);
+        __m256i mv_lo = _mm256_setzero_si256();
+        __m256i mv_hi = _mm256_setzero_si256();
+        __m256i score_lo = length_lo;
+        __m256i score_hi = length_hi;
+
+        for (size_t j = 0; j < num_codes; ++j) {
+            const auto* eq_row =
+                    reinterpret_cast<const __m256i*>(peq + codes[j] * num_lanes + pass);
+            edit_distance_step_avx2(_mm256_loadu_si256(eq_row), last_bit_lo, pv_lo, mv_lo,
+                                    score_lo);
+            edit_distance_step_avx2(_mm256_loadu_si256(eq_row + 1), last_bit_hi, pv_hi, mv_hi,
+                                    score_hi);
+        }
+        auto* out = reinterpret_cast<__m256i*>(scores + pass);
+        _mm256_storeu_si256(out, score_lo);
+        _mm256_storeu_si256(out + 1, score_hi);
+    }
+}
+#endif
+
+int edlib_edit_distance(const std::string& pattern, std::string_view text) {
+    if (pattern.empty()) {
+        return int(text.length());
+    }
+    EdlibAlignConfig config = edlibDefaultAlignConfig();
+    config.mode = EDLIB_MODE_NW;
+    config.task = EDLIB_TASK_DISTANCE;
+    auto result = edlibAlign(pattern.data(), int(pattern.length()), text.data(),
+                             int(text.length()), config);
+    const int distance = result.editDistance;
+    edlibFreeAlignResult(result);
+    return distance;
+}
+
+}  // namespace
+
+namespace dorado::utils {
+
+MultiPatternEditDistance::MultiPatternEditDistance(std::vector<std::string> patterns)
+        : m_patterns(std::move(patterns)) {
+    size_t num_codes = 1;
+    for (size_t i = 0; i < m_patterns.size(); ++i) {
+        const auto& pattern = m_patterns[i];
+        if (pattern.empty() || pattern.length() > MAX_LANE_PATTERN_LENGTH) {
+            m_long_patterns.push_back(i);
+            continue;
+        }
+        m_lane_patterns.push_back(i);
+        for (const char c : pattern) {
+            auto& code = m_char_codes[static_cast<uint8_t>(c)];
+            if (code == 0) {
+                code = static_cast<uint8_t>(num_codes++);
+            }
+        }
+    }
+
+    m_num_lanes = (m_lane_patterns.size() + LANES_PER_PASS - 1) / LANES_PER_PASS * LANES_PER_PASS;
+    m_lane_lengths.assign(m_num_lanes, 1);
+    m_peq.assign(num_codes * m_num_lanes, 0);
+    for (size_t lane = 0; lane < m_lane_patterns.size(); ++lane) {
+        const auto& pattern = m_patterns[m_lane_patterns[lane]];
+        m_lane_lengths[lane] = pattern.length();
+        for (size_t pos = 0; pos < pattern.length(); ++pos) {
+            const auto code = m_char_codes[static_cast<uint8_t>(pattern[pos])];
+            m_peq[code * m_num_lanes + lane] |= uint64_t{1} << pos;
+        }
+    }
+}
+
+std::vector<int> MultiPatternEditDistance::edit_distances(std::string_view text) const {
+    std::vector<int> distances(m_patterns.size());
+
+    if (m_num_lanes > 0) {
+        std::vector<uint8_t> codes(text.length());
+        std::transform(text.begin(), text.end(), codes.begin(),
+                       [this](char c) { return m_char_codes[static_cast<uint8_t>(c)]; });
+        std::vector<int64_t> scores(m_num_lanes);
+        edit_distances_impl(codes.data(), codes.size(), m_peq.data(), m_lane_lengths.data(),
+                            m_num_lanes, scores.data());
+        for (size_t lane = 0; lane < m_lane_patterns.size(); ++lane) {
+            distances[m_lane_patterns[lane]] = int(scores[lane]);
+        }
+    }
+
+    for (const size_t i : m_long_patterns) {
+        distances[i] = edlib_edit_distance(m_patterns[i], text);
+    }
+    return distances;
+}
+
+}  // namespace dorado::utils
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace dorado::utils {
+
+// Global edit distances of a fixed set of patterns against a text, computed for all of the
+// patterns at once.
+//
+// Uses Myers' bit-vector algorithm, with each pattern in its own 64-bit lane, so that a single
+// pass over the text scores several patterns.  The AVX2 implementation scores 8 patterns per
+// pass.  Results are the same as edlib's EDLIB_MODE_NW edit distance, with characters compared
+// exactly.  Patterns longer than 64 bases are scored with edlib.
+class MultiPatternEditDistance {
+public:
+    MultiPatternEditDistance() = default;
+    explicit MultiPatternEditDistance(std::vector<std::string> patterns);
+
+    size_t size() const { return m_patterns.size(); }
+    const std::vector<std::string>& patterns() const { return m_patterns; }
+
+    // Returns the edit distance of each pattern, in order, against the whole of text.
+    std::vector<int> edit_distances(std::string_view text) const;
+
+private:
+    std::vector<std::string> m_patterns;
+    // Maps each character to its index in the pattern alphabet, plus one.  0 is used for
+    // characters which don't appear in any pattern.
+    std::array<uint8_t, 256> m_char_codes{};
+    // Bitmask of the positions of each character code in each lane's pattern, indexed by
+    // code * m_num_lanes + lane.
+    std::vector<uint64_t> m_peq;
+    // Length of the pattern in each lane, or 1 for the padding lanes.
+    std::vector<uint64_t> m_lane_lengths;
+    size_t m_num_lanes{0};
+    // Index of the pattern in each lane.
+    std::vector<size_t> m_lane_patterns;
+    // Indices of patterns which don't fit in a lane.
+    std::vector<size_t> m_long_patterns;
+};
+
+}  // namespace dorado::utils
@@ -0,0 +1,166 @@
+#include "overlap_engine.h"
+
+#include <minimap.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <string_view>
+
+namespace dorado::utils {
+
+struct OverlapEngine::Options {
+    mm_idxopt_t idx_opt;
+    mm_mapopt_t map_opt;
+};
+
+// A single-sequence index, along with the mapping options updated to match it.
+struct OverlapEngine::Index {
+    mm_idx_t* index{nullptr};
+    mm_mapopt_t map_opt;
+    size_t seq_hash{0};
+    size_t seq_length{0};
+
+    Index() = default;
+    Index(const Index&) = delete;
+    Index& operator=(const Index&) = delete;
+    ~Index() {
+        if (index) {
+            mm_idx_destroy(index);
+        }
+    }
+
+    bool matches(size_t hash, size_t length) const {
+        return seq_hash == hash && seq_length == length;
+    }
+
+    // Rough size of the index: the sequence packed at 4 bits per base, plus a position
+    // and hash table entry for each minimizer, of which there are about 2 per window.
+    size_t num_bytes(int window_size) const {
+        const size_t num_minimizers = 2 * seq_length / (window_size + 1);
+        return sizeof(Index) + seq_length / 2 + num_minimizers * 2 * sizeof(uint64_t);
+    }
+};
+
+OverlapEngine::OverlapEngine(size_t max_cached_bytes)
+        : m_options([] {
+              auto options = std::make_unique<Options>();
+              mm_set_opt(0, &options->idx_opt, &options->map_opt);
+              mm_set_opt("map-hifi", &options->idx_opt, &options->map_opt);
+
+              // Equivalent to "--cap-kalloc 100m --cap-sw-mem 50m"
+              options->map_opt.cap_kalloc = 100'000'000;
+              options->map_opt.max_sw_mat = 50'000'000;
+              return options;
+          }()),
+          m_max_cached_bytes(max_cached_bytes) {}
+
+OverlapEngine::~OverlapEngine() = default;
+
+std::shared_ptr<const OverlapEngine::Index> OverlapEngine::get_index(
+        const std::string& query_seq,
+        const std::string& query_name) {
+    const size_t seq_hash = std::hash<std::string_view>{}(query_seq);
+    if (m_max_cached_bytes > 0) {
+        std::lock_guard lock(m_mutex);
+        auto it = m_cache.find(query_name);
+        if (it != m_cache.end() && it->second.index->matches(seq_hash, query_seq.length())) {
+            m_lru.splice(m_lru.begin(), m_lru, it->second.lru_it);
+            ++m_num_hits;
+            return it->second.index;
+        }
+    }
+    ++m_num_misses;
+
+    // Build the index outside of the lock.  If another thread builds the same one in the
+    // meantime then the later of the two replaces the earlier in the cache.
+    auto index = std::make_shared<Index>();
+    const auto& idx_opt = m_options->idx_opt;
+    const char* seqs[] = {query_seq.c_str()};
+    const char* names[] = {query_name.c_str()};
+    index->index = mm_idx_str(idx_opt.w, idx_opt.k, 0, idx_opt.bucket_bits, 1, seqs, names);
+    index->map_opt = m_options->map_opt;
+    mm_mapopt_update(&index->map_opt, index->index);
+    index->seq_hash = seq_hash;
+    index->seq_length = query_seq.length();
+
+    const size_t num_bytes = index->num_bytes(idx_opt.w);
+    if (num_bytes > m_max_cached_bytes) {
+        return index;
+    }
+
+    std::lock_guard lock(m_mutex);
+    auto it = m_cache.find(query_name);
+    if (it != m_cache.end()) {
+        m_cached_bytes -= it->second.index->num_bytes(idx_opt.w);
+        m_lru.erase(it->second.lru_it);
+        m_cache.erase(it);
+    }
+    while (!m_lru.empty() && m_cached_bytes + num_bytes > m_max_cached_bytes) {
+        // Indices still in use by another thread are kept alive by their shared_ptr.
+        auto oldest = m_cache.find(m_lru.back());
+        m_cached_bytes -= oldest->second.index->num_bytes(idx_opt.w);
+        m_cache.erase(oldest);
+        m_lru.pop_back();
+        ++m_num_evictions;
+    }
+    m_lru.push_front(query_name);
+    m_cache.emplace(query_name, CacheEntry{index, m_lru.begin()});
+    m_cached_bytes += num_bytes;
+    return index;
+}
+
+std::optional<OverlapResult> OverlapEngine::compute_overlap(const std::string& query_seq,
+                                                            const std::string& query_name,
+                                                            const std::string& target_seq,
+                                                            const std::string& target_name,
+                                                            MmTbufPtr& working_buffer) {
+    std::optional<OverlapResult> overlap_result;
+
+    const auto index = get_index(query_seq, query_name);
+
+    if (!working_buffer) {
+        working_buffer = MmTbufPtr(mm_tbuf_init());
+    }
+
+    int hits = 0;
+    mm_reg1_t* reg = mm_map(index->index, int(target_seq.length()), target_seq.c_str(), &hits,
+                            working_buffer.get(), &index->map_opt, target_name.c_str());
+
+    if (hits > 0) {
+        OverlapResult result;
+
+        auto best_map = std::max_element(
+                reg, reg + hits,
+                [](const mm_reg1_t& l, const mm_reg1_t& r) { return l.mapq < r.mapq; });
+        result.target_start = best_map->rs;
+        result.target_end = best_map->re;
+        result.query_start = best_map->qs;
+        result.query_end = best_map->qe;
+        result.mapq = best_map->mapq;
+        result.rev = best_map->rev;
+
+        overlap_result = result;
+    }
+
+    for (int i = 0; i < hits; ++i) {
+        free(reg[i].p);
+    }
+    free(reg);
+
+    return overlap_result;
+}
+
+stats::NamedStats OverlapEngine::sample_stats() const {
+    stats::NamedStats stats;
+    {
+        std::lock_guard lock(m_mutex);
+        stats["index_cache_bytes"] = double(m_cached_bytes);
+        stats["index_cache_entries"] = double(m_cache.size());
+    }
+    stats["index_cache_hits"] = double(m_num_hits.load());
+    stats["index_cache_misses"] = double(m_num_misses.load());
+    stats["index_cache_evictions"] = double(m_num_evictions.load());
+    return stats;
+}
+
+}  // namespace dorado::utils
@@ -0,0 +1,70 @@
+#pragma once
+
+#include "sequence_utils.h"
+#include "stats.h"
+#include "types.h"
+
+#include <atomic>
+#include <cstddef>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+
+namespace dorado::utils {
+
+// Overlaps pairs of reads with minimap2, as compute_overlap() does.
+//
+// The minimap2 options are set up once, and the single-sequence index built for each query
+// is cached by query name, so that a read which is overlapped several times, e.g. as the
+// template of more than one candidate pair, is only indexed once.  A cached index is only
+// reused if the query sequence matches the one it was built from.  The least recently used
+// indices are evicted to keep the estimated size of the cache within max_cached_bytes.
+//
+// Thread safe.  Each thread must pass its own working buffer.
+class OverlapEngine {
+public:
+    static constexpr size_t DEFAULT_MAX_CACHED_BYTES = size_t{512} << 20;
+
+    explicit OverlapEngine(size_t max_cached_bytes = DEFAULT_MAX_CACHED_BYTES);
+    ~OverlapEngine();
+
+    // |working_buffer| will be allocated if an empty one is passed in,
+    // allowing it to be reused in future calls by the caller.
+    std::optional<OverlapResult> compute_overlap(const std::string& query_seq,
+                                                 const std::string& query_name,
+                                                 const std::string& target_seq,
+                                                 const std::string& target_name,
+                                                 MmTbufPtr& working_buffer);
+
+    std::string get_name() const { return "OverlapEngine"; }
+    stats::NamedStats sample_stats() const;
+
+private:
+    struct Options;
+    struct Index;
+    struct CacheEntry {
+        std::shared_ptr<const Index> index;
+        std::list<std::string>::iterator lru_it;
+    };
+
+    std::shared_ptr<const Index> get_index(const std::string& query_seq,
+                                           const std::string& query_name);
+
+    const std::unique_ptr<const Options> m_options;
+    const size_t m_max_cached_bytes;
+
+    mutable std::mutex m_mutex;
+    std::unordered_map<std::string, CacheEntry> m_cache;
+    // Query names, most recently used first.
+    std::list<std::string> m_lru;
+    size_t m_cached_bytes{0};
+
+    std::atomic<size_t> m_num_hits{0};
+    std::atomic<size_t> m_num_misses{0};
+    std::atomic<size_t> m_num_evictions{0};
+};
+
+}  // namespace dorado::utils
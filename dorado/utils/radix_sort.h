@@ -0,0 +1,66 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace dorado::utils {
+
+// Stable LSD radix sort of items by a uint64_t key, one byte per pass.
+//
+// key(item) must return the item's uint64_t key.  Passes over bytes which are the same for
+// every item, e.g. the high bytes of small keys, are skipped.  scratch is resized to match
+// items and used as the other half of the ping-pong buffer, so passing the same scratch
+// vector to repeated sorts avoids reallocating it.
+template <typename T, typename KeyFunc>
+void radix_sort(std::vector<T>& items, std::vector<T>& scratch, KeyFunc key) {
+    constexpr int NUM_PASSES = sizeof(uint64_t);
+    constexpr size_t NUM_BUCKETS = 256;
+    const size_t num_items = items.size();
+    if (num_items < 2) {
+        return;
+    }
+
+    // Histogram every byte in a single read of the keys.
+    std::vector<std::array<size_t, NUM_BUCKETS>> counts(NUM_PASSES);
+    for (auto& pass_counts : counts) {
+        pass_counts.fill(0);
+    }
+    for (const auto& item : items) {
+        const uint64_t item_key = key(item);
+        for (int pass = 0; pass < NUM_PASSES; ++pass) {
+            ++counts[pass][(item_key >> (8 * pass)) & 0xff];
+        }
+    }
+
+    scratch.resize(num_items);
+    std::vector<T>* src = &items;
+    std::vector<T>* dst = &scratch;
+    for (int pass = 0; pass < NUM_PASSES; ++pass) {
+        auto& pass_counts = counts[pass];
+        const uint64_t first_byte = (key((*src)[0]) >> (8 * pass)) & 0xff;
+        if (pass_counts[first_byte] == num_items) {
+            // Every item has the same byte, so this pass wouldn't change the order.
+            continue;
+        }
+
+        // Convert counts to the offset of each bucket in the output.
+        size_t offset = 0;
+        for (auto& count : pass_counts) {
+            offset += count;
+            count = offset - count;
+        }
+        for (auto& item : *src) {
+            (*dst)[pass_counts[(key(item) >> (8 * pass)) & 0xff]++] = std::move(item);
+        }
+        std::swap(src, dst);
+    }
+
+    if (src != &items) {
+        items.swap(scratch);
+    }
+}
+
+}  // namespace dorado::utils
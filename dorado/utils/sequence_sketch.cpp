@@ -0,0 +1,136 @@
+#include "sequence_sketch.h"
+
+#include <algorithm>
+#include <array>
+#include <deque>
+#include <limits>
+#include <utility>
+
+namespace {
+
+// This is a heuristic rather than a bound on what minimap2 can find: repeated k-mers count once
+// here, and minimap2's chaining thresholds depend on its options.  It leaves a wide margin on the
+// duplex pairs in the tests, whose reads share 3268 and 7166 minimizers with their pair's reverse
+// complement, while the unrelated reads there share at most 1.
+constexpr size_t MIN_SHARED_RC_MINIMIZERS = 3;
+
+constexpr uint64_t KMER_MASK = (uint64_t{1} << (2 * dorado::utils::SequenceSketch::KMER_SIZE)) - 1;
+
+constexpr auto BASE_CODES = [] {
+    std::array<uint8_t, 256> codes{};
+    for (auto& code : codes) {
+        code = 4;
+    }
+    codes['A'] = codes['a'] = 0;
+    codes['C'] = codes['c'] = 1;
+    codes['G'] = codes['g'] = 2;
+    codes['T'] = codes['t'] = 3;
+    return codes;
+}();
+
+// Invertible integer hash, so that distinct k-mers never collide.
+uint64_t hash_kmer(uint64_t key) {
+    key = (~key + (key << 21)) & KMER_MASK;
+    key = key ^ key >> 24;
+    key = ((key + (key << 3)) + (key << 8)) & KMER_MASK;
+    key = key ^ key >> 14;
+    key = ((key + (key << 2)) + (key << 4)) & KMER_MASK;
+    key = key ^ key >> 28;
+    key = (key + (key << 31)) & KMER_MASK;
+    return key;
+}
+
+void sort_and_deduplicate(std::vector<uint64_t>& hashes) {
+    std::sort(hashes.begin(), hashes.end());
+    hashes.erase(std::unique(hashes.begin(), hashes.end()), hashes.end());
+}
+
+size_t count_shared(const std::vector<uint64_t>& lhs, const std::vector<uint64_t>& rhs) {
+    size_t count = 0;
+    auto lhs_it = lhs.begin();
+    auto rhs_it = rhs.begin();
+    while (lhs_it != lhs.end() && rhs_it != rhs.end()) {
+        if (*lhs_it < *rhs_it) {
+            ++lhs_it;
+        } else if (*rhs_it < *lhs_it) {
+            ++rhs_it;
+        } else {
+            ++count;
+            ++lhs_it;
+            ++rhs_it;
+        }
+    }
+    return count;
+}
+
+}  // namespace
+
+namespace dorado::utils {
+
+SequenceSketch sketch_sequence(const std::string& seq) {
+    constexpr int k = SequenceSketch::KMER_SIZE;
+    constexpr int w = SequenceSketch::WINDOW_SIZE;
+    constexpr int shift = 2 * (k - 1);
+
+    SequenceSketch sketch;
+    // Hashes of the k-mers in the current window, with the strand of their canonical form.
+    struct KmerHash {
+        uint64_t hash;
+        bool is_reverse;
+        size_t pos;
+    };
+    std::deque<KmerHash> window;  // Monotonic queue: hashes increase from front to back.
+    uint64_t forward_kmer = 0;
+    uint64_t reverse_kmer = 0;
+    int valid_bases = 0;
+    size_t last_pos = std::numeric_limits<size_t>::max();
+
+    for (size_t pos = 0; pos < seq.size(); ++pos) {
+        const uint8_t code = BASE_CODES[static_cast<uint8_t>(seq[pos])];
+        if (code > 3) {
+            valid_bases = 0;
+            window.clear();
+            continue;
+        }
+        forward_kmer = ((forward_kmer << 2) | code) & KMER_MASK;
+        reverse_kmer = (reverse_kmer >> 2) | (uint64_t(3 - code) << shift);
+        if (++valid_bases < k) {
+            continue;
+        }
+
+        const bool is_reverse = reverse_kmer < forward_kmer;
+        const uint64_t hash = hash_kmer(is_reverse ? reverse_kmer : forward_kmer);
+        // Ties keep the earlier k-mer, but it doesn't matter which is picked since they have
+        // the same hash, and so are the same canonical k-mer.
+        while (!window.empty() && window.back().hash > hash) {
+            window.pop_back();
+        }
+        window.push_back({hash, is_reverse, pos});
+        const size_t num_kmers = size_t(valid_bases - k + 1);
+        while (window.front().pos + w <= pos) {
+            window.pop_front();
+        }
+        if (num_kmers >= size_t(w) && window.front().pos != last_pos) {
+            last_pos = window.front().pos;
+            auto& hashes = window.front().is_reverse ? sketch.reverse : sketch.forward;
+            hashes.push_back(window.front().hash);
+        }
+    }
+
+    sort_and_deduplicate(sketch.forward);
+    sort_and_deduplicate(sketch.reverse);
+    return sketch;
+}
+
+size_t count_shared_rc_minimizers(const SequenceSketch& sketch1, const SequenceSketch& sketch2) {
+    // A k-mer read from the forward strand of seq1 is read from the reverse strand of seq2 if
+    // the sequences overlap on opposite strands.
+    return count_shared(sketch1.forward, sketch2.reverse) +
+           count_shared(sketch1.reverse, sketch2.forward);
+}
+
+bool may_have_rc_overlap(const SequenceSketch& sketch1, const SequenceSketch& sketch2) {
+    return count_shared_rc_minimizers(sketch1, sketch2) >= MIN_SHARED_RC_MINIMIZERS;
+}
+
+}  // namespace dorado::utils
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace dorado::utils {
+
+// Minimizer sketch of a sequence, used to cheaply rule out pairs of sequences which can't
+// have a reverse-complement overlap before running a full alignment.
+//
+// Each k-mer is hashed in its canonical form (the lesser of the k-mer and its reverse
+// complement), and the smallest hash in every window of consecutive k-mers is kept.  Since
+// the choice only depends on the window's contents, any stretch of window_length() bases
+// which two sequences share, on either strand, contributes the same minimizer to both.
+// Minimizers are split by which strand their canonical form was read from, so that matches
+// on the same strand and on opposite strands can be told apart.
+struct SequenceSketch {
+    static constexpr int KMER_SIZE = 15;
+    static constexpr int WINDOW_SIZE = 5;  // In k-mers.
+    static constexpr int window_length() { return KMER_SIZE + WINDOW_SIZE - 1; }
+
+    // Sorted and deduplicated hashes.
+    std::vector<uint64_t> forward;
+    std::vector<uint64_t> reverse;
+};
+
+// Bases other than ACGT break the sequence, so no k-mer includes them.
+SequenceSketch sketch_sequence(const std::string& seq);
+
+// Number of distinct minimizers shared by seq1 and the reverse complement of seq2.
+size_t count_shared_rc_minimizers(const SequenceSketch& sketch1, const SequenceSketch& sketch2);
+
+// False if seq1 and the reverse complement of seq2 share too few minimizers to be worth
+// aligning, so that unrelated pairs can be rejected cheaply.
+bool may_have_rc_overlap(const SequenceSketch& sketch1, const SequenceSketch& sketch2);
+
+}  // namespace dorado::utils
@@ -1,9 +1,9 @@
 #include "sequence_utils.h"
 
+#include "overlap_engine.h"
 #include "simd.h"
 
 #include <edlib.h>
-#include <minimap.h>
 #include <nvtx3/nvtx3.hpp>
 #include <spdlog/spdlog.h>
 
@@ -265,69 +265,31 @@ std::optional<OverlapResult> compute_overlap(const std::string& query_seq,
                                              const std::string& target_seq,
                                              const std::string& target_name,
                                              MmTbufPtr& working_buffer) {
-    std::optional<OverlapResult> overlap_result;
-
-    // Add mm2 based overlap check.
-    mm_idxopt_t idx_opt;
-    mm_mapopt_t map_opt;
-    mm_set_opt(0, &idx_opt, &map_opt);
-    mm_set_opt("map-hifi", &idx_opt, &map_opt);
-
-    // Equivalent to "--cap-kalloc 100m --cap-sw-mem 50m"
-    map_opt.cap_kalloc = 100'000'000;
-    map_opt.max_sw_mat = 50'000'000;
-
-    const char* seqs[] = {query_seq.c_str()};
-    const char* names[] = {query_name.c_str()};
-    mm_idx_t* index = mm_idx_str(idx_opt.w, idx_opt.k, 0, idx_opt.bucket_bits, 1, seqs, names);
-    mm_mapopt_update(&map_opt, index);
-
-    if (!working_buffer) {
-        working_buffer = MmTbufPtr(mm_tbuf_init());
-    }
-
-    int hits = 0;
-    mm_reg1_t* reg = mm_map(index, int(target_seq.length()), target_seq.c_str(), &hits,
-                            working_buffer.get(), &map_opt, target_name.c_str());
-
-    mm_idx_destroy(index);
-
-    if (hits > 0) {
-        OverlapResult result;
-
-        auto best_map = std::max_element(
-                reg, reg + hits,
-                [](const mm_reg1_t& l, const mm_reg1_t& r) { return l.mapq < r.mapq; });
-        result.target_start = best_map->rs;
-        result.target_end = best_map->re;
-        result.query_start = best_map->qs;
-        result.query_end = best_map->qe;
-        result.mapq = best_map->mapq;
-        result.rev = best_map->rev;
-
-        overlap_result = result;
-    }
-
-    for (int i = 0; i < hits; ++i) {
-        free(reg[i].p);
-    }
-    free(reg);
-
-    return overlap_result;
+    // An engine without a cache budget just sets up the options, so make one per call rather
+    // than sharing its state between threads.
+    OverlapEngine uncached_engine(0);
+    return uncached_engine.compute_overlap(query_seq, query_name, target_seq, target_name,
+                                           working_buffer);
 }
 
 // Query is the read that the moves table is associated with. A new moves table will be generated
 // Which is aligned to the target sequence.
 std::tuple<int, int, std::vector<uint8_t>> realign_moves(const std::string& query_sequence,
                                                          const std::string& target_sequence,
-                                                         const std::vector<uint8_t>& moves) {
+                                                         const std::vector<uint8_t>& moves,
+                                                         OverlapEngine* overlap_engine,
+                                                         const std::string& query_name) {
     assert(static_cast<int>(query_sequence.length()) ==
            std::accumulate(moves.begin(), moves.end(), 0));
 
     // We are going to compute the overlap between the two reads
     MmTbufPtr working_buffer;
     const auto overlap_result =
-            compute_overlap(query_sequence, "query", target_sequence, "target", working_buffer);
+            overlap_engine ? overlap_engine->compute_overlap(query_sequence, query_name,
+                                                             target_sequence, "target",
+                                                             working_buffer)
+                           : compute_overlap(query_sequence, query_name, target_sequence,
+                                             "target", working_buffer);
 
     // clang-tidy warns about performance-no-automatic-move if |failed_realignment| is const. It should be treated as such though.
     /*const*/ auto failed_realignment = std::make_tuple(-1, -1, std::vector<uint8_t>());
@@ -12,6 +12,8 @@
 
 namespace dorado::utils {
 
+class OverlapEngine;
+
 // Returns the polyA start index in seq. The is the polyA end index in the forward direction.
 // Used to trim the polyA from the qstring when calculating the mean.
 size_t find_rna_polya(const std::string& seq);
@@ -94,6 +96,10 @@ std::string reverse_complement(const std::string& sequence);
  *                        differ from the query sequence.
  * @param moves The original move table as a vector of unsigned 8-bit integers, aligned with
  *              the query sequence.
+ * @param overlap_engine If given, used to compute the overlap so that an index of the query
+ *                       sequence cached under query_name can be reused.
+ * @param query_name The name of the query sequence, e.g. its read id. It should also identify
+ *                   the strand, since the cached index is only reused for the same sequence.
  *
  * @return std::tuple<int, int, std::vector<uint8_t>>
  *         A tuple containing:
@@ -102,9 +108,12 @@ std::string reverse_complement(const std::string& sequence);
  *         3. The newly computed move table (std::vector<uint8_t>).
  *         If the move table cannot be computed, returns (-1, -1) and an empty vector.
  */
-std::tuple<int, int, std::vector<uint8_t>> realign_moves(const std::string& query_sequence,
-                                                         const std::string& target_sequence,
-                                                         const std::vector<uint8_t>& moves);
+std::tuple<int, int, std::vector<uint8_t>> realign_moves(
+        const std::string& query_sequence,
+        const std::string& target_sequence,
+        const std::vector<uint8_t>& moves,
+        OverlapEngine* overlap_engine = nullptr,
+        const std::string& query_name = "query");
 
 // Compile-time constant lookup table.
 static constexpr auto complement_table = [] {
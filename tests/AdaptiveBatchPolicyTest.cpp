@@ -0,0 +1,118 @@
+#include "utils/adaptive_batch_policy.h"
+
+#include <catch2/catch.hpp>
+
+#include <chrono>
+
+#define TEST_GROUP "[AdaptiveBatchPolicy]"
+
+using namespace std::chrono_literals;
+using dorado::utils::AdaptiveBatchPolicy;
+
+namespace {
+
+constexpr size_t BATCH_SIZE = 100;
+constexpr auto MIN_WAIT = 100ms;
+constexpr auto MAX_WAIT = 1000ms;
+
+// Records num_items arriving every interval for the given duration, returning the end time.
+AdaptiveBatchPolicy::Clock::time_point record_steady_arrivals(
+        AdaptiveBatchPolicy& policy,
+        AdaptiveBatchPolicy::Clock::time_point start,
+        size_t num_items,
+        AdaptiveBatchPolicy::Clock::duration interval,
+        AdaptiveBatchPolicy::Clock::duration duration) {
+    auto now = start;
+    policy.record_arrivals(num_items, now);
+    while (now - start < duration) {
+        now += interval;
+        policy.record_arrivals(num_items, now);
+    }
+    return now;
+}
+
+}  // namespace
+
+TEST_CASE("Without a rate estimate batches wait for a gap in arrivals", TEST_GROUP) {
+    AdaptiveBatchPolicy policy(BATCH_SIZE, MIN_WAIT, MAX_WAIT);
+    CHECK(policy.arrival_rate() == 0);
+
+    const auto batch_start = AdaptiveBatchPolicy::Clock::now();
+    const auto last_arrival = batch_start + 50ms;
+    CHECK(policy.deadline(10, batch_start, last_arrival) == last_arrival + MIN_WAIT);
+
+    // A single update doesn't give a rate.
+    policy.record_arrivals(10, batch_start);
+    CHECK(policy.arrival_rate() == 0);
+}
+
+TEST_CASE("Batches wait as long as they are expected to take to fill", TEST_GROUP) {
+    AdaptiveBatchPolicy policy(BATCH_SIZE, MIN_WAIT, MAX_WAIT);
+    const auto start = AdaptiveBatchPolicy::Clock::now();
+
+    // 10 items every 100ms is 100 items per second.
+    const auto now = record_steady_arrivals(policy, start, 10, 100ms, 5s);
+    CHECK(policy.arrival_rate() == Approx(100));
+
+    // 60 more items take 600ms, plus 50% slack.
+    const auto deadline = policy.deadline(40, now, now);
+    CHECK(std::chrono::duration<double>(deadline - now).count() == Approx(0.9));
+
+    // Nearly full batches still wait for the minimum time.
+    CHECK(policy.deadline(99, now, now) == now + MIN_WAIT);
+    CHECK(policy.deadline(BATCH_SIZE, now, now) == now + MIN_WAIT);
+}
+
+TEST_CASE("Partly filled batches wait for the rest from the latest arrival", TEST_GROUP) {
+    AdaptiveBatchPolicy policy(BATCH_SIZE, MIN_WAIT, MAX_WAIT);
+    const auto start = AdaptiveBatchPolicy::Clock::now();
+
+    // 100 items per second.
+    const auto now = record_steady_arrivals(policy, start, 10, 100ms, 5s);
+    REQUIRE(policy.arrival_rate() == Approx(100));
+
+    // The batch started 400ms ago, and the 80 remaining items take 800ms from the latest arrival,
+    // plus 50% slack. That's beyond the maximum wait from the start of the batch.
+    const auto batch_start = now - 400ms;
+    CHECK(policy.deadline(20, batch_start, now) == batch_start + MAX_WAIT);
+
+    // 20 remaining items take 200ms, plus 50% slack, from the latest arrival rather than from
+    // the start of the batch.
+    const auto deadline = policy.deadline(80, batch_start, now);
+    CHECK(std::chrono::duration<double>(deadline - now).count() == Approx(0.3));
+
+    // A full batch waits for the minimum time after its latest item.
+    CHECK(policy.deadline(BATCH_SIZE, batch_start, now) == now + MIN_WAIT);
+
+    // Without a rate, a batch still doesn't wait for more than the maximum time.
+    AdaptiveBatchPolicy new_policy(BATCH_SIZE, MIN_WAIT, MAX_WAIT);
+    CHECK(new_policy.deadline(10, now - 950ms, now) == now + 50ms);
+}
+
+TEST_CASE("Batches that won't fill wait for the maximum time", TEST_GROUP) {
+    AdaptiveBatchPolicy policy(BATCH_SIZE, MIN_WAIT, MAX_WAIT);
+    const auto start = AdaptiveBatchPolicy::Clock::now();
+
+    // 1 item every 100ms won't fill a batch within a second.
+    const auto now = record_steady_arrivals(policy, start, 1, 100ms, 5s);
+    CHECK(policy.arrival_rate() == Approx(10));
+    CHECK(policy.deadline(1, now, now) == now + MAX_WAIT);
+}
+
+TEST_CASE("The arrival rate estimate tracks recent arrivals", TEST_GROUP) {
+    AdaptiveBatchPolicy policy(BATCH_SIZE, MIN_WAIT, MAX_WAIT);
+    const auto start = AdaptiveBatchPolicy::Clock::now();
+
+    auto now = record_steady_arrivals(policy, start, 100, 100ms, 10s);
+    CHECK(policy.arrival_rate() == Approx(1000));
+
+    // After a drop in the rate, the estimate moves most of the way to the new one within
+    // a few time constants.
+    now = record_steady_arrivals(policy, now, 1, 100ms, 10s);
+    CHECK(policy.arrival_rate() < 20);
+
+    // Timeouts with no arrivals reduce the estimate.
+    const double rate_before_idle = policy.arrival_rate();
+    policy.record_arrivals(0, now + 1s);
+    CHECK(policy.arrival_rate() < rate_before_idle);
+}
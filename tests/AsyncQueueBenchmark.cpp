@@ -0,0 +1,90 @@
+#include "utils/AsyncQueue.h"
+#include "utils/LockFreeAsyncQueue.h"
+
+#include <catch2/catch.hpp>
+
+#include <algorithm>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Contention microbenchmarks comparing the AsyncQueue backends.
+// These are hidden, so run them explicitly with: dorado_tests "[benchmark]"
+
+#define CUT_TAG "[AsyncQueue][.][benchmark]"
+
+using dorado::utils::AsyncQueue;
+using dorado::utils::AsyncQueueStatus;
+using dorado::utils::LockFreeAsyncQueue;
+
+namespace {
+
+constexpr int NUM_ITEMS = 100000;
+
+// Pushes NUM_ITEMS through the queue with the given number of producer and
+// consumer threads.  Returns the number of items popped so that the work
+// can't be optimised away.
+template <class Queue>
+int run_contended(Queue& queue, int num_threads, bool batch_pops) {
+    std::vector<std::thread> consumers;
+    std::vector<int> num_popped(num_threads);
+    for (int i = 0; i < num_threads; ++i) {
+        consumers.emplace_back([&queue, &count = num_popped[i], batch_pops] {
+            if (batch_pops) {
+                while (queue.process_and_pop_n([&count](int) { ++count; }, 64) ==
+                       AsyncQueueStatus::Success) {
+                }
+            } else {
+                int val;
+                while (queue.try_pop(val) == AsyncQueueStatus::Success) {
+                    ++count;
+                }
+            }
+        });
+    }
+
+    std::vector<std::thread> producers;
+    for (int i = 0; i < num_threads; ++i) {
+        producers.emplace_back([&queue, num_threads] {
+            for (int j = 0; j < NUM_ITEMS / num_threads; ++j) {
+                int val = j;
+                queue.try_push(std::move(val));
+            }
+        });
+    }
+
+    for (auto& producer : producers) {
+        producer.join();
+    }
+    queue.terminate();
+    for (auto& consumer : consumers) {
+        consumer.join();
+    }
+    queue.restart();
+
+    int total = 0;
+    for (int count : num_popped) {
+        total += count;
+    }
+    return total;
+}
+
+}  // namespace
+
+TEMPLATE_TEST_CASE("AsyncQueue contention",
+                   CUT_TAG,
+                   AsyncQueue<int>,
+                   LockFreeAsyncQueue<int>) {
+    const std::size_t capacity = GENERATE(16, 1024);
+    TestType queue(capacity);
+
+    const int max_threads = std::max(2, int(std::thread::hardware_concurrency()));
+    for (int num_threads = 1; num_threads <= max_threads; num_threads *= 2) {
+        const auto suffix = " capacity=" + std::to_string(capacity) +
+                            " threads=" + std::to_string(num_threads);
+        BENCHMARK("try_pop" + suffix) { return run_contended(queue, num_threads, false); };
+        BENCHMARK("process_and_pop_n" + suffix) {
+            return run_contended(queue, num_threads, true);
+        };
+    }
+}
@@ -1,4 +1,5 @@
 #include "utils/AsyncQueue.h"
+#include "utils/LockFreeAsyncQueue.h"
 
 #include <catch2/catch.hpp>
 
@@ -6,16 +7,23 @@
 
 #include <algorithm>
 #include <atomic>
+#include <chrono>
 #include <iostream>
 #include <numeric>
 #include <thread>
+#include <vector>
 
 using dorado::utils::AsyncQueue;
 using dorado::utils::AsyncQueueStatus;
+using dorado::utils::LockFreeAsyncQueue;
 
-TEST_CASE(TEST_GROUP ": InputsMatchOutputs") {
+// Both backends have the same interface and semantics, so share the tests.
+#define DEFINE_TEST(name) \
+    TEMPLATE_TEST_CASE(TEST_GROUP name, "[AsyncQueue]", AsyncQueue<int>, LockFreeAsyncQueue<int>)
+
+DEFINE_TEST(": InputsMatchOutputs") {
     const int n = 10;
-    AsyncQueue<int> queue(n);
+    TestType queue(n);
 
     for (int i = 0; i < n; ++i) {
         // clang-tidy don't like us reusing a moved-from variable even if it's trivial,
@@ -32,23 +40,23 @@ TEST_CASE(TEST_GROUP ": InputsMatchOutputs") {
     }
 }
 
-TEST_CASE(TEST_GROUP ": PushFailsIfTerminating") {
-    AsyncQueue<int> queue(1);
+DEFINE_TEST(": PushFailsIfTerminating") {
+    TestType queue(1);
     queue.terminate();
     const auto status = queue.try_push(42);
     CHECK(status == AsyncQueueStatus::Terminate);
 }
 
-TEST_CASE(TEST_GROUP ": PopFailsIfTerminating") {
-    AsyncQueue<int> queue(1);
+DEFINE_TEST(": PopFailsIfTerminating") {
+    TestType queue(1);
     queue.terminate();
     int val;
     const auto status = queue.try_pop(val);
     CHECK(status == AsyncQueueStatus::Terminate);
 }
 
-TEST_CASE(TEST_GROUP ": PushPopSucceedAfterRestarting") {
-    AsyncQueue<int> queue(1);
+DEFINE_TEST(": PushPopSucceedAfterRestarting") {
+    TestType queue(1);
     queue.terminate();
     queue.restart();
     const auto push_status = queue.try_push(42);
@@ -60,8 +68,8 @@ TEST_CASE(TEST_GROUP ": PushPopSucceedAfterRestarting") {
 
 // Spawned thread sits waiting for an item.
 // Main thread supplies that item.
-TEST_CASE(TEST_GROUP ": PopFromOtherThread") {
-    AsyncQueue<int> queue(1);
+DEFINE_TEST(": PopFromOtherThread") {
+    TestType queue(1);
     std::atomic_bool thread_started{false};
     AsyncQueueStatus pop_status;
 
@@ -87,8 +95,8 @@ TEST_CASE(TEST_GROUP ": PopFromOtherThread") {
 
 // Spawned thread sits waiting for an item.
 // Main thread terminates wait.
-TEST_CASE(TEST_GROUP ": TerminateFromOtherThread") {
-    AsyncQueue<int> queue(1);
+DEFINE_TEST(": TerminateFromOtherThread") {
+    TestType queue(1);
     std::atomic_bool thread_started{false};
     AsyncQueueStatus pop_status;
 
@@ -112,9 +120,9 @@ TEST_CASE(TEST_GROUP ": TerminateFromOtherThread") {
     CHECK(pop_status == AsyncQueueStatus::Terminate);
 }
 
-TEST_CASE(TEST_GROUP ": process_and_pop_n") {
+DEFINE_TEST(": process_and_pop_n") {
     const int n = 10;
-    AsyncQueue<int> queue(n);
+    TestType queue(n);
     for (int i = 0; i < n; ++i) {
         // clang-tidy don't like us reusing a moved-from variable even if it's trivial,
         // so store to a temporary that's not used again after it's moved.
@@ -140,4 +148,90 @@ TEST_CASE(TEST_GROUP ": process_and_pop_n") {
     std::iota(expected.begin(), expected.end(), 0);
     CHECK(popped_items == expected);
     CHECK(queue.size() == 0);
-}
\ No newline at end of file
+}
+
+DEFINE_TEST(": PopTimesOutIfEmpty") {
+    TestType queue(1);
+    int val = -1;
+    const auto timeout = std::chrono::steady_clock::now() + std::chrono::milliseconds(10);
+    const auto status = queue.try_pop_until(val, timeout);
+    CHECK(status == AsyncQueueStatus::Timeout);
+    CHECK(val == -1);
+}
+
+// Several producers and consumers hammer a small queue, and every item comes out exactly once.
+DEFINE_TEST(": MultipleProducersAndConsumers") {
+    const int num_producers = 4;
+    const int num_consumers = 4;
+    const int items_per_producer = 10000;
+    TestType queue(3);
+
+    std::vector<std::thread> consumers;
+    std::vector<std::vector<int>> popped_items(num_consumers);
+    for (int i = 0; i < num_consumers; ++i) {
+        consumers.emplace_back([&queue, &popped = popped_items[i]] {
+            while (queue.process_and_pop_n([&popped](int val) { popped.push_back(val); }, 5) ==
+                   AsyncQueueStatus::Success) {
+            }
+        });
+    }
+
+    std::vector<std::thread> producers;
+    for (int i = 0; i < num_producers; ++i) {
+        producers.emplace_back([&queue, i] {
+            for (int j = 0; j < items_per_producer; ++j) {
+                int val = i * items_per_producer + j;
+                queue.try_push(std::move(val));
+            }
+        });
+    }
+
+    for (auto& producer : producers) {
+        producer.join();
+    }
+    // Termination only takes effect for consumers once the queue is drained.
+    queue.terminate();
+    for (auto& consumer : consumers) {
+        consumer.join();
+    }
+
+    std::vector<int> all_items;
+    for (const auto& popped : popped_items) {
+        all_items.insert(all_items.end(), popped.begin(), popped.end());
+    }
+    std::sort(all_items.begin(), all_items.end());
+    std::vector<int> expected(num_producers * items_per_producer);
+    std::iota(expected.begin(), expected.end(), 0);
+    CHECK(all_items == expected);
+}
+
+// Batch pushes larger than the capacity complete as the consumer makes space.
+DEFINE_TEST(": try_push_n") {
+    const int n = 100;
+    TestType queue(7);
+
+    std::vector<int> popped_items;
+    auto popping_thread = std::thread([&queue, &popped_items] {
+        while (queue.process_and_pop_n([&popped_items](int val) { popped_items.push_back(val); },
+                                       10) == AsyncQueueStatus::Success) {
+        }
+    });
+
+    std::vector<int> items(n);
+    std::iota(items.begin(), items.end(), 0);
+    const auto expected = items;
+    const auto status = queue.try_push_n(std::move(items));
+    queue.terminate();
+    popping_thread.join();
+
+    REQUIRE(status == AsyncQueueStatus::Success);
+    CHECK(popped_items == expected);
+}
+
+DEFINE_TEST(": try_push_n fails if terminating") {
+    TestType queue(1);
+    queue.terminate();
+    const auto status = queue.try_push_n(std::vector<int>{1, 2, 3});
+    CHECK(status == AsyncQueueStatus::Terminate);
+    CHECK(queue.size() == 0);
+}
@@ -1,9 +1,12 @@
 #include "demux/BarcodeClassifierSelector.h"
 
+#include "TestUtils.h"
 #include "demux/barcoding_info.h"
 
 #include <catch2/catch.hpp>
 
+#include <filesystem>
+
 #define TEST_GROUP "[dorado::demux::BarcodeClassifierSelector]"
 
 namespace {
@@ -58,4 +61,33 @@ TEST_CASE(TEST_GROUP " get_barcoder twice with different kits returns different
     REQUIRE(barcoder_first != barcoder_second);
 }
 
+TEST_CASE(TEST_GROUP " get_barcoder from different selectors returns same barcoder instance",
+          TEST_GROUP) {
+    dorado::demux::BarcodeClassifierSelector cut_first{};
+    dorado::demux::BarcodeClassifierSelector cut_second{};
+
+    dorado::demux::BarcodingInfo info;
+    info.kit_name = "SQK-RAB201";
+    auto barcoder_first = cut_first.get_barcoder(info);
+    auto barcoder_second = cut_second.get_barcoder(info);
+
+    REQUIRE(barcoder_first == barcoder_second);
+}
+
+TEST_CASE(TEST_GROUP " get_barcoder with and without custom sequences returns different instances",
+          TEST_GROUP) {
+    dorado::demux::BarcodeClassifierSelector cut{};
+
+    const auto data_dir = std::filesystem::path(get_data_dir("barcode_demux/custom_barcodes"));
+    dorado::demux::BarcodingInfo info;
+    info.custom_kit = (data_dir / "RPB004.toml").string();
+    auto barcoder_first = cut.get_barcoder(info);
+
+    dorado::demux::BarcodingInfo info2 = info;
+    info2.custom_seqs = (data_dir / "RPB004_sequences.fasta").string();
+    auto barcoder_second = cut.get_barcoder(info2);
+
+    REQUIRE(barcoder_first != barcoder_second);
+}
+
 }  // namespace
@@ -0,0 +1,46 @@
+#include "basecall/decode/CPUDecoder.h"
+
+#include <torch/torch.h>
+// Catch2 must come after torch since both define CHECK()
+#include <catch2/catch.hpp>
+
+#include <string>
+
+// Microbenchmarks for the CPU CRF scans.
+// These are hidden, so run them explicitly with: dorado_tests "[benchmark]"
+
+#define CUT_TAG "[CPUDecoder][.][benchmark]"
+
+TEST_CASE("CPUDecoder scans", CUT_TAG) {
+    // state_len 5 is the default for current models.
+    const int num_states = 1024;
+    const float stay_score = 2.0f;
+    const int T = GENERATE(500, 2000);
+    const int N = GENERATE(1, 8);
+
+    torch::manual_seed(42);
+    const auto scores = torch::randn({T, N, num_states * 4}, torch::kFloat);
+
+    const auto suffix = " T=" + std::to_string(T) + " N=" + std::to_string(N);
+    BENCHMARK("forward_scores" + suffix) {
+        return dorado::basecall::decode::inner::forward_scores(scores, stay_score);
+    };
+    BENCHMARK("backward_scores" + suffix) {
+        return dorado::basecall::decode::inner::backward_scores(scores, stay_score);
+    };
+}
+
+TEST_CASE("CPUDecoder beam search", CUT_TAG) {
+    const int num_states = 1024;
+    const int T = 2000;
+    const int N = GENERATE(1, 16, 64);
+
+    torch::manual_seed(42);
+    const auto scores = torch::randn({T, N, num_states * 4}, torch::kFloat);
+
+    dorado::basecall::decode::CPUDecoder decoder;
+    const dorado::basecall::decode::DecoderOptions options;
+    BENCHMARK("beam_search_part_2 N=" + std::to_string(N)) {
+        return decoder.beam_search_part_2({scores, N, options});
+    };
+}
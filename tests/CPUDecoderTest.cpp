@@ -0,0 +1,136 @@
+#include "basecall/decode/CPUDecoder.h"
+
+#include <torch/torch.h>
+// Catch2 must come after torch since both define CHECK()
+#include <catch2/catch.hpp>
+
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#define CUT_TAG "[CPUDecoder]"
+
+namespace {
+
+// Reference implementation of the scans using per-timestep ATen ops.
+// Operates in TNC.
+at::Tensor reference_scan(const at::Tensor& Ms,
+                          const float fixed_stay_score,
+                          const at::Tensor& idx,
+                          const at::Tensor& v0) {
+    const int T = int(Ms.size(0));
+    const int N = int(Ms.size(1));
+    const int C = int(Ms.size(2));
+
+    at::Tensor alpha = Ms.new_full({T + 1, N, C}, -1E38);
+    alpha[0] = v0;
+
+    for (int t = 0; t < T; t++) {
+        auto scored_steps = at::add(alpha.index({t, at::indexing::Slice(), idx}), Ms[t]);
+        auto scored_stay =
+                at::add(alpha.index({t, at::indexing::Slice()}), fixed_stay_score).unsqueeze(-1);
+        auto scored_transitions = at::cat({scored_stay, scored_steps}, -1);
+
+        alpha[t + 1] = at::logsumexp(scored_transitions, -1);
+    }
+
+    return alpha;
+}
+
+at::Tensor predecessor_indices(int num_states) {
+    return at::arange(num_states).repeat_interleave(4).reshape({4, -1}).t().contiguous();
+}
+
+at::Tensor reference_forward_scores(const at::Tensor& scores_TNC, float fixed_stay_score) {
+    const int T = int(scores_TNC.size(0));
+    const int N = int(scores_TNC.size(1));
+    const int num_states = int(scores_TNC.size(2)) / 4;
+
+    const at::Tensor Ms = scores_TNC.reshape({T, N, -1, 4});
+    const auto v0 = Ms.new_full({{N, num_states}}, 0.0f);
+    return reference_scan(Ms, fixed_stay_score, predecessor_indices(num_states), v0);
+}
+
+at::Tensor reference_backward_scores(const at::Tensor& scores_TNC, float fixed_stay_score) {
+    const int N = int(scores_TNC.size(1));
+    const int num_states = int(scores_TNC.size(2)) / 4;
+
+    const at::Tensor vT = scores_TNC.new_full({N, num_states}, 0.0f);
+    const auto idx = predecessor_indices(num_states);
+    auto idx_T = idx.flatten().argsort().reshape(idx.sizes());
+    const auto Ms_T = scores_TNC.index({at::indexing::Slice(), at::indexing::Slice(), idx_T});
+    idx_T = at::bitwise_right_shift(idx_T, 2);
+
+    return reference_scan(Ms_T.flip(0), fixed_stay_score, idx_T.to(at::kLong), vT).flip(0);
+}
+
+}  // namespace
+
+TEST_CASE(CUT_TAG ": scans match ATen reference", CUT_TAG) {
+    // Covers the generic fallback (state_len 1) as well as the SIMD paths.
+    const int state_len = GENERATE(1, 2, 3, 4, 5);
+    const int num_states = int(std::pow(4, state_len));
+    const int T = 50;
+    const int N = 3;
+    const float stay_score = 2.0f;
+    CAPTURE(state_len);
+
+    torch::manual_seed(42);
+    const auto scores = torch::randn({T, N, num_states * 4}, torch::kFloat) * 3;
+
+    const auto fwd = dorado::basecall::decode::inner::forward_scores(scores, stay_score);
+    const auto bwd = dorado::basecall::decode::inner::backward_scores(scores, stay_score);
+    const std::vector<int64_t> expected_sizes{T + 1, N, num_states};
+    CHECK(fwd.sizes().vec() == expected_sizes);
+    CHECK(bwd.sizes().vec() == expected_sizes);
+
+    CHECK(torch::allclose(fwd, reference_forward_scores(scores, stay_score), 1e-5, 1e-4));
+    CHECK(torch::allclose(bwd, reference_backward_scores(scores, stay_score), 1e-5, 1e-4));
+}
+
+TEST_CASE(CUT_TAG ": scans handle strided scores", CUT_TAG) {
+    const int num_states = 64;
+    const int T = 20;
+    const int N = 4;
+    const float stay_score = 2.0f;
+
+    torch::manual_seed(42);
+    // Slicing the batch dimension, as beam_search_part_2 does for each thread.
+    const auto all_scores = torch::randn({T, 2 * N, num_states * 4}, torch::kFloat);
+    const auto scores = all_scores.slice(1, 1, 1 + N);
+    // Non-contiguous innermost dimension.
+    const auto transposed = torch::randn({num_states * 4, N, T}, torch::kFloat).permute({2, 1, 0});
+
+    for (const auto& input : {scores, transposed}) {
+        const auto fwd = dorado::basecall::decode::inner::forward_scores(input, stay_score);
+        const auto bwd = dorado::basecall::decode::inner::backward_scores(input, stay_score);
+        CHECK(torch::allclose(fwd, reference_forward_scores(input, stay_score), 1e-5, 1e-4));
+        CHECK(torch::allclose(bwd, reference_backward_scores(input, stay_score), 1e-5, 1e-4));
+    }
+}
+
+TEST_CASE(CUT_TAG ": batch decode matches single chunk decodes", CUT_TAG) {
+    const int num_states = 256;
+    const int T = 100;
+    const int N = 16;
+
+    torch::manual_seed(42);
+    const auto scores = torch::randn({T, N, num_states * 4}, torch::kFloat) * 2;
+
+    dorado::basecall::decode::CPUDecoder decoder;
+    const dorado::basecall::decode::DecoderOptions options;
+    // Only decode some of the batch, as the model runners do for partial batches.
+    const int num_chunks = N - 3;
+    const auto batch_results = decoder.beam_search_part_2({scores, num_chunks, options});
+    REQUIRE(batch_results.size() == size_t(num_chunks));
+
+    for (int chunk_idx = 0; chunk_idx < num_chunks; ++chunk_idx) {
+        CAPTURE(chunk_idx);
+        const auto chunk_scores = scores.slice(1, chunk_idx, chunk_idx + 1).contiguous();
+        const auto chunk_results = decoder.beam_search_part_2({chunk_scores, 1, options});
+        REQUIRE(chunk_results.size() == 1);
+        CHECK(batch_results[chunk_idx].sequence == chunk_results[0].sequence);
+        CHECK(batch_results[chunk_idx].qstring == chunk_results[0].qstring);
+        CHECK(batch_results[chunk_idx].moves == chunk_results[0].moves);
+    }
+}
@@ -0,0 +1,143 @@
+#include "correct/compact_overlaps.h"
+
+#include "read_pipeline/messages.h"
+#include "utils/cigar.h"
+
+#include <catch2/catch.hpp>
+
+#include <chrono>
+#include <future>
+#include <random>
+#include <string>
+#include <vector>
+
+#define TEST_GROUP "[correct][CompactOverlaps]"
+
+namespace dorado::correction::test {
+
+namespace {
+
+// minimap2 packs each op as length << 4 | op, with ops in the order MIDNSHP=X.
+uint32_t pack_op(uint32_t length, CigarOpType op) {
+    return length << 4 | static_cast<uint32_t>(op);
+}
+
+}  // namespace
+
+TEST_CASE(TEST_GROUP " interned read names are indexed in order", TEST_GROUP) {
+    InternedReadNames read_names;
+    CHECK(read_names.intern("read1") == 0);
+    CHECK(read_names.intern("read2") == 1);
+    // Interning a view of a temporary must copy it.
+    CHECK(read_names.intern(std::string("read1")) == 0);
+    for (int i = 0; i < 1000; ++i) {
+        read_names.intern("extra" + std::to_string(i));
+    }
+    // Names stay valid as more are added.
+    CHECK(read_names.intern("read2") == 1);
+    CHECK(read_names.name(0) == "read1");
+    CHECK(read_names.name(1) == "read2");
+    CHECK(read_names.name(1001) == "extra999");
+}
+
+TEST_CASE(TEST_GROUP " overlaps expand to the alignments they were built from", TEST_GROUP) {
+    const std::vector<CigarOpType> ops{CigarOpType::M,  CigarOpType::I,    CigarOpType::D,
+                                       CigarOpType::EQ, CigarOpType::X};
+    std::minstd_rand rng(42);
+
+    InternedReadNames read_names;
+    const std::string target_name = "target";
+    read_names.intern(target_name);
+
+    CorrectionAlignments expected;
+    expected.read_name = target_name;
+    CompactTargetOverlaps target_overlaps;
+    uint64_t expected_bytes = 0;
+    for (int i = 0; i < 20; ++i) {
+        const std::string query_name = "query" + std::to_string(i % 7);
+        const uint32_t query_idx = read_names.intern(query_name);
+
+        utils::Overlap overlap;
+        overlap.qstart = i;
+        overlap.qend = 1000 + i;
+        overlap.qlen = 2000 + i;
+        overlap.tstart = 2 * i;
+        overlap.tend = 3000 + i;
+        overlap.tlen = 4000;
+        overlap.fwd = i % 2 == 0;
+
+        // Includes an overlap with no ops, and lengths which need more than a byte.
+        std::vector<uint32_t> cigar;
+        for (int j = 0; j < i; ++j) {
+            cigar.push_back(pack_op(1 + rng() % 100000, ops[rng() % ops.size()]));
+        }
+
+        target_overlaps.add(query_idx, overlap, cigar.data(), uint32_t(cigar.size()));
+        expected_bytes += CompactTargetOverlaps::overlap_bytes(uint32_t(cigar.size()));
+
+        expected.qnames.push_back(query_name);
+        expected.cigars.push_back(convert_mm2_cigar(cigar.data(), uint32_t(cigar.size())));
+        expected.overlaps.push_back(overlap);
+    }
+    CHECK(target_overlaps.size() == 20);
+    CHECK(target_overlaps.num_bytes() == expected_bytes);
+
+    auto query_name = [&read_names](uint32_t query_idx) -> const std::string& {
+        return read_names.name(query_idx);
+    };
+    const CorrectionAlignments alignments = target_overlaps.expand(target_name, query_name);
+    CHECK(alignments.read_name == expected.read_name);
+    CHECK(alignments.qnames == expected.qnames);
+    CHECK(alignments.cigars == expected.cigars);
+    REQUIRE(alignments.overlaps.size() == expected.overlaps.size());
+    for (size_t i = 0; i < alignments.overlaps.size(); ++i) {
+        CAPTURE(i);
+        const auto& overlap = alignments.overlaps[i];
+        const auto& expected_overlap = expected.overlaps[i];
+        CHECK(overlap.qstart == expected_overlap.qstart);
+        CHECK(overlap.qend == expected_overlap.qend);
+        CHECK(overlap.qlen == expected_overlap.qlen);
+        CHECK(overlap.tstart == expected_overlap.tstart);
+        CHECK(overlap.tend == expected_overlap.tend);
+        CHECK(overlap.tlen == expected_overlap.tlen);
+        CHECK(overlap.fwd == expected_overlap.fwd);
+    }
+
+    // The compact copy is freed once expanded.
+    CHECK(target_overlaps.empty());
+    CHECK(target_overlaps.num_bytes() == 0);
+}
+
+TEST_CASE(TEST_GROUP " mapping waits for pending overlaps to be sent", TEST_GROUP) {
+    using namespace std::chrono_literals;
+    OverlapMemoryBudget budget(100);
+
+    // Over budget, but nothing pending to wait for.
+    budget.add_mapping(150);
+    budget.wait_for_memory();
+    budget.finish_mapping();
+    CHECK(budget.mapping_bytes() == 0);
+    CHECK(budget.pending_bytes() == 150);
+
+    // Still within budget with the next chunk's first overlaps.
+    budget.release_pending(100);
+    budget.add_mapping(40);
+    budget.wait_for_memory();
+
+    // Over budget with overlaps pending, so wait until they're released.
+    budget.add_mapping(20);
+    auto waiter = std::async(std::launch::async, [&budget] { budget.wait_for_memory(); });
+    CHECK(waiter.wait_for(100ms) == std::future_status::timeout);
+    budget.release_pending(5);
+    // Only part of the pending overlaps have been sent, which isn't enough.
+    CHECK(waiter.wait_for(100ms) == std::future_status::timeout);
+    budget.release_pending(45);
+    CHECK(waiter.wait_for(10s) == std::future_status::ready);
+    waiter.get();
+
+    CHECK(budget.pending_bytes() == 0);
+    CHECK(budget.mapping_bytes() == 60);
+    CHECK(budget.wait_ms() >= 100);
+}
+
+}  // namespace dorado::correction::test
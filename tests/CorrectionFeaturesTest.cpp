@@ -0,0 +1,378 @@
+#include "correct/conversions.h"
+#include "correct/features.h"
+#include "correct/types.h"
+#include "correct/windows.h"
+#include "read_pipeline/messages.h"
+#include "utils/cigar.h"
+#include "utils/sequence_utils.h"
+
+#include <ATen/Functions.h>
+#include <catch2/catch.hpp>
+#include <torch/types.h>
+
+#include <algorithm>
+#include <numeric>
+#include <random>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#define TEST_GROUP "[correct][features]"
+
+namespace dorado::correction::test {
+
+namespace {
+
+constexpr int TOP_K = 30;
+
+// Feature generation as it was before windows were generated in parallel into pooled buffers,
+// kept as a reference for the faster version: the aligned part of each query is copied out and
+// reverse complemented, and support is counted a column at a time.
+std::vector<int> reference_max_ins(const std::vector<OverlapWindow>& overlaps,
+                                   const CorrectionAlignments& alignments,
+                                   int tstart,
+                                   int win_len) {
+    std::vector<int> max_ins(win_len, 0);
+    for (const auto& overlap : overlaps) {
+        auto tpos = overlap.tstart - tstart;
+        const auto& cigar = alignments.cigars[overlap.overlap_idx];
+        const int cigar_len = overlap.cigar_end_idx - overlap.cigar_start_idx + 1;
+        for (int i = overlap.cigar_start_idx;
+             i <= std::min(overlap.cigar_end_idx, int(cigar.size()) - 1); i++) {
+            const CigarOpType op = cigar[i].op;
+            const int len = cigar[i].len;
+            if (op == CigarOpType::I) {
+                max_ins[tpos - 1] = std::max(len, max_ins[tpos - 1]);
+                continue;
+            }
+            if (cigar_len == 1) {
+                tpos += overlap.cigar_end_offset - overlap.cigar_start_offset;
+            } else if (i == overlap.cigar_start_idx) {
+                tpos += len - overlap.cigar_start_offset;
+            } else if (i == overlap.cigar_end_idx) {
+                tpos += overlap.cigar_end_offset;
+            } else {
+                tpos += len;
+            }
+        }
+    }
+    return max_ins;
+}
+
+std::tuple<at::Tensor, at::Tensor> reference_features_for_window(
+        const std::vector<OverlapWindow>& overlaps,
+        const CorrectionAlignments& alignments,
+        int win_len,
+        int tstart,
+        const std::vector<int>& max_ins) {
+    static const auto base_encoding = gen_base_encoding();
+    const int length = std::accumulate(max_ins.begin(), max_ins.end(), 0) + (int)max_ins.size();
+    const int reads = 1 + TOP_K;
+
+    auto bases = at::empty({reads, length},
+                           at::TensorOptions().dtype(torch::kInt32).device(torch::kCPU));
+    auto quals = at::empty({reads, length},
+                           at::TensorOptions().dtype(torch::kFloat32).device(torch::kCPU));
+    int* bases_ptr = bases.data_ptr<int>();
+    float* quals_ptr = quals.data_ptr<float>();
+    std::fill(bases_ptr, bases_ptr + bases.numel(), base_encoding['.']);
+    std::fill(quals_ptr, quals_ptr + quals.numel(), normalize_quals((float)'!'));
+
+    std::fill(bases_ptr, bases_ptr + length, base_encoding['*']);
+    int tpos = 0;
+    for (int i = 0; i < win_len; i++) {
+        bases_ptr[tpos] = base_encoding[alignments.read_seq[i + tstart]];
+        quals_ptr[tpos] = normalize_quals(float(alignments.read_qual[i + tstart] + 33));
+        tpos += 1 + max_ins[i];
+    }
+
+    for (int w = 0; w < (int)overlaps.size(); w++) {
+        int* query_bases = &bases_ptr[length * (w + 1)];
+        float* query_quals = &quals_ptr[length * (w + 1)];
+        const auto& overlap = overlaps[w];
+        const auto& cigar = alignments.cigars[overlap.overlap_idx];
+        const auto& aln = alignments.overlaps[overlap.overlap_idx];
+        const bool fwd = aln.fwd;
+        const int qstart = fwd ? aln.qstart + overlap.qstart : aln.qend - overlap.qend;
+        const int qend = fwd ? aln.qstart + overlap.qend : aln.qend - overlap.qstart;
+
+        std::string qseq = alignments.seqs[overlap.overlap_idx].substr(qstart, qend - qstart);
+        std::vector<uint8_t> qqual(alignments.quals[overlap.overlap_idx] + qstart,
+                                   alignments.quals[overlap.overlap_idx] + qend);
+        if (!fwd) {
+            qseq = utils::reverse_complement(qseq);
+            std::reverse(qqual.begin(), qqual.end());
+        }
+
+        const int cigar_len = overlap.cigar_end_idx - overlap.cigar_start_idx + 1;
+        const int cigar_end = std::min(int(cigar.size()) - overlap.cigar_start_idx, cigar_len);
+
+        std::fill(query_bases, query_bases + length, base_encoding[fwd ? '*' : '#']);
+        const int offset = overlap.tstart - tstart;
+        tpos = offset;
+        int idx = offset + std::accumulate(max_ins.begin(), max_ins.begin() + offset, 0);
+        std::fill(query_bases, query_bases + idx, base_encoding['.']);
+
+        int query_iter = 0;
+        for (int cigar_idx = 0; cigar_idx < cigar_end; cigar_idx++) {
+            const auto& cigar_op = cigar[cigar_idx + overlap.cigar_start_idx];
+            uint32_t l = cigar_op.len;
+            if (cigar_len == 1) {
+                l = overlap.cigar_end_offset - overlap.cigar_start_offset;
+            } else if (cigar_idx == 0) {
+                l -= overlap.cigar_start_offset;
+            } else if (cigar_idx == cigar_len - 1) {
+                l = overlap.cigar_end_offset;
+            }
+
+            if (cigar_op.op == CigarOpType::EQ || cigar_op.op == CigarOpType::X) {
+                for (uint32_t i = 0; i < l; i++) {
+                    query_bases[idx] = base_encoding[uint8_t(qseq[query_iter]) + (fwd ? 0 : 32)];
+                    query_quals[idx] = normalize_quals((float)(qqual[query_iter] + 33));
+                    idx += 1 + max_ins[tpos + i];
+                    query_iter++;
+                }
+                tpos += l;
+            } else if (cigar_op.op == CigarOpType::D) {
+                for (uint32_t i = 0; i < l; i++) {
+                    idx += 1 + max_ins[tpos + i];
+                }
+                tpos += l;
+            } else if (cigar_op.op == CigarOpType::I) {
+                idx -= max_ins[tpos - 1];
+                for (uint32_t i = 0; i < l; i++) {
+                    query_bases[idx + i] =
+                            base_encoding[uint8_t(qseq[query_iter]) + (fwd ? 0 : 32)];
+                    query_quals[idx + i] = normalize_quals((float)(qqual[query_iter] + 33));
+                    query_iter++;
+                }
+                idx += max_ins[tpos - 1];
+            }
+        }
+        if (idx < length) {
+            std::fill(query_bases + idx, query_bases + length, base_encoding['.']);
+        }
+    }
+    return {bases, quals};
+}
+
+std::vector<std::pair<int, int>> reference_supported(const at::Tensor& bases) {
+    static const auto base_forward = base_forward_mapping();
+    static const auto base_encoding = gen_base_encoding();
+    static const auto base_decoding = gen_base_decoding();
+    const int reads = static_cast<int>(bases.sizes()[0]);
+    const int length = static_cast<int>(bases.sizes()[1]);
+    const int* bases_ptr = bases.data_ptr<int>();
+
+    std::vector<std::pair<int, int>> supported;
+    int tpos = -1, ins = 0;
+    std::array<int, 128> counter;
+    for (int c = 0; c < length; c++) {
+        if (bases_ptr[c] == base_encoding['*']) {
+            ins += 1;
+        } else {
+            tpos += 1;
+            ins = 0;
+        }
+        counter.fill(0);
+        for (int r = 0; r < reads; r++) {
+            const int base = bases_ptr[r * length + c];
+            if (base != base_encoding['.']) {
+                counter[base_forward[base_decoding[base]]]++;
+            }
+        }
+        if (std::count_if(counter.begin(), counter.end(), [](int num) { return num >= 3; }) >=
+            2) {
+            supported.push_back({tpos, ins});
+        }
+    }
+    return supported;
+}
+
+std::vector<int> reference_indices(const at::Tensor& bases,
+                                   const std::vector<std::pair<int, int>>& supported) {
+    static const auto base_encoding = gen_base_encoding();
+    const int* target_bases = bases.data_ptr<int>();
+    std::vector<int> columns;
+    for (int i = 0; i < bases.sizes()[1]; i++) {
+        if (target_bases[i] != base_encoding['*']) {
+            columns.push_back(i);
+        }
+    }
+    std::vector<int> indices;
+    for (auto [pos, ins] : supported) {
+        indices.push_back(columns[pos] + ins);
+    }
+    return indices;
+}
+
+template <typename T>
+std::vector<T> to_vector(const at::Tensor& tensor) {
+    const T* data = tensor.data_ptr<T>();
+    return std::vector<T>(data, data + tensor.numel());
+}
+
+char next_base(char base) {
+    const std::string bases = "ACGT";
+    return bases[(bases.find(base) + 1) % bases.length()];
+}
+
+void add_op(std::vector<CigarOp>& cigar, CigarOpType op) {
+    if (!cigar.empty() && cigar.back().op == op) {
+        cigar.back().len++;
+    } else {
+        cigar.push_back({op, 1});
+    }
+}
+
+// Adds a query which covers the whole of the target, with random errors plus the given
+// substitutions, aligned to the forward or reverse strand.
+void add_query(CorrectionAlignments& alignments,
+               const std::vector<std::pair<int, char>>& substitutions,
+               bool fwd,
+               int window_size,
+               std::minstd_rand& rng) {
+    const std::string& tseq = alignments.read_seq;
+    const int tlen = int(tseq.length());
+    std::string qseq;
+    std::vector<CigarOp> cigar;
+    for (int t = 0; t < tlen; ++t) {
+        // Keep indels away from window boundaries.
+        const int window_pos = t % window_size;
+        const bool indels_allowed = window_pos > 2 && window_pos < window_size - 3 && t < tlen - 3;
+        const auto substitution =
+                std::find_if(substitutions.begin(), substitutions.end(),
+                             [t](const auto& substitution) { return substitution.first == t; });
+        const int error = rng() % 100;
+        if (substitution != substitutions.end()) {
+            qseq += substitution->second;
+            add_op(cigar, substitution->second == tseq[t] ? CigarOpType::EQ : CigarOpType::X);
+        } else if (error < 2) {
+            qseq += next_base(tseq[t]);
+            add_op(cigar, CigarOpType::X);
+        } else if (error < 4 && indels_allowed) {
+            add_op(cigar, CigarOpType::D);
+        } else if (error < 6 && indels_allowed) {
+            qseq += tseq[t];
+            add_op(cigar, CigarOpType::EQ);
+            qseq += "ACGT"[rng() % 4];
+            add_op(cigar, CigarOpType::I);
+        } else {
+            qseq += tseq[t];
+            add_op(cigar, CigarOpType::EQ);
+        }
+    }
+    std::vector<uint8_t> qual(qseq.length());
+    for (auto& q : qual) {
+        q = uint8_t(rng() % 50);
+    }
+    if (!fwd) {
+        qseq = utils::reverse_complement(qseq);
+        std::reverse(qual.begin(), qual.end());
+    }
+
+    utils::Overlap overlap;
+    overlap.qstart = 0;
+    overlap.qend = int(qseq.length());
+    overlap.qlen = int(qseq.length());
+    overlap.tstart = 0;
+    overlap.tend = tlen;
+    overlap.tlen = tlen;
+    overlap.fwd = fwd;
+
+    alignments.qnames.push_back("query" + std::to_string(alignments.qnames.size()));
+    alignments.overlaps.push_back(overlap);
+    alignments.cigars.push_back(std::move(cigar));
+    alignments.seqs.push_back(std::move(qseq));
+    alignments.qual_storage.push_back(std::move(qual));
+}
+
+}  // namespace
+
+TEST_CASE(TEST_GROUP " window features match the reference", TEST_GROUP) {
+    constexpr int WINDOW_SIZE = 100;
+    constexpr int TLEN = 350;
+    std::minstd_rand rng(42);
+
+    CorrectionAlignments alignments;
+    alignments.read_name = "target";
+    for (int i = 0; i < TLEN; ++i) {
+        alignments.read_seq += "ACGT"[rng() % 4];
+    }
+    std::vector<uint8_t> target_qual(TLEN);
+    for (auto& q : target_qual) {
+        q = uint8_t(rng() % 50);
+    }
+    alignments.read_qual = target_qual.data();
+
+    // Variants shared by enough queries on both strands to be candidates for correction.
+    std::vector<std::pair<int, char>> variants;
+    for (int t : {15, 140, 260}) {
+        variants.emplace_back(t, next_base(alignments.read_seq[t]));
+    }
+    const int num_queries = 10;
+    alignments.qual_storage.reserve(num_queries);
+    for (int i = 0; i < num_queries; ++i) {
+        const bool fwd = i % 2 == 0;
+        add_query(alignments, i < 6 ? variants : std::vector<std::pair<int, char>>{}, fwd,
+                  WINDOW_SIZE, rng);
+    }
+    for (const auto& qual : alignments.qual_storage) {
+        alignments.quals.push_back(qual.data());
+    }
+
+    std::vector<std::vector<OverlapWindow>> windows((TLEN + WINDOW_SIZE - 1) / WINDOW_SIZE);
+    REQUIRE(extract_windows(windows, alignments, WINDOW_SIZE));
+    REQUIRE_FALSE(filter_features(windows, alignments).empty());
+
+    // Pooled buffers are reused, so hand out ones full of junk.
+    const FeatureAllocator allocate = [](int reads, int length) {
+        auto bases = at::empty({reads, length},
+                               at::TensorOptions().dtype(torch::kInt32).device(torch::kCPU));
+        auto quals = at::empty({reads, length},
+                               at::TensorOptions().dtype(torch::kFloat32).device(torch::kCPU));
+        std::fill(bases.data_ptr<int>(), bases.data_ptr<int>() + bases.numel(), 99);
+        std::fill(quals.data_ptr<float>(), quals.data_ptr<float>() + quals.numel(), 99.f);
+        return std::make_tuple(bases, quals);
+    };
+
+    size_t num_supported = 0;
+    for (int w = 0; w < (int)windows.size(); ++w) {
+        CAPTURE(w);
+        const auto& overlap_windows = windows[w];
+        REQUIRE(overlap_windows.size() > 1);
+        const bool has_fwd = std::any_of(
+                overlap_windows.begin(), overlap_windows.end(),
+                [&](const auto& ow) { return alignments.overlaps[ow.overlap_idx].fwd; });
+        const bool has_rev = std::any_of(
+                overlap_windows.begin(), overlap_windows.end(),
+                [&](const auto& ow) { return !alignments.overlaps[ow.overlap_idx].fwd; });
+        CHECK(has_fwd);
+        CHECK(has_rev);
+
+        const WindowFeatures wf =
+                extract_window_features(overlap_windows, alignments, WINDOW_SIZE, w, allocate);
+
+        const int tstart = w * WINDOW_SIZE;
+        const int win_len = std::min(WINDOW_SIZE, TLEN - tstart);
+        const auto max_ins = reference_max_ins(overlap_windows, alignments, tstart, win_len);
+        const auto [bases, quals] = reference_features_for_window(overlap_windows, alignments,
+                                                                  win_len, tstart, max_ins);
+        const auto supported = reference_supported(bases);
+
+        CHECK(wf.window_idx == w);
+        CHECK(wf.n_alns == int(overlap_windows.size()));
+        REQUIRE(wf.bases.sizes() == bases.sizes());
+        REQUIRE(wf.quals.sizes() == quals.sizes());
+        CHECK(to_vector<int>(wf.bases) == to_vector<int>(bases));
+        CHECK(to_vector<float>(wf.quals) == to_vector<float>(quals));
+        CHECK(wf.supported == supported);
+        CHECK(wf.length == int(supported.size()));
+        CHECK(to_vector<int>(wf.indices) == reference_indices(bases, supported));
+        num_supported += supported.size();
+    }
+    // The shared variants make for candidates, so the comparison isn't trivial.
+    CHECK(num_supported >= variants.size());
+}
+
+}  // namespace dorado::correction::test
@@ -249,3 +249,46 @@ TEST_CASE("Test split where only one subread is generated", TEST_GROUP) {
     const auto &read_common = get_read_common_data(messages[0]);
     CHECK(read_common.parent_read_id != read_common.read_id);
 }
+
+TEST_CASE("Pore samples clustered over part of a signal match detecting them in it", TEST_GROUP) {
+    auto read = make_read();
+    const auto signal = read->read_common.raw_data.to(at::kFloat);
+    const dorado::splitter::DuplexSplitSettings settings(false);
+
+    const auto pore_samples = dorado::splitter::find_pore_samples(signal, settings.pore_thr);
+    const int64_t begin = GENERATE(0, 97230, 152310);
+    const int64_t end = GENERATE(152310, 256790);
+    CAPTURE(begin, end);
+
+    const auto expected = dorado::splitter::detect_pore_signal<float>(
+            signal.index({at::indexing::Slice(begin, end)}), settings.pore_thr,
+            settings.pore_cl_dist, settings.expect_pore_prefix);
+    const auto clusters = dorado::splitter::cluster_pore_samples(
+            pore_samples, begin, end, settings.pore_cl_dist, settings.expect_pore_prefix);
+
+    REQUIRE(clusters.size() == expected.size());
+    for (size_t i = 0; i < clusters.size(); ++i) {
+        CHECK(clusters[i].start_sample == expected[i].start_sample);
+        CHECK(clusters[i].end_sample == expected[i].end_sample);
+        CHECK(clusters[i].argmax_sample == expected[i].argmax_sample);
+        CHECK(clusters[i].max_val == expected[i].max_val);
+    }
+}
+
+TEST_CASE("Split finder stats", TEST_GROUP) {
+    dorado::splitter::DuplexReadSplitter splitter(dorado::splitter::DuplexSplitSettings(false));
+    const auto split_res = splitter.split(make_read());
+    REQUIRE(split_res.size() == 4);
+
+    const auto stats = splitter.sample_stats();
+    CHECK(stats.at("SIGNAL_SCAN.num_reads") == 1);
+    CHECK(stats.at("PORE_ADAPTER.num_reads") == 1);
+    // Every split was found by one of the finders.
+    double num_splits = 0;
+    for (const auto &[name, value] : stats) {
+        if (name.size() > 11 && name.substr(name.size() - 11) == ".num_splits") {
+            num_splits += value;
+        }
+    }
+    CHECK(num_splits >= 3);
+}
@@ -9,6 +9,7 @@
 #include <memory>
 #include <numeric>
 #include <random>
+#include <stdexcept>
 #include <vector>
 
 #define TEST_GROUP "[hts_file]"
@@ -93,6 +94,19 @@ struct Tester {
         file_in.reset();
         header_in.reset();
     }
+
+    std::vector<std::string> read_output_qnames() {
+        std::vector<std::string> qnames;
+        file_in.reset(hts_open(file_out_path.string().c_str(), "r"));
+        header_in.reset(sam_hdr_read(file_in.get()));
+        BamPtr record(bam_init1());
+        while (sam_read1(file_in.get(), header_in.get(), record.get()) >= 0) {
+            qnames.emplace_back(bam_get_qname(record.get()));
+        }
+        file_in.reset();
+        header_in.reset();
+        return qnames;
+    }
 };
 
 std::vector<std::string> get_dummy_filenames(const std::string& base_name,
@@ -146,6 +160,62 @@ TEST_CASE("HtsFileTest: Write to multiple sorted files, and merge", TEST_GROUP)
     tester.check_output(true);
 }
 
+TEST_CASE("HtsFileTest: Merged output matches output from a single sort buffer", TEST_GROUP) {
+    Tester tester;
+    tester.read_input_records();
+
+    tester.write_output_records(5000000);
+    const auto single_file_qnames = tester.read_output_qnames();
+
+    // Temp files are written in the background while the next buffer fills up, which mustn't
+    // change the order of the merged records.
+    tester.write_output_records(200000);
+    const auto merged_qnames = tester.read_output_qnames();
+
+    REQUIRE(merged_qnames.size() == tester.records.size());
+    CHECK(merged_qnames == single_file_qnames);
+}
+
+TEST_CASE("HtsFileTest: Failed temp file write is reported by the next write", TEST_GROUP) {
+    Tester tester;
+    tester.read_input_records();
+
+    // Temp files are written next to the output file, so this makes every spill fail.
+    const auto missing_dir_path = tester.output_test_dir.m_path / "missing" / "test_output.bam";
+    HtsFile file_out(missing_dir_path.string(), HtsFile::OutputMode::BAM, NUM_THREADS, true);
+    file_out.set_buffer_size(200000);
+    file_out.set_header(tester.header_out.get());
+
+    // The first spill fails in the background, and the error is handed over when the next
+    // buffer is full and has to wait for it.
+    CHECK_THROWS_AS(
+            [&] {
+                for (size_t i = 0; i < tester.records.size(); ++i) {
+                    file_out.write(tester.records[tester.indices[i]].get());
+                }
+            }(),
+            std::runtime_error);
+    CHECK_THROWS_AS(file_out.finalise([](size_t) {}), std::runtime_error);
+    CHECK_FALSE(fs::exists(missing_dir_path));
+}
+
+TEST_CASE("HtsFileTest: Failed temp file write is reported by finalise", TEST_GROUP) {
+    Tester tester;
+    tester.read_input_records();
+
+    const auto missing_dir_path = tester.output_test_dir.m_path / "missing" / "test_output.bam";
+    HtsFile file_out(missing_dir_path.string(), HtsFile::OutputMode::BAM, NUM_THREADS, true);
+    file_out.set_buffer_size(5000000);
+    file_out.set_header(tester.header_out.get());
+
+    // Everything fits in one buffer, so the only spill happens in finalise().
+    for (size_t i = 0; i < tester.records.size(); ++i) {
+        REQUIRE(file_out.write(tester.records[tester.indices[i]].get()) == 0);
+    }
+    CHECK_THROWS_AS(file_out.finalise([](size_t) {}), std::runtime_error);
+    CHECK_FALSE(fs::exists(missing_dir_path));
+}
+
 TEST_CASE("HtsFileTest: construct with zero threads for sorted BAM does not throw", TEST_GROUP) {
     Tester tester;
     std::unique_ptr<HtsFile> cut{};
@@ -241,6 +311,14 @@ TEST_CASE("FileMergeBatcher: Eight batches, 3 recursions", TEST_GROUP) {
     CHECK(batcher.get_merge_filename(6) == filepath("folder", "batch_6.tmp"));
     CHECK(batcher.get_merge_filename(7) == filepath("folder", "merged.bam"));
 
+    // Batches within each recursion can be merged concurrently.
+    for (size_t batch = 0; batch < 5; ++batch) {
+        CHECK(batcher.get_merge_level(batch) == 0);
+    }
+    CHECK(batcher.get_merge_level(5) == 1);
+    CHECK(batcher.get_merge_level(6) == 1);
+    CHECK(batcher.get_merge_level(7) == 2);
+
     // First recursion: 20 files in 5 batches of 4.
     auto expected_files0 = get_dummy_filenames(filepath("folder", "file_"), ".bam", 4, 0);
     const auto& batch0 = batcher.get_batch(0);
@@ -0,0 +1,87 @@
+#include "utils/loser_tree.h"
+
+#include <catch2/catch.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#define TEST_GROUP "[loser_tree]"
+
+using dorado::utils::LoserTree;
+
+namespace {
+
+// Merges the sources, returning the (source, value) pairs in the order they come out.
+std::vector<std::pair<size_t, uint64_t>> merge(const std::vector<std::vector<uint64_t>>& sources) {
+    std::vector<uint64_t> first_keys;
+    for (const auto& source : sources) {
+        first_keys.push_back(source.front());
+    }
+    std::vector<size_t> positions(sources.size(), 0);
+    std::vector<std::pair<size_t, uint64_t>> merged;
+    LoserTree<uint64_t> tree(first_keys);
+    while (!tree.empty()) {
+        const size_t source = tree.top();
+        merged.emplace_back(source, tree.top_key());
+        if (++positions[source] < sources[source].size()) {
+            tree.replace_top(sources[source][positions[source]]);
+        } else {
+            tree.pop_top();
+        }
+    }
+    return merged;
+}
+
+// Reference implementation using a linear scan, matching the original HtsFile merge.
+std::vector<std::pair<size_t, uint64_t>> linear_merge(
+        const std::vector<std::vector<uint64_t>>& sources) {
+    std::vector<size_t> positions(sources.size(), 0);
+    std::vector<std::pair<size_t, uint64_t>> merged;
+    while (true) {
+        int best_index = -1;
+        for (size_t i = 0; i < sources.size(); ++i) {
+            if (positions[i] < sources[i].size() &&
+                (best_index == -1 ||
+                 sources[i][positions[i]] < sources[best_index][positions[best_index]])) {
+                best_index = int(i);
+            }
+        }
+        if (best_index == -1) {
+            return merged;
+        }
+        merged.emplace_back(best_index, sources[best_index][positions[best_index]++]);
+    }
+}
+
+}  // namespace
+
+TEST_CASE("LoserTree: single source", TEST_GROUP) {
+    const std::vector<std::vector<uint64_t>> sources{{1, 2, 2, 5}};
+    const std::vector<std::pair<size_t, uint64_t>> expected{{0, 1}, {0, 2}, {0, 2}, {0, 5}};
+    CHECK(merge(sources) == expected);
+}
+
+TEST_CASE("LoserTree: ties go to the lowest source index", TEST_GROUP) {
+    const std::vector<std::vector<uint64_t>> sources{{3, 4}, {1, 3}, {3}};
+    const std::vector<std::pair<size_t, uint64_t>> expected{
+            {1, 1}, {0, 3}, {1, 3}, {2, 3}, {0, 4}};
+    CHECK(merge(sources) == expected);
+}
+
+TEST_CASE("LoserTree: matches a linear scan merge", TEST_GROUP) {
+    const size_t num_sources = GENERATE(2, 3, 7, 16, 33);
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<uint64_t> value_dist(0, 50);
+    std::uniform_int_distribution<size_t> length_dist(1, 40);
+
+    std::vector<std::vector<uint64_t>> sources(num_sources);
+    for (auto& source : sources) {
+        source.resize(length_dist(rng));
+        std::generate(source.begin(), source.end(), [&] { return value_dist(rng); });
+        std::sort(source.begin(), source.end());
+    }
+
+    CHECK(merge(sources) == linear_merge(sources));
+}
@@ -3,6 +3,7 @@
 #include "data_loader/DataLoader.h"
 #include "read_pipeline/ReadPipeline.h"
 
+#include <iterator>
 #include <memory>
 #include <vector>
 
@@ -33,9 +34,10 @@ private:
     std::vector<dorado::Message>& m_messages;
 
     void worker_thread() {
-        dorado::Message message;
-        while (get_input_message(message)) {
-            m_messages.push_back(std::move(message));
+        std::vector<dorado::Message> messages;
+        while (get_input_messages(messages, 100)) {
+            m_messages.insert(m_messages.end(), std::make_move_iterator(messages.begin()),
+                              std::make_move_iterator(messages.end()));
         }
     }
 };
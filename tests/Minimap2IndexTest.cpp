@@ -183,6 +183,28 @@ TEST_CASE(TEST_GROUP " Test split index loading", TEST_GROUP) {
         CHECK(cut.load(temp_input_file.string(), 1, true) == IndexLoadResult::success);
         CHECK(cut.load_next_chunk(1) == IndexLoadResult::success);
     }
+
+    SECTION("Next chunk read ahead of use") {
+        REQUIRE(cut.load(temp_input_file.string(), 1, true) == IndexLoadResult::success);
+        const mm_idx_t* first_chunk = cut.index();
+        auto next_chunk = cut.read_next_chunk(1);
+        REQUIRE(next_chunk != nullptr);
+        CHECK(cut.index() == first_chunk);
+        cut.use_chunk(next_chunk);
+        CHECK(cut.index() == next_chunk.get());
+    }
+
+    SECTION("No chunks after the last") {
+        REQUIRE(cut.load(temp_input_file.string(), 1, true) == IndexLoadResult::success);
+        std::shared_ptr<const mm_idx_t> next_chunk;
+        int num_chunks = 1;
+        while ((next_chunk = cut.read_next_chunk(1)) != nullptr) {
+            cut.use_chunk(std::move(next_chunk));
+            ++num_chunks;
+        }
+        CHECK(num_chunks > 1);
+        CHECK(cut.load_next_chunk(1) == IndexLoadResult::end_of_index);
+    }
 }
 
 }  // namespace dorado::alignment::test
@@ -0,0 +1,52 @@
+#include "modbase/encode_kmer.h"
+
+#include <catch2/catch.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+// Microbenchmarks for the modbase kmer encoding.
+// These are hidden, so run them explicitly with: dorado_tests "[benchmark]"
+
+#define CUT_TAG "[modbase_encoder][.][benchmark]"
+
+TEST_CASE("Encode kmer context", CUT_TAG) {
+    // Current remora models use 4 bases either side, i.e. 9-mers.  The others cover kmer
+    // lengths which take a different number of vector stores per sample.
+    const auto [bases_before, bases_after] = GENERATE(table<size_t, size_t>({
+            {4, 4},
+            {2, 2},
+            {3, 8},
+            {8, 8},
+    }));
+    constexpr size_t CONTEXT_SAMPLES = 200;
+
+    // Bases with around 10 samples each, as for a 5kHz signal.
+    std::minstd_rand rng(42);
+    std::vector<uint64_t> seq_to_sig{0};
+    while (seq_to_sig.back() < CONTEXT_SAMPLES) {
+        const uint64_t next_base_sample = seq_to_sig.back() + 5 + rng() % 10;
+        seq_to_sig.push_back(std::min(next_base_sample, uint64_t{CONTEXT_SAMPLES}));
+    }
+    std::vector<int> seq_ints(seq_to_sig.size() - 1 + bases_before + bases_after);
+    for (auto& base : seq_ints) {
+        base = int(rng() % 4);
+    }
+
+    const size_t kmer_len = bases_before + bases_after + 1;
+    std::vector<int8_t> output(kmer_len * 4 * CONTEXT_SAMPLES);
+    const auto suffix = " kmer_len=" + std::to_string(kmer_len);
+    BENCHMARK("encode_kmer_context vector" + suffix) {
+        return dorado::modbase::encode_kmer_context(seq_ints, seq_to_sig, bases_before,
+                                                    bases_after, CONTEXT_SAMPLES);
+    };
+    BENCHMARK("encode_kmer_context buffer" + suffix) {
+        dorado::modbase::encode_kmer_context(seq_ints, seq_to_sig, bases_before, bases_after,
+                                             CONTEXT_SAMPLES, output.data());
+        return output[0];
+    };
+}
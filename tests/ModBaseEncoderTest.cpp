@@ -6,8 +6,10 @@
 
 #include <catch2/catch.hpp>
 
+#include <algorithm>
 #include <cstddef>
 #include <cstring>
+#include <random>
 #include <stdexcept>
 #include <string>
 #include <unordered_map>
@@ -518,3 +520,61 @@ TEST_CASE("Encode kmer for chuck mods models - stride 5", TEST_GROUP) {
         test_chunk_enc(kmer_len, padding, is_centered, kmer_bases);
     }
 }
+
+TEST_CASE("Encode kmer context into a buffer for any kmer length", TEST_GROUP) {
+    const size_t bases_before = GENERATE(1, 2, 4, 6);
+    const size_t bases_after = GENERATE(1, 3, 4, 7);
+    const size_t kmer_len = bases_before + bases_after + 1;
+    constexpr size_t CONTEXT_SAMPLES = 150;
+    CAPTURE(bases_before, bases_after);
+
+    // Random bases with a few Ns at either end, and between 1 and 5 samples per base.
+    std::minstd_rand rng(42);
+    std::vector<int> seq_ints;
+    std::vector<uint64_t> seq_to_sig{0};
+    while (seq_to_sig.back() < CONTEXT_SAMPLES) {
+        const uint64_t next_base_sample = seq_to_sig.back() + 1 + rng() % 5;
+        seq_to_sig.push_back(std::min(next_base_sample, uint64_t{CONTEXT_SAMPLES}));
+    }
+    const size_t context_seq_len = seq_to_sig.size() - 1;
+    for (size_t i = 0; i < context_seq_len + kmer_len - 1; ++i) {
+        const bool is_n = i < 2 || i + 3 > context_seq_len + kmer_len - 1;
+        seq_ints.push_back(is_n ? -1 : int(rng() % 4));
+    }
+
+    std::string expected_bases;
+    for (size_t s = 0; s < context_seq_len; ++s) {
+        for (uint64_t sample = seq_to_sig[s]; sample < seq_to_sig[s + 1]; ++sample) {
+            for (size_t k = 0; k < kmer_len; ++k) {
+                const int base = seq_ints[s + k];
+                expected_bases += base == -1 ? 'N' : seq_int_map[int8_t(base)];
+            }
+        }
+    }
+    const auto expected = encode_bases(expected_bases);
+    REQUIRE(expected.size() == CONTEXT_SAMPLES * kmer_len * 4);
+
+    CHECK(encode_kmer_context(seq_ints, seq_to_sig, bases_before, bases_after, CONTEXT_SAMPLES) ==
+          expected);
+
+    SECTION("Stale data in the buffer is overwritten") {
+        std::vector<int8_t> buffer(expected.size(), 0x55);
+        encode_kmer_context(seq_ints, seq_to_sig, bases_before, bases_after, CONTEXT_SAMPLES,
+                            buffer.data());
+        CHECK(buffer == expected);
+    }
+
+    SECTION("Samples past the last base are zeroed") {
+        // Drop the last base so that its samples are left unmapped.
+        seq_ints.pop_back();
+        seq_to_sig.pop_back();
+        const auto unmapped_bytes = (CONTEXT_SAMPLES - seq_to_sig.back()) * kmer_len * 4;
+        auto expected_truncated = expected;
+        std::fill(expected_truncated.end() - unmapped_bytes, expected_truncated.end(), 0);
+
+        std::vector<int8_t> buffer(expected.size(), 0x55);
+        encode_kmer_context(seq_ints, seq_to_sig, bases_before, bases_after, CONTEXT_SAMPLES,
+                            buffer.data());
+        CHECK(buffer == expected_truncated);
+    }
+}
@@ -1,9 +1,15 @@
 #include "modbase/MotifMatcher.h"
 
 #include "modbase/ModBaseModelConfig.h"
+#include "utils/sequence_utils.h"
 
 #include <catch2/catch.hpp>
 
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
 #define TEST_GROUP "[modbase_motif_matcher]"
 
 using std::make_tuple;
@@ -42,3 +48,65 @@ TEST_CASE(TEST_GROUP ": test motifs", TEST_GROUP) {
     auto hits = matcher.get_motif_hits(SEQ);
     CHECK(hits == expected_results);
 }
+
+TEST_CASE(TEST_GROUP ": multiple motifs in one pass", TEST_GROUP) {
+    const std::vector<std::pair<std::string, size_t>> motifs{
+            {"CG", 0}, {"CG", 1}, {"C", 0}, {"AA", 1}, {"TAC", 2}, {"DRACH", 2},
+    };
+    dorado::modbase::MultiMotifMatcher matcher(motifs);
+    REQUIRE(matcher.num_motifs() == motifs.size());
+
+    const auto hits = matcher.get_motif_hits(SEQ);
+    REQUIRE(hits.size() == motifs.size());
+    for (size_t i = 0; i < motifs.size(); ++i) {
+        CAPTURE(motifs[i].first, motifs[i].second);
+        dorado::modbase::MotifMatcher single_matcher(motifs[i].first, motifs[i].second);
+        CHECK(hits[i] == single_matcher.get_motif_hits(SEQ));
+    }
+    CHECK(hits[5] == std::vector<size_t>{14, 18});
+}
+
+TEST_CASE(TEST_GROUP ": multiple motifs match single motifs on both strands", TEST_GROUP) {
+    // Enough motifs to span several state words, including one longer than a word.
+    std::minstd_rand rng(42);
+    const std::string iupac = "ACGTRYSWKMBDHVN";
+    std::vector<std::pair<std::string, size_t>> motifs{{"CG", 0}, {"A", 0}, {"GATC", 1}};
+    while (motifs.size() < 40) {
+        std::string motif(1 + rng() % 6, 'N');
+        for (auto& base : motif) {
+            base = iupac[rng() % iupac.size()];
+        }
+        motifs.emplace_back(motif, rng() % motif.size());
+    }
+    motifs.emplace_back(std::string(70, 'N') + "CA", 71);
+    dorado::modbase::MultiMotifMatcher matcher(motifs);
+
+    std::string seq(2000, 'A');
+    for (auto& base : seq) {
+        base = "ACGT"[rng() % 4];
+    }
+    const auto rc_seq = dorado::utils::reverse_complement(seq);
+
+    dorado::modbase::MultiMotifMatcher::Hits rc_hits;
+    const auto hits = matcher.get_motif_hits(seq, &rc_hits);
+    REQUIRE(hits.size() == motifs.size());
+    REQUIRE(rc_hits.size() == motifs.size());
+    for (size_t i = 0; i < motifs.size(); ++i) {
+        CAPTURE(motifs[i].first, motifs[i].second);
+        dorado::modbase::MotifMatcher single_matcher(motifs[i].first, motifs[i].second);
+        CHECK(hits[i] == single_matcher.get_motif_hits(seq));
+        CHECK(rc_hits[i] == single_matcher.get_motif_hits(rc_seq));
+
+        // Hits within part of the sequence are the same as those in that part alone.
+        const size_t start = 500, length = 700;
+        CHECK(matcher.hits_within(i, hits[i], start, length) ==
+              single_matcher.get_motif_hits(seq.substr(start, length)));
+    }
+}
+
+TEST_CASE(TEST_GROUP ": invalid motifs", TEST_GROUP) {
+    using Motifs = std::vector<std::pair<std::string, size_t>>;
+    CHECK_THROWS(dorado::modbase::MultiMotifMatcher(Motifs{{"CG", 2}}));
+    CHECK_THROWS(dorado::modbase::MultiMotifMatcher(Motifs{{"", 0}}));
+    CHECK_THROWS(dorado::modbase::MultiMotifMatcher(Motifs{{"CXG", 0}}));
+}
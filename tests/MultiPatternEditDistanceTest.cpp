@@ -0,0 +1,73 @@
+#include "TestUtils.h"
+#include "utils/multi_pattern_edit_distance.h"
+
+#include <catch2/catch.hpp>
+#include <edlib.h>
+
+#include <random>
+#include <string>
+#include <vector>
+
+#define CUT_TAG "[utils][MultiPatternEditDistance]"
+#define DEFINE_TEST(name) TEST_CASE(CUT_TAG " " name, CUT_TAG)
+
+using dorado::utils::MultiPatternEditDistance;
+
+namespace {
+
+int edlib_edit_distance(const std::string& pattern, const std::string& text) {
+    EdlibAlignConfig config = edlibDefaultAlignConfig();
+    config.mode = EDLIB_MODE_NW;
+    auto result = edlibAlign(pattern.data(), int(pattern.length()), text.data(),
+                             int(text.length()), config);
+    const int distance = result.editDistance;
+    edlibFreeAlignResult(result);
+    return distance;
+}
+
+}  // namespace
+
+DEFINE_TEST("Exact and inexact matches") {
+    const MultiPatternEditDistance patterns({"ACGTACGT", "ACGTTCGT", "TTTT", "ACGTACGTAA"});
+    const auto distances = patterns.edit_distances("ACGTACGT");
+    REQUIRE(distances.size() == 4);
+    CHECK(distances[0] == 0);
+    CHECK(distances[1] == 1);
+    CHECK(distances[2] == 6);
+    CHECK(distances[3] == 2);
+}
+
+DEFINE_TEST("Empty text") {
+    const MultiPatternEditDistance patterns({"ACGT", "A"});
+    CHECK(patterns.edit_distances("") == std::vector<int>{4, 1});
+}
+
+DEFINE_TEST("Matches edlib") {
+    // Pattern lengths either side of the lane width, and texts with characters which
+    // aren't in any pattern.
+    const size_t num_patterns = GENERATE(1, 7, 8, 9, 96);
+    const size_t pattern_length = GENERATE(1, 24, 39, 63, 64, 65, 100);
+    CAPTURE(num_patterns, pattern_length);
+
+    std::mt19937 rng(42);
+    std::vector<std::string> pattern_seqs;
+    for (size_t i = 0; i < num_patterns; ++i) {
+        pattern_seqs.push_back(generate_random_sequence_string(rng, pattern_length));
+    }
+    const MultiPatternEditDistance patterns(pattern_seqs);
+    REQUIRE(patterns.size() == num_patterns);
+
+    for (int i = 0; i < 10; ++i) {
+        const size_t text_length = rng() % (2 * pattern_length + 10);
+        auto text = generate_random_sequence_string(rng, text_length, "ACGTN");
+        if (i == 0) {
+            text = pattern_seqs.back();
+        }
+        const auto distances = patterns.edit_distances(text);
+        REQUIRE(distances.size() == num_patterns);
+        for (size_t p = 0; p < num_patterns; ++p) {
+            CAPTURE(text, pattern_seqs[p]);
+            CHECK(distances[p] == edlib_edit_distance(pattern_seqs[p], text));
+        }
+    }
+}
@@ -0,0 +1,98 @@
+#include "TestUtils.h"
+#include "utils/overlap_engine.h"
+#include "utils/sequence_utils.h"
+
+#include <catch2/catch.hpp>
+
+#include <random>
+#include <string>
+
+#define TEST_GROUP "[utils][overlap_engine]"
+
+using namespace dorado::utils;
+
+namespace {
+
+void check_same_overlap(const std::optional<OverlapResult>& lhs,
+                        const std::optional<OverlapResult>& rhs) {
+    REQUIRE(lhs.has_value() == rhs.has_value());
+    if (lhs) {
+        CHECK(lhs->query_start == rhs->query_start);
+        CHECK(lhs->query_end == rhs->query_end);
+        CHECK(lhs->target_start == rhs->target_start);
+        CHECK(lhs->target_end == rhs->target_end);
+        CHECK(lhs->mapq == rhs->mapq);
+        CHECK(lhs->rev == rhs->rev);
+    }
+}
+
+}  // namespace
+
+TEST_CASE(TEST_GROUP ": Cached indices give the same overlaps", TEST_GROUP) {
+    std::mt19937 rng(42);
+    const auto query = generate_random_sequence_string(rng, 5000);
+    const auto target1 = reverse_complement(query.substr(500, 4000));
+    const auto target2 = query.substr(1000, 3000);
+
+    OverlapEngine engine;
+    dorado::MmTbufPtr working_buffer;
+    const auto overlap1 = engine.compute_overlap(query, "query", target1, "t1", working_buffer);
+    const auto overlap2 = engine.compute_overlap(query, "query", target2, "t2", working_buffer);
+
+    check_same_overlap(overlap1, compute_overlap(query, "query", target1, "t1", working_buffer));
+    check_same_overlap(overlap2, compute_overlap(query, "query", target2, "t2", working_buffer));
+    REQUIRE(overlap1.has_value());
+    CHECK(overlap1->rev);
+
+    const auto stats = engine.sample_stats();
+    CHECK(stats.at("index_cache_misses") == 1);
+    CHECK(stats.at("index_cache_hits") == 1);
+    CHECK(stats.at("index_cache_entries") == 1);
+}
+
+TEST_CASE(TEST_GROUP ": A changed sequence is reindexed", TEST_GROUP) {
+    std::mt19937 rng(42);
+    const auto query1 = generate_random_sequence_string(rng, 5000);
+    const auto query2 = generate_random_sequence_string(rng, 5000);
+
+    OverlapEngine engine;
+    dorado::MmTbufPtr working_buffer;
+    CHECK(engine.compute_overlap(query1, "query", query1, "target", working_buffer));
+    // Same name, different sequence, so the cached index mustn't be used.
+    CHECK(!engine.compute_overlap(query2, "query", query1, "target", working_buffer));
+
+    const auto stats = engine.sample_stats();
+    CHECK(stats.at("index_cache_misses") == 2);
+    CHECK(stats.at("index_cache_hits") == 0);
+    CHECK(stats.at("index_cache_entries") == 1);
+}
+
+TEST_CASE(TEST_GROUP ": Least recently used indices are evicted", TEST_GROUP) {
+    std::mt19937 rng(42);
+    std::vector<std::string> queries;
+    for (int i = 0; i < 3; ++i) {
+        queries.push_back(generate_random_sequence_string(rng, 5000));
+    }
+
+    // Room for two indices of this size, but not three.
+    OverlapEngine sizing_engine;
+    dorado::MmTbufPtr working_buffer;
+    sizing_engine.compute_overlap(queries[0], "q0", queries[0], "target", working_buffer);
+    const auto index_bytes = size_t(sizing_engine.sample_stats().at("index_cache_bytes"));
+
+    OverlapEngine engine(index_bytes * 2);
+    engine.compute_overlap(queries[0], "q0", queries[0], "target", working_buffer);
+    engine.compute_overlap(queries[1], "q1", queries[1], "target", working_buffer);
+    // Use q0 again, so that q1 is the least recently used when q2 is added.
+    engine.compute_overlap(queries[0], "q0", queries[0], "target", working_buffer);
+    engine.compute_overlap(queries[2], "q2", queries[2], "target", working_buffer);
+    engine.compute_overlap(queries[0], "q0", queries[0], "target", working_buffer);
+    engine.compute_overlap(queries[1], "q1", queries[1], "target", working_buffer);
+
+    const auto stats = engine.sample_stats();
+    CHECK(stats.at("index_cache_hits") == 2);
+    CHECK(stats.at("index_cache_misses") == 4);
+    CHECK(stats.at("index_cache_evictions") == 2);
+    CHECK(stats.at("index_cache_entries") == 2);
+    CHECK(stats.at("index_cache_bytes") <= index_bytes * 2);
+}
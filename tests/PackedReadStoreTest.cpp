@@ -0,0 +1,123 @@
+#include "hts_io/PackedReadStore.h"
+
+#include "TestUtils.h"
+#include "read_pipeline/HtsWriter.h"
+#include "utils/hts_file.h"
+
+#include <catch2/catch.hpp>
+#include <htslib/sam.h>
+
+#include <random>
+#include <string>
+#include <vector>
+
+#define TEST_GROUP "[hts_io][PackedReadStore]"
+
+namespace dorado::hts_io::test {
+
+namespace {
+
+struct TestRead {
+    std::string name;
+    std::string seq;
+    std::vector<uint8_t> qual;
+};
+
+void write_fastq(const std::filesystem::path& path, const std::vector<TestRead>& reads) {
+    utils::HtsFile hts_file(path.string(), utils::HtsFile::OutputMode::FASTQ, 2, false);
+    HtsWriter writer(hts_file, "");
+    for (const auto& read : reads) {
+        BamPtr rec(bam_init1());
+        bam_set1(rec.get(), read.name.length(), read.name.c_str(), 4, -1, -1, 0, 0, nullptr, -1,
+                 -1, 0, read.seq.length(), read.seq.c_str(),
+                 reinterpret_cast<const char*>(read.qual.data()), 0);
+        writer.write(rec.get());
+    }
+    hts_file.finalise([](size_t) { /* noop */ });
+}
+
+}  // namespace
+
+TEST_CASE(TEST_GROUP " reads are returned as written", TEST_GROUP) {
+    auto temp_dir = tests::make_temp_dir("packed_read_store_test");
+    const auto fastq_path = temp_dir.m_path / "input.fq";
+
+    // Lengths either side of whole packed bytes, and bases which don't pack into 2 bits.
+    std::vector<TestRead> reads{
+            {"read1", "A", {10}},
+            {"read2", "ACGT", {1, 2, 3, 4}},
+            {"read3", "ACGTNACGTN", {0, 1, 2, 3, 4, 5, 6, 7, 8, 9}},
+            {"read4", "NNNNN", {50, 50, 50, 50, 50}},
+    };
+    std::minstd_rand rng(42);
+    for (size_t length : {1023, 1024, 1025, 20001}) {
+        TestRead read{"long" + std::to_string(length), {}, {}};
+        for (size_t i = 0; i < length; ++i) {
+            read.seq += "ACGTRYN"[rng() % 7];
+            read.qual.push_back(static_cast<uint8_t>(rng() % 60));
+        }
+        reads.push_back(std::move(read));
+    }
+    write_fastq(fastq_path, reads);
+
+    PackedReadStore store(fastq_path.string(), temp_dir.m_path);
+    REQUIRE(store.size() == reads.size());
+    std::string seq = "reused";
+    for (size_t i = 0; i < reads.size(); ++i) {
+        CAPTURE(i);
+        CHECK(store.name(i) == reads[i].name);
+        CHECK(store.find(reads[i].name) == i);
+        REQUIRE(store.length(i) == reads[i].seq.length());
+        CHECK(store.seq(i) == reads[i].seq);
+        store.get_seq(i, seq);
+        CHECK(seq == reads[i].seq);
+        const uint8_t* qual = store.qual(i);
+        CHECK(std::vector<uint8_t>(qual, qual + store.length(i)) == reads[i].qual);
+    }
+    CHECK_FALSE(store.find("missing").has_value());
+}
+
+TEST_CASE(TEST_GROUP " store file is cleaned up", TEST_GROUP) {
+    auto temp_dir = tests::make_temp_dir("packed_read_store_cleanup_test");
+    const auto input_dir = temp_dir.m_path / "input";
+    const auto store_dir = temp_dir.m_path / "store";
+    std::filesystem::create_directories(input_dir);
+    std::filesystem::create_directories(store_dir);
+    const auto fastq_path = input_dir / "input.fq";
+    write_fastq(fastq_path, {{"read", "ACGT", {1, 2, 3, 4}}});
+
+    {
+        PackedReadStore store(fastq_path.string(), store_dir);
+        CHECK(store.seq(0) == "ACGT");
+    }
+    CHECK(std::filesystem::is_empty(store_dir));
+}
+
+TEST_CASE(TEST_GROUP " store file fits in the estimated space", TEST_GROUP) {
+    auto temp_dir = tests::make_temp_dir("packed_read_store_estimate_test");
+    const auto fastq_path = temp_dir.m_path / "input.fq";
+
+    std::vector<TestRead> reads;
+    std::minstd_rand rng(42);
+    for (size_t length : {1, 101, 5000, 20001}) {
+        TestRead read{"read" + std::to_string(length), {}, {}};
+        for (size_t i = 0; i < length; ++i) {
+            read.seq += "ACGT"[rng() % 4];
+            read.qual.push_back(static_cast<uint8_t>(rng() % 60));
+        }
+        reads.push_back(std::move(read));
+    }
+    write_fastq(fastq_path, reads);
+
+    // The store holds each read's bases packed 4 to a byte, followed by its qualities.
+    uint64_t store_bytes = 0;
+    for (const auto& read : reads) {
+        store_bytes += (read.seq.length() + 3) / 4 + read.seq.length();
+    }
+    const uint64_t estimated_bytes = PackedReadStore::estimate_file_bytes(fastq_path);
+    CHECK(store_bytes <= estimated_bytes);
+    // It shouldn't be so generous that it rejects directories with enough space.
+    CHECK(estimated_bytes < store_bytes + store_bytes / 10);
+}
+
+}  // namespace dorado::hts_io::test
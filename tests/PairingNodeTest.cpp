@@ -3,13 +3,17 @@
 #include "MessageSinkUtils.h"
 #include "TestUtils.h"
 #include "read_pipeline/DefaultClientInfo.h"
+#include "utils/sequence_sketch.h"
 #include "utils/sequence_utils.h"
 #include "utils/time_utils.h"
+#include "utils/types.h"
 
 #include <ATen/Functions.h>
 #include <catch2/catch.hpp>
 
 #include <filesystem>
+#include <string>
+#include <vector>
 
 #define TEST_GROUP "[PairingNodeTest]"
 
@@ -97,3 +101,44 @@ TEST_CASE("Split read pairing", TEST_GROUP) {
             });
     CHECK(num_pairs == 2);
 }
+
+TEST_CASE("Sketch prefilter keeps every pair found by alignment", TEST_GROUP) {
+    // The duplex fixtures: a stereo template/complement pair, and the truncated reverse
+    // complement used for the mapping pathway above.
+    const std::string long_target =
+            ReadFileIntoString(std::filesystem::path(get_aligner_data_dir()) / "long_target.fa");
+    const auto long_target_rc = dorado::utils::reverse_complement(long_target);
+    const std::vector<std::string> seqs{
+            ReadFileIntoString(std::filesystem::path(get_stereo_data_dir()) / "template_seq"),
+            ReadFileIntoString(std::filesystem::path(get_stereo_data_dir()) / "complement_seq"),
+            long_target,
+            long_target_rc.substr(0, size_t(long_target.length() * 0.8f)),
+    };
+
+    std::vector<dorado::utils::SequenceSketch> sketches;
+    for (const auto& seq : seqs) {
+        sketches.push_back(dorado::utils::sketch_sequence(seq));
+    }
+
+    // Every reverse strand hit minimap2 could accept as a pair must survive the prefilter.
+    dorado::MmTbufPtr working_buffer;
+    int num_overlaps = 0;
+    for (size_t temp = 0; temp < seqs.size(); ++temp) {
+        for (size_t comp = 0; comp < seqs.size(); ++comp) {
+            if (temp == comp) {
+                continue;
+            }
+            const auto overlap =
+                    dorado::utils::compute_overlap(seqs[temp], std::to_string(temp), seqs[comp],
+                                                   std::to_string(comp), working_buffer);
+            if (!overlap || !overlap->rev) {
+                continue;
+            }
+            CAPTURE(temp, comp);
+            CHECK(dorado::utils::may_have_rc_overlap(sketches[temp], sketches[comp]));
+            ++num_overlaps;
+        }
+    }
+    // Both pairs overlap, in either order.
+    CHECK(num_overlaps >= 4);
+}
@@ -102,6 +102,35 @@ TEST_CASE(TEST_GROUP "Load data sorted by channel id.") {
     }
 }
 
+TEST_CASE(TEST_GROUP "Signal is loaded lazily.") {
+    auto data_path = get_data_dir("multi_read_pod5");
+
+    dorado::PipelineDescriptor pipeline_desc;
+    std::vector<dorado::Message> messages;
+    pipeline_desc.add_node<MessageSinkToVector>({}, 100, messages);
+    auto pipeline = dorado::Pipeline::create(std::move(pipeline_desc), nullptr);
+
+    {
+        dorado::DataLoader loader(*pipeline, "cpu", 1, 0, std::nullopt, {});
+        loader.load_reads(data_path, true, dorado::ReadOrder::UNRESTRICTED);
+    }
+    pipeline.reset();
+    REQUIRE(!messages.empty());
+
+    // The loader and file have gone, but the reads can still load their signal.
+    for (auto& message : messages) {
+        const auto& read_common = dorado::get_read_common_data(message);
+        CHECK(!read_common.raw_data.defined());
+        REQUIRE(read_common.raw_data_loader);
+
+        dorado::materialise_read_raw_data(message);
+        CHECK(!read_common.raw_data_loader);
+        REQUIRE(read_common.raw_data.defined());
+        CHECK(read_common.raw_data.dtype() == at::kShort);
+        CHECK(read_common.get_raw_data_samples() == read_common.attributes.num_samples);
+    }
+}
+
 TEST_CASE(TEST_GROUP "Test loading POD5 file with read ignore list") {
     auto data_path = get_data_dir("multi_read_pod5");
 
@@ -0,0 +1,69 @@
+#include "utils/radix_sort.h"
+
+#include <catch2/catch.hpp>
+
+#include <cstdint>
+#include <map>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Compares sorting the HtsFile sort buffer with radix_sort against the std::multimap it
+// replaced.  These are hidden, so run them explicitly with: dorado_tests "[benchmark]"
+
+#define CUT_TAG "[radix_sort][.][benchmark]"
+
+using dorado::utils::radix_sort;
+
+namespace {
+
+struct BufferEntry {
+    uint64_t sorting_key;
+    int64_t offset;
+};
+
+// Keys laid out like HtsFile::calculate_sorting_key, with a handful of references and
+// positions spread over a human-sized genome.
+std::vector<BufferEntry> make_entries(size_t count) {
+    std::mt19937_64 rng(42);
+    std::uniform_int_distribution<uint64_t> tid_dist(0, 24);
+    std::uniform_int_distribution<uint64_t> pos_dist(0, 250000000);
+    std::vector<BufferEntry> entries(count);
+    int64_t offset = 0;
+    for (auto& entry : entries) {
+        entry = {(tid_dist(rng) << 32) | pos_dist(rng), offset};
+        offset += 4096;
+    }
+    return entries;
+}
+
+}  // namespace
+
+TEST_CASE("HtsFile sort buffer", CUT_TAG) {
+    // The default 20 MB buffer holds a few thousand reads, multi-GB buffers millions.
+    for (size_t count : {size_t{5000}, size_t{100000}, size_t{2000000}}) {
+        const auto entries = make_entries(count);
+        const auto suffix = " records=" + std::to_string(count);
+
+        BENCHMARK("std::multimap" + suffix) {
+            // Insertion is included, since that's where the multimap does its sorting.
+            std::multimap<uint64_t, int64_t> buffer_map;
+            for (const auto& entry : entries) {
+                buffer_map.insert({entry.sorting_key, entry.offset});
+            }
+            return buffer_map.begin()->second;
+        };
+
+        std::vector<BufferEntry> scratch;
+        BENCHMARK("radix_sort" + suffix) {
+            std::vector<BufferEntry> buffer_entries;
+            for (const auto& entry : entries) {
+                buffer_entries.push_back(entry);
+            }
+            radix_sort(buffer_entries, scratch,
+                       [](const BufferEntry& entry) { return entry.sorting_key; });
+            return buffer_entries.front().offset;
+        };
+    }
+}
@@ -0,0 +1,75 @@
+#include "utils/radix_sort.h"
+
+#include <catch2/catch.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#define TEST_GROUP "[radix_sort]"
+
+using dorado::utils::radix_sort;
+
+namespace {
+
+struct Entry {
+    uint64_t key;
+    size_t index;
+    bool operator==(const Entry& other) const {
+        return key == other.key && index == other.index;
+    }
+};
+
+uint64_t get_key(const Entry& entry) { return entry.key; }
+
+std::vector<Entry> make_entries(size_t count, uint64_t key_mask, unsigned seed) {
+    std::mt19937_64 rng(seed);
+    std::vector<Entry> entries(count);
+    for (size_t i = 0; i < count; ++i) {
+        entries[i] = {rng() & key_mask, i};
+    }
+    return entries;
+}
+
+}  // namespace
+
+TEST_CASE("radix_sort: empty and single item", TEST_GROUP) {
+    std::vector<Entry> entries, scratch;
+    radix_sort(entries, scratch, get_key);
+    CHECK(entries.empty());
+
+    entries.push_back({42, 0});
+    radix_sort(entries, scratch, get_key);
+    REQUIRE(entries.size() == 1);
+    CHECK(entries[0].key == 42);
+}
+
+TEST_CASE("radix_sort: matches std::stable_sort", TEST_GROUP) {
+    // Masks giving many duplicate keys, keys with constant high bytes as with BAM sorting
+    // keys, and full width keys.
+    const uint64_t key_mask = GENERATE(uint64_t{0xf}, uint64_t{0x0000000f0000ffff},
+                                       uint64_t{0xffffffffffffffff});
+    const size_t count = GENERATE(2, 100, 10000);
+    auto entries = make_entries(count, key_mask, 42);
+    auto expected = entries;
+    std::stable_sort(expected.begin(), expected.end(),
+                     [](const Entry& lhs, const Entry& rhs) { return lhs.key < rhs.key; });
+
+    std::vector<Entry> scratch;
+    radix_sort(entries, scratch, get_key);
+
+    CHECK(entries == expected);
+}
+
+TEST_CASE("radix_sort: reusing the scratch buffer", TEST_GROUP) {
+    std::vector<Entry> scratch;
+    for (unsigned seed = 0; seed < 3; ++seed) {
+        auto entries = make_entries(1000, 0xffff, seed);
+        auto expected = entries;
+        std::stable_sort(expected.begin(), expected.end(),
+                         [](const Entry& lhs, const Entry& rhs) { return lhs.key < rhs.key; });
+        radix_sort(entries, scratch, get_key);
+        CHECK(entries == expected);
+    }
+}
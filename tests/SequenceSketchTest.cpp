@@ -0,0 +1,65 @@
+#include "TestUtils.h"
+#include "utils/sequence_sketch.h"
+#include "utils/sequence_utils.h"
+
+#include <catch2/catch.hpp>
+
+#include <random>
+#include <string>
+
+#define TEST_GROUP "[seq_utils][sequence_sketch]"
+
+using namespace dorado::utils;
+
+TEST_CASE(TEST_GROUP ": Reverse complement sequences share minimizers", TEST_GROUP) {
+    std::mt19937 rng(42);
+    const auto seq = generate_random_sequence_string(rng, 5000);
+    const auto sketch = sketch_sequence(seq);
+    const auto rc_sketch = sketch_sequence(reverse_complement(seq));
+
+    CHECK(!sketch.forward.empty());
+    CHECK(!sketch.reverse.empty());
+    // Canonical k-mers swap strands under reverse complementation.
+    CHECK(sketch.forward == rc_sketch.reverse);
+    CHECK(sketch.reverse == rc_sketch.forward);
+    CHECK(count_shared_rc_minimizers(sketch, rc_sketch) ==
+          sketch.forward.size() + sketch.reverse.size());
+}
+
+TEST_CASE(TEST_GROUP ": Same strand and unrelated sequences share few minimizers", TEST_GROUP) {
+    std::mt19937 rng(42);
+    const auto seq = generate_random_sequence_string(rng, 5000);
+    const auto sketch = sketch_sequence(seq);
+
+    const auto unrelated = reverse_complement(generate_random_sequence_string(rng, 5000));
+
+    CHECK(count_shared_rc_minimizers(sketch, sketch) < 5);
+    CHECK(count_shared_rc_minimizers(sketch, sketch_sequence(unrelated)) < 5);
+}
+
+TEST_CASE(TEST_GROUP ": A short shared region always shares a minimizer", TEST_GROUP) {
+    std::mt19937 rng(42);
+    for (int i = 0; i < 100; ++i) {
+        auto seq1 = generate_random_sequence_string(rng, 200);
+        auto seq2 = generate_random_sequence_string(rng, 200);
+        const auto shared = generate_random_sequence_string(rng, SequenceSketch::window_length());
+        seq1.replace(50, shared.size(), shared);
+        seq2.replace(120, shared.size(), reverse_complement(shared));
+        CHECK(count_shared_rc_minimizers(sketch_sequence(seq1), sketch_sequence(seq2)) > 0);
+    }
+}
+
+TEST_CASE(TEST_GROUP ": Short and ambiguous sequences", TEST_GROUP) {
+    const auto empty = sketch_sequence("");
+    CHECK(empty.forward.empty());
+    CHECK(empty.reverse.empty());
+
+    const auto short_sketch = sketch_sequence("ACGTACGTAC");
+    CHECK(short_sketch.forward.empty());
+    CHECK(short_sketch.reverse.empty());
+
+    // N breaks up k-mers, so a run of Ns between short stretches gives no minimizers.
+    const auto n_sketch = sketch_sequence("ACGTACGTACNNNNNNNNNNACGTACGTAC");
+    CHECK(n_sketch.forward.empty());
+    CHECK(n_sketch.reverse.empty());
+}
@@ -0,0 +1,122 @@
+#include "torch_utils/signal_arena.h"
+
+#include <ATen/ATen.h>
+#include <catch2/catch.hpp>
+
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#define CUT_TAG "[SignalArena]"
+
+using dorado::utils::SignalArena;
+
+TEST_CASE(CUT_TAG ": allocations are rounded up to a size class", CUT_TAG) {
+    CHECK(SignalArena::size_class_bytes(1) == 16 * 1024);
+    CHECK(SignalArena::size_class_bytes(16 * 1024) == 16 * 1024);
+    CHECK(SignalArena::size_class_bytes(16 * 1024 + 1) == 20 * 1024);
+    CHECK(SignalArena::size_class_bytes(100 * 1000) == 112 * 1024);
+    CHECK(SignalArena::size_class_bytes(64 * 1024 * 1024) == 64 * 1024 * 1024);
+    CHECK(SignalArena::size_class_bytes(64 * 1024 * 1024 + 1) == 0);
+}
+
+TEST_CASE(CUT_TAG ": freed slabs are reused", CUT_TAG) {
+    auto arena = SignalArena::create({});
+
+    const void* first_data = nullptr;
+    {
+        auto samples = arena->allocate(4000, at::kShort);
+        CHECK(samples.sizes().vec() == std::vector<int64_t>{4000});
+        CHECK(samples.dtype() == at::kShort);
+        samples.fill_(7);
+        first_data = samples.data_ptr();
+
+        auto stats = arena->sample_stats();
+        CHECK(stats.at("bytes_in_use") == 16 * 1024);
+        CHECK(stats.at("bytes_cached") == 0);
+    }
+
+    auto stats = arena->sample_stats();
+    CHECK(stats.at("bytes_in_use") == 0);
+    CHECK(stats.at("bytes_cached") == 16 * 1024);
+
+    // Same size class, so gets the same slab back.
+    auto samples = arena->allocate(8000, at::kShort);
+    CHECK(samples.data_ptr() == first_data);
+    stats = arena->sample_stats();
+    CHECK(stats.at("allocations") == 2);
+    CHECK(stats.at("allocations_avoided") == 1);
+    CHECK(stats.at("bytes_cached") == 0);
+
+    // Different size class, so needs a new slab.
+    auto big_samples = arena->allocate(100000, at::kShort);
+    CHECK(big_samples.data_ptr() != first_data);
+    CHECK(arena->sample_stats().at("allocations_avoided") == 1);
+}
+
+TEST_CASE(CUT_TAG ": slices keep the slab in use", CUT_TAG) {
+    auto arena = SignalArena::create({});
+    at::Tensor slice;
+    {
+        auto samples = arena->allocate(4000, at::kShort);
+        slice = samples.slice(0, 100, 200);
+    }
+    CHECK(arena->sample_stats().at("bytes_in_use") == 16 * 1024);
+    slice = at::Tensor();
+    CHECK(arena->sample_stats().at("bytes_in_use") == 0);
+}
+
+TEST_CASE(CUT_TAG ": oversize allocations bypass the arena", CUT_TAG) {
+    auto arena = SignalArena::create({});
+    {
+        auto samples = arena->allocate(40 * 1024 * 1024, at::kShort);
+        CHECK(samples.numel() == 40 * 1024 * 1024);
+    }
+    const auto stats = arena->sample_stats();
+    CHECK(stats.at("oversize_allocations") == 1);
+    CHECK(stats.at("bytes_in_use") == 0);
+    CHECK(stats.at("bytes_cached") == 0);
+}
+
+TEST_CASE(CUT_TAG ": cached bytes are capped", CUT_TAG) {
+    SignalArena::Options options;
+    options.max_cached_bytes = 40 * 1024;
+    auto arena = SignalArena::create(options);
+    {
+        std::vector<at::Tensor> tensors;
+        for (int i = 0; i < 4; ++i) {
+            tensors.push_back(arena->allocate(8000, at::kShort));
+        }
+    }
+    const auto stats = arena->sample_stats();
+    CHECK(stats.at("bytes_cached") == 32 * 1024);
+    CHECK(stats.at("slabs_released") == 2);
+}
+
+TEST_CASE(CUT_TAG ": tensors outlive the arena", CUT_TAG) {
+    auto arena = SignalArena::create({});
+    auto samples = arena->allocate(1000, at::kFloat);
+    arena.reset();
+    samples.fill_(1.0f);
+    CHECK(samples.sum().item<float>() == 1000.0f);
+}
+
+TEST_CASE(CUT_TAG ": concurrent allocate and free", CUT_TAG) {
+    auto arena = SignalArena::create({});
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&arena, t] {
+            for (int i = 0; i < 1000; ++i) {
+                auto samples = arena->allocate(1000 + (i * 37 + t) % 20000, at::kShort);
+                samples[0] = int16_t(i);
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    const auto stats = arena->sample_stats();
+    CHECK(stats.at("allocations") == 4000);
+    CHECK(stats.at("bytes_in_use") == 0);
+    CHECK(stats.at("allocations_avoided") > 0);
+}
@@ -87,4 +87,14 @@ std::string generate_random_sequence_string(int len) {
     return read;
 }
 
+std::string generate_random_sequence_string(std::mt19937& rng,
+                                            size_t len,
+                                            std::string_view alphabet) {
+    std::string read(len, ' ');
+    for (auto& base : read) {
+        base = alphabet[rng() % alphabet.size()];
+    }
+    return read;
+}
+
 }  // namespace dorado::tests
@@ -4,7 +4,9 @@
 
 #include <cstring>
 #include <filesystem>
+#include <random>
 #include <string>
+#include <string_view>
 #include <vector>
 
 namespace dorado::tests {
@@ -76,6 +78,11 @@ public:
 
 std::string generate_random_sequence_string(int len);
 
+// Reproducible from the state of rng, with bases drawn uniformly from alphabet.
+std::string generate_random_sequence_string(std::mt19937& rng,
+                                            size_t len,
+                                            std::string_view alphabet = "ACGT");
+
 }  // namespace dorado::tests
 
 using namespace dorado::tests;
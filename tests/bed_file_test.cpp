@@ -5,8 +5,10 @@
 
 #include <catch2/catch.hpp>
 
+#include <random>
 #include <sstream>
 #include <string>
+#include <vector>
 
 #define CUT_TAG "[dorado::alignment::BedFile]"
 
@@ -268,4 +270,59 @@ TEST_CASE(CUT_TAG " load from stream. Parameterised testing.", CUT_TAG) {
     CHECK(entries[0] == BedFile::Entry{line, start, end, strand});
 }
 
+TEST_CASE(CUT_TAG " overlapping_entries returns overlaps in file order", CUT_TAG) {
+    dorado::alignment::BedFile cut{};
+    std::istringstream input_stream{LAMBDA_2.bed_line + "\n" + RANDOM_1.bed_line + "\n" +
+                                    LAMBDA_1.bed_line};
+    REQUIRE(cut.load(input_stream));
+
+    auto check_overlaps = [&](size_t first, size_t last, const BedFile::Entries& expected) {
+        CAPTURE(first, last);
+        const auto overlaps = cut.overlapping_entries("Lambda", first, last);
+        REQUIRE(overlaps.size() == expected.size());
+        for (size_t i = 0; i < overlaps.size(); ++i) {
+            CHECK(*overlaps[i] == expected[i]);
+        }
+    };
+    check_overlaps(0, 100, {});
+    check_overlaps(0, 1234, {LAMBDA_1});
+    check_overlaps(2345, 3456, {LAMBDA_2, LAMBDA_1});
+    check_overlaps(2346, 3455, {});
+    check_overlaps(4000, 10000, {LAMBDA_2});
+    CHECK(cut.overlapping_entries("Unknown", 0, 10000).empty());
+}
+
+TEST_CASE(CUT_TAG " overlapping_entries matches a linear scan", CUT_TAG) {
+    const size_t num_entries = GENERATE(1, 2, 7, 16, 17, 100, 1000);
+    CAPTURE(num_entries);
+
+    // Mostly short intervals, with some long ones that overlap many others.
+    std::minstd_rand rng(42);
+    std::string bed_lines;
+    for (size_t i = 0; i < num_entries; ++i) {
+        const size_t start = rng() % 100000;
+        const size_t length = (i % 10 == 0) ? rng() % 20000 : rng() % 1000;
+        bed_lines += "chr1\t" + std::to_string(start) + "\t" + std::to_string(start + length) +
+                     "\tentry" + std::to_string(i) + "\n";
+    }
+    dorado::alignment::BedFile cut{};
+    std::istringstream input_stream{bed_lines};
+    REQUIRE(cut.load(input_stream));
+    const auto& entries = cut.entries("chr1");
+    REQUIRE(entries.size() == num_entries);
+
+    for (int query = 0; query < 200; ++query) {
+        const size_t first = rng() % 110000;
+        const size_t last = first + rng() % 5000;
+        std::vector<const BedFile::Entry*> expected;
+        for (const auto& entry : entries) {
+            if (entry.start <= last && entry.end >= first) {
+                expected.push_back(&entry);
+            }
+        }
+        CAPTURE(first, last);
+        CHECK(cut.overlapping_entries("chr1", first, last) == expected);
+    }
+}
+
 }  // namespace dorado::alignment::bed_file::test
\ No newline at end of file
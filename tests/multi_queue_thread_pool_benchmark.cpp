@@ -0,0 +1,81 @@
+#include "utils/concurrency/multi_queue_thread_pool.h"
+#include "utils/concurrency/synchronisation.h"
+
+#include <catch2/catch.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Stress benchmark of task throughput against pool size.
+// These are hidden, so run them explicitly with: dorado_tests "[benchmark]"
+
+#define CUT_TAG "[dorado::utils::concurrency::MultiQueueThreadPool][.][benchmark]"
+
+namespace dorado::utils::concurrency::multi_queue_thread_pool_benchmark {
+
+namespace {
+
+constexpr std::size_t NUM_TASKS{200000};
+
+// Pushes NUM_TASKS trivial tasks through the pool, split between num_producers
+// producer threads each with their own queue, and waits for them all to run.
+// Returns the number of tasks run so that the work can't be optimised away.
+std::size_t run_tasks(const std::vector<MultiQueueThreadPool::ThreadPoolQueue*>& task_queues) {
+    const std::size_t num_producers = task_queues.size();
+    const std::size_t tasks_per_producer = NUM_TASKS / num_producers;
+    const std::size_t total_tasks = tasks_per_producer * num_producers;
+    // Only the last task touches the latch, so that it doesn't become the bottleneck.
+    Latch all_tasks_run{1};
+    std::atomic<std::size_t> num_run{0};
+
+    std::vector<std::thread> producers;
+    for (auto* task_queue : task_queues) {
+        producers.emplace_back(
+                [task_queue, tasks_per_producer, total_tasks, &all_tasks_run, &num_run] {
+                    for (std::size_t i{0}; i < tasks_per_producer; ++i) {
+                        task_queue->push([total_tasks, &all_tasks_run, &num_run] {
+                            if (num_run.fetch_add(1) + 1 == total_tasks) {
+                                all_tasks_run.count_down();
+                            }
+                        });
+                    }
+                });
+    }
+    for (auto& producer : producers) {
+        producer.join();
+    }
+    all_tasks_run.wait();
+    return num_run.load();
+}
+
+}  // namespace
+
+TEST_CASE("MultiQueueThreadPool task throughput", CUT_TAG) {
+    const std::size_t num_producers = GENERATE(1, 4);
+    const std::size_t max_threads = std::max(2u, std::thread::hardware_concurrency());
+    for (std::size_t num_threads{1}; num_threads <= max_threads; num_threads *= 2) {
+        MultiQueueThreadPool pool{num_threads, "benchmark"};
+        std::vector<MultiQueueThreadPool::ThreadPoolQueue*> task_queues;
+        for (std::size_t i{0}; i < num_producers; ++i) {
+            task_queues.push_back(&pool.create_task_queue(TaskPriority::normal));
+        }
+
+        const auto suffix = " producers=" + std::to_string(num_producers) +
+                            " threads=" + std::to_string(num_threads);
+        BENCHMARK("tasks=" + std::to_string(NUM_TASKS) + suffix) {
+            return run_tasks(task_queues);
+        };
+
+        // Catch reports the time per run, so report the rate directly as well.
+        const auto start = std::chrono::steady_clock::now();
+        const auto num_run = run_tasks(task_queues);
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        WARN("tasks/sec" << suffix << ": " << num_run / elapsed.count());
+    }
+}
+
+}  // namespace dorado::utils::concurrency::multi_queue_thread_pool_benchmark
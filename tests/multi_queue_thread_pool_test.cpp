@@ -123,6 +123,38 @@ DEFINE_TEST("ThreadPoolQueue::push() invokes task on separate thread") {
     REQUIRE(invocation_thread != std::this_thread::get_id());
 }
 
+DEFINE_TEST("ThreadPoolQueue::push() from multiple producers invokes every task") {
+    constexpr std::size_t num_producers{4};
+    constexpr std::size_t tasks_per_producer{1000};
+    MultiQueueThreadPool cut{4, "test_executor"};
+    Latch all_tasks_invoked{num_producers * tasks_per_producer};
+
+    std::vector<std::thread> producer_threads{};
+    for (std::size_t index{0}; index < num_producers; ++index) {
+        auto& task_queue = cut.create_task_queue(TaskPriority::normal);
+        producer_threads.emplace_back([&task_queue, &all_tasks_invoked] {
+            for (std::size_t task_index{0}; task_index < tasks_per_producer; ++task_index) {
+                task_queue.push([&all_tasks_invoked] { all_tasks_invoked.count_down(); });
+            }
+        });
+    }
+    for (auto& producer_thread : producer_threads) {
+        producer_thread.join();
+    }
+
+    REQUIRE(all_tasks_invoked.wait_for(TIMEOUT));
+}
+
+DEFINE_TEST("ThreadPoolQueue::push() from a pool thread invokes the task") {
+    MultiQueueThreadPool cut{1, "test_executor"};
+    auto& task_queue = cut.create_task_queue(TaskPriority::normal);
+
+    Flag invoked{};
+    task_queue.push([&task_queue, &invoked] { task_queue.push([&invoked] { invoked.signal(); }); });
+
+    REQUIRE(invoked.wait_for(TIMEOUT));
+}
+
 DEFINE_TEST("MultiQueueThreadPool::join() with 2 active threads completes") {
     constexpr std::size_t num_threads{2};
     MultiQueueThreadPool cut{num_threads, "test_executor"};
@@ -173,4 +205,25 @@ DEFINE_TEST_FIXTURE_METHOD(
     REQUIRE(task_started_flags[2]->wait_for(TIMEOUT));
 }
 
+DEFINE_TEST_FIXTURE_METHOD(
+        "ThreadPoolQueue::push() normal priority with pool size 2 and 2 busy high tasks then only "
+        "one normal task is invoked") {
+    auto& high_task_queue = cut->create_task_queue(TaskPriority::high);
+    high_task_queue.push(create_task(0));
+    high_task_queue.push(create_task(1));
+    REQUIRE(task_started_flags[0]->wait_for(TIMEOUT));
+    REQUIRE(task_started_flags[1]->wait_for(TIMEOUT));
+
+    auto& normal_task_queue = cut->create_task_queue(TaskPriority::normal);
+    normal_task_queue.push(create_task(2));
+    normal_task_queue.push(create_task(3));
+
+    // Only max(1, 2/4) expansion threads are available to normal tasks.
+    REQUIRE(task_started_flags[2]->wait_for(TIMEOUT));
+    CHECK_FALSE(task_started_flags[3]->wait_for(FAST_TIMEOUT));
+
+    task_release_flags[2]->signal();
+    REQUIRE(task_started_flags[3]->wait_for(TIMEOUT));
+}
+
 }  // namespace dorado::utils::concurrency::multi_queue_thread_pool
\ No newline at end of file
@@ -0,0 +1,64 @@
+#include "TestUtils.h"
+#include "splitter/myers.h"
+
+#include <catch2/catch.hpp>
+#include <edlib.h>
+
+#include <optional>
+#include <random>
+#include <string>
+
+// Compares myers_align_best() against the edlib searches it replaced in the duplex splitter.
+// These are hidden, so run them explicitly with: dorado_tests "[benchmark]"
+
+#define CUT_TAG "[myers][.][benchmark]"
+
+using dorado::splitter::myers_align_best;
+
+namespace {
+
+// A read with a noisy copy of query in the middle.
+std::string make_read(std::mt19937& rng, const std::string& query, size_t length) {
+    auto read = generate_random_sequence_string(rng, length);
+    const auto insert_pos = length / 2;
+    for (size_t i = 0; i < query.size(); ++i) {
+        read[insert_pos + i] = rng() % 10 == 0 ? "ACGT"[rng() % 4] : query[i];
+    }
+    return read;
+}
+
+std::optional<int> edlib_align_best(const std::string& query,
+                                    const std::string& read,
+                                    int max_edist) {
+    auto edlib_cfg = edlibNewAlignConfig(max_edist, EDLIB_MODE_HW, EDLIB_TASK_LOC, nullptr, 0);
+    auto edlib_result = edlibAlign(query.data(), int(query.size()), read.data(), int(read.size()),
+                                   edlib_cfg);
+    std::optional<int> start;
+    if (edlib_result.editDistance != -1) {
+        start = edlib_result.startLocations[0];
+    }
+    edlibFreeAlignResult(edlib_result);
+    return start;
+}
+
+}  // namespace
+
+TEST_CASE("Best match in a read", CUT_TAG) {
+    std::mt19937 rng(42);
+    // Adapter sized queries, as used by the splitter, and template regions longer than a word.
+    for (size_t query_len : {size_t{30}, size_t{200}}) {
+        const auto query = generate_random_sequence_string(rng, query_len);
+        const auto max_edist = int(query_len / 6);
+        for (size_t read_len : {size_t{1000}, size_t{20000}, size_t{100000}}) {
+            const auto read = make_read(rng, query, read_len);
+            const auto suffix =
+                    " query=" + std::to_string(query_len) + " read=" + std::to_string(read_len);
+
+            BENCHMARK("edlib" + suffix) { return edlib_align_best(query, read, max_edist); };
+
+            BENCHMARK("myers_align_best" + suffix) {
+                return myers_align_best(query, read, max_edist);
+            };
+        }
+    }
+}
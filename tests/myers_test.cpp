@@ -1,12 +1,18 @@
+#include "TestUtils.h"
 #include "splitter/myers.h"
 
 #include <catch2/catch.hpp>
+#include <edlib.h>
+
+#include <random>
+#include <string>
 
 #define CUT_TAG "[myers]"
 #define DEFINE_TEST(name) TEST_CASE(CUT_TAG " " name, CUT_TAG)
 
 using dorado::splitter::EdistResult;
 using dorado::splitter::myers_align;
+using dorado::splitter::myers_align_best;
 
 DEFINE_TEST("Basic alignment, single hit") {
     const std::string_view query = "AAA";
@@ -93,3 +99,43 @@ DEFINE_TEST("Complex alignment, doesn't crash when high edist near start") {
     const auto alignments = myers_align(query, seq, max_edist);
     CHECK(!alignments.empty());
 }
+
+DEFINE_TEST("Best alignment matches edlib") {
+    // Queries either side of a word, so that the blocked search is covered.
+    const auto query_len = GENERATE(20, 64, 65, 150);
+    CAPTURE(query_len);
+
+    std::mt19937 rng(42);
+
+    for (int i = 0; i < 50; i++) {
+        const auto query = generate_random_sequence_string(rng, query_len);
+        auto seq = generate_random_sequence_string(rng, 3 * query_len);
+        // Plant a noisy copy of the query.
+        for (int pos = 0; pos < query_len; pos++) {
+            if (rng() % 8 != 0) {
+                seq[query_len + pos] = query[pos];
+            }
+        }
+        const int max_edist = query_len / 4;
+        CAPTURE(query, seq, max_edist);
+
+        auto edlib_cfg = edlibNewAlignConfig(max_edist, EDLIB_MODE_HW, EDLIB_TASK_LOC, nullptr, 0);
+        auto edlib_result = edlibAlign(query.data(), int(query.size()), seq.data(),
+                                       int(seq.size()), edlib_cfg);
+        const auto alignment = myers_align_best(query, seq, max_edist);
+
+        REQUIRE(alignment.has_value() == (edlib_result.editDistance != -1));
+        if (alignment) {
+            CHECK(alignment->begin == std::size_t(edlib_result.startLocations[0]));
+            CHECK(alignment->end == std::size_t(edlib_result.endLocations[0] + 1));
+            CHECK(alignment->edist == std::size_t(edlib_result.editDistance));
+        }
+        edlibFreeAlignResult(edlib_result);
+    }
+}
+
+DEFINE_TEST("Best alignment, no hit") {
+    const std::string_view query = "AAAAAAAA";
+    const std::string_view seq = "CCCCCCCCCCCCCCCC";
+    CHECK(!myers_align_best(query, seq, 3).has_value());
+}